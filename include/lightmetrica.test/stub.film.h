@@ -42,10 +42,13 @@ public:
 	virtual void RecordContribution( const Math::Vec2& rasterPos, const Math::Vec3& contrb ) {}
 	virtual void AccumulateContribution( const Math::Vec2& rasterPos, const Math::Vec3& contrb ) {}
 	virtual void AccumulateContribution( const Film& film ) {}
+	virtual void AccumulateContributions( const Splat* splats, size_t n, const Math::Float& weight ) {}
 	virtual void Rescale( const Math::Float& weight ) {}
 	virtual bool Load( const ConfigNode& node, const Assets& assets ) { return true; }
 	virtual Film* Clone() const { return nullptr; }
 	virtual void Clear() {}
+	virtual void SetSharedMode(bool enable) {}
+	virtual void Flush() {}
 
 };
 
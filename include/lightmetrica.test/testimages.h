@@ -0,0 +1,132 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef LIB_LIGHTMETRICA_TEST_TEST_IMAGES_H
+#define LIB_LIGHTMETRICA_TEST_TEST_IMAGES_H
+
+#include "common.h"
+
+LM_NAMESPACE_BEGIN
+LM_TEST_NAMESPACE_BEGIN
+
+/*!
+	Test image.
+	Contents of an image file.
+*/
+struct TestImage
+{
+	const unsigned char* data;		//!< Contents of the file
+	unsigned int length;			//!< Length of the contents in bytes
+};
+
+/*!
+	Test images.
+	A collection of test images shared by the texture tests.
+	Every image consists of 2x2 texels of white, red, blue, and black in row major order.
+*/
+class TestImages
+{
+private:
+
+	TestImages();
+	LM_DISABLE_COPY_AND_MOVE(TestImages);
+
+public:
+
+	//! OpenEXR image.
+	static TestImage OpenEXR()
+	{
+		static const unsigned char data[] = {
+			0x76, 0x2f, 0x31, 0x01, 0x02, 0x00, 0x00, 0x00, 0x63, 0x68, 0x61, 0x6e,
+			0x6e, 0x65, 0x6c, 0x73, 0x00, 0x63, 0x68, 0x6c, 0x69, 0x73, 0x74, 0x00,
+			0x37, 0x00, 0x00, 0x00, 0x42, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x47, 0x00,
+			0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+			0x01, 0x00, 0x00, 0x00, 0x52, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x63,
+			0x6f, 0x6d, 0x70, 0x72, 0x65, 0x73, 0x73, 0x69, 0x6f, 0x6e, 0x00, 0x63,
+			0x6f, 0x6d, 0x70, 0x72, 0x65, 0x73, 0x73, 0x69, 0x6f, 0x6e, 0x00, 0x01,
+			0x00, 0x00, 0x00, 0x03, 0x64, 0x61, 0x74, 0x61, 0x57, 0x69, 0x6e, 0x64,
+			0x6f, 0x77, 0x00, 0x62, 0x6f, 0x78, 0x32, 0x69, 0x00, 0x10, 0x00, 0x00,
+			0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+			0x00, 0x01, 0x00, 0x00, 0x00, 0x64, 0x69, 0x73, 0x70, 0x6c, 0x61, 0x79,
+			0x57, 0x69, 0x6e, 0x64, 0x6f, 0x77, 0x00, 0x62, 0x6f, 0x78, 0x32, 0x69,
+			0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x6c, 0x69, 0x6e,
+			0x65, 0x4f, 0x72, 0x64, 0x65, 0x72, 0x00, 0x6c, 0x69, 0x6e, 0x65, 0x4f,
+			0x72, 0x64, 0x65, 0x72, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x70, 0x69,
+			0x78, 0x65, 0x6c, 0x41, 0x73, 0x70, 0x65, 0x63, 0x74, 0x52, 0x61, 0x74,
+			0x69, 0x6f, 0x00, 0x66, 0x6c, 0x6f, 0x61, 0x74, 0x00, 0x04, 0x00, 0x00,
+			0x00, 0x00, 0x00, 0x80, 0x3f, 0x73, 0x63, 0x72, 0x65, 0x65, 0x6e, 0x57,
+			0x69, 0x6e, 0x64, 0x6f, 0x77, 0x43, 0x65, 0x6e, 0x74, 0x65, 0x72, 0x00,
+			0x76, 0x32, 0x66, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x00, 0x00, 0x00, 0x00, 0x73, 0x63, 0x72, 0x65, 0x65, 0x6e, 0x57, 0x69,
+			0x6e, 0x64, 0x6f, 0x77, 0x57, 0x69, 0x64, 0x74, 0x68, 0x00, 0x66, 0x6c,
+			0x6f, 0x61, 0x74, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x3f,
+			0x00, 0x41, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x00, 0x19, 0x00, 0x00, 0x00, 0x78, 0x9c, 0x63, 0x60, 0x60, 0x68, 0x68,
+			0x80, 0x60, 0x10, 0x68, 0x80, 0x83, 0xfd, 0x8e, 0x30, 0x0c, 0x82, 0x70,
+			0x61, 0x00, 0x6e, 0xfa, 0x12, 0x81
+		};
+		const TestImage image = { data, 354 };
+		return image;
+	}
+
+	//! Radiance HDR image.
+	static TestImage RadianceHDR()
+	{
+		static const unsigned char data[] = {
+			0x23, 0x3f, 0x52, 0x41, 0x44, 0x49, 0x41, 0x4e, 0x43, 0x45, 0x0a, 0x23,
+			0x20, 0x4d, 0x61, 0x64, 0x65, 0x20, 0x77, 0x69, 0x74, 0x68, 0x20, 0x46,
+			0x72, 0x65, 0x65, 0x49, 0x6d, 0x61, 0x67, 0x65, 0x20, 0x33, 0x2e, 0x31,
+			0x35, 0x2e, 0x34, 0x0a, 0x46, 0x4f, 0x52, 0x4d, 0x41, 0x54, 0x3d, 0x33,
+			0x32, 0x2d, 0x62, 0x69, 0x74, 0x5f, 0x72, 0x6c, 0x65, 0x5f, 0x72, 0x67,
+			0x62, 0x65, 0x0a, 0x47, 0x41, 0x4d, 0x4d, 0x41, 0x3d, 0x31, 0x0a, 0x45,
+			0x58, 0x50, 0x4f, 0x53, 0x55, 0x52, 0x45, 0x3d, 0x30, 0x0a, 0x0a, 0x2d,
+			0x59, 0x20, 0x32, 0x20, 0x2b, 0x58, 0x20, 0x32, 0x0a, 0x80, 0x80, 0x80,
+			0x81, 0x80, 0x00, 0x00, 0x81, 0x00, 0x00, 0x80, 0x81, 0x00, 0x00, 0x00,
+			0x00
+		};
+		const TestImage image = { data, 109 };
+		return image;
+	}
+
+	//! PNG image.
+	static TestImage PNG()
+	{
+		static const unsigned char data[] = {
+			0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d,
+			0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x02,
+			0x08, 0x02, 0x00, 0x00, 0x00, 0xfd, 0xd4, 0x9a, 0x73, 0x00, 0x00, 0x00,
+			0x15, 0x49, 0x44, 0x41, 0x54, 0x78, 0x9c, 0x05, 0xc1, 0x01, 0x01, 0x00,
+			0x00, 0x00, 0x80, 0x10, 0xff, 0x4f, 0x17, 0xaa, 0x40, 0x18, 0x31, 0xdc,
+			0x04, 0xfc, 0x74, 0x84, 0x53, 0x09, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45,
+			0x4e, 0x44, 0xae, 0x42, 0x60, 0x82
+		};
+		const TestImage image = { data, 78 };
+		return image;
+	}
+
+};
+
+LM_TEST_NAMESPACE_END
+LM_NAMESPACE_END
+
+#endif // LIB_LIGHTMETRICA_TEST_TEST_IMAGES_H
\ No newline at end of file
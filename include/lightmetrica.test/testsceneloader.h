@@ -0,0 +1,129 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef LIB_LIGHTMETRICA_TEST_TEST_SCENE_LOADER_H
+#define LIB_LIGHTMETRICA_TEST_TEST_SCENE_LOADER_H
+
+#include "common.h"
+#include "stub.config.h"
+#include <lightmetrica/assets.h>
+#include <lightmetrica/texture.h>
+#include <lightmetrica/bsdf.h>
+#include <lightmetrica/trianglemesh.h>
+#include <lightmetrica/film.h>
+#include <lightmetrica/camera.h>
+#include <lightmetrica/light.h>
+#include <lightmetrica/primitives.h>
+#include <lightmetrica/scene.h>
+#include <memory>
+#include <string>
+
+LM_NAMESPACE_BEGIN
+LM_TEST_NAMESPACE_BEGIN
+
+/*!
+	Test scene loader.
+	Loads the assets and the scene of a test scene (see #TestScenes),
+	and configures and builds the scene.
+	The scene is not post-configured, as the tests using the scene usually do not need it.
+*/
+class TestSceneLoader
+{
+public:
+
+	TestSceneLoader() {}
+
+private:
+
+	LM_DISABLE_COPY_AND_MOVE(TestSceneLoader);
+
+public:
+
+	/*!
+		Load a test scene.
+		\param sceneString Test scene containing 'assets' and 'scene' element.
+		\retval true Succeeded to load the scene.
+		\retval false Failed to load the scene.
+	*/
+	bool Load(const std::string& sceneString)
+	{
+		if (!config.LoadFromString(sceneString, ""))
+		{
+			return false;
+		}
+
+		// Assets
+		assets.reset(ComponentFactory::Create<Assets>());
+		if (!assets->RegisterInterface<Texture>() ||
+			!assets->RegisterInterface<BSDF>() ||
+			!assets->RegisterInterface<TriangleMesh>() ||
+			!assets->RegisterInterface<Film>() ||
+			!assets->RegisterInterface<Camera>() ||
+			!assets->RegisterInterface<Light>())
+		{
+			return false;
+		}
+		if (!assets->Load(config.Root().Child("assets")))
+		{
+			return false;
+		}
+
+		// Primitives
+		std::unique_ptr<Primitives> primitives(ComponentFactory::Create<Primitives>());
+		if (!primitives->Load(config.Root().Child("scene"), *assets))
+		{
+			return false;
+		}
+
+		// Scene
+		const auto sceneNode = config.Root().Child("scene");
+		scene.reset(ComponentFactory::Create<Scene>(sceneNode.AttributeValue("type")));
+		if (scene == nullptr)
+		{
+			return false;
+		}
+		scene->Load(primitives.release());
+		return scene->Configure(sceneNode) && scene->Build();
+	}
+
+	/*!
+		Get the loaded assets.
+		\return Assets.
+	*/
+	const Assets& GetAssets() const { return *assets; }
+
+	/*!
+		Get the loaded scene.
+		\return Scene.
+	*/
+	const Scene& GetScene() const { return *scene; }
+
+private:
+
+	StubConfig config;
+	std::unique_ptr<Assets> assets;
+	std::unique_ptr<Scene> scene;
+
+};
+
+LM_TEST_NAMESPACE_END
+LM_NAMESPACE_END
+
+#endif // LIB_LIGHTMETRICA_TEST_TEST_SCENE_LOADER_H
\ No newline at end of file
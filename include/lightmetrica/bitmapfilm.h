@@ -34,6 +34,7 @@ enum class BitmapImageType
 	RadianceHDR,	//!< Radiance HDR
 	OpenEXR,		//!< OpenEXR
 	PNG,
+	PFM,			//!< Portable float map
 };
 
 class BitmapImage;
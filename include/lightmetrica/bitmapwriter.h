@@ -0,0 +1,136 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef LIB_LIGHTMETRICA_BITMAP_WRITER_H
+#define LIB_LIGHTMETRICA_BITMAP_WRITER_H
+
+#include "common.h"
+#include "math.types.h"
+#include <string>
+#include <cstddef>
+
+LM_NAMESPACE_BEGIN
+
+class BitmapImage;
+
+/*!
+	Transfer functions.
+	Defines transfer functions used for the conversion to 8-bit images.
+*/
+enum class BitmapTransferFunction
+{
+	Gamma,		//!< Gamma correction with gamma = 2.2
+	SRGB,		//!< sRGB transfer function
+};
+
+/*!
+	OpenEXR pixel types.
+*/
+enum class OpenEXRPixelType
+{
+	Half,		//!< 16-bit floating-point
+	Float,		//!< 32-bit floating-point
+};
+
+/*!
+	OpenEXR compression types.
+	Only the compression types which do not require external libraries are supported.
+*/
+enum class OpenEXRCompression
+{
+	None,		//!< No compression
+	RLE,		//!< Run-length encoding
+};
+
+/*!
+	Bitmap image writer.
+	Helper functions for the conversion and the output of bitmap images.
+	The functions directly read the internal data of the bitmap image
+	(#BitmapImage::InternalData) and process the scanlines in parallel.
+	The internal data is interpreted as RGB triplets
+	where the first scanline is the bottom of the image.
+*/
+class LM_PUBLIC_API BitmapImageWriter
+{
+private:
+
+	BitmapImageWriter() {}
+	LM_DISABLE_COPY_AND_MOVE(BitmapImageWriter);
+
+public:
+
+	/*!
+		Rescale and convert to 32-bit floating-point RGB image.
+		\param bitmap Bitmap image.
+		\param width Width of the image.
+		\param height Height of the image.
+		\param weight Rescaling weight.
+		\param dst Destination buffer (first scanline is the bottom of the image).
+		\param pitch Size of a scanline of #dst in bytes.
+	*/
+	static void ConvertToFloat(const BitmapImage& bitmap, int width, int height, const Math::Float& weight, unsigned char* dst, size_t pitch);
+
+	/*!
+		Rescale and convert to 8-bit RGB image.
+		The transfer function is evaluated with a look-up table.
+		\param bitmap Bitmap image.
+		\param width Width of the image.
+		\param height Height of the image.
+		\param weight Rescaling weight.
+		\param transfer Transfer function.
+		\param bgr Store channels in BGR order if true, otherwise in RGB order.
+		\param dst Destination buffer (first scanline is the bottom of the image).
+		\param pitch Size of a scanline of #dst in bytes.
+	*/
+	static void ConvertTo8Bit(const BitmapImage& bitmap, int width, int height, const Math::Float& weight, BitmapTransferFunction transfer, bool bgr, unsigned char* dst, size_t pitch);
+
+	/*!
+		Save as PFM (portable float map) image.
+		\param path Path to the output image.
+		\param bitmap Bitmap image.
+		\param width Width of the image.
+		\param height Height of the image.
+		\param weight Rescaling weight.
+		\retval true Succeeded to save the image.
+		\retval false Failed to save the image.
+	*/
+	static bool SavePFM(const std::string& path, const BitmapImage& bitmap, int width, int height, const Math::Float& weight);
+
+	/*!
+		Save as OpenEXR image.
+		Writes a single-part scanline image with R, G, B channels.
+		Scanline chunks are compressed in parallel.
+		\param path Path to the output image.
+		\param bitmap Bitmap image.
+		\param width Width of the image.
+		\param height Height of the image.
+		\param weight Rescaling weight.
+		\param pixelType Pixel type.
+		\param compression Compression type.
+		\retval true Succeeded to save the image.
+		\retval false Failed to save the image.
+	*/
+	static bool SaveOpenEXR(const std::string& path, const BitmapImage& bitmap, int width, int height, const Math::Float& weight, OpenEXRPixelType pixelType, OpenEXRCompression compression);
+
+};
+
+LM_NAMESPACE_END
+
+#endif // LIB_LIGHTMETRICA_BITMAP_WRITER_H
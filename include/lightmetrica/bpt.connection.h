@@ -0,0 +1,195 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef LIB_LIGHTMETRICA_BPT_CONNECTION_H
+#define LIB_LIGHTMETRICA_BPT_CONNECTION_H
+
+#include "bpt.common.h"
+#include "bpt.subpath.h"
+#include "bpt.fullpath.h"
+#include "math.types.h"
+#include "ray.h"
+#include "align.h"
+#include <vector>
+#include <memory>
+
+LM_NAMESPACE_BEGIN
+
+class Scene;
+
+/*!
+	Connection of sub-paths.
+	Records the contribution of the full-path with strategy (s,t)
+	until the visibility test of the shadow ray is resolved.
+*/
+struct BPTConnection
+{
+
+	int s;							//!< # of vertices in light sub-path
+	int t;							//!< # of vertices in eye sub-path
+	int shadowRayIndex;				//!< Index of the shadow ray or -1 if no visibility test is required
+	Math::Float weight;				//!< MIS weight w_{s,t}
+	Math::Vec2 rasterPosition;		//!< Raster position
+	Math::Vec3 Cstar;				//!< Unweight contribution C^*_{s,t} without the visibility test
+
+};
+
+typedef std::vector<BPTConnection, aligned_allocator<BPTConnection, std::alignment_of<BPTConnection>::value>> BPTConnections;
+
+/*!
+	Batch of connections of sub-paths.
+	Collects the connections of a sample with their shadow rays
+	and traces the shadow rays in a batch with occlusion-only queries.
+	The buffers are reused between samples in order to avoid unnecessary memory allocation.
+*/
+class LM_PUBLIC_API BPTConnectionBatch
+{
+public:
+
+	BPTConnectionBatch();
+
+private:
+
+	LM_DISABLE_COPY_AND_MOVE(BPTConnectionBatch);
+
+public:
+
+	/*!
+		Clear the connections.
+	*/
+	void Clear();
+
+	/*!
+		Add a connection without the visibility test.
+		\param connection Connection.
+	*/
+	void Add(const BPTConnection& connection);
+
+	/*!
+		Add a connection with the visibility test.
+		\param connection Connection.
+		\param shadowRay Shadow ray between y_{s-1} and z_{t-1}.
+	*/
+	void Add(const BPTConnection& connection, const Ray& shadowRay);
+
+	/*!
+		Add connections of all strategies.
+		Evaluates the unweight contributions C^*_{s,t} except for the visibility
+		of all strategies combining the sub-paths, and adds the connections
+		with non-zero contribution and their MIS weights.
+		\tparam MISWeightFunc Type of the function object evaluating the MIS weight of a full-path.
+		\param scene Scene.
+		\param subpathL Light sub-path.
+		\param subpathE Eye sub-path.
+		\param maxPathVertices Maximum number of path vertices (-1 for unlimited).
+		\param evaluateMISWeight Function object evaluating the MIS weight of a full-path.
+	*/
+	template <typename MISWeightFunc>
+	void AddFullPaths(const Scene& scene, const BPTSubpath& subpathL, const BPTSubpath& subpathE, int maxPathVertices, const MISWeightFunc& evaluateMISWeight);
+
+	/*!
+		Trace the shadow rays.
+		Resolves the visibility tests of the connections in a batch.
+		\param scene Scene.
+	*/
+	void TraceShadowRays(const Scene& scene);
+
+	/*!
+		Get the connections.
+		\return Connections.
+	*/
+	const BPTConnections& Connections() const { return connections; }
+
+	/*!
+		Check if the connection is occluded.
+		Requires #TraceShadowRays be called after the connection is added.
+		\param connection Connection.
+		\retval true The shadow ray of the connection is occluded.
+		\retval false The connection is visible.
+	*/
+	bool Occluded(const BPTConnection& connection) const { return connection.shadowRayIndex >= 0 && occluded[connection.shadowRayIndex]; }
+
+private:
+
+	BPTConnections connections;															//!< Connections
+	std::vector<Ray, aligned_allocator<Ray, std::alignment_of<Ray>::value>> shadowRays;	//!< Shadow rays of the connections
+	std::unique_ptr<bool[]> occluded;													//!< Results of the visibility tests
+	size_t occludedCapacity;															//!< Number of elements of #occluded
+
+};
+
+template <typename MISWeightFunc>
+void BPTConnectionBatch::AddFullPaths( const Scene& scene, const BPTSubpath& subpathL, const BPTSubpath& subpathE, int maxPathVertices, const MISWeightFunc& evaluateMISWeight )
+{
+	const int nL = static_cast<int>(subpathL.vertices.size());
+	const int nE = static_cast<int>(subpathE.vertices.size());
+
+	// For each subpath vertex sums n
+	// If n = 0 or 1 no valid path is generated
+	for (int n = 2; n <= nE + nL; n++)
+	{
+		if (maxPathVertices != -1 && n > maxPathVertices)
+		{
+			continue;
+		}
+
+		// Process full-path with length n+1 (subpath edges + connecting edge)
+		const int minS = Math::Max(0, n-nE);
+		const int maxS = Math::Min(nL, n);
+
+		for (int s = minS; s <= maxS; s++)
+		{
+			// Number of vertices in eye subpath
+			const int t = n - s;
+
+			// Create fullpath
+			BPTFullPath fullPath(s, t, subpathL, subpathE);
+
+			// Evaluate unweight contribution C^*_{s,t} except for the visibility
+			BPTConnection connection;
+			Ray shadowRay;
+			bool shadowRayRequired;
+			connection.Cstar = fullPath.EvaluateUnoccludedContribution(scene, connection.rasterPosition, shadowRay, shadowRayRequired);
+			if (Math::IsZero(connection.Cstar))
+			{
+				// For some reason, the sampled path is not used
+				// e.g., the BSDFs of y_{s-1} and z_{t-1} are degenerated
+				continue;
+			}
+
+			// Evaluate weighting function w_{s,t}
+			connection.s = s;
+			connection.t = t;
+			connection.weight = evaluateMISWeight(fullPath);
+			if (shadowRayRequired)
+			{
+				Add(connection, shadowRay);
+			}
+			else
+			{
+				Add(connection);
+			}
+		}
+	}
+}
+
+LM_NAMESPACE_END
+
+#endif // LIB_LIGHTMETRICA_BPT_CONNECTION_H
\ No newline at end of file
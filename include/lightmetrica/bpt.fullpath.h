@@ -30,6 +30,7 @@ LM_NAMESPACE_BEGIN
 class BPTPathVertex;
 class BPTSubpath;
 class Scene;
+struct Ray;
 
 /*!
 	BPT full-path.
@@ -63,6 +64,21 @@ public:
 	*/
 	LM_PUBLIC_API Math::Vec3 EvaluateUnweightContribution(const Scene& scene, Math::Vec2& rasterPosition) const;
 
+	/*!
+		Evaluate unweight contribution C^*_{s,t} without the visibility test.
+		Same as #EvaluateUnweightContribution except that the visibility
+		between y_{s-1} and z_{t-1} is not checked.
+		If #shadowRayRequired is true, the contribution is valid
+		only if #shadowRay is not occluded.
+		This function makes it possible to trace the shadow rays of the full-paths in a batch.
+		\param scene Scene.
+		\param rasterPosition Raster position.
+		\param shadowRay Shadow ray from y_{s-1} to z_{t-1}.
+		\param shadowRayRequired True if the visibility test with #shadowRay is required.
+		\return Contribution.
+	*/
+	LM_PUBLIC_API Math::Vec3 EvaluateUnoccludedContribution(const Scene& scene, Math::Vec2& rasterPosition, Ray& shadowRay, bool& shadowRayRequired) const;
+
 	/*!
 		Evaluate full-path probability density.
 		Evaluate p_i(x_{s,t}) := p_{i,s+t-i}(x_{s,t}).
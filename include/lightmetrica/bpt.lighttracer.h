@@ -0,0 +1,142 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef LIB_LIGHTMETRICA_BPT_LIGHT_TRACER_H
+#define LIB_LIGHTMETRICA_BPT_LIGHT_TRACER_H
+
+#include "bpt.subpath.h"
+#include "bpt.pool.h"
+#include "sampler.h"
+#include "align.h"
+#include "logger.h"
+#include <vector>
+#include <memory>
+#include <omp.h>
+
+LM_NAMESPACE_BEGIN
+
+class Scene;
+
+/*!
+	Light sub-path tracer.
+	Traces a fixed number of light sub-paths in parallel and collects their vertices into a flat array.
+	Used by the renderers sharing the light sub-paths of an iteration among the samples,
+	e.g., light vertex cache mode of BPT and the vertex merging of VCM.
+	Each thread has its own sampler and buffer of the vertices, which are reused among iterations.
+	\tparam LightVertex Type of the light vertices.
+*/
+template <typename LightVertex>
+class BPTLightSubpathTracer
+{
+public:
+
+	//! Vector type for the light vertices
+	typedef std::vector<LightVertex, aligned_allocator<LightVertex, std::alignment_of<LightVertex>::value>> LightVertices;
+
+public:
+
+	BPTLightSubpathTracer() {}
+
+private:
+
+	LM_DISABLE_COPY_AND_MOVE(BPTLightSubpathTracer);
+
+public:
+
+	/*!
+		Initialize the tracer.
+		Creates the samplers of the threads with the seeds sampled from #initialSampler.
+		\param initialSampler Sampler.
+	*/
+	void Initialize(Sampler& initialSampler)
+	{
+		const int numThreads = omp_get_max_threads();
+		samplers.clear();
+		for (int thread = 0; thread < numThreads; thread++)
+		{
+			samplers.emplace_back(initialSampler.Clone());
+			samplers.back()->SetSeed(initialSampler.NextUInt());
+		}
+		threadVertices.assign(numThreads, LightVertices());
+	}
+
+	/*!
+		Trace light sub-paths.
+		The vertices of the previous call are discarded.
+		#appendVertices is called as appendVertices(subpath, vertices) for each light sub-path
+		to append the vertices of the sub-path to the buffer of the thread.
+		The function object is copied for each thread so that it can own per-thread working buffers.
+		\param scene Scene.
+		\param numLightPaths Number of light sub-paths.
+		\param rrDepth Depth of beginning RR.
+		\param maxPathVertices Maximum number of light path vertices.
+		\param appendVertices Function object to append the vertices of a light sub-path.
+	*/
+	template <typename AppendFunc>
+	void Trace(const Scene& scene, long long numLightPaths, int rrDepth, int maxPathVertices, const AppendFunc& appendVertices)
+	{
+		#pragma omp parallel
+		{
+			const int thread = omp_get_thread_num();
+			auto& sampler = *samplers[thread];
+			auto& localVertices = threadVertices[thread];
+			localVertices.clear();
+
+			auto append = appendVertices;
+			BPTPathVertexPool pool;
+			BPTSubpath subpath(TransportDirection::LE);
+
+			#pragma omp for schedule(dynamic, 64)
+			for (long long sample = 0; sample < numLightPaths; sample++)
+			{
+				pool.Release();
+				subpath.Clear();
+				subpath.Sample(scene, sampler, pool, rrDepth, maxPathVertices);
+				append(subpath, localVertices);
+			}
+		}
+
+		// Concatenate light vertices from each thread
+		vertices.clear();
+		for (const auto& localVertices : threadVertices)
+		{
+			vertices.insert(vertices.end(), localVertices.begin(), localVertices.end());
+		}
+
+		LM_LOG_DEBUG("Traced " + std::to_string(numLightPaths) + " light sub-paths : light vertices = " + std::to_string(vertices.size()));
+	}
+
+	/*!
+		Get light vertices.
+		\return Light vertices traced in the last call of #Trace.
+	*/
+	const LightVertices& Vertices() const { return vertices; }
+
+private:
+
+	std::vector<std::unique_ptr<Sampler>> samplers;		// Samplers for the light sub-paths of each thread
+	std::vector<LightVertices> threadVertices;			// Light vertices of each thread
+	LightVertices vertices;								// Light vertices of all threads
+
+};
+
+LM_NAMESPACE_END
+
+#endif // LIB_LIGHTMETRICA_BPT_LIGHT_TRACER_H
\ No newline at end of file
@@ -0,0 +1,144 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef LIB_LIGHTMETRICA_BPT_LIGHT_VERTEX_CACHE_H
+#define LIB_LIGHTMETRICA_BPT_LIGHT_VERTEX_CACHE_H
+
+#include "bpt.common.h"
+#include "math.types.h"
+#include "align.h"
+#include <vector>
+
+LM_NAMESPACE_BEGIN
+
+class Scene;
+class GeneralizedBSDF;
+class BPTSubpath;
+class BPTFullPath;
+struct Ray;
+
+/*!
+	Cached light vertex.
+	Records a vertex of the light sub-paths of an iteration in light vertex cache mode.
+	The vertex is stored in a compact form independent of the memory pool of the sub-path,
+	where the tangent space of the surface geometry is restored from the shading normal.
+*/
+struct BPTLightVertex
+{
+
+	const GeneralizedBSDF* bsdf;		//!< Generalized BSDF of y_k (the light if k = 0)
+	bool degenerated;					//!< #SurfaceGeometry::degenerated of y_k
+	bool prevDegenerated;				//!< True if y_{k-1} is positionally degenerated
+	Math::Vec3 p;						//!< Position of y_k
+	Math::Vec3 gn;						//!< Geometry normal of y_k
+	Math::Vec3 sn;						//!< Shading normal of y_k
+	Math::Vec2 uv;						//!< Texture coordinates of y_k
+	Math::Vec3 wi;						//!< Direction to y_{k-1}
+	Math::Vec3 throughput;				//!< \alpha^L_{k+1}
+	Math::Float misInvPdfSq;			//!< #BPTPathVertex::misInvPdfSq of y_k
+	Math::Float misPartialSum;			//!< Partial sum of the strategies except for s = 0 (see #BPTLightVertexCache::EvaluatePartialSums)
+	Math::Float misEndpointPartialSum;	//!< Partial sum of the strategy s = 0
+	int numVertices;					//!< # of vertices of the light sub-path up to y_k, i.e., k + 1
+
+};
+
+//! Vector type for the cached light vertices
+typedef std::vector<BPTLightVertex, aligned_allocator<BPTLightVertex, std::alignment_of<BPTLightVertex>::value>> BPTLightVertices;
+
+/*!
+	Light vertex cache.
+	Utilities for light vertex cache mode of bidirectional path tracing,
+	where the vertices of a fixed number of light sub-paths are cached in each iteration
+	and each vertex of the eye sub-paths is connected to a number of cached vertices chosen uniformly.
+	The MIS weights (power heuristics) take the numbers of samples of the strategies into account:
+	the strategy with s = 0 is sampled once per sample, the strategy with t = 0 is not sampled,
+	and the other strategies are sampled c times in average, where c is the effective number of connection samples.
+	References:
+	  - T. Davidovic et al., Progressive light transport simulation on the GPU: Survey and improvements,
+	    ACM Transactions on Graphics, 33(3), 2014.
+*/
+class LM_PUBLIC_API BPTLightVertexCache
+{
+private:
+
+	BPTLightVertexCache();
+	~BPTLightVertexCache();
+
+	LM_DISABLE_COPY_AND_MOVE(BPTLightVertexCache);
+
+public:
+
+	/*!
+		Evaluate the partial sums of the MIS weights.
+		The term of the strategy using the endpoint x_0 as the connection vertex
+		(s = 0 for the light sub-path and t = 0 for the eye sub-path)
+		is accumulated separately because it has a different number of samples.
+		#endpointSums[k] + #sums[k] is equal to #BPTPathVertex::misPartialSum of x_k.
+		\param subpath Sub-path.
+		\param endpointSums Partial sums of the strategy using the endpoint.
+		\param sums Partial sums of the other strategies.
+	*/
+	static void EvaluatePartialSums(const BPTSubpath& subpath, std::vector<Math::Float>& endpointSums, std::vector<Math::Float>& sums);
+
+	/*!
+		Append light vertices.
+		Appends the vertices of the light sub-path which can be connected,
+		i.e., the vertices with non-delta generalized BSDFs.
+		\param subpath Light sub-path.
+		\param endpointSums Partial sums of the strategy s = 0 of #subpath.
+		\param sums Partial sums of the other strategies of #subpath.
+		\param vertices Light vertices.
+	*/
+	static void AppendLightVertices(const BPTSubpath& subpath, const std::vector<Math::Float>& endpointSums, const std::vector<Math::Float>& sums, BPTLightVertices& vertices);
+
+	/*!
+		Evaluate a connection with a cached light vertex.
+		Evaluates the unweight contribution C^*_{s,t} except for the visibility
+		and the MIS weight divided by the effective number of connection samples.
+		\param scene Scene.
+		\param y Cached light vertex y_{s-1}.
+		\param subpathE Eye sub-path.
+		\param t Number of vertices in the eye sub-path.
+		\param partialSumsE Partial sums of the strategies except for t = 0 of #subpathE.
+		\param alphaE \alpha^E_t.
+		\param connectionCount Effective number of connection samples.
+		\param rasterPosition Raster position (updated if t = 1).
+		\param shadowRay Shadow ray between y_{s-1} and z_{t-1}.
+		\param weight MIS weight divided by the effective number of connection samples.
+		\return Unweight contribution.
+	*/
+	static Math::Vec3 EvaluateConnection(const Scene& scene, const BPTLightVertex& y, const BPTSubpath& subpathE, int t, const std::vector<Math::Float>& partialSumsE, const Math::Vec3& alphaE, const Math::Float& connectionCount, Math::Vec2& rasterPosition, Ray& shadowRay, Math::Float& weight);
+
+	/*!
+		Evaluate MIS weight of the strategy s = 0.
+		Same as \a powerincremental MIS weight except that
+		the numbers of samples of the strategies are taken into account.
+		\param fullPath Full-path with s = 0.
+		\param partialSumsE Partial sums of the strategies except for t = 0 of the eye sub-path.
+		\param connectionCount Effective number of connection samples.
+		\return MIS weight.
+	*/
+	static Math::Float EvaluateEndpointMISWeight(const BPTFullPath& fullPath, const std::vector<Math::Float>& partialSumsE, const Math::Float& connectionCount);
+
+};
+
+LM_NAMESPACE_END
+
+#endif // LIB_LIGHTMETRICA_BPT_LIGHT_VERTEX_CACHE_H
\ No newline at end of file
@@ -104,6 +104,14 @@ public:
 	Math::Vec3 wi;							//!< Incoming ray direction
 	Math::Vec3 wo;							//!< Outgoing ray direction
 
+											// # Partial sums for incremental MIS weights.
+											// Let x_k be the vertex and p_A(x_k) be the area density of sampling x_k
+											// along the sub-path. The terms are accumulated in #BPTSubpath::Sample
+											// and combined with the connection-dependent PDFs in O(1) per full-path.
+											// --------------------------------------------------------------------------------
+	Math::Float misInvPdfSq;				//!< 1 / p_A(x_k)^2 if the strategy using x_k as the connection vertex is valid, otherwise zero
+	Math::Float misPartialSum;				//!< V_{k-1} / p_{\sigma^\bot}(x_{k-1}\to x_k)^2 where V_{k-1} is the partial sum for x_{k-1} (see #BPTSubpath::Sample)
+
 };
 
 class BPTPathVertexPool;
@@ -156,6 +164,22 @@ public:
 	*/
 	LM_PUBLIC_API void Sample(const Scene& scene, Sampler& sampler, BPTPathVertexPool& pool, int rrDepth, int maxPathVertices);
 
+	/*!
+		Sample a subpath with specified dimensions.
+		The i-th vertex of the subpath utilizes the dimensions
+		[#dimensionOffset + 12i, #dimensionOffset + 12i + 6) of the sampler.
+		Light and eye subpaths are interleaved by specifying d and d + 6 for #dimensionOffset.
+		If #rasterPos is not nullptr, the direction from the camera is sampled with the raster position.
+		\param scene Scene.
+		\param sampler Sampler.
+		\param pool Memory pool for path vertex.
+		\param rrDepth Depth to begin Russian roulette.
+		\param maxPathVertices Maximum number of vertex of subpath.
+		\param dimensionOffset Offset of the dimensions.
+		\param rasterPos Raster position (only for eye subpath) or nullptr.
+	*/
+	LM_PUBLIC_API void Sample(const Scene& scene, Sampler& sampler, BPTPathVertexPool& pool, int rrDepth, int maxPathVertices, int dimensionOffset, const Math::Vec2* rasterPos);
+
 	/*!
 		Evaluate alpha of subpaths.
 		The function is called from #EvaluateUnweightContribution.
@@ -23,6 +23,7 @@
 
 #include "generalizedbsdf.h"
 #include "surfacegeometry.h"
+#include "raydifferential.h"
 
 LM_NAMESPACE_BEGIN
 
@@ -42,6 +43,30 @@ public:
 	BSDF() {}
 	virtual ~BSDF() {}
 
+public:
+
+	/*!
+		Propagate ray differential.
+		Updates the direction differentials of #rd according to the sampled direction.
+		The default implementation approximates the differentials
+		by the spread of the lobe estimated from the PDF of the sampled direction,
+		which is suitable for the non-specular BSDFs.
+		\param query Query structure utilized for the sampling.
+		\param geom Surface geometry.
+		\param result Sampled result.
+		\param rd Ray differential transferred to #geom.
+	*/
+	virtual void PropagateRayDifferential(const GeneralizedBSDFSampleQuery& query, const SurfaceGeometry& geom, const GeneralizedBSDFSampleResult& result, RayDifferential& rd) const
+	{
+		auto pdf = result.pdf.v;
+		if (result.pdf.measure == Math::ProbabilityMeasure::ProjectedSolidAngle)
+		{
+			pdf *= Math::Abs(Math::Dot(result.wo, geom.sn));
+		}
+
+		rd.Spread(result.wo, pdf);
+	}
+
 protected:
 
 	/*!
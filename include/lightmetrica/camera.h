@@ -27,6 +27,7 @@ LM_NAMESPACE_BEGIN
 
 class Film;
 struct Ray;
+struct RayDifferential;
 
 /*!
 	Camera.
@@ -58,6 +59,19 @@ public:
 	*/
 	virtual bool RayToRasterPosition(const Math::Vec3& p, const Math::Vec3& d, Math::Vec2& rasterPos) const = 0;
 
+	/*!
+		Generate ray differential.
+		Computes the differentials of the primary ray w.r.t.
+		the offsets of the raster position by a pixel of the film.
+		The default implementation does not support ray differentials.
+		\param rasterPos Raster position of the primary ray.
+		\param geom Surface geometry on the camera.
+		\param rd Generated ray differential.
+		\retval true Succeeded to generate.
+		\retval false The camera does not support ray differentials.
+	*/
+	virtual bool GenerateRayDifferential(const Math::Vec2& rasterPos, const SurfaceGeometry& geom, RayDifferential& rd) const { return false; }
+
 	/*!
 		Get film.
 		Returns the film referenced by the camera.
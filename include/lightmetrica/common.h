@@ -54,6 +54,13 @@
 	#define LM_MPI 0
 #endif
 
+// NUMA flag (libnuma)
+#ifdef LM_USE_NUMA
+	#define LM_NUMA 1
+#else
+	#define LM_NUMA 0
+#endif
+
 // --------------------------------------------------------------------------------
 
 // Platform
@@ -26,6 +26,32 @@
 
 LM_NAMESPACE_BEGIN
 
+/*!
+	Splat.
+	A contribution to the film at the raster position.
+	Used for the batched accumulation of the contributions.
+	\sa Film::AccumulateContributions
+*/
+struct Splat
+{
+
+	Math::Vec2 rasterPos;		//!< Raster position
+	Math::Vec3 L;				//!< Contribution
+
+	Splat()
+	{
+
+	}
+
+	Splat(const Math::Vec2& rasterPos, const Math::Vec3& L)
+		: rasterPos(rasterPos)
+		, L(L)
+	{
+
+	}
+
+};
+
 /*!
 	Film.
 	A base class of the films.
@@ -81,6 +107,17 @@ public:
 	*/
 	virtual void AccumulateContribution(const Film& film) = 0;
 
+	/*!
+		Accumulate the contributions of the splats.
+		Batched version of #AccumulateContribution.
+		Accumulates the contributions of #n splats starting from #splats multiplied by #weight.
+		Splats outside of the film are ignored.
+		\param splats Splats.
+		\param n Number of splats.
+		\param weight Weight multiplied to the contributions.
+	*/
+	virtual void AccumulateContributions(const Splat* splats, size_t n, const Math::Float& weight) = 0;
+
 	/*!
 		Rescale the pixel values by constant weight.
 		\param weight Rescaling weight.
@@ -94,9 +131,43 @@ public:
 	virtual Film* Clone() const = 0;
 
 	/*!
+		Clear the film.
+		Sets all pixel values to zero.
 	*/
 	virtual void Clear() = 0;
 
+	/*!
+		Enable or disable shared mode.
+		In shared mode the film is shared among threads.
+		Instead of the full copy of the film, #Clone creates a lightweight per-thread film
+		which buffers the contributions and accumulates them into this film in a thread-safe manner.
+		Per-thread films must be deleted before shared mode is disabled.
+		\param enable Enables shared mode if true.
+	*/
+	virtual void SetSharedMode(bool enable) = 0;
+
+	/*!
+		Flush buffered contributions.
+		In shared mode, reflects the contributions buffered in the per-thread films to this film.
+		The function must not be called concurrently with the accumulation.
+	*/
+	virtual void Flush() = 0;
+
+protected:
+
+	/*!
+		Compute pixel indices of the splats.
+		Converts the raster positions to the pixel indices (y * width + x) at once.
+		The indices of the splats outside of the film are set to -1.
+		\param splats Splats.
+		\param n Number of splats.
+		\param width Width of the film.
+		\param height Height of the film.
+		\param indices Computed pixel indices (#n elements).
+		\return Number of splats outside of the film.
+	*/
+	LM_PUBLIC_API static size_t ComputePixelIndices(const Splat* splats, size_t n, int width, int height, int* indices);
+
 };
 
 LM_NAMESPACE_END
@@ -0,0 +1,63 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef LIB_LIGHTMETRICA_HALF_UTILS_H
+#define LIB_LIGHTMETRICA_HALF_UTILS_H
+
+#include "common.h"
+
+LM_NAMESPACE_BEGIN
+
+/*!
+	Half precision floating-point number utility.
+	Helper class for the conversion between single and half precision floating-point numbers.
+*/
+class LM_PUBLIC_API HalfUtils
+{
+private:
+
+	HalfUtils() {}
+	LM_DISABLE_COPY_AND_MOVE(HalfUtils);
+
+public:
+
+	/*!
+		Convert single precision floating-point number to half precision.
+		The value is rounded to nearest even as in IEEE 754 (and OpenEXR).
+		The finite values rounded out of the range of half precision become infinity of the same sign,
+		and the values too small to be represented become zero of the same sign.
+		\param v Single precision floating-point number.
+		\return Bits of the half precision floating-point number.
+	*/
+	static unsigned short FloatToHalf(float v);
+
+	/*!
+		Convert half precision floating-point number to single precision.
+		The conversion is exact.
+		\param v Bits of the half precision floating-point number.
+		\return Single precision floating-point number.
+	*/
+	static float HalfToFloat(unsigned short v);
+
+};
+
+LM_NAMESPACE_END
+
+#endif // LIB_LIGHTMETRICA_HALF_UTILS_H
\ No newline at end of file
@@ -0,0 +1,267 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef LIB_LIGHTMETRICA_HASH_GRID_H
+#define LIB_LIGHTMETRICA_HASH_GRID_H
+
+#include "common.h"
+#include "math.types.h"
+#include "align.h"
+#include "aabb.h"
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cmath>
+
+LM_NAMESPACE_BEGIN
+
+/*!
+	Hash grid.
+	Uniform grid with spatial hashing for the fixed-radius queries of points.
+	The elements are sorted by the hashes of the cells with counting sort,
+	and stored in a compact layout with the start indices of the hash entries.
+	If the cell size is twice the query radius, a query visits at most 2x2x2 cells.
+	\tparam T Element type with the position as the member \a p.
+*/
+template <typename T>
+class HashGrid
+{
+public:
+
+	//! Vector type for the elements
+	typedef std::vector<T, aligned_allocator<T, std::alignment_of<T>::value>> Elements;
+
+private:
+
+	//! Index of a cell in the grid
+	struct Cell
+	{
+		Cell() {}
+		Cell(int x, int y, int z) : x(x), y(y), z(z) {}
+		bool operator==(const Cell& c) const { return x == c.x && y == c.y && z == c.z; }
+		int x, y, z;
+	};
+
+public:
+
+	HashGrid()
+		: cellSize(0)
+		, invCellSize(0)
+		, hashMask(0)
+	{
+
+	}
+
+private:
+
+	LM_DISABLE_COPY_AND_MOVE(HashGrid);
+
+public:
+
+	/*!
+		Build the grid.
+		The elements are copied to the grid in the order of the hash entries.
+		If #cellSize is not positive, the cell size is determined from
+		the bound of the elements so that each cell contains a few elements.
+		\param elements Elements.
+		\param cellSize Size of a cell.
+	*/
+	void Build(const Elements& elements, Math::Float cellSize)
+	{
+		const long long n = static_cast<long long>(elements.size());
+
+		// Cell size
+		if (cellSize <= Math::Float(0))
+		{
+			AABB bound;
+			for (const auto& element : elements)
+			{
+				bound = bound.Union(element.p);
+			}
+
+			Math::Float extent(0);
+			if (n > 0)
+			{
+				const auto size = bound.max - bound.min;
+				extent = std::max(size.x, std::max(size.y, size.z));
+			}
+
+			cellSize = extent > Math::Float(0) ? extent / Math::Float(std::cbrt(static_cast<double>(n))) : Math::Float(1);
+		}
+		this->cellSize = cellSize;
+		invCellSize = 1.0 / static_cast<double>(cellSize);
+
+		// Size of the hash table
+		unsigned int tableSize = 1;
+		while (static_cast<long long>(tableSize) < n)
+		{
+			tableSize *= 2;
+		}
+		hashMask = tableSize - 1;
+
+		// Count the elements in each hash entry
+		std::vector<unsigned int> hashes(elements.size());
+		std::unique_ptr<std::atomic<unsigned int>[]> counts(new std::atomic<unsigned int>[tableSize]);
+
+		#pragma omp parallel for
+		for (long long i = 0; i < static_cast<long long>(tableSize); i++)
+		{
+			counts[i].store(0, std::memory_order_relaxed);
+		}
+
+		#pragma omp parallel for
+		for (long long i = 0; i < n; i++)
+		{
+			hashes[i] = Hash(CellOf(elements[i].p));
+			counts[hashes[i]].fetch_add(1, std::memory_order_relaxed);
+		}
+
+		// Start indices of the hash entries
+		cellStarts.resize(tableSize + 1);
+		cellStarts[0] = 0;
+		for (unsigned int i = 0; i < tableSize; i++)
+		{
+			cellStarts[i + 1] = cellStarts[i] + counts[i].load(std::memory_order_relaxed);
+			counts[i].store(cellStarts[i], std::memory_order_relaxed);
+		}
+
+		// Scatter the elements
+		// Order of the elements in a hash entry depends on the scheduling of the threads
+		data.resize(elements.size());
+
+		#pragma omp parallel for
+		for (long long i = 0; i < n; i++)
+		{
+			data[counts[hashes[i]].fetch_add(1, std::memory_order_relaxed)] = elements[i];
+		}
+	}
+
+	/*!
+		Traverse the cells around the query point.
+		Dispatches #func for the elements nearer than #maxDist2.
+		If the query radius is too large compared to the cell size, all elements are scanned.
+		\tparam Func Function of the signature void (const T&, Math::Float dist2, Math::Float& maxDist2).
+		\param p Query point.
+		\param maxDist2 Squared maximum distance.
+		\param func Function called for each element.
+	*/
+	template <typename Func>
+	void Traverse(const Math::Vec3& p, Math::Float& maxDist2, const Func& func) const
+	{
+		if (data.empty())
+		{
+			return;
+		}
+
+		// Range of the cells overlapping with the query sphere
+		// The radius is slightly enlarged in order to be conservative
+		// against the rounding error of the distances computed in single precision
+		const double radius = std::sqrt(static_cast<double>(maxDist2)) * (1.0 + 1e-5);
+		double minCell[3], maxCell[3];
+		double numCells = 1;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			minCell[axis] = std::floor((static_cast<double>(p[axis]) - radius) * invCellSize);
+			maxCell[axis] = std::floor((static_cast<double>(p[axis]) + radius) * invCellSize);
+			numCells *= maxCell[axis] - minCell[axis] + 1;
+		}
+
+		if (!(numCells <= static_cast<double>(hashMask) + 1))
+		{
+			// Scan all elements if the range is too large
+			for (const auto& element : data)
+			{
+				const auto dist2 = Math::Length2(element.p - p);
+				if (dist2 < maxDist2)
+				{
+					func(element, dist2, maxDist2);
+				}
+			}
+			return;
+		}
+
+		const Cell minC(static_cast<int>(minCell[0]), static_cast<int>(minCell[1]), static_cast<int>(minCell[2]));
+		const Cell maxC(static_cast<int>(maxCell[0]), static_cast<int>(maxCell[1]), static_cast<int>(maxCell[2]));
+		for (int z = minC.z; z <= maxC.z; z++)
+		{
+			for (int y = minC.y; y <= maxC.y; y++)
+			{
+				for (int x = minC.x; x <= maxC.x; x++)
+				{
+					// Different cells can share the hash entry,
+					// thus the cell of each element is checked in order not to visit it twice
+					const Cell cell(x, y, z);
+					const auto hash = Hash(cell);
+					for (unsigned int i = cellStarts[hash]; i < cellStarts[hash + 1]; i++)
+					{
+						const auto& element = data[i];
+						const auto dist2 = Math::Length2(element.p - p);
+						if (dist2 < maxDist2 && CellOf(element.p) == cell)
+						{
+							func(element, dist2, maxDist2);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	/*!
+		Get the elements.
+		The elements are sorted by the hash values.
+		\return Elements.
+	*/
+	const Elements& Data() const
+	{
+		return data;
+	}
+
+private:
+
+	LM_FORCE_INLINE Cell CellOf(const Math::Vec3& p) const
+	{
+		// Computed in double precision consistently with the range of the cells in #Traverse
+		return Cell(
+			static_cast<int>(std::floor(static_cast<double>(p.x) * invCellSize)),
+			static_cast<int>(std::floor(static_cast<double>(p.y) * invCellSize)),
+			static_cast<int>(std::floor(static_cast<double>(p.z) * invCellSize)));
+	}
+
+	LM_FORCE_INLINE unsigned int Hash(const Cell& cell) const
+	{
+		// Spatial hash function [Teschner et al. 2003]
+		return ((static_cast<unsigned int>(cell.x) * 73856093U) ^
+				(static_cast<unsigned int>(cell.y) * 19349663U) ^
+				(static_cast<unsigned int>(cell.z) * 83492791U)) & hashMask;
+	}
+
+private:
+
+	Math::Float cellSize;					//!< Size of a cell
+	double invCellSize;						//!< Inverse of #cellSize
+	unsigned int hashMask;					//!< Mask for the hash values (size of the hash table minus one)
+	std::vector<unsigned int> cellStarts;	//!< Start indices of the hash entries in #data
+	Elements data;							//!< Elements sorted by the hash values
+
+};
+
+LM_NAMESPACE_END
+
+#endif // LIB_LIGHTMETRICA_HASH_GRID_H
\ No newline at end of file
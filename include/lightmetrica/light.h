@@ -38,7 +38,12 @@ public:
 
 public:
 
-	Light() {}
+	Light()
+		: lightIndex(-1)
+	{
+
+	}
+
 	virtual ~Light() {}
 
 public:
@@ -50,6 +55,34 @@ public:
 	*/
 	virtual bool EnvironmentLight() const = 0;
 
+	/*!
+		Get the power of the light.
+		The power (radiant flux) of the light is utilized e.g. for the light selection.
+		The function must be called after the light is configured (see #RegisterPrimitives and #PostConfigure).
+		\return Power.
+	*/
+	virtual Math::Vec3 Power() const = 0;
+
+public:
+
+	/*!
+		Get the index of the light.
+		The index is assigned when the light is registered to the scene,
+		which is utilized e.g. for the evaluation of the light selection PDF.
+		\return Index of the light (-1 if not registered).
+	*/
+	int LightIndex() const { return lightIndex; }
+
+	/*!
+		Set the index of the light.
+		\param index Index of the light.
+	*/
+	void SetLightIndex(int index) { lightIndex = index; }
+
+private:
+
+	int lightIndex;
+
 };
 
 LM_NAMESPACE_END
@@ -0,0 +1,99 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef LIB_LIGHTMETRICA_LIGHT_SELECTOR_H
+#define LIB_LIGHTMETRICA_LIGHT_SELECTOR_H
+
+#include "component.h"
+#include "math.types.h"
+#include <vector>
+
+LM_NAMESPACE_BEGIN
+
+class ConfigNode;
+class Assets;
+class Light;
+
+/*!
+	Light selector.
+	A base class of the strategies to choose a light from the lights in the scene.
+	The selection can depend on the position of the shading point,
+	which is utilized for the direct light sampling.
+	The lights are specified by the indices in the list given by #Build.
+*/
+class LightSelector : public Component
+{
+public:
+
+	LM_COMPONENT_INTERFACE_DEF("light_selector");
+
+public:
+
+	LightSelector() {}
+	virtual ~LightSelector() {}
+
+private:
+
+	LM_DISABLE_COPY_AND_MOVE(LightSelector);
+
+public:
+
+	/*!
+		Configure.
+		Configures the light selector.
+		\param node A XML element which consists of \a light_selector element.
+		\param assets Assets manager.
+		\retval true Succeeded to configure.
+		\retval false Failed to configure.
+	*/
+	virtual bool Configure(const ConfigNode& node, const Assets& assets) = 0;
+
+	/*!
+		Build the light selector.
+		The function is called after the lights are configured.
+		\param lights Lights in the scene.
+		\retval true Succeeded to build.
+		\retval false Failed to build.
+	*/
+	virtual bool Build(const std::vector<const Light*>& lights) = 0;
+
+	/*!
+		Choose a light.
+		#u is rescaled to [0, 1) so that it can be reused in the following procedure.
+		\param p Position of the shading point, or nullptr if the selection is independent of the position.
+		\param u Light sample.
+		\param selectionPdf PDF evaluation of the selection (discrete measure).
+		\return Index of the selected light.
+	*/
+	virtual int Sample(const Math::Vec3* p, Math::Float& u, Math::PDFEval& selectionPdf) const = 0;
+
+	/*!
+		Evaluate PDF of the light selection.
+		\param p Position of the shading point, or nullptr if the selection is independent of the position.
+		\param index Index of the light.
+		\return Evaluated PDF (discrete measure).
+	*/
+	virtual Math::PDFEval EvaluatePdf(const Math::Vec3* p, int index) const = 0;
+
+};
+
+LM_NAMESPACE_END
+
+#endif // LIB_LIGHTMETRICA_LIGHT_SELECTOR_H
\ No newline at end of file
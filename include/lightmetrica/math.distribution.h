@@ -24,6 +24,7 @@
 #include "math.types.h"
 #include "logger.h"
 #include <vector>
+#include <algorithm>
 
 LM_NAMESPACE_BEGIN
 LM_MATH_NAMESPACE_BEGIN
@@ -63,6 +64,16 @@ public:
 		size_t v = static_cast<size_t>(std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin()) - 1;
 		return Math::Clamp<size_t>(v, 0, cdf.size() - 2);
 	}
+
+	// Reusable version of #Sample
+	// #u is rescaled to [0, 1) in the interval of the sampled element
+	size_t SampleReuse(Math::Float& u) const
+	{
+		auto i = Sample(u);
+		auto w = cdf[i + 1] - cdf[i];
+		u = w > Math::Float(0) ? (u - cdf[i]) / w : Math::Float(0);
+		return i;
+	}
 	
 	Math::Float EvaluatePDF(int i) const
 	{
@@ -86,6 +97,223 @@ private:
 
 };
 
+/*!
+	Discrete 1D distribution with alias table.
+	Offers the same interface as DiscreteDistribution1D,
+	but the sampling is O(1) with the alias method (Walker 1977; Vose 1991).
+	The alias table is created in #Normalize, which must be called before sampling.
+*/
+class DiscreteAliasDistribution1D
+{
+private:
+
+	struct Entry
+	{
+		Math::Float prob;		// Probability to choose the element itself
+		int alias;				// Index of the alternative element
+	};
+
+public:
+
+	DiscreteAliasDistribution1D() { Clear(); }
+
+public:
+
+	void Add(const Math::Float& v)
+	{
+		pdf.push_back(v);
+		sum += v;
+	}
+
+	void Normalize()
+	{
+		const int n = static_cast<int>(pdf.size());
+		if (n == 0)
+		{
+			return;
+		}
+
+		// Use uniform distribution if the sum is zero
+		// Element-wise operations are parallelized for large distributions
+		const int ParallelThreshold = 1 << 16;
+		const auto invSum = sum > Math::Float(0) ? Math::Float(1) / sum : Math::Float(0);
+		const auto uniformPdf = Math::Float(1) / Math::Float(n);
+		table.resize(n);
+		std::vector<double> scaled(n);
+		#pragma omp parallel for if (n >= ParallelThreshold)
+		for (int i = 0; i < n; i++)
+		{
+			pdf[i] = sum > Math::Float(0) ? pdf[i] * invSum : uniformPdf;
+			scaled[i] = static_cast<double>(pdf[i]) * n;
+		}
+
+		// Create alias table with Vose's method
+		// Elements are partitioned into the ones with the probability
+		// smaller and larger than the average, and each small element is paired with a large element.
+		std::vector<int> smallIndices, largeIndices;
+		smallIndices.reserve(n);
+		largeIndices.reserve(n);
+		for (int i = 0; i < n; i++)
+		{
+			(scaled[i] < 1.0 ? smallIndices : largeIndices).push_back(i);
+		}
+
+		while (!smallIndices.empty() && !largeIndices.empty())
+		{
+			const int s = smallIndices.back(); smallIndices.pop_back();
+			const int l = largeIndices.back(); largeIndices.pop_back();
+			table[s].prob = Math::Float(scaled[s]);
+			table[s].alias = l;
+			scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+			(scaled[l] < 1.0 ? smallIndices : largeIndices).push_back(l);
+		}
+
+		// Remaining elements have the probability one up to the numerical error
+		for (int i : smallIndices) { table[i].prob = Math::Float(1); table[i].alias = i; }
+		for (int i : largeIndices) { table[i].prob = Math::Float(1); table[i].alias = i; }
+	}
+
+	size_t Sample(const Math::Float& u) const
+	{
+		auto v = u;
+		return SampleReuse(v);
+	}
+
+	// Reusable version of #Sample
+	// #u is rescaled to [0, 1)
+	size_t SampleReuse(Math::Float& u) const
+	{
+		const Math::Float OneMinusEps = Math::Float(1) - std::numeric_limits<Math::Float>::epsilon();
+		const int n = static_cast<int>(table.size());
+		const auto x = u * Math::Float(n);
+		const int i = Math::Clamp(static_cast<int>(x), 0, n - 1);
+		const auto f = Math::Min(x - Math::Float(i), OneMinusEps);
+		const auto& entry = table[i];
+		if (f < entry.prob)
+		{
+			u = Math::Min(f / entry.prob, OneMinusEps);
+			return static_cast<size_t>(i);
+		}
+
+		u = Math::Min((f - entry.prob) / (Math::Float(1) - entry.prob), OneMinusEps);
+		return static_cast<size_t>(entry.alias);
+	}
+
+	Math::Float EvaluatePDF(int i) const
+	{
+		return (i < 0 || i >= static_cast<int>(pdf.size())) ? Math::Float(0) : pdf[i];
+	}
+
+	// Sum of the added values before normalization
+	Math::Float Sum() const
+	{
+		return sum;
+	}
+
+	void Clear()
+	{
+		pdf.clear();
+		table.clear();
+		sum = Math::Float(0);
+	}
+
+	bool Empty() const
+	{
+		return pdf.empty();
+	}
+
+private:
+
+	std::vector<Math::Float> pdf;
+	std::vector<Entry> table;
+	Math::Float sum;
+
+};
+
+/*!
+	Piecewise constant 2D distribution.
+	Offers interface for creating and sampling from a piecewise constant PDF on [0, 1]^2
+	defined by a grid of non-negative values.
+	A cell is chosen from the marginal distribution of the rows and
+	the conditional distribution of the columns in the row, both of which are sampled in O(1).
+*/
+class PiecewiseConstantDistribution2D
+{
+public:
+
+	PiecewiseConstantDistribution2D() : width(0), height(0) {}
+
+public:
+
+	/*!
+		Build the distribution.
+		\param values Values of the cells in row major order (#width * #height elements).
+		\param width Number of columns.
+		\param height Number of rows.
+	*/
+	void Build(const std::vector<Math::Float>& values, int width, int height)
+	{
+		this->width = width;
+		this->height = height;
+		conditional.assign(height, DiscreteAliasDistribution1D());
+		marginal.Clear();
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				conditional[y].Add(values[width * y + x]);
+			}
+			conditional[y].Normalize();
+			marginal.Add(conditional[y].Sum());
+		}
+		marginal.Normalize();
+	}
+
+	/*!
+		Sample a point.
+		\param u Uniform random numbers in [0, 1)^2.
+		\param pdf PDF of the sampled point w.r.t. the area measure on [0, 1]^2.
+		\return Sampled point.
+	*/
+	Math::Vec2 Sample(const Math::Vec2& u, Math::Float& pdf) const
+	{
+		auto uy = u.y;
+		auto ux = u.x;
+		const int y = static_cast<int>(marginal.SampleReuse(uy));
+		const int x = static_cast<int>(conditional[y].SampleReuse(ux));
+		pdf = marginal.EvaluatePDF(y) * conditional[y].EvaluatePDF(x) * Math::Float(width * height);
+		return Math::Vec2((Math::Float(x) + ux) / Math::Float(width), (Math::Float(y) + uy) / Math::Float(height));
+	}
+
+	/*!
+		Evaluate the PDF.
+		\param uv A point in [0, 1]^2.
+		\return PDF of the point w.r.t. the area measure on [0, 1]^2.
+	*/
+	Math::Float EvaluatePDF(const Math::Vec2& uv) const
+	{
+		const int x = Math::Clamp(static_cast<int>(uv.x * Math::Float(width)), 0, width - 1);
+		const int y = Math::Clamp(static_cast<int>(uv.y * Math::Float(height)), 0, height - 1);
+		return marginal.EvaluatePDF(y) * conditional[y].EvaluatePDF(x) * Math::Float(width * height);
+	}
+
+	/*!
+		Sum of the values.
+		\return Sum of the values of the cells.
+	*/
+	Math::Float Sum() const
+	{
+		return marginal.Sum();
+	}
+
+private:
+
+	int width, height;
+	std::vector<DiscreteAliasDistribution1D> conditional;	// Conditional distributions of the columns for each row
+	DiscreteAliasDistribution1D marginal;					// Marginal distribution of the rows
+
+};
+
 LM_MATH_NAMESPACE_END
 LM_NAMESPACE_END
 
@@ -0,0 +1,114 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef LIB_LIGHTMETRICA_NUMA_H
+#define LIB_LIGHTMETRICA_NUMA_H
+
+#include "common.h"
+#include <vector>
+#include <cstddef>
+
+LM_NAMESPACE_BEGIN
+
+/*!
+	NUMA utility.
+	Helper functions for NUMA-aware thread placement and memory allocation.
+	The topology is obtained from sysfs (/sys/devices/system/node).
+	Memory is allocated with libnuma if available (LM_NUMA),
+	otherwise we rely on the first-touch policy of the OS.
+	On non-Linux platforms the system is regarded as a single node
+	and thread binding is not supported.
+*/
+class LM_PUBLIC_API NUMAUtils
+{
+private:
+
+	NUMAUtils() {}
+	LM_DISABLE_COPY_AND_MOVE(NUMAUtils);
+
+public:
+
+	/*!
+		Get number of NUMA nodes.
+		\return Number of nodes (always >= 1).
+	*/
+	static int NumNodes();
+
+	/*!
+		Get CPUs in the node.
+		Only CPUs which the process is allowed to run on are returned.
+		\param node Node index.
+		\return List of CPU indices.
+	*/
+	static std::vector<int> NodeCPUs(int node);
+
+	/*!
+		Assign CPUs to the threads.
+		Threads are distributed to the nodes in round-robin manner
+		so that the memory bandwidth of all nodes are utilized.
+		\param numThreads Number of threads.
+		\return CPU indices for each thread.
+	*/
+	static std::vector<int> AssignCPUs(int numThreads);
+
+	/*!
+		Bind current thread to the CPU.
+		The node of the CPU is recorded and can be queried by #CurrentThreadNode.
+		\param cpu CPU index.
+		\retval true Succeeded to bind.
+		\retval false Failed to bind.
+	*/
+	static bool BindCurrentThread(int cpu);
+
+	/*!
+		Unbind current thread.
+		Restores the affinity of the current thread to all allowed CPUs.
+	*/
+	static void UnbindCurrentThread();
+
+	/*!
+		Get the node of current thread.
+		\return Node index, or -1 if the thread is not bound.
+	*/
+	static int CurrentThreadNode();
+
+	/*!
+		Allocate memory on the node.
+		If libnuma is not available, the memory is allocated with the default policy,
+		so the memory should be initialized by a thread bound to the node.
+		The memory is aligned to at least 16 bytes.
+		\param size Size in bytes.
+		\param node Node index.
+		\return Allocated memory.
+	*/
+	static void* Allocate(size_t size, int node);
+
+	/*!
+		Free memory allocated by #Allocate.
+		\param p Memory.
+		\param size Size in bytes (must be same as the allocated size).
+	*/
+	static void Free(void* p, size_t size);
+
+};
+
+LM_NAMESPACE_END
+
+#endif // LIB_LIGHTMETRICA_NUMA_H
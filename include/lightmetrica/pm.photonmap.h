@@ -25,6 +25,7 @@
 #include "component.h"
 #include "pm.photon.h"
 #include <functional>
+#include <algorithm>
 
 LM_NAMESPACE_BEGIN
 
@@ -52,12 +53,81 @@ public:
 	//! Function called when a photon is collected in CollectPhotons
 	typedef std::function<void (const Math::Vec3&, const Photon&, Math::Float&)> PhotonCollectFunc;
 
+	//! Collected photon and its squared distance to the query point
+	typedef std::pair<const Photon*, Math::Float> CollectedPhotonInfo;
+
 public:
 
 	virtual void Build(const Photons& photons) = 0;
 	virtual void CollectPhotons(const Math::Vec3& p, Math::Float& maxDist2, const PhotonCollectFunc& collectFunc) const = 0;
 	virtual void GetPhotons(std::vector<const Photon*>& photons) const = 0;
 
+	/*!
+		Set the maximum query radius.
+		Some implementations utilize the radius for the construction of the acceleration structure.
+		The function must be called before #Build.
+		The queries with larger radius are still supported, possibly in less efficient way.
+		\param radius Maximum query radius.
+	*/
+	virtual void SetQueryRadius(Math::Float radius) {}
+
+	/*!
+		Collect k-nearest photons.
+		Collects at most #k photons nearest to #p within the distance specified by #maxDist2.
+		If #k photons are collected, #maxDist2 is shrunk to the squared distance to the farthest one.
+		The default implementation maintains a bounded heap with #CollectPhotons.
+		\param p Query point.
+		\param k Maximum number of photons.
+		\param maxDist2 Squared maximum distance.
+		\param collected Collected photons organized as a max-heap of the distances.
+	*/
+	virtual void CollectNearestPhotons(const Math::Vec3& p, int k, Math::Float& maxDist2, std::vector<CollectedPhotonInfo>& collected) const
+	{
+		collected.clear();
+		CollectPhotons(p, maxDist2, [k, &collected](const Math::Vec3& p, const Photon& photon, Math::Float& maxDist2)
+		{
+			AddNearestPhoton(photon, Math::Length2(photon.p - p), static_cast<size_t>(k), maxDist2, collected);
+		});
+	}
+
+protected:
+
+	/*!
+		Add a photon to the bounded heap of k-nearest photons.
+		The photon must be nearer than #maxDist2.
+		\param photon Photon.
+		\param dist2 Squared distance to the photon.
+		\param k Maximum number of photons.
+		\param maxDist2 Squared maximum distance, updated if the heap is full.
+		\param collected Collected photons.
+	*/
+	static void AddNearestPhoton(const Photon& photon, Math::Float dist2, size_t k, Math::Float& maxDist2, std::vector<CollectedPhotonInfo>& collected)
+	{
+		const auto comp = [](const CollectedPhotonInfo& p1, const CollectedPhotonInfo& p2)
+		{
+			return p1.second < p2.second;
+		};
+
+		if (collected.size() < k)
+		{
+			collected.emplace_back(&photon, dist2);
+			if (collected.size() == k)
+			{
+				// Create heap
+				std::make_heap(collected.begin(), collected.end(), comp);
+				maxDist2 = collected.front().second;
+			}
+		}
+		else
+		{
+			// Update heap
+			std::pop_heap(collected.begin(), collected.end(), comp);
+			collected.back() = std::make_pair(&photon, dist2);
+			std::push_heap(collected.begin(), collected.end(), comp);
+			maxDist2 = collected.front().second;
+		}
+	}
+
 };
 
 LM_NAMESPACE_END
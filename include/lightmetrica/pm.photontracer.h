@@ -0,0 +1,64 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef LIB_LIGHTMETRICA_PM_PHOTON_TRACER_H
+#define LIB_LIGHTMETRICA_PM_PHOTON_TRACER_H
+
+#include "pm.photon.h"
+
+LM_NAMESPACE_BEGIN
+
+class Scene;
+class Sampler;
+
+/*!
+	Photon tracer.
+	Traces photons from the lights for the photon mapping based renderers.
+	Photons are traced in parallel, where each thread has its own sampler and photon buffer.
+	The number of samples and the number of photons are the budgets shared among threads.
+*/
+class LM_PUBLIC_API PhotonTracer
+{
+private:
+
+	PhotonTracer() {}
+	LM_DISABLE_COPY_AND_MOVE(PhotonTracer);
+
+public:
+
+	/*!
+		Trace photons.
+		Photons are stored on the non-specular surfaces until
+		#numSamples light paths are traced or #maxPhotons photons are stored.
+		The samplers of the threads are cloned from #initialSampler and seeded by it.
+		\param scene Scene.
+		\param initialSampler Sampler.
+		\param numSamples Maximum number of light paths.
+		\param maxPhotons Maximum number of photons.
+		\param photons Traced photons.
+		\param tracedPaths Number of traced light paths is added to the value.
+	*/
+	static void TracePhotons(const Scene& scene, Sampler& initialSampler, long long numSamples, long long maxPhotons, Photons& photons, long long& tracedPaths);
+
+};
+
+LM_NAMESPACE_END
+
+#endif // LIB_LIGHTMETRICA_PM_PHOTON_TRACER_H
\ No newline at end of file
@@ -22,9 +22,129 @@
 #define LIB_LIGHTMETRICA_POOL_H
 
 #include "common.h"
+#include "align.h"
+#include <vector>
+#include <new>
 
 LM_NAMESPACE_BEGIN
 
+/*!
+	Object arena.
+	A chunked memory arena for objects of a type with bump-pointer allocation.
+	Objects are constructed in the aligned slots of the chunks in order,
+	and #Release destructs all objects at once and resets the cursor to the first slot.
+	The chunks are kept for the reuse, so that no memory is allocated or freed
+	once the arena has grown to the required size.
+	The arena is not thread-safe, thus each thread should have its own arena.
+	\tparam T Object type.
+	\tparam Alignment Alignment of the slots.
+*/
+template <typename T, std::size_t Alignment>
+class ObjectArena
+{
+public:
+
+	//! Default number of slots in a chunk
+	static const std::size_t DefaultSlotsPerChunk = 64;
+
+public:
+
+	ObjectArena()
+		: slotsPerChunk(DefaultSlotsPerChunk)
+		, numConstructed(0)
+	{
+
+	}
+
+	/*!
+		Constructor.
+		\param slotsPerChunk Number of slots in a chunk.
+	*/
+	explicit ObjectArena(std::size_t slotsPerChunk)
+		: slotsPerChunk(slotsPerChunk > 0 ? slotsPerChunk : 1)
+		, numConstructed(0)
+	{
+
+	}
+
+	~ObjectArena()
+	{
+		Release();
+		for (auto* chunk : chunks)
+		{
+			aligned_free(chunk);
+		}
+	}
+
+private:
+
+	LM_DISABLE_COPY_AND_MOVE(ObjectArena);
+
+public:
+
+	/*!
+		Construct an object.
+		The object is default-constructed in the next slot.
+		A new chunk is allocated only if all slots of the existing chunks are in use.
+		\return Constructed object.
+	*/
+	T* Construct()
+	{
+		const std::size_t chunkIndex = numConstructed / slotsPerChunk;
+		if (chunkIndex == chunks.size())
+		{
+			void* chunk = aligned_malloc(SlotSize * slotsPerChunk, Alignment);
+			if (chunk == nullptr)
+			{
+				throw std::bad_alloc();
+			}
+			chunks.push_back(static_cast<unsigned char*>(chunk));
+		}
+
+		// Global placement new is used explicitly because
+		// T might define class-specific operator new (e.g., SIMDAlignedType)
+		void* slot = chunks[chunkIndex] + SlotSize * (numConstructed % slotsPerChunk);
+		T* object = ::new (slot) T;
+		numConstructed++;
+		return object;
+	}
+
+	/*!
+		Release all objects.
+		Destructs all constructed objects and resets the cursor.
+		The memory of the chunks is retained.
+	*/
+	void Release()
+	{
+		for (std::size_t i = 0; i < numConstructed; i++)
+		{
+			reinterpret_cast<T*>(chunks[i / slotsPerChunk] + SlotSize * (i % slotsPerChunk))->~T();
+		}
+		numConstructed = 0;
+	}
+
+	/*!
+		Get the number of constructed objects.
+		\return Number of constructed objects.
+	*/
+	std::size_t NumConstructed() const { return numConstructed; }
+
+	/*!
+		Get the number of allocated slots.
+		\return Number of slots in all chunks.
+	*/
+	std::size_t Capacity() const { return chunks.size() * slotsPerChunk; }
+
+private:
+
+	//! Size of a slot (rounded up to the multiple of the alignment)
+	static const std::size_t SlotSize = (sizeof(T) + Alignment - 1) / Alignment * Alignment;
+
+	std::size_t slotsPerChunk;				//!< Number of slots in a chunk
+	std::size_t numConstructed;				//!< Number of constructed objects (cursor)
+	std::vector<unsigned char*> chunks;		//!< Allocated chunks
+
+};
 
 LM_NAMESPACE_END
 
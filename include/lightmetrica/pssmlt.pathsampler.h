@@ -64,6 +64,17 @@ public:
 	*/
 	virtual PSSMLTPathSampler* Clone() const = 0;
 
+	/*!
+		Get expected number of primary sample dimensions.
+		Returns the number of samples consumed by #SampleAndEvaluate
+		for the path with maximum number of vertices,
+		which is utilized to preallocate primary samples.
+		\param maxPathVertices Maximum number of vertex, -1 specifies no limits.
+		\return Number of dimensions.
+		\sa PSSMLTPrimarySampler::Reserve
+	*/
+	virtual int PrimarySampleDimensionsHint(int maxPathVertices) const = 0;
+
 	/*!
 		Sample and evaluate light paths.
 		Light path sampling strategy such as BPT might generate
@@ -77,6 +88,27 @@ public:
 	*/
 	virtual void SampleAndEvaluate(const Scene& scene, Sampler& sampler, PSSMLTSplats& splats, int rrDepth, int maxPathVertices) = 0;
 
+	/*!
+		Sample and evaluate light paths for multiple samplers.
+		Equivalent to calling #SampleAndEvaluate for each sampler,
+		but the implementation might advance the paths in lockstep
+		in order to trace the rays of all paths in a batch.
+		The default implementation calls #SampleAndEvaluate for each sampler.
+		\param scene Scene.
+		\param samplers Abstract samplers (#n elements).
+		\param splats Evaluated pixel contributions for each sampler (#n elements).
+		\param n Number of samplers.
+		\param rrDepth Depth to begin RR, -1 skips RR.
+		\param maxPathVertices Maximum number of vertex, -1 specifies no limits.
+	*/
+	virtual void SampleAndEvaluateBatch(const Scene& scene, Sampler* const* samplers, PSSMLTSplats* const* splats, int n, int rrDepth, int maxPathVertices)
+	{
+		for (int i = 0; i < n; i++)
+		{
+			SampleAndEvaluate(scene, *samplers[i], *splats[i], rrDepth, maxPathVertices);
+		}
+	}
+
 	/*!
 		Sample and evaluate light paths (separated PSS version for BPT).
 		Primary sample spaces is separated into two parts:
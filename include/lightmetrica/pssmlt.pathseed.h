@@ -23,17 +23,23 @@
 
 #include "common.h"
 #include "math.types.h"
+#include <vector>
 
 LM_NAMESPACE_BEGIN
 
+class Random;
+
 /*!
 	Light path seed.
 	Required data to generate a seed light path.
+	A seed is identified by the stream of the rewindable sampler
+	and the sample index in the stream.
 */
 struct PSSMLTPathSeed
 {
 
-	int index;			//!< Sample index of restorable sampler
+	int stream;			//!< Stream index of restorable sampler
+	long long index;	//!< Sample index of restorable sampler
 	Math::Float I;		//!< Luminance of the sampled light path (used for debugging)
 
 	PSSMLTPathSeed()
@@ -41,8 +47,9 @@ struct PSSMLTPathSeed
 
 	}
 
-	PSSMLTPathSeed(int index, const Math::Float& I)
-		: index(index)
+	PSSMLTPathSeed(int stream, long long index, const Math::Float& I)
+		: stream(stream)
+		, index(index)
 		, I(I)
 	{
 
@@ -50,6 +57,47 @@ struct PSSMLTPathSeed
 
 };
 
+/*!
+	Reservoir of light path seeds.
+	Keeps a fixed number of seeds which are independently sampled
+	from the added candidates proportional to the luminance
+	(weighted reservoir sampling with replacement).
+	The memory usage is bounded by the number of slots
+	regardless of the number of candidates.
+*/
+struct PSSMLTPathSeedReservoir
+{
+
+	std::vector<PSSMLTPathSeed> seeds;	//!< Sampled seeds
+	Math::Float sumI;					//!< Sum of luminance of the candidates
+	long long numCandidates;			//!< Number of candidates
+	size_t next;						//!< Index of the next seed returned by #Next
+
+	/*!
+		Initialize the reservoir.
+		\param size Number of slots.
+	*/
+	LM_PUBLIC_API void Initialize(size_t size);
+
+	/*!
+		Add a candidate.
+		Each slot is replaced by the candidate with the probability
+		of the luminance of the candidate over the sum of luminance.
+		\param candidate Candidate.
+		\param rng Random number generator.
+	*/
+	LM_PUBLIC_API void Add(const PSSMLTPathSeed& candidate, Random& rng);
+
+	/*!
+		Get a seed.
+		Returns the seeds in the slots in order.
+		The seeds are reused if all seeds are returned.
+		\return Seed.
+	*/
+	LM_PUBLIC_API const PSSMLTPathSeed& Next();
+
+};
+
 LM_NAMESPACE_END
 
 #endif // LIB_LIGHTMETRICA_PSSMLT_PATH_SEED_H
\ No newline at end of file
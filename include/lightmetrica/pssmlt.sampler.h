@@ -62,6 +62,16 @@ public:
 	*/
 	virtual void Configure(Random* rng, const Math::Float& s1, const Math::Float& s2) = 0;
 
+	/*!
+		Reserve primary samples.
+		Preallocates the internal storage for #numDimensions primary samples
+		in order to avoid reallocations while the mutations.
+		The storage grows automatically if a path requires more dimensions.
+		\param numDimensions Expected number of dimensions.
+		\sa PSSMLTPathSampler::PrimarySampleDimensionsHint
+	*/
+	virtual void Reserve(int numDimensions) = 0;
+
 	/*!
 		Accept mutation.
 		Indicates to accept mutated samples.
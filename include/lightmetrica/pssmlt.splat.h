@@ -24,6 +24,7 @@
 #include "common.h"
 #include "math.types.h"
 #include "align.h"
+#include "film.h"
 #include <vector>
 
 LM_NAMESPACE_BEGIN
@@ -31,14 +32,14 @@ LM_NAMESPACE_BEGIN
 /*!
 	Splat for path sampler.
 	Used as a sampled result of light path sampler in PSSMLT.
+	In addition to #Splat, the splat holds the strategy
+	with which the path is sampled.
 */
-struct PSSMLTSplat
+struct PSSMLTSplat : public Splat
 {
 
 	int s;						//!< # of light subpath vertices
 	int t;						//!< # of eye subpath vertices
-	Math::Vec2 rasterPos;		//!< Raster position
-	Math::Vec3 L;				//!< Radiance
 
 	PSSMLTSplat()
 	{
@@ -46,35 +47,33 @@ struct PSSMLTSplat
 	}
 
 	PSSMLTSplat(int s, int t, const Math::Vec2& rasterPos, const Math::Vec3& L)
-		: s(s)
+		: Splat(rasterPos, L)
+		, s(s)
 		, t(t)
-		, rasterPos(rasterPos)
-		, L(L)
 	{
 		
 	}
 
 	PSSMLTSplat(const Math::Vec2& rasterPos, const Math::Vec3& L)
-		: s(0)
+		: Splat(rasterPos, L)
+		, s(0)
 		, t(0)
-		, rasterPos(rasterPos)
-		, L(L)
 	{
 
 	}
 
 };
 
-class Film;
-
 /*!
 	List of splats.
 	List of evaluated result of the sampled light paths.
+	The splats are stored contiguously so that they can be
+	accumulated to the film at once (see Film::AccumulateContributions).
 */
 struct PSSMLTSplats
 {
 
-	std::vector<PSSMLTSplat, aligned_allocator<PSSMLTSplat, std::alignment_of<PSSMLTSplat>::value>> splats;
+	std::vector<Splat, aligned_allocator<Splat, std::alignment_of<Splat>::value>> splats;
 
 	LM_PUBLIC_API Math::Float SumI() const;
 	LM_PUBLIC_API void AccumulateContributionToFilm(Film& film, const Math::Float& weight) const;
@@ -59,6 +59,37 @@ public:
 	*/
 	virtual void SetSeed(unsigned int seed) = 0;
 
+	/*!
+		Skip random numbers.
+		Advances the internal state as if #NextUInt is called #n times.
+		The default implementation actually generates the numbers,
+		counter-based generators can override the function to skip in constant time.
+		\param n Number of random numbers to be skipped.
+	*/
+	virtual void Skip(unsigned long long n)
+	{
+		for (unsigned long long i = 0; i < n; i++)
+		{
+			NextUInt();
+		}
+	}
+
+	/*!
+		Generate pseudorandom numbers as unsigned integer type at once.
+		Equivalent to calling #NextUInt #n times.
+		Implementations can override the function in order to avoid
+		the virtual function call per number or to generate the numbers in bulk.
+		\param values Generated numbers (#n elements).
+		\param n Number of random numbers.
+	*/
+	virtual void FillUInt(unsigned int* values, size_t n)
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			values[i] = NextUInt();
+		}
+	}
+
 	/*!
 		Clone.
 		\return Duplicated instance.
@@ -79,6 +110,14 @@ public:
 	*/
 	LM_FORCE_INLINE Math::Vec2 NextVec2();
 
+	/*!
+		Generate pseudorandom numbers as floating point type at once.
+		Equivalent to calling #Next #n times.
+		\param values Generated numbers (#n elements).
+		\param n Number of random numbers.
+	*/
+	LM_FORCE_INLINE void Fill(Math::Float* values, size_t n);
+
 private:
 
 	class Impl;
@@ -35,4 +35,19 @@ LM_FORCE_INLINE Math::Vec2 Random::NextVec2()
 	return Math::Vec2(u1, u2);
 }
 
+LM_FORCE_INLINE void Random::Fill(Math::Float* values, size_t n)
+{
+	const size_t ChunkSize = 64;
+	unsigned int buffer[ChunkSize];
+	for (size_t begin = 0; begin < n; begin += ChunkSize)
+	{
+		const size_t size = n - begin < ChunkSize ? n - begin : ChunkSize;
+		FillUInt(buffer, size);
+		for (size_t i = 0; i < size; i++)
+		{
+			values[begin + i] = Math::Float(buffer[i] * (1.0/4294967296.0));
+		}
+	}
+}
+
 LM_NAMESPACE_END
\ No newline at end of file
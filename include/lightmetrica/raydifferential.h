@@ -0,0 +1,149 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#ifndef LIB_LIGHTMETRICA_RAY_DIFFERENTIAL_H
+#define LIB_LIGHTMETRICA_RAY_DIFFERENTIAL_H
+
+#include "ray.h"
+#include "surfacegeometry.h"
+#include "math.functions.h"
+
+LM_NAMESPACE_BEGIN
+
+/*!
+	Ray differential.
+	Differentials of the origin and the direction of a ray w.r.t.
+	the offsets of the raster position by a pixel in x and y directions.
+	The differentials are tracked along with #Ray in order to estimate
+	the footprint of the path on the surfaces, e.g., for the filtering of the textures.
+	The normals are assumed to be constant around the intersection points.
+	Reference:
+		H. Igehy, Tracing ray differentials,
+		Procs. of the 26th annual conference on Computer graphics and interactive techniques, 1999.
+*/
+struct RayDifferential
+{
+
+	Math::Vec3 dodx, dody;		//!< Differentials of the origin
+	Math::Vec3 dddx, dddy;		//!< Differentials of the normalized direction
+
+	/*!
+		Transfer the differentials to the intersection point.
+		Replaces the differentials of the origin with the ones of the intersection point
+		and computes the footprint of the ray in the texture coordinates.
+		\param ray Intersected ray. #Ray::d must be normalized.
+		\param geom Surface geometry of the intersection point. #SurfaceGeometry::uvFootprint is updated.
+	*/
+	LM_FORCE_INLINE void Transfer(const Ray& ray, SurfaceGeometry& geom)
+	{
+		geom.uvFootprint = Math::Float(0);
+
+		// Differentials of the intersection point on the tangent plane
+		const auto dDotN = Math::Dot(ray.d, geom.gn);
+		if (Math::Abs(dDotN) < Math::Constants::Eps())
+		{
+			return;
+		}
+
+		dodx += dddx * ray.maxT;
+		dody += dddy * ray.maxT;
+		dodx -= ray.d * (Math::Dot(dodx, geom.gn) / dDotN);
+		dody -= ray.d * (Math::Dot(dody, geom.gn) / dDotN);
+
+		// Differentials of the texture coordinates
+		// Solve dpdx = dudx * dpdu + dvdx * dpdv in the two dimensions
+		// where the projection of the tangent plane is not degenerated
+		const auto n = Math::Vec3(Math::Abs(geom.gn.x), Math::Abs(geom.gn.y), Math::Abs(geom.gn.z));
+		const int i0 = n.x > n.y && n.x > n.z ? 1 : 0;
+		const int i1 = n.z > n.x && n.z > n.y ? 1 : 2;
+		const auto det = geom.dpdu[i0] * geom.dpdv[i1] - geom.dpdv[i0] * geom.dpdu[i1];
+		if (Math::IsZero(det))
+		{
+			return;
+		}
+
+		const auto invDet = Math::Float(1) / det;
+		const auto dudx = (geom.dpdv[i1] * dodx[i0] - geom.dpdv[i0] * dodx[i1]) * invDet;
+		const auto dvdx = (geom.dpdu[i0] * dodx[i1] - geom.dpdu[i1] * dodx[i0]) * invDet;
+		const auto dudy = (geom.dpdv[i1] * dody[i0] - geom.dpdv[i0] * dody[i1]) * invDet;
+		const auto dvdy = (geom.dpdu[i0] * dody[i1] - geom.dpdu[i1] * dody[i0]) * invDet;
+		geom.uvFootprint = Math::Max(
+			Math::Sqrt(dudx * dudx + dvdx * dvdx),
+			Math::Sqrt(dudy * dudy + dvdy * dvdy));
+	}
+
+	/*!
+		Propagate the direction differentials through the specular reflection.
+		\param n Normal of the surface.
+	*/
+	LM_FORCE_INLINE void Reflect(const Math::Vec3& n)
+	{
+		dddx -= n * (Math::Float(2) * Math::Dot(dddx, n));
+		dddy -= n * (Math::Float(2) * Math::Dot(dddy, n));
+	}
+
+	/*!
+		Propagate the direction differentials through the specular refraction.
+		The refracted direction is wo = eta * d + mu * n
+		where mu = -eta * (d, n) - cos(theta_t) and n is in the same side as -d.
+		\param d Direction of the incident ray.
+		\param wo Refracted direction.
+		\param n Normal of the surface.
+		\param eta Relative index of refraction (the incident side over the transmitted side).
+	*/
+	LM_FORCE_INLINE void Refract(const Math::Vec3& d, const Math::Vec3& wo, const Math::Vec3& n, const Math::Float& eta)
+	{
+		const auto nn = Math::Dot(d, n) < Math::Float(0) ? n : -n;
+		const auto cosThetaT = Math::Abs(Math::Dot(wo, nn));
+		if (cosThetaT < Math::Constants::Eps())
+		{
+			return;
+		}
+
+		// d(mu) = -(eta + eta^2 * (d, n) / cos(theta_t)) * (dd, n)
+		const auto k = -(eta + eta * eta * Math::Dot(d, nn) / cosThetaT);
+		dddx = dddx * eta + nn * (k * Math::Dot(dddx, nn));
+		dddy = dddy * eta + nn * (k * Math::Dot(dddy, nn));
+	}
+
+	/*!
+		Approximate the direction differentials with the spread of the sampled lobe.
+		The angular width is approximated by the square root of the solid angle
+		per sample 1 / pdf, and clamped by #MaxSpread.
+		Utilized for non-specular BSDFs where the exact differentials are not available.
+		\param wo Sampled direction.
+		\param pdf PDF of #wo in the solid angle measure.
+	*/
+	LM_FORCE_INLINE void Spread(const Math::Vec3& wo, const Math::Float& pdf)
+	{
+		const auto MaxSpread = Math::Float(0.25);
+		const auto width = pdf > Math::Float(0) ? Math::Min(MaxSpread, Math::Float(1) / Math::Sqrt(pdf)) : MaxSpread;
+		Math::Vec3 s, t;
+		Math::OrthonormalBasis(wo, s, t);
+		dddx = s * width;
+		dddy = t * width;
+	}
+
+};
+
+LM_NAMESPACE_END
+
+#endif // LIB_LIGHTMETRICA_RAY_DIFFERENTIAL_H
\ No newline at end of file
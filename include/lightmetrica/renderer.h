@@ -102,6 +102,28 @@ public:
 	*/
 	virtual RenderProcess* CreateRenderProcess(const Scene& scene, int threadID, int numThreads) = 0;
 
+	/*!
+		Get number of samples per iteration.
+		Iterative renderers (e.g., progressive photon mapping) process the samples in iterations,
+		where each iteration requires a global preprocess (see #PreprocessIteration).
+		The default implementation returns -1, i.e., the renderer is not iterative.
+		\return Number of samples per iteration, or -1 if the renderer is not iterative.
+	*/
+	virtual long long NumSamplesPerIteration() const { return -1; }
+
+	/*!
+		Preprocess an iteration.
+		For iterative renderers, schedulers call the function before processing the samples of each iteration.
+		The function is called outside of the parallel region of the scheduler,
+		so that the function can utilize multiple threads.
+		The default implementation does nothing.
+		\param scene Scene.
+		\param iteration Index of the iteration.
+		\retval true Succeeded to preprocess.
+		\retval false Failed to preprocess.
+	*/
+	virtual bool PreprocessIteration(const Scene& scene, long long iteration) { return true; }
+
 public:
 
 	/*!
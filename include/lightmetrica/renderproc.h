@@ -75,6 +75,17 @@ public:
 	*/
 	virtual const Film* GetFilm() const = 0;
 
+	/*!
+		Set sample index.
+		Schedulers call the function before #ProcessSingleSample
+		with the global index of the sample.
+		The index is utilized by the renderers in order to assign
+		pixels and per-pixel sample indices to the samples.
+		The default implementation does nothing.
+		\param index Sample index.
+	*/
+	virtual void SetSampleIndex(long long index) {}
+
 };
 
 // --------------------------------------------------------------------------------
@@ -95,6 +106,27 @@ public:
 	*/
 	virtual void ProcessSinglePixel(const Scene& scene, const Math::Vec2i& pixel) = 0;
 
+	/*!
+		Process a tile.
+		Processes pixels in [begin, end) at once.
+		The default implementation calls #ProcessSinglePixel for each pixel in scanline order.
+		Implementations can override the function in order to exploit
+		the coherency of the pixels in the tile (e.g., packets of primary rays).
+		\param scene Scene.
+		\param begin Pixel coordinates of the top-left corner of the tile (inclusive).
+		\param end Pixel coordinates of the bottom-right corner of the tile (exclusive).
+	*/
+	virtual void ProcessTile(const Scene& scene, const Math::Vec2i& begin, const Math::Vec2i& end)
+	{
+		for (int y = begin.y; y < end.y; y++)
+		{
+			for (int x = begin.x; x < end.x; x++)
+			{
+				ProcessSinglePixel(scene, Math::Vec2i(x, y));
+			}
+		}
+	}
+
 };
 
 LM_NAMESPACE_END
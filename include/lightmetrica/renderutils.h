@@ -28,6 +28,8 @@ LM_NAMESPACE_BEGIN
 
 struct SurfaceGeometry;
 class Scene;
+class Sampler;
+class Film;
 
 /*!
 	Render utilities.
@@ -74,6 +76,33 @@ public:
 	*/
 	static bool Visible(const Scene& scene, const Math::Vec3& p1, const Math::Vec3& p2);
 
+	/*!
+		Begin a sample and generate raster position.
+		If the sampler requires sample indices (e.g., low-discrepancy samplers),
+		pixels are assigned to the samples in round-robin order and
+		the raster position is jittered inside the pixel with
+		the first two dimensions of the per-pixel sequence.
+		Otherwise the raster position is uniformly sampled from the entire raster.
+		\param sampler Sampler.
+		\param film Film.
+		\param sampleIndex Global index of the sample.
+		\return Raster position in [0, 1]^2.
+	*/
+	static Math::Vec2 BeginSample(Sampler& sampler, const Film& film, long long sampleIndex);
+
+	/*!
+		Compute squared radius of progressive density estimation.
+		The radius is globally reduced for each iteration
+		as r_{i+1}^2 = r_i^2 (i + alpha) / (i + 1) [Knaus & Zwicker 2011],
+		where the radius of the first iteration (i = 0) is the initial radius.
+		\param radius2 Squared radius of the previous iteration (ignored if #iteration is zero).
+		\param initialRadius Initial radius.
+		\param alpha Parameter to control the reduction of the radius in (0, 1).
+		\param iteration Index of the current iteration.
+		\return Squared radius of the current iteration.
+	*/
+	static Math::Float ProgressiveRadius2(Math::Float radius2, Math::Float initialRadius, Math::Float alpha, long long iteration);
+
 };
 
 LM_NAMESPACE_END
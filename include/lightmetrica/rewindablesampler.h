@@ -63,10 +63,12 @@ public:
 		The index values can be obtained by #SampleIndex function.
 		In the condition of the same seed, this function guarantees
 		to generate same sequence of samples after #index.
+		The cost of the function depends on Random::Skip of the underlying generator,
+		which is constant for counter-based generators (e.g., \a philox).
 		\param index Sample index.
 		\sa SampleIndex
 	*/
-	virtual void Rewind(int index) = 0;
+	virtual void Rewind(long long index) = 0;
 
 	/*!
 		Get the current sampler index.
@@ -74,7 +76,7 @@ public:
 		\return Current sample index.
 		\sa Rewind
 	*/
-	virtual int SampleIndex() const = 0;
+	virtual long long SampleIndex() const = 0;
 
 };
 
@@ -84,6 +84,40 @@ public:
 	*/
 	virtual Random* Rng() = 0;
 
+public:
+
+	/*!
+		Check if the sampler requires sample indices.
+		Samplers based on low-discrepancy sequences generate the points
+		of the sequences specified by #BeginSample.
+		Renderers are responsible to assign pixels and sample indices
+		to the samples if the function returns true.
+		\retval true The sampler requires sample indices.
+		\retval false The sampler does not require sample indices.
+	*/
+	virtual bool RequiresSampleIndex() const { return false; }
+
+	/*!
+		Begin a new sample.
+		Specifies the pixel and the index of the sample in the pixel.
+		Following calls of #Next or #NextVec2 return
+		the elements of the point from the first dimension.
+		The default implementation does nothing.
+		\param pixel Pixel index.
+		\param index Sample index in the pixel.
+	*/
+	virtual void BeginSample(long long pixel, long long index) {}
+
+	/*!
+		Set the dimension of the next sample.
+		Path renderers assign fixed dimension offsets per bounce
+		so that the same dimensions are utilized for the same purpose
+		regardless of the number of samples consumed by previous bounces.
+		The default implementation does nothing.
+		\param dimension Dimension.
+	*/
+	virtual void SetDimension(int dimension) {}
+
 public:
 
 	/*!
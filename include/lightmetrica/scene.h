@@ -36,6 +36,7 @@ class ConfigNode;
 class Camera;
 class Light;
 class Primitives;
+class LightSelector;
 struct Primitive;
 struct Ray;
 struct Intersection;
@@ -64,10 +65,22 @@ public:
 	/*!
 		Load primitives.
 		Ownership of #primitives is delegated to this class.
+		The light selector is built with the lights of the primitives,
+		so that the lights can be selected before #PostConfigure.
 		\param primitives Primitives.
 	*/
 	LM_PUBLIC_API void Load(Primitives* primitives);
 
+	/*!
+		Load light selector.
+		Ownership of #lightSelector is delegated to this class.
+		If the light selector is not loaded, the uniform light selector is used.
+		The function must be called before #PostConfigure,
+		which rebuilds the light selector after the powers of the lights are determined.
+		\param lightSelector Light selector.
+	*/
+	LM_PUBLIC_API void LoadLightSelector(LightSelector* lightSelector);
+
 	/*!
 		Post configuration of the scene.
 		This function must be called after #Build.
@@ -87,6 +100,31 @@ public:
 	*/
 	LM_PUBLIC_API bool Intersect(Ray& ray, Intersection& isect) const;
 
+	/*!
+		Batched intersection query.
+		Equivalent to calling #Intersect for each ray,
+		but the implementation might overlap the memory accesses
+		of the traversals of the rays in order to hide the latency.
+		\param rays Rays (#n elements).
+		\param isects Intersection data (#n elements).
+		\param hits Resulting flags, true if the ray is intersected with the scene (#n elements).
+		\param n Number of rays.
+	*/
+	LM_PUBLIC_API void IntersectBatch(Ray* rays, Intersection* isects, bool* hits, int n) const;
+
+	/*!
+		Batched occlusion query.
+		Checks if each ray hits with the scene in the range [minT, maxT].
+		Unlike #IntersectBatch, the traversal of a ray can be terminated on the first hit
+		and no information on the hit point is reconstructed,
+		which is suitable for the visibility tests of shadow rays.
+		Note that #maxT of the rays might be modified.
+		\param rays Rays (#n elements).
+		\param occluded Resulting flags, true if the ray is occluded (#n elements).
+		\param n Number of rays.
+	*/
+	LM_PUBLIC_API void OccludedBatch(Ray* rays, bool* occluded, int n) const;
+
 	/*!
 		Get a main camera.
 		\return Main camera.
@@ -97,14 +135,28 @@ public:
 		Choose a light included in the scene (reusable version).
 		Note that only the x component of #lightSampleP is used
 		and reusable in the following procedure, e.g. positional sampling on the light.
+		The selection is independent of the position.
 		\param lightSampleP Light sample.
 		\param selectionPdf PDF evaluation of the selection (discrete measure).
 		\return Selected light.
 	*/
 	LM_PUBLIC_API const Light* SampleLightSelection(Math::Vec2& lightSampleP, Math::PDFEval& selectionPdf) const;
 
+	/*!
+		Choose a light included in the scene according to the shading point (reusable version).
+		The function is utilized for the direct light sampling from #p.
+		Note that only the x component of #lightSampleP is used
+		and reusable in the following procedure, e.g. positional sampling on the light.
+		\param p Position of the shading point.
+		\param lightSampleP Light sample.
+		\param selectionPdf PDF evaluation of the selection (discrete measure).
+		\return Selected light.
+	*/
+	LM_PUBLIC_API const Light* SampleLightSelection(const Math::Vec3& p, Math::Vec2& lightSampleP, Math::PDFEval& selectionPdf) const;
+
 	/*!
 		Choose a light included in the scene.
+		The selection is independent of the position.
 		\param lightSample Light sample.
 		\param selectionPdf PDF evaluation of the selection (discrete measure).
 		\return Selected light.
@@ -113,9 +165,20 @@ public:
 
 	/*!
 		PDF evaluation for light selection sampling.
+		Corresponds to the position independent version of #SampleLightSelection.
+		\param light Light.
+		\return Evaluated PDF.
+	*/
+	LM_PUBLIC_API Math::PDFEval LightSelectionPdf(const Light* light) const;
+
+	/*!
+		PDF evaluation for light selection sampling according to the shading point.
+		Corresponds to the position dependent version of #SampleLightSelection.
+		\param p Position of the shading point.
+		\param light Light.
 		\return Evaluated PDF.
 	*/
-	LM_PUBLIC_API Math::PDFEval LightSelectionPdf() const;
+	LM_PUBLIC_API Math::PDFEval LightSelectionPdf(const Math::Vec3& p, const Light* light) const;
 
 	/*!
 		Get AABB of the scene.
@@ -155,6 +218,25 @@ public:
 	*/
 	virtual bool IntersectTriangles(Ray& ray, Intersection& isect) const = 0;
 
+	/*!
+		Batched intersection query with triangles.
+		The default implementation calls #IntersectTriangles for each ray.
+		\param rays Rays (#n elements).
+		\param isects Intersection data (#n elements).
+		\param hits Resulting flags, true if the ray is intersected with the triangles (#n elements).
+		\param n Number of rays.
+	*/
+	virtual void IntersectTrianglesBatch(Ray* rays, Intersection* isects, bool* hits, int n) const;
+
+	/*!
+		Batched occlusion query with triangles.
+		The default implementation calls #IntersectTriangles for each ray.
+		\param rays Rays (#n elements).
+		\param occluded Resulting flags, true if the ray is occluded by the triangles (#n elements).
+		\param n Number of rays.
+	*/
+	virtual void OccludedTrianglesBatch(Ray* rays, bool* occluded, int n) const;
+
 	/*!
 		Get AABB of triangles in the scene.
 		\return AABB of triangles in the scene.
@@ -184,9 +266,20 @@ protected:
 	*/
 	void StoreIntersectionFromBarycentricCoords(unsigned int primitiveIndex, unsigned int triangleIndex, const Ray& ray, const Math::Vec2& b, Intersection& isect) const;
 
+private:
+
+	/*!
+		Build light selector.
+		Builds #lightSelector with the lights of #primitives.
+		\retval true Succeeded to build the light selector.
+		\retval false Failed to build the light selector.
+	*/
+	bool BuildLightSelector();
+
 protected:
 
 	std::unique_ptr<Primitives> primitives;
+	std::unique_ptr<LightSelector> lightSelector;
 
 };
 
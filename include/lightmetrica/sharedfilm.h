@@ -0,0 +1,86 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef LIB_LIGHTMETRICA_SHARED_FILM_H
+#define LIB_LIGHTMETRICA_SHARED_FILM_H
+
+#include "common.h"
+#include <cstddef>
+
+LM_NAMESPACE_BEGIN
+
+class Film;
+class BitmapImage;
+
+/*!
+	Shared film.
+	Manages thread-safe accumulation to a bitmap shared among threads.
+	The class is used to implement shared mode of the films (see Film::SetSharedMode).
+	Per-thread films created by #CreateThreadFilm buffer the contributions
+	in small splat buffers and flush them into the shared bitmap.
+	Pixels are guarded by striped locks, each of which protects a band of rows.
+	Buffered contributions are sorted by the pixel index before flushing,
+	so that each lock is acquired at most once per flush.
+*/
+class LM_PUBLIC_API SharedFilm
+{
+public:
+
+	/*!
+		Constructor.
+		\param bitmap Shared bitmap.
+		\param width Width of the bitmap.
+		\param height Height of the bitmap.
+		\param bufferSize Number of splats buffered per thread.
+	*/
+	SharedFilm(BitmapImage& bitmap, int width, int height, size_t bufferSize = 4096);
+	~SharedFilm();
+
+private:
+
+	LM_DISABLE_COPY_AND_MOVE(SharedFilm);
+
+public:
+
+	/*!
+		Create a per-thread film.
+		The created film must be deleted before this instance is deleted,
+		otherwise the film is detached and further contributions are ignored.
+		\return Per-thread film.
+	*/
+	Film* CreateThreadFilm();
+
+	/*!
+		Flush buffered contributions of all per-thread films.
+		The function must not be called concurrently with the accumulation.
+	*/
+	void Flush();
+
+private:
+
+	friend class SharedFilmThreadFilm;
+	class Impl;
+	Impl* p;
+
+};
+
+LM_NAMESPACE_END
+
+#endif // LIB_LIGHTMETRICA_SHARED_FILM_H
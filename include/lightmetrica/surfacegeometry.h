@@ -43,10 +43,18 @@ struct SurfaceGeometry
 	Math::Vec3 sn;					//!< Shading normal
 	Math::Vec3 ss, st;				//!< Tangent vectors w.r.t. shading normal
 	Math::Vec2 uv;					//!< Texture coordinates
+	Math::Vec3 dpdu, dpdv;			//!< Partial derivatives of #p w.r.t. texture coordinates (zero if not available)
+	Math::Float uvFootprint;		//!< Width of the footprint of the ray in texture coordinates (zero if unknown, see RayDifferential)
 
 	Math::Mat3 worldToShading;		//!< Convarsion to local shading coordinates from world coordinates
 	Math::Mat3 shadingToWorld;		//!< Convarsion to world coordinates from local shading coordinates
 
+	SurfaceGeometry()
+		: uvFootprint(0)
+	{
+
+	}
+
 	/*!
 		Compute tangent space w.r.t. shading normal.
 		Computes #sn, #sn, #worldToShading and #shadingToWorld from #sn.
@@ -44,8 +44,24 @@ public:
 
 public:
 
+	/*!
+		Evaluate the texture.
+		\param uv Texture coordinates.
+		\return Evaluated value.
+	*/
 	virtual Math::Vec3 Evaluate(const Math::Vec2& uv) const = 0;
 
+	/*!
+		Evaluate the texture with filtering.
+		The width of the footprint of the lookup is utilized as a hint
+		for the filtering, e.g. the selection of the mip-map level.
+		The default implementation ignores the footprint.
+		\param uv Texture coordinates.
+		\param footprint Width of the footprint in the texture coordinates.
+		\return Evaluated value.
+	*/
+	virtual Math::Vec3 Evaluate(const Math::Vec2& uv, const Math::Float& footprint) const { return Evaluate(uv); }
+
 };
 
 LM_NAMESPACE_END
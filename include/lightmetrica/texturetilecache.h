@@ -0,0 +1,131 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#ifndef LIB_LIGHTMETRICA_TEXTURE_TILE_CACHE_H
+#define LIB_LIGHTMETRICA_TEXTURE_TILE_CACHE_H
+
+#include "common.h"
+#include <vector>
+#include <memory>
+#include <functional>
+
+LM_NAMESPACE_BEGIN
+
+/*!
+	Texture tile cache.
+	Per-process LRU cache of the tiles of the tiled textures.
+	The tiles are loaded lazily by the loader functions given by the textures,
+	and the least recently used tiles are discarded
+	when the total size of the tiles exceeds the memory budget.
+	The tiles are shared with std::shared_ptr so that
+	the tiles being used are not released even if they are discarded from the cache.
+	The cache is divided into #NumShards shards selected by the texture ID and the tile index,
+	and the memory budget is evenly divided into the shards.
+	The least recently used tiles are discarded for each shard.
+	The functions are thread-safe.
+*/
+class LM_PUBLIC_API TextureTileCache
+{
+public:
+
+	typedef std::vector<unsigned char> TileData;
+	typedef std::function<bool (TileData&)> TileLoaderFunc;
+
+	//! Number of the shards of the cache.
+	static const int NumShards = 16;
+
+private:
+
+	TextureTileCache();
+	~TextureTileCache();
+
+	LM_DISABLE_COPY_AND_MOVE(TextureTileCache);
+
+public:
+
+	/*!
+		Get instance.
+		Obtains the process-wide instance of the cache.
+		\return Instance.
+	*/
+	static TextureTileCache& Instance();
+
+public:
+
+	/*!
+		Set memory budget.
+		The tiles of a shard are discarded if the total size of the tiles in the shard
+		exceeds the budget divided by #NumShards.
+		\param bytes Memory budget in bytes.
+	*/
+	void SetMemoryBudget(size_t bytes);
+
+	/*!
+		Get memory budget.
+		\return Memory budget in bytes.
+	*/
+	size_t MemoryBudget() const;
+
+	/*!
+		Get memory usage.
+		\return Total size of the cached tiles in bytes.
+	*/
+	size_t MemoryUsage() const;
+
+	/*!
+		Register a texture.
+		\return Unique ID of the texture used for #Lookup.
+	*/
+	int RegisterTexture();
+
+	/*!
+		Unregister a texture.
+		Discards all tiles of the texture.
+		\param textureID ID of the texture.
+	*/
+	void UnregisterTexture(int textureID);
+
+	/*!
+		Lookup a tile.
+		If the tile is not in the cache, the tile is loaded with #loader.
+		\param textureID ID of the texture.
+		\param tileIndex Index of the tile in the texture.
+		\param loader Function to load the tile.
+		\return Tile data, or nullptr if failed to load the tile.
+	*/
+	std::shared_ptr<const TileData> Lookup(int textureID, int tileIndex, const TileLoaderFunc& loader);
+
+	/*!
+		Clear the cache.
+		Discards all tiles.
+	*/
+	void Clear();
+
+private:
+
+	class Impl;
+	Impl* p;
+
+};
+
+LM_NAMESPACE_END
+
+#endif // LIB_LIGHTMETRICA_TEXTURE_TILE_CACHE_H
\ No newline at end of file
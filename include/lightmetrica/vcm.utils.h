@@ -0,0 +1,123 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef LIB_LIGHTMETRICA_VCM_UTILS_H
+#define LIB_LIGHTMETRICA_VCM_UTILS_H
+
+#include "bpt.common.h"
+#include "math.types.h"
+#include "align.h"
+#include <vector>
+
+LM_NAMESPACE_BEGIN
+
+class BPTPathVertex;
+class BPTSubpath;
+class BPTFullPath;
+
+/*!
+	Light vertex for vertex merging.
+	Records a vertex of the light sub-paths of an iteration which is used for vertex merging.
+	The vertex is stored in a compact form independent of the memory pool of the sub-path.
+*/
+struct VCMLightVertex
+{
+
+	Math::Vec3 p;						//!< Position of the vertex y_k
+	Math::Vec3 wi;						//!< Direction to y_{k-1}
+	Math::Vec3 throughput;				//!< \alpha^L_{k+1}
+	Math::Float misInvPdfSq;			//!< #BPTPathVertex::misInvPdfSq of y_k
+	Math::Float misPartialSum;			//!< #BPTPathVertex::misPartialSum of y_k
+	Math::Float misMergePartialSum;		//!< Partial sum of the merging strategies (see #VCMUtils::EvaluateMergePartialSums)
+	int numVertices;					//!< # of vertices of the light sub-path up to y_k, i.e., k + 1
+
+};
+
+typedef std::vector<VCMLightVertex, aligned_allocator<VCMLightVertex, std::alignment_of<VCMLightVertex>::value>> VCMLightVertices;
+
+/*!
+	Vertex connection and merging utilities.
+	The MIS weights combining the connection and merging strategies (power heuristics)
+	are evaluated in constant time per full-path with the partial sums
+	accumulated along the sub-paths (see \a powerincremental MIS weight).
+	The merging strategy merging x_k has the PDF of the connection strategy
+	multiplied by \eta p_A(x_k), where \eta = \pi r^2 * # of light sub-paths.
+*/
+class LM_PUBLIC_API VCMUtils
+{
+private:
+
+	VCMUtils();
+	~VCMUtils();
+
+	LM_DISABLE_COPY_AND_MOVE(VCMUtils);
+
+public:
+
+	/*!
+		Evaluate the partial sums of the merging strategies along a sub-path.
+		The MIS partial sum V_k of #BPTSubpath::Sample is extended with the merging strategies.
+		The extended sum is V_k + \eta^2 U_k with U_k = m_k + (p_{\sigma^\bot}(x_k\to x_{k-1}) / p_{\sigma^\bot}(x_{k-1}\to x_k))^2 U_{k-1},
+		where m_k is one if x_k can be merged (non-endpoint vertex with non-delta BSDF).
+		#sums[k] is the counterpart of #BPTPathVertex::misPartialSum, i.e., U_{k-1} / p_{\sigma^\bot}(x_{k-1}\to x_k)^2.
+		\param subpath Sub-path.
+		\param sums Partial sums of the merging strategies.
+	*/
+	static void EvaluateMergePartialSums(const BPTSubpath& subpath, std::vector<Math::Float>& sums);
+
+	/*!
+		Append light vertices.
+		Appends the vertices of the light sub-path which can be merged,
+		i.e., the non-endpoint vertices with non-delta generalized BSDFs.
+		\param subpath Light sub-path.
+		\param mergeSums Partial sums of the merging strategies of #subpath.
+		\param vertices Light vertices.
+	*/
+	static void AppendLightVertices(const BPTSubpath& subpath, const std::vector<Math::Float>& mergeSums, VCMLightVertices& vertices);
+
+	/*!
+		Evaluate MIS weight of a connection strategy.
+		Same as \a powerincremental MIS weight except that
+		the merging strategies are also taken into account.
+		\param fullPath Full-path.
+		\param mergePartialSumsL Partial sums of the merging strategies of the light sub-path.
+		\param mergePartialSumsE Partial sums of the merging strategies of the eye sub-path.
+		\param eta Ratio of the PDFs of merging and connection strategies.
+		\return MIS weight.
+	*/
+	static Math::Float EvaluateConnectionMISWeight(const BPTFullPath& fullPath, const std::vector<Math::Float>& mergePartialSumsL, const std::vector<Math::Float>& mergePartialSumsE, const Math::Float& eta);
+
+	/*!
+		Evaluate MIS weight of a merging strategy.
+		The full-path is given by merging z_{t-1} with the light vertex y_k,
+		where the PDFs at the merged vertex are evaluated with the BSDF of z_{t-1}.
+		\param z Eye sub-path vertex z_{t-1}.
+		\param zMergePartialSum Partial sum of the merging strategies of z_{t-1}.
+		\param y Light vertex y_k.
+		\param eta Ratio of the PDFs of merging and connection strategies.
+		\return MIS weight.
+	*/
+	static Math::Float EvaluateMergingMISWeight(const BPTPathVertex* z, const Math::Float& zMergePartialSum, const VCMLightVertex& y, const Math::Float& eta);
+
+};
+
+LM_NAMESPACE_END
+
+#endif // LIB_LIGHTMETRICA_VCM_UTILS_H
\ No newline at end of file
@@ -0,0 +1,507 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+#include "simdsupport.h"
+#include <lightmetrica/bitmapwriter.h>
+#include <lightmetrica/bitmap.h>
+#include <lightmetrica/halfutils.h>
+#include <lightmetrica/logger.h>
+#include <lightmetrica/align.h>
+#include <fstream>
+#include <cstring>
+
+LM_NAMESPACE_BEGIN
+
+namespace
+{
+
+unsigned int FloatToBits(float v)
+{
+	unsigned int bits;
+	std::memcpy(&bits, &v, sizeof(float));
+	return bits;
+}
+
+float BitsToFloat(unsigned int bits)
+{
+	float v;
+	std::memcpy(&v, &bits, sizeof(float));
+	return v;
+}
+
+/*
+	Look-up table for transfer functions.
+	The table is indexed by the exponent and the upper bits of the mantissa
+	of the clamped value in [2^-20, 1], so that the resolution is
+	fine enough for the dark region where the transfer functions are steep.
+*/
+struct TransferLUT
+{
+
+	static const unsigned int MantissaBits = 10;
+	static const unsigned int Shift = 23 - MantissaBits;
+	static const unsigned int MinBits = (127 - 20) << 23;		// 2^-20
+	static const unsigned int MaxBits = 127 << 23;				// 1
+
+	std::vector<unsigned char> table;
+
+	TransferLUT(BitmapTransferFunction transfer)
+	{
+		const unsigned int n = ((MaxBits - MinBits) >> Shift) + 1;
+		table.resize(n);
+		for (unsigned int i = 0; i < n; i++)
+		{
+			// Evaluate at the center of the bucket
+			const double v = Math::Min(1.0, static_cast<double>(BitsToFloat(MinBits + (i << Shift) + (1 << (Shift - 1)))));
+			double e;
+			if (transfer == BitmapTransferFunction::Gamma)
+			{
+				e = std::pow(v, 1.0 / 2.2);
+			}
+			else
+			{
+				e = v <= 0.0031308 ? 12.92 * v : 1.055 * std::pow(v, 1.0 / 2.4) - 0.055;
+			}
+			table[i] = static_cast<unsigned char>(Math::Clamp(e, 0.0, 1.0) * 255.0);
+		}
+	}
+
+	unsigned char Lookup(float v) const
+	{
+		// Note that NaN is also clamped to the minimum value
+		const float MinValue = BitsToFloat(MinBits);
+		if (!(v > MinValue)) v = MinValue;
+		if (v > 1.0f) v = 1.0f;
+		return table[(FloatToBits(v) - MinBits) >> Shift];
+	}
+
+	static const TransferLUT& Get(BitmapTransferFunction transfer)
+	{
+		static const TransferLUT gamma(BitmapTransferFunction::Gamma);
+		static const TransferLUT srgb(BitmapTransferFunction::SRGB);
+		return transfer == BitmapTransferFunction::Gamma ? gamma : srgb;
+	}
+
+};
+
+/*
+	Rescale a part of the internal data and convert to 32-bit floating-point values.
+*/
+void RescaleToFloat(const Math::Float* src, size_t n, const Math::Float& weight, float* dst)
+{
+	size_t i = 0;
+
+#if LM_SSE2 && LM_SINGLE_PRECISION
+	const __m128 w = _mm_set1_ps(weight);
+	for (; i + 4 <= n; i += 4)
+	{
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(src + i), w));
+	}
+#endif
+
+	for (; i < n; i++)
+	{
+		dst[i] = Math::Cast<float>(src[i] * weight);
+	}
+}
+
+// --------------------------------------------------------------------------------
+
+void AppendBytes(std::vector<char>& buffer, const void* data, size_t size)
+{
+	const char* p = reinterpret_cast<const char*>(data);
+	buffer.insert(buffer.end(), p, p + size);
+}
+
+void AppendString(std::vector<char>& buffer, const char* str)
+{
+	AppendBytes(buffer, str, std::strlen(str) + 1);
+}
+
+template <typename T>
+void AppendValue(std::vector<char>& buffer, const T& v)
+{
+	AppendBytes(buffer, &v, sizeof(T));
+}
+
+void AppendAttribute(std::vector<char>& buffer, const char* name, const char* type, const std::vector<char>& value)
+{
+	AppendString(buffer, name);
+	AppendString(buffer, type);
+	AppendValue(buffer, static_cast<int>(value.size()));
+	buffer.insert(buffer.end(), value.begin(), value.end());
+}
+
+/*
+	Run-length encoding used in OpenEXR (RLE_COMPRESSION).
+	Bytes are reordered and delta-encoded before the compression
+	in the same way as the reference implementation.
+	Returns the size of the compressed data.
+*/
+size_t CompressRLE(const std::vector<char>& in, std::vector<char>& tmp, std::vector<char>& out)
+{
+	const size_t n = in.size();
+	tmp.resize(n);
+	out.resize(n * 3 / 2 + 1);
+
+	// Reorder bytes : even bytes to the first half, odd bytes to the second half
+	{
+		size_t t1 = 0;
+		size_t t2 = (n + 1) / 2;
+		for (size_t i = 0; i < n; i += 2)
+		{
+			tmp[t1++] = in[i];
+			if (i + 1 < n)
+			{
+				tmp[t2++] = in[i + 1];
+			}
+		}
+	}
+
+	// Predictor
+	{
+		auto* t = reinterpret_cast<unsigned char*>(tmp.data());
+		int p = n > 0 ? t[0] : 0;
+		for (size_t i = 1; i < n; i++)
+		{
+			const int d = static_cast<int>(t[i]) - p + (128 + 256);
+			p = t[i];
+			t[i] = static_cast<unsigned char>(d);
+		}
+	}
+
+	// Run-length encoding
+	const int MinRunLength = 3;
+	const int MaxRunLength = 127;
+	const char* inEnd = tmp.data() + n;
+	const char* runStart = tmp.data();
+	const char* runEnd = runStart + 1;
+	signed char* outWrite = reinterpret_cast<signed char*>(out.data());
+	while (runStart < inEnd)
+	{
+		while (runEnd < inEnd && *runStart == *runEnd && runEnd - runStart - 1 < MaxRunLength)
+		{
+			++runEnd;
+		}
+
+		if (runEnd - runStart >= MinRunLength)
+		{
+			// Compressible run
+			*outWrite++ = static_cast<signed char>((runEnd - runStart) - 1);
+			*outWrite++ = *reinterpret_cast<const signed char*>(runStart);
+			runStart = runEnd;
+		}
+		else
+		{
+			// Uncompressible run
+			while (runEnd < inEnd &&
+				((runEnd + 1 >= inEnd || *runEnd != *(runEnd + 1)) ||
+				 (runEnd + 2 >= inEnd || *(runEnd + 1) != *(runEnd + 2))) &&
+				runEnd - runStart < MaxRunLength)
+			{
+				++runEnd;
+			}
+
+			*outWrite++ = static_cast<signed char>(runStart - runEnd);
+			while (runStart < runEnd)
+			{
+				*outWrite++ = *reinterpret_cast<const signed char*>(runStart++);
+			}
+		}
+
+		++runEnd;
+	}
+
+	return static_cast<size_t>(outWrite - reinterpret_cast<signed char*>(out.data()));
+}
+
+}
+
+void BitmapImageWriter::ConvertToFloat( const BitmapImage& bitmap, int width, int height, const Math::Float& weight, unsigned char* dst, size_t pitch )
+{
+	const auto* data = &bitmap.InternalData()[0];
+	#pragma omp parallel for
+	for (int y = 0; y < height; y++)
+	{
+		RescaleToFloat(data + 3 * static_cast<size_t>(y) * width, 3 * static_cast<size_t>(width), weight, reinterpret_cast<float*>(dst + y * pitch));
+	}
+}
+
+void BitmapImageWriter::ConvertTo8Bit( const BitmapImage& bitmap, int width, int height, const Math::Float& weight, BitmapTransferFunction transfer, bool bgr, unsigned char* dst, size_t pitch )
+{
+	const auto& lut = TransferLUT::Get(transfer);
+	const auto* data = &bitmap.InternalData()[0];
+	const size_t n = 3 * static_cast<size_t>(width);
+
+	// Offsets of the destination for each channel
+	const int offsets[] = { bgr ? 2 : 0, 0, bgr ? -2 : 0 };
+
+	#pragma omp parallel for
+	for (int y = 0; y < height; y++)
+	{
+		const auto* src = data + y * n;
+		auto* row = dst + y * pitch;
+		size_t i = 0;
+
+#if LM_SSE2 && LM_SINGLE_PRECISION
+		// Compute indices of the table for 4 values at once
+		const __m128 w = _mm_set1_ps(weight);
+		const __m128 minValue = _mm_set1_ps(BitsToFloat(TransferLUT::MinBits));
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128i minBits = _mm_set1_epi32(static_cast<int>(TransferLUT::MinBits));
+		LM_ALIGN_16 int indices[4];
+		for (; i + 4 <= n; i += 4)
+		{
+			// Note that _mm_max_ps returns the second operand if the first one is NaN
+			const __m128 v = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i), w), minValue), one);
+			_mm_store_si128(reinterpret_cast<__m128i*>(indices), _mm_srli_epi32(_mm_sub_epi32(_mm_castps_si128(v), minBits), TransferLUT::Shift));
+			for (size_t j = 0; j < 4; j++)
+			{
+				row[i + j + offsets[(i + j) % 3]] = lut.table[indices[j]];
+			}
+		}
+#endif
+
+		for (; i < n; i++)
+		{
+			row[i + offsets[i % 3]] = lut.Lookup(Math::Cast<float>(src[i] * weight));
+		}
+	}
+}
+
+bool BitmapImageWriter::SavePFM( const std::string& path, const BitmapImage& bitmap, int width, int height, const Math::Float& weight )
+{
+	std::ofstream ofs(path, std::ios::out | std::ios::binary);
+	if (!ofs)
+	{
+		LM_LOG_ERROR("Failed to open '" + path + "'");
+		return false;
+	}
+
+	// Header
+	// Negative scale means little endian
+	ofs << "PF\n" << width << " " << height << "\n-1\n";
+
+	// PFM stores scanlines from the bottom to the top,
+	// which is the same order as the internal data
+	const auto& data = bitmap.InternalData();
+#if LM_SINGLE_PRECISION
+	if (weight == Math::Float(1))
+	{
+		// Write the internal data as it is
+		ofs.write(reinterpret_cast<const char*>(&data[0]), data.size() * sizeof(float));
+	}
+	else
+#endif
+	{
+		// Rescale and write by blocks of scanlines
+		const int BlockSize = 64;
+		std::vector<float> buffer(3 * static_cast<size_t>(width) * BlockSize);
+		for (int begin = 0; begin < height; begin += BlockSize)
+		{
+			const int end = Math::Min(height, begin + BlockSize);
+			#pragma omp parallel for
+			for (int y = begin; y < end; y++)
+			{
+				RescaleToFloat(&data[3 * static_cast<size_t>(y) * width], 3 * static_cast<size_t>(width), weight, &buffer[3 * static_cast<size_t>(y - begin) * width]);
+			}
+			ofs.write(reinterpret_cast<const char*>(&buffer[0]), 3 * static_cast<size_t>(width) * (end - begin) * sizeof(float));
+		}
+	}
+
+	if (!ofs)
+	{
+		LM_LOG_ERROR("Failed to write '" + path + "'");
+		return false;
+	}
+
+	return true;
+}
+
+bool BitmapImageWriter::SaveOpenEXR( const std::string& path, const BitmapImage& bitmap, int width, int height, const Math::Float& weight, OpenEXRPixelType pixelType, OpenEXRCompression compression )
+{
+	std::ofstream ofs(path, std::ios::out | std::ios::binary);
+	if (!ofs)
+	{
+		LM_LOG_ERROR("Failed to open '" + path + "'");
+		return false;
+	}
+
+	// --------------------------------------------------------------------------------
+
+	// Header
+	// Note that all values are stored in little endian
+	std::vector<char> header;
+	AppendValue(header, 20000630);		// Magic number
+	AppendValue(header, 2);				// Version (single-part scanline image)
+
+	// Channels (sorted by name)
+	{
+		std::vector<char> value;
+		const char* Channels[] = { "B", "G", "R" };
+		for (const auto* channel : Channels)
+		{
+			AppendString(value, channel);
+			AppendValue(value, pixelType == OpenEXRPixelType::Half ? 1 : 2);
+			AppendValue(value, 0);				// pLinear + reserved
+			AppendValue(value, 1);				// xSampling
+			AppendValue(value, 1);				// ySampling
+		}
+		value.push_back(0);
+		AppendAttribute(header, "channels", "chlist", value);
+	}
+
+	// Compression
+	{
+		std::vector<char> value(1, compression == OpenEXRCompression::RLE ? 1 : 0);
+		AppendAttribute(header, "compression", "compression", value);
+	}
+
+	// Data window and display window
+	{
+		std::vector<char> value;
+		AppendValue(value, 0);
+		AppendValue(value, 0);
+		AppendValue(value, width - 1);
+		AppendValue(value, height - 1);
+		AppendAttribute(header, "dataWindow", "box2i", value);
+		AppendAttribute(header, "displayWindow", "box2i", value);
+	}
+
+	// Line order (increasing y)
+	{
+		std::vector<char> value(1, 0);
+		AppendAttribute(header, "lineOrder", "lineOrder", value);
+	}
+
+	// Pixel aspect ratio
+	{
+		std::vector<char> value;
+		AppendValue(value, 1.0f);
+		AppendAttribute(header, "pixelAspectRatio", "float", value);
+	}
+
+	// Screen window
+	{
+		std::vector<char> value;
+		AppendValue(value, 0.0f);
+		AppendValue(value, 0.0f);
+		AppendAttribute(header, "screenWindowCenter", "v2f", value);
+	}
+	{
+		std::vector<char> value;
+		AppendValue(value, 1.0f);
+		AppendAttribute(header, "screenWindowWidth", "float", value);
+	}
+
+	header.push_back(0);
+	ofs.write(&header[0], header.size());
+
+	// Offset table is written after the chunks are written
+	const auto offsetTablePos = ofs.tellp();
+	std::vector<unsigned long long> offsets(height, 0);
+	ofs.write(reinterpret_cast<const char*>(&offsets[0]), offsets.size() * sizeof(unsigned long long));
+
+	// --------------------------------------------------------------------------------
+
+	// Chunks
+	// A chunk contains a scanline, and the scanlines are processed in parallel by blocks.
+	const auto& data = bitmap.InternalData();
+	const size_t componentSize = pixelType == OpenEXRPixelType::Half ? 2 : 4;
+	const size_t scanlineSize = 3 * componentSize * width;
+	const int BlockSize = 256;
+	std::vector<std::vector<char>> chunks(BlockSize);
+	for (int begin = 0; begin < height; begin += BlockSize)
+	{
+		const int end = Math::Min(height, begin + BlockSize);
+
+		#pragma omp parallel
+		{
+			std::vector<char> scanline(scanlineSize);
+			std::vector<char> tmp;
+			std::vector<char> compressed;
+
+			#pragma omp for schedule(dynamic, 16)
+			for (int y = begin; y < end; y++)
+			{
+				// OpenEXR stores scanlines from the top to the bottom
+				const auto* src = &data[3 * static_cast<size_t>(height - 1 - y) * width];
+
+				// Channels are stored separately (B, G, R)
+				for (int c = 0; c < 3; c++)
+				{
+					auto* dst = &scanline[c * componentSize * width];
+					for (int x = 0; x < width; x++)
+					{
+						const float v = Math::Cast<float>(src[3 * x + (2 - c)] * weight);
+						if (pixelType == OpenEXRPixelType::Half)
+						{
+							const auto h = HalfUtils::FloatToHalf(v);
+							std::memcpy(dst + 2 * x, &h, 2);
+						}
+						else
+						{
+							std::memcpy(dst + 4 * x, &v, 4);
+						}
+					}
+				}
+
+				// Compress the scanline
+				// If the compressed data is not smaller, uncompressed data is stored
+				auto& chunk = chunks[y - begin];
+				if (compression == OpenEXRCompression::RLE)
+				{
+					const size_t size = CompressRLE(scanline, tmp, compressed);
+					if (size < scanlineSize)
+					{
+						chunk.assign(compressed.begin(), compressed.begin() + size);
+						continue;
+					}
+				}
+				chunk = scanline;
+			}
+		}
+
+		// Write chunks
+		for (int y = begin; y < end; y++)
+		{
+			const auto& chunk = chunks[y - begin];
+			offsets[y] = static_cast<unsigned long long>(ofs.tellp());
+			const int size = static_cast<int>(chunk.size());
+			ofs.write(reinterpret_cast<const char*>(&y), sizeof(int));
+			ofs.write(reinterpret_cast<const char*>(&size), sizeof(int));
+			ofs.write(&chunk[0], chunk.size());
+		}
+	}
+
+	// Offset table
+	ofs.seekp(offsetTablePos);
+	ofs.write(reinterpret_cast<const char*>(&offsets[0]), offsets.size() * sizeof(unsigned long long));
+
+	if (!ofs)
+	{
+		LM_LOG_ERROR("Failed to write '" + path + "'");
+		return false;
+	}
+
+	return true;
+}
+
+LM_NAMESPACE_END
@@ -0,0 +1,67 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+#include <lightmetrica/bpt.connection.h>
+#include <lightmetrica/scene.h>
+
+LM_NAMESPACE_BEGIN
+
+BPTConnectionBatch::BPTConnectionBatch()
+	: occludedCapacity(0)
+{
+
+}
+
+void BPTConnectionBatch::Clear()
+{
+	connections.clear();
+	shadowRays.clear();
+}
+
+void BPTConnectionBatch::Add( const BPTConnection& connection )
+{
+	connections.push_back(connection);
+	connections.back().shadowRayIndex = -1;
+}
+
+void BPTConnectionBatch::Add( const BPTConnection& connection, const Ray& shadowRay )
+{
+	connections.push_back(connection);
+	connections.back().shadowRayIndex = static_cast<int>(shadowRays.size());
+	shadowRays.push_back(shadowRay);
+}
+
+void BPTConnectionBatch::TraceShadowRays( const Scene& scene )
+{
+	if (shadowRays.empty())
+	{
+		return;
+	}
+
+	if (occludedCapacity < shadowRays.size())
+	{
+		occludedCapacity = shadowRays.size();
+		occluded.reset(new bool[occludedCapacity]);
+	}
+
+	scene.OccludedBatch(&shadowRays[0], occluded.get(), static_cast<int>(shadowRays.size()));
+}
+
+LM_NAMESPACE_END
\ No newline at end of file
@@ -25,6 +25,10 @@
 #include <lightmetrica/bpt.fullpath.h>
 #include <lightmetrica/bpt.pool.h>
 #include <lightmetrica/bpt.mis.h>
+#include <lightmetrica/bpt.lighttracer.h>
+#include <lightmetrica/bpt.lightvertexcache.h>
+#include <lightmetrica/bpt.connection.h>
+#include <lightmetrica/generalizedbsdf.h>
 #include <lightmetrica/confignode.h>
 #include <lightmetrica/scene.h>
 #include <lightmetrica/camera.h>
@@ -51,9 +55,16 @@ LM_NAMESPACE_BEGIN
 /*!
 	Veach's bidirectional path trace renderer.
 	An implementation of bidirectional path tracing (BPT) according to Veach's paper.
-	Reference:
-		E. Veach and L. Guibas, Bidirectional estimators for light transport,
-		Procs. of the Fifth Eurographics Workshop on Rendering, pp.147-162, 1994.
+	In light vertex cache mode, the light sub-paths are not sampled per sample.
+	Instead, the rendering is separated into iterations and a fixed number of light sub-paths
+	are traced in parallel in each iteration, whose vertices are stored in a flat array.
+	Then each vertex of the eye sub-path is connected to a number of cached vertices chosen uniformly.
+	The MIS weights (power heuristics) take the effective number of connection samples into account.
+	References:
+	  - E. Veach and L. Guibas, Bidirectional estimators for light transport,
+	    Procs. of the Fifth Eurographics Workshop on Rendering, pp.147-162, 1994.
+	  - T. Davidovic et al., Progressive light transport simulation on the GPU: Survey and improvements,
+	    ACM Transactions on Graphics, 33(3), 2014.
 */
 class BidirectionalPathtraceRenderer final : public Renderer
 {
@@ -72,6 +83,8 @@ public:
 	virtual bool Preprocess(const Scene& scene, const RenderProcessScheduler& sched) override;
 	virtual bool Postprocess(const Scene& scene, const RenderProcessScheduler& sched) const override;
 	virtual RenderProcess* CreateRenderProcess(const Scene& scene, int threadID, int numThreads) override;
+	virtual long long NumSamplesPerIteration() const override { return lightVertexCache ? numSamplesPerIteration : -1; }
+	virtual bool PreprocessIteration(const Scene& scene, long long iteration) override;
 	virtual boost::signals2::connection Connect_ReportProgress(const std::function<void(double, bool)>& func) override { return signal_ReportProgress.connect(func); }
 
 private:
@@ -85,6 +98,18 @@ private:
 	std::unique_ptr<ConfigurableSampler> initialSampler;	//!< Sampler
 	std::unique_ptr<BPTMISWeight> misWeight;				//!< MIS weighting function
 
+private:
+
+	bool lightVertexCache;									//!< Enables light vertex cache mode if true
+	long long numLightPaths;								//!< Number of light sub-paths of an iteration (light vertex cache mode)
+	long long numSamplesPerIteration;						//!< Number of samples of an iteration (light vertex cache mode)
+	int numConnections;										//!< Number of cached light vertices connected to each eye sub-path vertex (light vertex cache mode)
+
+private:
+
+	BPTLightSubpathTracer<BPTLightVertex> lightTracer;		// Light sub-path tracer holding the light vertex cache of the current iteration
+	Math::Float connectionCount;							// Effective number of samples of the connection strategies, i.e., #numConnections * #numLightPaths / #vertices in the cache
+
 private:
 
 #if LM_ENABLE_BPT_EXPERIMENTAL
@@ -123,6 +148,7 @@ public:
 		: renderer(renderer)
 		, sampler(sampler)
 		, film(film)
+		, sampleIndex(0)
 		, subpathL(TransportDirection::LE)
 		, subpathE(TransportDirection::EL)
 	{
@@ -137,12 +163,27 @@ public:
 
 	virtual void ProcessSingleSample(const Scene& scene) override;
 	virtual const Film* GetFilm() const override { return film.get(); }
+	virtual void SetSampleIndex(long long index) override { sampleIndex = index; }
+
+private:
+
+	/*!
+		Sample connections with the light vertex cache.
+		Connects each vertex of the eye sub-path with the cached light vertices chosen uniformly
+		and records the connections and their shadow rays.
+		The choices of the light vertices for z_{t-1} are stratified with a sample
+		of the dimension 2 + 12(t-1), which is reserved for the light sub-path
+		and unused in light vertex cache mode.
+		\param scene Scene.
+	*/
+	void SampleCachedConnections(const Scene& scene);
 
 private:
 
 	BidirectionalPathtraceRenderer& renderer;
 	std::unique_ptr<Sampler> sampler;
 	std::unique_ptr<Film> film;
+	long long sampleIndex;
 
 private:
 
@@ -151,6 +192,15 @@ private:
 	BPTPathVertexPool pool;			//!< Memory pool for path vertices
 	BPTSubpath subpathL;			//!< Light subpath
 	BPTSubpath subpathE;			//!< Eye subpath
+	std::vector<Math::Float> endpointPartialSumsE;	//!< Partial sums of the strategy t = 0 for #subpathE (light vertex cache mode)
+	std::vector<Math::Float> partialSumsE;			//!< Partial sums of the other strategies for #subpathE (light vertex cache mode)
+
+	// Contributions of a sample are accumulated to the film at once
+	std::vector<Splat, aligned_allocator<Splat, std::alignment_of<Splat>::value>> splats;		//!< Splats of the current sample
+
+	// Shadow rays of all connections of a sample are traced in a batch
+	// The MIS weights of the connections with cached light vertices are divided by the effective number of connection samples
+	BPTConnectionBatch connectionBatch;		//!< Connections of the current sample
 
 };
 
@@ -165,9 +215,9 @@ bool BidirectionalPathtraceRenderer::Configure(const ConfigNode& node, const Ass
 	// Sampler
 	auto samplerNode = node.Child("sampler");
 	auto samplerNodeType = samplerNode.AttributeValue("type");
-	if (samplerNodeType != "random")
+	if (samplerNodeType != "random" && samplerNodeType != "sobol" && samplerNodeType != "halton")
 	{
-		LM_LOG_ERROR("Invalid sampler type. This renderer requires 'random' sampler");
+		LM_LOG_ERROR("Invalid sampler type. This renderer requires 'random', 'sobol', or 'halton' sampler");
 		return false;
 	}
 	initialSampler.reset(ComponentFactory::Create<ConfigurableSampler>(samplerNodeType));
@@ -201,6 +251,42 @@ bool BidirectionalPathtraceRenderer::Configure(const ConfigNode& node, const Ass
 		return false;
 	}
 
+	// Light vertex cache mode
+	auto lightVertexCacheNode = node.Child("light_vertex_cache");
+	lightVertexCache = !lightVertexCacheNode.Empty();
+	if (lightVertexCache)
+	{
+		// 'num_light_paths' and 'num_samples_per_iteration'
+		// Default to the number of pixels, i.e., one light sub-path and one sample per pixel in average
+		const auto* film = scene.MainCamera()->GetFilm();
+		const long long numPixels = static_cast<long long>(film->Width()) * film->Height();
+		lightVertexCacheNode.ChildValueOrDefault("num_light_paths", numPixels, numLightPaths);
+		lightVertexCacheNode.ChildValueOrDefault("num_samples_per_iteration", numPixels, numSamplesPerIteration);
+		lightVertexCacheNode.ChildValueOrDefault("num_connections", 3, numConnections);
+		if (numLightPaths <= 0)
+		{
+			LM_LOG_ERROR("Invalid value for 'num_light_paths'");
+			return false;
+		}
+		if (numSamplesPerIteration <= 0)
+		{
+			LM_LOG_ERROR("Invalid value for 'num_samples_per_iteration'");
+			return false;
+		}
+		if (numConnections <= 0)
+		{
+			LM_LOG_ERROR("Invalid value for 'num_connections'");
+			return false;
+		}
+
+		// The MIS weights depending on the numbers of samples are evaluated with the partial sums
+		if (misWeightType != "powerincremental")
+		{
+			LM_LOG_ERROR("Light vertex cache mode requires 'powerincremental' MIS weighting function");
+			return false;
+		}
+	}
+
 #if LM_ENABLE_BPT_EXPERIMENTAL
 	// Experimental parameters
 	auto experimentalNode = node.Child("experimental");
@@ -217,6 +303,12 @@ bool BidirectionalPathtraceRenderer::Configure(const ConfigNode& node, const Ass
 	{
 		enableExperimentalMode = false;
 	}
+
+	if (enableExperimentalMode && lightVertexCache)
+	{
+		LM_LOG_ERROR("Experimental mode is not supported in light vertex cache mode");
+		return false;
+	}
 #endif
 
 #if LM_EXPERIMENTAL_MODE
@@ -259,6 +351,40 @@ bool BidirectionalPathtraceRenderer::Preprocess(const Scene& scene, const Render
 	}
 #endif
 
+	// Light sub-paths of the iterations are traced in parallel,
+	// where each thread has its own sampler and buffer of light vertices
+	if (lightVertexCache)
+	{
+		lightTracer.Initialize(*initialSampler);
+	}
+
+	return true;
+}
+
+bool BidirectionalPathtraceRenderer::PreprocessIteration(const Scene& scene, long long iteration)
+{
+	if (!lightVertexCache)
+	{
+		return true;
+	}
+
+	// Trace light sub-paths and store the vertices which can be connected
+	// The buffers of the partial sums are captured by value so that each thread has its own copies
+	std::vector<Math::Float> endpointPartialSums;
+	std::vector<Math::Float> partialSums;
+	lightTracer.Trace(scene, numLightPaths, rrDepth, maxPathVertices, [endpointPartialSums, partialSums](const BPTSubpath& subpath, BPTLightVertices& vertices) mutable
+	{
+		BPTLightVertexCache::EvaluatePartialSums(subpath, endpointPartialSums, partialSums);
+		BPTLightVertexCache::AppendLightVertices(subpath, endpointPartialSums, partialSums, vertices);
+	});
+
+	// Connecting an eye sub-path vertex with #numConnections of V cached vertices
+	// corresponds to the connections with #numConnections * #numLightPaths / V light sub-paths
+	const auto numLightVertices = lightTracer.Vertices().size();
+	connectionCount = numLightVertices == 0
+		? Math::Float(0)
+		: Math::Float(static_cast<double>(numConnections) * static_cast<double>(numLightPaths) / static_cast<double>(numLightVertices));
+
 	return true;
 }
 
@@ -340,10 +466,24 @@ void BidirectionalPathtraceRenderer_RenderProcess::ProcessSingleSample(const Sce
 	pool.Release();
 	subpathL.Clear();
 	subpathE.Clear();
+	splats.clear();
+	connectionBatch.Clear();
 
 	// Sample sub-paths
-	subpathL.Sample(scene, *sampler, pool, renderer.rrDepth, renderer.maxPathVertices);
-	subpathE.Sample(scene, *sampler, pool, renderer.rrDepth, renderer.maxPathVertices);
+	// Dimensions [0, 2) are used for the raster position,
+	// and the vertices of the sub-paths use the following dimensions interleaved
+	// In light vertex cache mode, only the eye sub-path is sampled
+	// and the dimensions of the light sub-path are used for the choices of the cached light vertices
+	const auto rasterPos = RenderUtils::BeginSample(*sampler, *film, sampleIndex++);
+	if (!renderer.lightVertexCache)
+	{
+		subpathL.Sample(scene, *sampler, pool, renderer.rrDepth, renderer.maxPathVertices, 2, nullptr);
+	}
+	subpathE.Sample(scene, *sampler, pool, renderer.rrDepth, renderer.maxPathVertices, 8, &rasterPos);
+	if (renderer.lightVertexCache)
+	{
+		BPTLightVertexCache::EvaluatePartialSums(subpathE, endpointPartialSumsE, partialSumsE);
+	}
 
 	// Debug print
 #if 0
@@ -368,79 +508,138 @@ void BidirectionalPathtraceRenderer_RenderProcess::ProcessSingleSample(const Sce
 	// Here we rewrote the order of summation of Veach's estimator (equation 10.3 in [Veach 1997])
 	// in order to apply MIS intuitively
 
-	const int nL = static_cast<int>(subpathL.vertices.size());
-	const int nE = static_cast<int>(subpathE.vertices.size());
+	// The connections are evaluated in three phases.
+	// First the unoccluded contributions of all strategies are evaluated
+	// and the shadow rays of the connections with non-zero contribution are collected.
+	// In light vertex cache mode, the light sub-path is empty and
+	// only the strategies with s = 0 are evaluated here.
+	// The shadow rays are then traced in a batch with occlusion-only queries,
+	// and the MIS weighted contributions of the visible connections are recorded.
+	connectionBatch.AddFullPaths(scene, subpathL, subpathE, renderer.maxPathVertices, [this](const BPTFullPath& fullPath)
+	{
+		return renderer.lightVertexCache
+			? BPTLightVertexCache::EvaluateEndpointMISWeight(fullPath, partialSumsE, renderer.connectionCount)
+			: renderer.misWeight->Evaluate(fullPath);
+	});
+
+	// Connections with the cached light vertices
+	if (renderer.lightVertexCache)
+	{
+		SampleCachedConnections(scene);
+	}
 
-	// For each subpath vertex sums n
-	// If n = 0 or 1 no valid path is generated
-	for (int n = 2; n <= nE + nL; n++)
+	// Visibility tests for the connections
+	connectionBatch.TraceShadowRays(scene);
+
+	for (const auto& connection : connectionBatch.Connections())
 	{
-		if (renderer.maxPathVertices != -1 && n > renderer.maxPathVertices)
+		if (connectionBatch.Occluded(connection))
 		{
+			// y_{s-1} and z_{t-1} is not visible each other
 			continue;
 		}
 
-		// Process full-path with length n+1 (subpath edges + connecting edge)
-		const int minS = Math::Max(0, n-nE);
-		const int maxS = Math::Min(nL, n);
+		const auto& rasterPosition = connection.rasterPosition;
+		const auto& Cstar = connection.Cstar;
 
-		for (int s = minS; s <= maxS; s++)
+#if LM_ENABLE_BPT_EXPERIMENTAL
+		// Accumulation contribution to sub-path films
+		if (renderer.enableExperimentalMode && connection.s <= renderer.maxSubpathNumVertices && connection.t <= renderer.maxSubpathNumVertices)
 		{
-			// Number of vertices in eye subpath
-			const int t = n - s;
-
-			// Create fullpath
-			BPTFullPath fullPath(s, t, subpathL, subpathE);
-
-			// Evaluate unweighted contribution C^*_{s,t}
-			Math::Vec2 rasterPosition;
-			auto Cstar = fullPath.EvaluateUnweightContribution(scene, rasterPosition);
-			if (Math::IsZero(Cstar))
+			#pragma omp critical
 			{
-				// For some reason, the sampled path is not used
-				// e.g., y_{s-1} and z_{t-1} is not visible each other
-				continue;
+				renderer.subpathFilms[connection.s*(renderer.maxSubpathNumVertices+1)+connection.t]->AccumulateContribution(rasterPosition, Cstar);
 			}
+		}
+#endif
 
-			// Evaluate weighting function w_{s,t}
-			auto w = renderer.misWeight->Evaluate(fullPath);
+		// Evaluate contribution C_{s,t} and record the splat
+		auto C = connection.weight * Cstar;
+		splats.emplace_back(rasterPosition, C);
 
 #if LM_ENABLE_BPT_EXPERIMENTAL
-			// Accumulation contribution to sub-path films
-			if (renderer.enableExperimentalMode && s <= renderer.maxSubpathNumVertices && t <= renderer.maxSubpathNumVertices)
+		// Accumulate contribution to per length image
+		if (renderer.enableExperimentalMode)
+		{
+			const int n = connection.s + connection.t;
+			#pragma omp critical
 			{
-				#pragma omp critical
+				// Extend if needed
+				if (renderer.perLengthFilms.find(n) == renderer.perLengthFilms.end())
 				{
-					renderer.subpathFilms[s*(renderer.maxSubpathNumVertices+1)+t]->AccumulateContribution(rasterPosition, Cstar);
+					// Create a new film for #n vertices
+					std::unique_ptr<BitmapFilm> newFilm(dynamic_cast<BitmapFilm*>(ComponentFactory::Create<Film>("hdr")));
+					newFilm->SetImageType(BitmapImageType::RadianceHDR);
+					newFilm->Allocate(film->Width(), film->Height());
+					renderer.perLengthFilms.insert(std::make_pair(n, std::move(newFilm)));
 				}
+
+				// Accumulate
+				renderer.perLengthFilms[n]->AccumulateContribution(rasterPosition, C);
 			}
+		}
 #endif
+	}
 
-			// Evaluate contribution C_{s,t} and record to the film
-			auto C = w * Cstar;
-			film->AccumulateContribution(rasterPosition, C);
+	// Accumulate contributions to the film
+	if (!splats.empty())
+	{
+		film->AccumulateContributions(&splats[0], splats.size(), Math::Float(1));
+	}
+}
 
-#if LM_ENABLE_BPT_EXPERIMENTAL
-			// Accumulate contribution to per length image
-			if (renderer.enableExperimentalMode)
+void BidirectionalPathtraceRenderer_RenderProcess::SampleCachedConnections( const Scene& scene )
+{
+	const auto& lightVertices = renderer.lightTracer.Vertices();
+	if (lightVertices.empty())
+	{
+		return;
+	}
+
+	// Connect z_{t-1} with #numConnections light vertices chosen uniformly from the cache.
+	// The strategies with t = 1 (light tracing) connect the cached vertices with the camera.
+	// The i-th light vertex is chosen with (u + i) / #numConnections for a sample u,
+	// so that each choice is uniform and the choices are stratified over the cache.
+	const auto numLightVertices = lightVertices.size();
+	const int nE = static_cast<int>(subpathE.vertices.size());
+	for (int t = 1; t <= nE; t++)
+	{
+		const auto* z = subpathE.vertices[t-1];
+		if ((z->bsdf->BSDFTypes() & GeneralizedBSDFType::NonDelta) == 0)
+		{
+			continue;
+		}
+
+		Math::Vec2 rasterPositionE;
+		const auto alphaE = subpathE.EvaluateSubpathAlpha(t, rasterPositionE);
+		if (Math::IsZero(alphaE))
+		{
+			continue;
+		}
+
+		sampler->SetDimension(2 + 12 * (t - 1));
+		const auto u = sampler->Next();
+		for (int i = 0; i < renderer.numConnections; i++)
+		{
+			const auto ui = (u + Math::Float(i)) / Math::Float(renderer.numConnections);
+			const auto& y = lightVertices[Math::Min(static_cast<size_t>(ui * Math::Float(numLightVertices)), numLightVertices - 1)];
+			if (renderer.maxPathVertices != -1 && y.numVertices + t > renderer.maxPathVertices)
 			{
-				#pragma omp critical
-				{
-					// Extend if needed
-					if (renderer.perLengthFilms.find(n) == renderer.perLengthFilms.end())
-					{
-						// Create a new film for #n vertices
-						std::unique_ptr<BitmapFilm> newFilm(dynamic_cast<BitmapFilm*>(ComponentFactory::Create<Film>("hdr")));
-						newFilm->SetImageType(BitmapImageType::RadianceHDR);
-						newFilm->Allocate(film->Width(), film->Height());
-						renderer.perLengthFilms.insert(std::make_pair(n, std::move(newFilm)));
-					}
+				continue;
+			}
 
-					// Accumulate
-					renderer.perLengthFilms[n]->AccumulateContribution(rasterPosition, C);
-				}
+			BPTConnection connection;
+			Ray shadowRay;
+			connection.rasterPosition = rasterPositionE;
+			connection.Cstar = BPTLightVertexCache::EvaluateConnection(scene, y, subpathE, t, partialSumsE, alphaE, renderer.connectionCount, connection.rasterPosition, shadowRay, connection.weight);
+			if (Math::IsZero(connection.Cstar))
+			{
+				continue;
 			}
-#endif
+
+			connection.s = y.numVertices;
+			connection.t = t;
+			connectionBatch.Add(connection, shadowRay);
 		}
 	}
 }
@@ -167,6 +167,26 @@ BPTFullPath::BPTFullPath( int s, int t, const BPTSubpath& lightSubpath, const BP
 
 Math::Vec3 BPTFullPath::EvaluateUnweightContribution( const Scene& scene, Math::Vec2& rasterPosition ) const
 {
+	Ray shadowRay;
+	bool shadowRayRequired;
+	auto Cstar = EvaluateUnoccludedContribution(scene, rasterPosition, shadowRay, shadowRayRequired);
+	if (shadowRayRequired && !Math::IsZero(Cstar))
+	{
+		// Check connectivity between y_{s-1} and z_{t-1}
+		Intersection shadowIsect;
+		if (scene.Intersect(shadowRay, shadowIsect))
+		{
+			return Math::Vec3();
+		}
+	}
+
+	return Cstar;
+}
+
+Math::Vec3 BPTFullPath::EvaluateUnoccludedContribution( const Scene& scene, Math::Vec2& rasterPosition, Ray& shadowRay, bool& shadowRayRequired ) const
+{
+	shadowRayRequired = false;
+
 	// Evaluate \alpha^L_s
 	auto alphaL = lightSubpath.EvaluateSubpathAlpha(s, rasterPosition);
 	if (Math::IsZero(alphaL))
@@ -242,8 +262,8 @@ Math::Vec3 BPTFullPath::EvaluateUnweightContribution( const Scene& scene, Math::
 			return Math::Vec3();
 		}
 
-		// Check connectivity between #vL->geom.p and #vE->geom.p
-		Ray shadowRay;
+		// Shadow ray between #vL->geom.p and #vE->geom.p
+		// The connectivity is checked by the caller
 		auto pLpE = vE->geom.p - vL->geom.p;
 		auto pLpE_Length = Math::Length(pLpE);
 		shadowRay.d = pLpE / pLpE_Length;
@@ -258,9 +278,10 @@ Math::Vec3 BPTFullPath::EvaluateUnweightContribution( const Scene& scene, Math::
 			visible = scene.MainCamera()->RayToRasterPosition(vE->geom.p, -shadowRay.d, rasterPosition);
 		}
 
-		Intersection shadowIsect;
-		if (visible && !scene.Intersect(shadowRay, shadowIsect))
-		{			
+		if (visible)
+		{
+			shadowRayRequired = true;
+
 			GeneralizedBSDFEvaluateQuery bsdfEQ;
 			bsdfEQ.type = GeneralizedBSDFType::NonDelta;
 
@@ -0,0 +1,236 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+#include <lightmetrica/bpt.lightvertexcache.h>
+#include <lightmetrica/bpt.subpath.h>
+#include <lightmetrica/bpt.fullpath.h>
+#include <lightmetrica/generalizedbsdf.h>
+#include <lightmetrica/surfacegeometry.h>
+#include <lightmetrica/scene.h>
+#include <lightmetrica/camera.h>
+#include <lightmetrica/ray.h>
+#include <lightmetrica/renderutils.h>
+#include <lightmetrica/assert.h>
+
+LM_NAMESPACE_BEGIN
+
+void BPTLightVertexCache::EvaluatePartialSums( const BPTSubpath& subpath, std::vector<Math::Float>& endpointSums, std::vector<Math::Float>& sums )
+{
+	const int n = static_cast<int>(subpath.vertices.size());
+	const int dir = subpath.transportDir;
+	endpointSums.resize(n);
+	sums.resize(n);
+	if (n == 0)
+	{
+		return;
+	}
+
+	endpointSums[0] = Math::Float(0);
+	sums[0] = Math::Float(0);
+	for (int k = 1; k < n; k++)
+	{
+		const auto* pv = subpath.vertices[k-1];
+		const auto pvPdfD = pv->pdfD[dir].v;
+		const auto pvPdfDRev = pv->pdfD[1-dir].v;
+		if (Math::IsZero(pvPdfD))
+		{
+			endpointSums[k] = Math::Float(0);
+			sums[k] = Math::Float(0);
+			continue;
+		}
+
+		const auto endpointTerm = k == 1 ? pv->misInvPdfSq : Math::Float(0);
+		const auto term = k >= 2 ? pv->misInvPdfSq : Math::Float(0);
+		endpointSums[k] = (endpointTerm + pvPdfDRev * pvPdfDRev * endpointSums[k-1]) / (pvPdfD * pvPdfD);
+		sums[k] = (term + pvPdfDRev * pvPdfDRev * sums[k-1]) / (pvPdfD * pvPdfD);
+	}
+}
+
+void BPTLightVertexCache::AppendLightVertices( const BPTSubpath& subpath, const std::vector<Math::Float>& endpointSums, const std::vector<Math::Float>& sums, BPTLightVertices& vertices )
+{
+	const int n = static_cast<int>(subpath.vertices.size());
+	for (int k = 0; k < n; k++)
+	{
+		const auto* v = subpath.vertices[k];
+		if ((v->bsdf->BSDFTypes() & GeneralizedBSDFType::NonDelta) == 0)
+		{
+			continue;
+		}
+
+		Math::Vec2 rasterPosition;
+		BPTLightVertex lightVertex;
+		lightVertex.throughput = subpath.EvaluateSubpathAlpha(k + 1, rasterPosition);
+		if (Math::IsZero(lightVertex.throughput))
+		{
+			break;
+		}
+
+		lightVertex.bsdf = v->bsdf;
+		lightVertex.degenerated = v->geom.degenerated;
+		lightVertex.prevDegenerated = k > 0 && subpath.vertices[k-1]->geom.degenerated;
+		lightVertex.p = v->geom.p;
+		lightVertex.gn = v->geom.gn;
+		lightVertex.sn = v->geom.sn;
+		lightVertex.uv = v->geom.uv;
+		lightVertex.wi = v->wi;
+		lightVertex.misInvPdfSq = v->misInvPdfSq;
+		lightVertex.misPartialSum = sums[k];
+		lightVertex.misEndpointPartialSum = endpointSums[k];
+		lightVertex.numVertices = k + 1;
+		vertices.push_back(lightVertex);
+	}
+}
+
+Math::Vec3 BPTLightVertexCache::EvaluateConnection( const Scene& scene, const BPTLightVertex& y, const BPTSubpath& subpathE, int t, const std::vector<Math::Float>& partialSumsE, const Math::Vec3& alphaE, const Math::Float& connectionCount, Math::Vec2& rasterPosition, Ray& shadowRay, Math::Float& weight )
+{
+	const auto* z = subpathE.vertices[t-1];
+	const auto* zPrev = t > 1 ? subpathE.vertices[t-2] : nullptr;
+
+	// Restore surface geometry of y_{s-1}
+	SurfaceGeometry yGeom;
+	yGeom.degenerated = y.degenerated;
+	yGeom.p = y.p;
+	if (!yGeom.degenerated)
+	{
+		yGeom.gn = y.gn;
+		yGeom.sn = y.sn;
+		yGeom.uv = y.uv;
+		yGeom.ComputeTangentSpace();
+	}
+
+	// Shadow ray between y_{s-1} and z_{t-1}
+	auto pLpE = z->geom.p - y.p;
+	auto pLpE_Length = Math::Length(pLpE);
+	shadowRay.d = pLpE / pLpE_Length;
+	shadowRay.o = y.p;
+	shadowRay.minT = Math::Constants::Eps();
+	shadowRay.maxT = pLpE_Length * (Math::Float(1) - Math::Constants::Eps());
+
+	// Update raster position if #t = 1
+	if (t == 1 && !scene.MainCamera()->RayToRasterPosition(z->geom.p, -shadowRay.d, rasterPosition))
+	{
+		return Math::Vec3();
+	}
+
+	// Evaluate C^*_{s,t} = \alpha^L_s f_s(y_{s-1}) G f_s(z_{t-1}) \alpha^E_t
+	GeneralizedBSDFEvaluateQuery bsdfEQ;
+	bsdfEQ.type = GeneralizedBSDFType::NonDelta;
+
+	bsdfEQ.transportDir = TransportDirection::LE;
+	bsdfEQ.wi = y.wi;
+	bsdfEQ.wo = shadowRay.d;
+	const auto fsL = y.bsdf->EvaluateDirection(bsdfEQ, yGeom);
+
+	bsdfEQ.transportDir = TransportDirection::EL;
+	bsdfEQ.wi = z->wi;
+	bsdfEQ.wo = -shadowRay.d;
+	const auto fsE = z->bsdf->EvaluateDirection(bsdfEQ, z->geom);
+
+	const auto G = RenderUtils::GeneralizedGeometryTerm(yGeom, z->geom);
+	const auto Cstar = y.throughput * fsL * G * fsE * alphaE;
+	if (Math::IsZero(Cstar))
+	{
+		return Math::Vec3();
+	}
+
+	// --------------------------------------------------------------------------------
+
+	// PDFs depending on the connection (same as #BPTFullPath::pdfDL and #BPTFullPath::pdfDE)
+	Math::Float pdfDL_EL(0);
+	if (y.numVertices > 1 && !y.prevDegenerated)
+	{
+		bsdfEQ.transportDir = TransportDirection::EL;
+		bsdfEQ.wi = shadowRay.d;
+		bsdfEQ.wo = y.wi;
+		pdfDL_EL = y.bsdf->EvaluateDirectionPDF(bsdfEQ, yGeom).v;
+	}
+
+	Math::Float pdfDL_LE(0);
+	if (!z->geom.degenerated)
+	{
+		bsdfEQ.transportDir = TransportDirection::LE;
+		bsdfEQ.wi = y.wi;
+		bsdfEQ.wo = shadowRay.d;
+		pdfDL_LE = y.bsdf->EvaluateDirectionPDF(bsdfEQ, yGeom).v;
+	}
+
+	Math::Float pdfDE_LE(0);
+	if (zPrev != nullptr && !zPrev->geom.degenerated)
+	{
+		bsdfEQ.transportDir = TransportDirection::LE;
+		bsdfEQ.wi = -shadowRay.d;
+		bsdfEQ.wo = z->wi;
+		pdfDE_LE = z->bsdf->EvaluateDirectionPDF(bsdfEQ, z->geom).v;
+	}
+
+	Math::Float pdfDE_EL(0);
+	if (!y.degenerated)
+	{
+		bsdfEQ.transportDir = TransportDirection::EL;
+		bsdfEQ.wi = z->wi;
+		bsdfEQ.wo = -shadowRay.d;
+		pdfDE_EL = z->bsdf->EvaluateDirectionPDF(bsdfEQ, z->geom).v;
+	}
+
+	// --------------------------------------------------------------------------------
+
+	// MIS weight (power heuristics with the numbers of samples)
+	// The strategy with s = 0 is sampled once per sample, the strategy with t = 0 is not sampled,
+	// and the other strategies are sampled c times in average, where c is the effective number of connection samples.
+	// The weight is c^2 p_s^2 / \sum_i n_i^2 p_i^2 and the contribution of the connection is divided by c.
+	const auto c = connectionCount;
+	const auto c2 = c * c;
+
+	// Light sub-path side
+	Math::Float sumL;
+	{
+		const auto pdfAFromE = pdfDE_EL * G;
+		const auto n2 = y.numVertices == 1 ? Math::Float(1) : c2;
+		sumL = pdfAFromE * pdfAFromE * (n2 * y.misInvPdfSq + pdfDL_EL * pdfDL_EL * (c2 * y.misPartialSum + y.misEndpointPartialSum));
+	}
+
+	// Eye sub-path side
+	Math::Float sumE;
+	{
+		const auto pdfAFromL = pdfDL_LE * G;
+		const auto n2 = t == 1 ? Math::Float(0) : c2;
+		sumE = pdfAFromL * pdfAFromL * (n2 * z->misInvPdfSq + pdfDE_LE * pdfDE_LE * c2 * partialSumsE[t-1]);
+	}
+
+	weight = c / (c2 + sumL + sumE);
+	return Cstar;
+}
+
+Math::Float BPTLightVertexCache::EvaluateEndpointMISWeight( const BPTFullPath& fullPath, const std::vector<Math::Float>& partialSumsE, const Math::Float& connectionCount )
+{
+	LM_ASSERT(fullPath.s == 0);
+
+	// z_{t-1} is hit by the eye sub-path.
+	// The other strategies except for t = 0 are sampled c times in average
+	const int t = fullPath.t;
+	const auto* z = fullPath.eyeSubpath.vertices[t-1];
+	const auto pdfA = z->pdfP.v;
+	const auto c = connectionCount;
+	const auto pdfDRev = fullPath.pdfDE[TransportDirection::LE].v;
+	const auto sumE = c * c * pdfA * pdfA * (z->misInvPdfSq + pdfDRev * pdfDRev * partialSumsE[t-1]);
+	return Math::Float(1) / (Math::Float(1) + sumE);
+}
+
+LM_NAMESPACE_END
\ No newline at end of file
@@ -0,0 +1,126 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+#include <lightmetrica/bpt.mis.h>
+#include <lightmetrica/bpt.fullpath.h>
+#include <lightmetrica/bpt.subpath.h>
+#include <lightmetrica/generalizedbsdf.h>
+#include <lightmetrica/assert.h>
+#include <lightmetrica/renderutils.h>
+#include <lightmetrica/confignode.h>
+
+LM_NAMESPACE_BEGIN
+
+/*!
+	Power heuristics MIS weight (incremental version).
+	Implements power heuristics (beta = 2) evaluated in constant time per full-path.
+	The sums of the squared PDF ratios of the strategies are accumulated
+	along each sub-path in #BPTSubpath::Sample (#BPTPathVertex::misInvPdfSq and #BPTPathVertex::misPartialSum)
+	and only the PDFs depending on the connection are evaluated here.
+	The weights are same as the ones of the \a power weighting function.
+	Reference:
+		I. Georgiev, Implementing vertex connection and merging, Technical report, 2012.
+*/
+class BPTPowerHeuristicsIncrementalMISWeight final : public BPTMISWeight
+{
+public:
+
+	LM_COMPONENT_IMPL_DEF("powerincremental");
+
+public:
+
+	virtual bool Configure(const ConfigNode& node, const Assets& assets) override;
+	virtual BPTMISWeight* Clone() const override;
+	virtual Math::Float Evaluate(const BPTFullPath& fullPath) const override;
+
+};
+
+bool BPTPowerHeuristicsIncrementalMISWeight::Configure( const ConfigNode& node, const Assets& assets )
+{
+	return true;
+}
+
+BPTMISWeight* BPTPowerHeuristicsIncrementalMISWeight::Clone() const
+{
+	return new BPTPowerHeuristicsIncrementalMISWeight;
+}
+
+Math::Float BPTPowerHeuristicsIncrementalMISWeight::Evaluate(const BPTFullPath& fullPath) const
+{
+	const int s = fullPath.s;
+	const int t = fullPath.t;
+
+	// Sum of (p_i/p_s)^2 for i < s and i > s respectively
+	Math::Float sumL(0);
+	Math::Float sumE(0);
+
+	if (s == 0)
+	{
+		// z_{t-1} is hit by the eye sub-path.
+		// p_A(z_{t-1}) is zero and so are the other terms if z_{t-1} is not a light
+		const auto* z = fullPath.eyeSubpath.vertices[t-1];
+		const auto pdfA = z->pdfP.v;
+		const auto pdfDRev = fullPath.pdfDE[TransportDirection::LE].v;
+		sumE = pdfA * pdfA * (z->misInvPdfSq + pdfDRev * pdfDRev * z->misPartialSum);
+	}
+	else if (t == 0)
+	{
+		// y_{s-1} is hit by the light sub-path.
+		// p_A(y_{s-1}) is zero and so are the other terms if y_{s-1} is not a camera
+		const auto* y = fullPath.lightSubpath.vertices[s-1];
+		const auto pdfA = y->pdfP.v;
+		const auto pdfDRev = fullPath.pdfDL[TransportDirection::EL].v;
+		sumL = pdfA * pdfA * (y->misInvPdfSq + pdfDRev * pdfDRev * y->misPartialSum);
+	}
+	else
+	{
+		// Full-path cannot be sampled with p_s if one of connection vertices is degenerated
+		const auto* y = fullPath.lightSubpath.vertices[s-1];
+		const auto* z = fullPath.eyeSubpath.vertices[t-1];
+		if ((y->bsdf->BSDFTypes() & GeneralizedBSDFType::NonDelta) == 0 || (z->bsdf->BSDFTypes() & GeneralizedBSDFType::NonDelta) == 0)
+		{
+			return Math::Float(0);
+		}
+
+		const auto G = RenderUtils::GeneralizedGeometryTerm(y->geom, z->geom);
+
+		// Light sub-path side
+		// p_A(y_{s-1}) evaluated with z_{t-1} is p_{\sigma^\bot}(z_{t-1}\to y_{s-1}) G(z_{t-1}\leftrightarrow y_{s-1})
+		// Note that #pdfDL[EL] is not used if s = 1 because the partial sum of y_0 is zero
+		{
+			const auto pdfAFromE = fullPath.pdfDE[TransportDirection::EL].v * G;
+			const auto pdfDRev = fullPath.pdfDL[TransportDirection::EL].v;
+			sumL = pdfAFromE * pdfAFromE * (y->misInvPdfSq + pdfDRev * pdfDRev * y->misPartialSum);
+		}
+
+		// Eye sub-path side
+		{
+			const auto pdfAFromL = fullPath.pdfDL[TransportDirection::LE].v * G;
+			const auto pdfDRev = fullPath.pdfDE[TransportDirection::LE].v;
+			sumE = pdfAFromL * pdfAFromL * (z->misInvPdfSq + pdfDRev * pdfDRev * z->misPartialSum);
+		}
+	}
+
+	return Math::Float(1) / (Math::Float(1) + sumL + sumE);
+}
+
+LM_COMPONENT_REGISTER_IMPL(BPTPowerHeuristicsIncrementalMISWeight, BPTMISWeight);
+
+LM_NAMESPACE_END
\ No newline at end of file
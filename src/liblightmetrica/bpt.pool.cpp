@@ -21,9 +21,15 @@
 #include <lightmetrica/bpt.subpath.h>
 #include <lightmetrica/bpt.pool.h>
 #include <lightmetrica/align.h>
+#include <lightmetrica/pool.h>
 
 LM_NAMESPACE_BEGIN
 
+/*
+	Implementation of BPTPathVertexPool.
+	Path vertices are constructed in a chunked arena,
+	so that no memory is allocated or freed per sample in the steady state.
+*/
 class BPTPathVertexPool::Impl
 {
 public:
@@ -34,19 +40,17 @@ public:
 
 	BPTPathVertex* Construct()
 	{
-		pool.push_back(new BPTPathVertex);
-		return pool.back();
+		return arena.Construct();
 	}
 
 	void Release()
 	{
-		for (auto* v : pool) { LM_SAFE_DELETE(v); }
-		pool.clear();
+		arena.Release();
 	}
 
 private:
 
-	std::vector<BPTPathVertex*> pool;
+	ObjectArena<BPTPathVertex, std::alignment_of<BPTPathVertex>::value> arena;
 
 };
 
@@ -32,6 +32,7 @@
 #include <lightmetrica/ray.h>
 #include <lightmetrica/intersection.h>
 #include <lightmetrica/primitive.h>
+#include <lightmetrica/renderutils.h>
 
 LM_NAMESPACE_BEGIN
 
@@ -41,6 +42,8 @@ BPTPathVertex::BPTPathVertex()
 	, bsdf(nullptr)
 	, areaL(nullptr)
 	, areaE(nullptr)
+	, misInvPdfSq(0)
+	, misPartialSum(0)
 {
 
 }
@@ -153,12 +156,19 @@ BPTPathVertex* BPTSubpath::Vertex( int i ) const
 }
 
 void BPTSubpath::Sample( const Scene& scene, Sampler& sampler, BPTPathVertexPool& pool, int rrDepth, int maxPathVertices )
+{
+	Sample(scene, sampler, pool, rrDepth, maxPathVertices, transportDir == TransportDirection::LE ? 0 : 6, nullptr);
+}
+
+void BPTSubpath::Sample( const Scene& scene, Sampler& sampler, BPTPathVertexPool& pool, int rrDepth, int maxPathVertices, int dimensionOffset, const Math::Vec2* rasterPos )
 {
 	LM_ASSERT(vertices.empty());
+	LM_ASSERT(rasterPos == nullptr || transportDir == TransportDirection::EL);
 
 	// --------------------------------------------------------------------------------
 
 	// # Create initial vertex
+	sampler.SetDimension(dimensionOffset);
 	auto* v = pool.Construct();
 	v->type = BPTPathVertexType::EndPoint;
 	v->transportDir = transportDir;
@@ -191,7 +201,7 @@ void BPTSubpath::Sample( const Scene& scene, Sampler& sampler, BPTPathVertexPool
 	v->bsdf = v->emitter;
 
 	GeneralizedBSDFSampleQuery bsdfSQE;
-	bsdfSQE.sample = sampler.NextVec2();
+	bsdfSQE.sample = rasterPos ? *rasterPos : sampler.NextVec2();
 	bsdfSQE.transportDir = transportDir;
 	bsdfSQE.type = GeneralizedBSDFType::AllEmitter;
 
@@ -207,6 +217,13 @@ void BPTSubpath::Sample( const Scene& scene, Sampler& sampler, BPTPathVertexPool
 	// Number of vertices is always greater than 1
 	v->pdfRR = Math::PDFEval(Math::Float(1), Math::ProbabilityMeasure::Discrete);
 
+	// ## Partial sums for MIS weights
+	// The strategy with zero vertices in the opposite sub-path is valid
+	// only if the endpoint is not positionally degenerated and is able to be hit.
+	const bool endpointIsHittable = transportDir == TransportDirection::EL ? v->areaE != nullptr : v->areaL != nullptr;
+	v->misInvPdfSq = endpointIsHittable && !v->geom.degenerated && !Math::IsZero(v->pdfP.v) ? Math::Float(1) / (v->pdfP.v * v->pdfP.v) : Math::Float(0);
+	v->misPartialSum = Math::Float(0);
+
 	vertices.push_back(v);
 
 	// --------------------------------------------------------------------------------
@@ -266,8 +283,12 @@ void BPTSubpath::Sample( const Scene& scene, Sampler& sampler, BPTPathVertexPool
 		if (v->emitter)
 		{
 			// Calculate #pdfP for intersected emitter
+			// Light selection PDF is considered only for lights
 			v->pdfP = v->emitter->EvaluatePositionPDF(v->geom);
-			v->pdfP.v *= scene.LightSelectionPdf().v;
+			if (v->emitter == v->areaL)
+			{
+				v->pdfP.v *= scene.LightSelectionPdf(v->areaL).v;
+			}
 		}
 		else
 		{
@@ -276,7 +297,26 @@ void BPTSubpath::Sample( const Scene& scene, Sampler& sampler, BPTPathVertexPool
 
 		// --------------------------------------------------------------------------------
 
+		// ## Partial sums for MIS weights
+		// Let V_k be the sum of (p_i/p_{k+1})^2 for i <= k divided by (p_{\sigma^\bot}(x_{k+1}\to x_k) G(x_{k+1}\leftrightarrow x_k))^2,
+		// which satisfies V_k = e_k / p_A(x_k)^2 + (p_{\sigma^\bot}(x_k\to x_{k-1}) / p_{\sigma^\bot}(x_{k-1}\to x_k))^2 V_{k-1},
+		// where e_k is zero if the strategy cannot sample the path (i.e., x_{k-1} or x_k is degenerated).
+		// Here the terms of V_k except for p_{\sigma^\bot}(x_k\to x_{k-1}) are accumulated,
+		// which depends on the next vertex or on the connection.
+		{
+			const auto pvPdfD = pv->pdfD[transportDir].v;
+			const auto pdfA = pvPdfD * RenderUtils::GeneralizedGeometryTerm(pv->geom, v->geom);
+			const bool strategyIsValid = (pv->bsdf->BSDFTypes() & GeneralizedBSDFType::NonDelta) != 0 && (v->bsdf->BSDFTypes() & GeneralizedBSDFType::NonDelta) != 0;
+			v->misInvPdfSq = strategyIsValid && !Math::IsZero(pdfA) ? Math::Float(1) / (pdfA * pdfA) : Math::Float(0);
+
+			const auto pvPdfDRev = pv->pdfD[1-transportDir].v;
+			v->misPartialSum = !Math::IsZero(pvPdfD) ? (pv->misInvPdfSq + pvPdfDRev * pvPdfDRev * pv->misPartialSum) / (pvPdfD * pvPdfD) : Math::Float(0);
+		}
+
+		// --------------------------------------------------------------------------------
+
 		// ## Path termination
+		sampler.SetDimension(dimensionOffset + 12 * numPathVertices);
 
 		// Apply RR
 		if (rrDepth != -1 && numPathVertices >= rrDepth)
@@ -53,6 +53,7 @@ public:
 	virtual Math::Vec3 EvaluateDirection(const GeneralizedBSDFEvaluateQuery& query, const SurfaceGeometry& geom) const override;
 	virtual Math::PDFEval EvaluateDirectionPDF(const GeneralizedBSDFEvaluateQuery& query, const SurfaceGeometry& geom) const override;
 	virtual int BSDFTypes() const override { return GeneralizedBSDFType::Specular; }
+	virtual void PropagateRayDifferential(const GeneralizedBSDFSampleQuery& query, const SurfaceGeometry& geom, const GeneralizedBSDFSampleResult& result, RayDifferential& rd) const override;
 
 private:
 
@@ -587,6 +588,25 @@ Math::PDFEval DielectricBSDF::EvaluateDirectionPDF( const GeneralizedBSDFEvaluat
 	return Math::PDFEval((Math::Float(1) - Fr) / Math::Abs(cosThetaT2), Math::ProbabilityMeasure::ProjectedSolidAngle);
 }
 
+void DielectricBSDF::PropagateRayDifferential( const GeneralizedBSDFSampleQuery& query, const SurfaceGeometry& geom, const GeneralizedBSDFSampleResult& result, RayDifferential& rd ) const
+{
+	if (result.sampledType == GeneralizedBSDFType::SpecularReflection)
+	{
+		rd.Reflect(geom.sn);
+		return;
+	}
+
+	// Index of refraction
+	auto etaI = n1;
+	auto etaT = n2;
+	if (Math::Dot(query.wi, geom.sn) <= Math::Float(0))
+	{
+		std::swap(etaI, etaT);
+	}
+
+	rd.Refract(-query.wi, result.wo, geom.sn, etaI / etaT);
+}
+
 Math::Float DielectricBSDF::EvalFrDielectic( const Math::Float& /*etaI*/, const Math::Float& /*etaT*/, const Math::Float& cosThetaI, Math::Float& cosThetaT ) const
 {
 #if 0
@@ -153,7 +153,7 @@ Math::Vec3 DiffuseBSDF::SampleAndEstimateDirection( const GeneralizedBSDFSampleQ
 	// R * \pi^-1 / (p_\sigma / \cos(w_o))
 	// R * \pi^-1 / (\pi^-1 * \cos(w_o) / \cos(w_o))
 	// R
-	return R->Evaluate(geom.uv) * sf;
+	return R->Evaluate(geom.uv, geom.uvFootprint) * sf;
 }
 
 bool DiffuseBSDF::SampleAndEstimateDirectionBidir( const GeneralizedBSDFSampleQuery& query, const SurfaceGeometry& geom, GeneralizedBSDFSampleBidirResult& result ) const
@@ -182,7 +182,7 @@ bool DiffuseBSDF::SampleAndEstimateDirectionBidir( const GeneralizedBSDFSampleQu
 		return false;
 	}
 
-	auto diffuseR = R->Evaluate(geom.uv);
+	auto diffuseR = R->Evaluate(geom.uv, geom.uvFootprint);
 	result.weight[query.transportDir] = diffuseR * sf;
 	result.weight[1-query.transportDir] = diffuseR * sfInv;
 
@@ -204,7 +204,7 @@ Math::Vec3 DiffuseBSDF::EvaluateDirection( const GeneralizedBSDFEvaluateQuery& q
 		return Math::Vec3();
 	}
 
-	return R->Evaluate(geom.uv) * Math::Constants::InvPi() * sf;
+	return R->Evaluate(geom.uv, geom.uvFootprint) * Math::Constants::InvPi() * sf;
 }
 
 Math::PDFEval DiffuseBSDF::EvaluateDirectionPDF( const GeneralizedBSDFEvaluateQuery& query, const SurfaceGeometry& geom ) const
@@ -0,0 +1,99 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+#include "simdsupport.h"
+#include <lightmetrica/film.h>
+
+LM_NAMESPACE_BEGIN
+
+size_t Film::ComputePixelIndices( const Splat* splats, size_t n, int width, int height, int* indices )
+{
+	size_t invalid = 0;
+	size_t i = 0;
+
+#if LM_SSE2 && LM_SINGLE_PRECISION
+	// Process 4 splats at once
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 w = _mm_set1_ps(static_cast<float>(width));
+	const __m128 h = _mm_set1_ps(static_cast<float>(height));
+	const __m128 maxX = _mm_set1_ps(static_cast<float>(width - 1));
+	const __m128 maxY = _mm_set1_ps(static_cast<float>(height - 1));
+	for (; i + 4 <= n; i += 4)
+	{
+		// Transpose raster positions to SOA format
+		__m128 p01 = _mm_loadl_pi(zero, reinterpret_cast<const __m64*>(&splats[i  ].rasterPos.x));
+		p01 = _mm_loadh_pi(p01, reinterpret_cast<const __m64*>(&splats[i+1].rasterPos.x));
+		__m128 p23 = _mm_loadl_pi(zero, reinterpret_cast<const __m64*>(&splats[i+2].rasterPos.x));
+		p23 = _mm_loadh_pi(p23, reinterpret_cast<const __m64*>(&splats[i+3].rasterPos.x));
+		const __m128 x = _mm_shuffle_ps(p01, p23, _MM_SHUFFLE(2, 0, 2, 0));
+		const __m128 y = _mm_shuffle_ps(p01, p23, _MM_SHUFFLE(3, 1, 3, 1));
+
+		// Bounds check
+		const __m128 valid = _mm_and_ps(
+			_mm_and_ps(_mm_cmpge_ps(x, zero), _mm_cmple_ps(x, one)),
+			_mm_and_ps(_mm_cmpge_ps(y, zero), _mm_cmple_ps(y, one)));
+		const int validMask = _mm_movemask_ps(valid);
+
+		// Convert to pixel coordinates
+		// Clamping before the truncation is equivalent to clamping the truncated value
+		// because the positions are non-negative
+		const __m128i px = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(x, w), zero), maxX));
+		const __m128i py = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(y, h), zero), maxY));
+		LM_ALIGN_16 int pxs[4];
+		LM_ALIGN_16 int pys[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(pxs), px);
+		_mm_store_si128(reinterpret_cast<__m128i*>(pys), py);
+
+		for (int j = 0; j < 4; j++)
+		{
+			if (validMask & (1 << j))
+			{
+				indices[i+j] = pys[j] * width + pxs[j];
+			}
+			else
+			{
+				indices[i+j] = -1;
+				invalid++;
+			}
+		}
+	}
+#endif
+
+	// Remaining splats
+	for (; i < n; i++)
+	{
+		const auto& rasterPos = splats[i].rasterPos;
+		if (rasterPos.x < 0 || 1 < rasterPos.x || rasterPos.y < 0 || 1 < rasterPos.y)
+		{
+			indices[i] = -1;
+			invalid++;
+			continue;
+		}
+
+		const int x = Math::Clamp(Math::Cast<int>(Math::Float(rasterPos.x * Math::Float(width))), 0, width-1);
+		const int y = Math::Clamp(Math::Cast<int>(Math::Float(rasterPos.y * Math::Float(height))), 0, height-1);
+		indices[i] = y * width + x;
+	}
+
+	return invalid;
+}
+
+LM_NAMESPACE_END
@@ -0,0 +1,115 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+#include <lightmetrica/halfutils.h>
+#include <cstring>
+
+LM_NAMESPACE_BEGIN
+
+unsigned short HalfUtils::FloatToHalf( float v )
+{
+	unsigned int x;
+	std::memcpy(&x, &v, sizeof(x));
+	const unsigned int sign = (x >> 16) & 0x8000U;
+	const unsigned int floatExp = (x >> 23) & 0xffU;
+	unsigned int mant = x & 0x7fffffU;
+	if (floatExp == 0xffU)
+	{
+		// Infinity or NaN
+		return static_cast<unsigned short>(sign | 0x7c00U | (mant ? 0x200U : 0U));
+	}
+
+	const int exp = static_cast<int>(floatExp) - 127 + 15;
+	if (exp >= 31)
+	{
+		// Overflow (rounded to infinity)
+		return static_cast<unsigned short>(sign | 0x7c00U);
+	}
+
+	if (exp <= 0)
+	{
+		// Subnormal number
+		if (exp < -10)
+		{
+			return static_cast<unsigned short>(sign);
+		}
+
+		mant |= 0x800000U;
+		const unsigned int shift = static_cast<unsigned int>(14 - exp);
+		unsigned int h = mant >> shift;
+		const unsigned int rem = mant & ((1U << shift) - 1U);
+		const unsigned int halfway = 1U << (shift - 1U);
+		if (rem > halfway || (rem == halfway && (h & 1U)))
+		{
+			h++;
+		}
+		return static_cast<unsigned short>(sign | h);
+	}
+
+	// The carry of the rounding propagates to the exponent
+	// (values rounded beyond the maximum finite value become infinity)
+	unsigned int h = (static_cast<unsigned int>(exp) << 10) | (mant >> 13);
+	const unsigned int rem = mant & 0x1fffU;
+	if (rem > 0x1000U || (rem == 0x1000U && (h & 1U)))
+	{
+		h++;
+	}
+	return static_cast<unsigned short>(sign | h);
+}
+
+float HalfUtils::HalfToFloat( unsigned short v )
+{
+	const unsigned int sign = static_cast<unsigned int>(v & 0x8000U) << 16;
+	unsigned int exp = (v >> 10) & 0x1fU;
+	unsigned int mant = v & 0x3ffU;
+	unsigned int x;
+	if (exp == 0)
+	{
+		if (mant == 0)
+		{
+			x = sign;
+		}
+		else
+		{
+			// Normalize subnormal number
+			exp = 127 - 15 + 1;
+			while ((mant & 0x400U) == 0)
+			{
+				mant <<= 1;
+				exp--;
+			}
+			x = sign | (exp << 23) | ((mant & 0x3ffU) << 13);
+		}
+	}
+	else if (exp == 31)
+	{
+		x = sign | 0x7f800000U | (mant << 13);
+	}
+	else
+	{
+		x = sign | ((exp - 15 + 127) << 23) | (mant << 13);
+	}
+
+	float f;
+	std::memcpy(&f, &x, sizeof(f));
+	return f;
+}
+
+LM_NAMESPACE_END
\ No newline at end of file
@@ -23,6 +23,8 @@
 #include <lightmetrica/assert.h>
 #include <lightmetrica/confignode.h>
 #include <lightmetrica/bitmap.h>
+#include <lightmetrica/sharedfilm.h>
+#include <lightmetrica/bitmapwriter.h>
 #include <FreeImage.h>
 
 LM_NAMESPACE_BEGIN
@@ -39,7 +41,10 @@ public:
 
 public:
 
-	HDRBitmapFilm() {}
+	HDRBitmapFilm()
+		: exrPixelType(OpenEXRPixelType::Half)
+		, exrCompression(OpenEXRCompression::RLE)
+	{}
 	virtual ~HDRBitmapFilm() {}
 
 public:
@@ -53,9 +58,12 @@ public:
 	virtual void RecordContribution(const Math::Vec2& rasterPos, const Math::Vec3& contrb) override;
 	virtual void AccumulateContribution(const Math::Vec2& rasterPos, const Math::Vec3& contrb) override;
 	virtual void AccumulateContribution(const Film& film) override;
+	virtual void AccumulateContributions(const Splat* splats, size_t n, const Math::Float& weight) override;
 	virtual void Rescale(const Math::Float& weight) override;
 	virtual Film* Clone() const override;
 	virtual void Clear() override;
+	virtual void SetSharedMode(bool enable) override;
+	virtual void Flush() override { if (shared) shared->Flush(); }
 
 public:
 
@@ -76,6 +84,9 @@ private:
 	int height;
 	BitmapImageType type;		// Type of the image to be saved
 	BitmapImage bitmap;
+	std::unique_ptr<SharedFilm> shared;		// Shared film (enabled only in shared mode)
+	OpenEXRPixelType exrPixelType;			// Pixel type of OpenEXR image
+	OpenEXRCompression exrCompression;		// Compression type of OpenEXR image
 
 };
 
@@ -103,6 +114,11 @@ bool HDRBitmapFilm::Load( const ConfigNode& node, const Assets& assets )
 			// Image type is .exr (OpenEXR)
 			SetImageType(BitmapImageType::OpenEXR);
 		}
+		else if (imageTypeNode.Value() == "pfm")
+		{
+			// Image type is .pfm (Portable float map)
+			SetImageType(BitmapImageType::PFM);
+		}
 		else
 		{
 			LM_LOG_ERROR("Invalid image type '" + imageTypeNode.Value() + "'");
@@ -110,6 +126,43 @@ bool HDRBitmapFilm::Load( const ConfigNode& node, const Assets& assets )
 		}
 	}
 
+	// OpenEXR options (optional)
+	auto exrPixelTypeNode = node.Child("exr_pixel_type");
+	if (!exrPixelTypeNode.Empty())
+	{
+		if (exrPixelTypeNode.Value() == "half")
+		{
+			exrPixelType = OpenEXRPixelType::Half;
+		}
+		else if (exrPixelTypeNode.Value() == "float")
+		{
+			exrPixelType = OpenEXRPixelType::Float;
+		}
+		else
+		{
+			LM_LOG_ERROR("Invalid OpenEXR pixel type '" + exrPixelTypeNode.Value() + "'");
+			return false;
+		}
+	}
+
+	auto exrCompressionNode = node.Child("exr_compression");
+	if (!exrCompressionNode.Empty())
+	{
+		if (exrCompressionNode.Value() == "none")
+		{
+			exrCompression = OpenEXRCompression::None;
+		}
+		else if (exrCompressionNode.Value() == "rle")
+		{
+			exrCompression = OpenEXRCompression::RLE;
+		}
+		else
+		{
+			LM_LOG_ERROR("Invalid OpenEXR compression type '" + exrCompressionNode.Value() + "'");
+			return false;
+		}
+	}
+
 	// Allocate image data
 	Allocate(width, height);
 
@@ -190,9 +243,58 @@ void HDRBitmapFilm::AccumulateContribution( const Film& film )
 	const auto& otherData = dynamic_cast<const HDRBitmapFilm&>(film).bitmap.InternalData();
 	auto& data = bitmap.InternalData();
 	LM_ASSERT(data.size() == otherData.size());
-	for (size_t i = 0; i < data.size(); i++)
+	const long long n = static_cast<long long>(data.size());
+	auto* dst = &data[0];
+	const auto* src = &otherData[0];
+	#pragma omp parallel for
+	for (long long i = 0; i < n; i++)
 	{
-		data[i] += otherData[i];
+		dst[i] += src[i];
+	}
+}
+
+void HDRBitmapFilm::AccumulateContributions( const Splat* splats, size_t n, const Math::Float& weight )
+{
+	// Process splats by chunks in order to keep the indices on the stack
+	const size_t ChunkSize = 64;
+	int indices[ChunkSize];
+	size_t invalid = 0;
+	auto& data = bitmap.InternalData();
+	for (size_t begin = 0; begin < n; begin += ChunkSize)
+	{
+		const size_t size = Math::Min(ChunkSize, n - begin);
+		invalid += ComputePixelIndices(splats + begin, size, width, height, indices);
+		for (size_t i = 0; i < size; i++)
+		{
+			if (indices[i] < 0)
+			{
+				continue;
+			}
+
+			// Accumulate contribution
+			const auto contrb = splats[begin + i].L * weight;
+			const size_t idx = static_cast<size_t>(indices[i]);
+			data[3 * idx    ] += contrb[0];
+			data[3 * idx + 1] += contrb[1];
+			data[3 * idx + 2] += contrb[2];
+		}
+	}
+
+	if (invalid > 0)
+	{
+		LM_LOG_WARN(boost::str(boost::format("Ignored %d splats with invalid raster positions") % invalid));
+	}
+}
+
+void HDRBitmapFilm::SetSharedMode( bool enable )
+{
+	if (enable)
+	{
+		shared.reset(new SharedFilm(bitmap, width, height));
+	}
+	else
+	{
+		shared.reset();
 	}
 }
 
@@ -216,7 +318,8 @@ bool HDRBitmapFilm::RescaleAndSave( const std::string& path, const Math::Float&
 		{
 			// Check validity
 			bool valid = (p.extension() == ".hdr" && type == BitmapImageType::RadianceHDR) ||
-						 (p.extension() == ".exr" && type == BitmapImageType::OpenEXR);
+						 (p.extension() == ".exr" && type == BitmapImageType::OpenEXR) ||
+						 (p.extension() == ".pfm" && type == BitmapImageType::PFM);
 			if (!valid)
 			{
 				imagePath = "result.hdr";
@@ -234,6 +337,10 @@ bool HDRBitmapFilm::RescaleAndSave( const std::string& path, const Math::Float&
 			{
 				imagePath += ".exr";
 			}
+			else if (type == BitmapImageType::PFM)
+			{
+				imagePath += ".pfm";
+			}
 			else
 			{
 				LM_UNREACHABLE();
@@ -254,9 +361,24 @@ bool HDRBitmapFilm::RescaleAndSave( const std::string& path, const Math::Float&
 		}
 	}
 
+	if (type == BitmapImageType::PFM || type == BitmapImageType::OpenEXR)
+	{
+		// Native writers directly read the internal data
+		bool result = type == BitmapImageType::PFM
+			? BitmapImageWriter::SavePFM(imagePath, bitmap, width, height, weight)
+			: BitmapImageWriter::SaveOpenEXR(imagePath, bitmap, width, height, weight, exrPixelType, exrCompression);
+		if (!result)
+		{
+			LM_LOG_DEBUG("Failed to save image : " + imagePath);
+			return false;
+		}
+
+		LM_LOG_INFO("Successfully saved to " + imagePath);
+		return true;
+	}
+
 	// Create bitmap
-	// 128 bit RGBA float image
-	// Note: EXR - FIT_RGBAF, HDR - FIT_RGBF
+	// 96 bit RGB float image
 	FIBITMAP* fibitmap = FreeImage_AllocateT(FIT_RGBF, width, height);
 	if (!fibitmap)
 	{
@@ -265,31 +387,10 @@ bool HDRBitmapFilm::RescaleAndSave( const std::string& path, const Math::Float&
 	}
 
 	// Copy data
-	auto& data = bitmap.InternalData();
-	for (int y = 0; y < height; y++)
-	{
-		FIRGBF* bits = (FIRGBF*)FreeImage_GetScanLine(fibitmap, y);
-		for (int x = 0; x < width; x++)
-		{
-			int idx = y * width + x;
-			bits[x].red		= Math::Cast<float>(data[3 * idx    ] * weight);
-			bits[x].green	= Math::Cast<float>(data[3 * idx + 1] * weight);
-			bits[x].blue	= Math::Cast<float>(data[3 * idx + 2] * weight);
-		}
-	}
-
-	BOOL result = false;
-	if (type == BitmapImageType::RadianceHDR)
-	{
-		// Save image as Radiance HDR format
-		result = FreeImage_Save(FIF_HDR, fibitmap, imagePath.c_str(), HDR_DEFAULT);
-	}
-	else if (type == BitmapImageType::OpenEXR)
-	{
-		// Save image as OpenEXR format
-		result = FreeImage_Save(FIF_EXR, fibitmap, imagePath.c_str(), EXR_DEFAULT);
-	}
+	BitmapImageWriter::ConvertToFloat(bitmap, width, height, weight, FreeImage_GetBits(fibitmap), FreeImage_GetPitch(fibitmap));
 
+	// Save image as Radiance HDR format
+	BOOL result = FreeImage_Save(FIF_HDR, fibitmap, imagePath.c_str(), HDR_DEFAULT);
 	if (!result)
 	{
 		LM_LOG_DEBUG("Failed to save image : " + imagePath);
@@ -305,11 +406,19 @@ bool HDRBitmapFilm::RescaleAndSave( const std::string& path, const Math::Float&
 
 Film* HDRBitmapFilm::Clone() const
 {
+	if (shared)
+	{
+		// Create lightweight per-thread film in shared mode
+		return shared->CreateThreadFilm();
+	}
+
 	auto* film = new HDRBitmapFilm;
 	film->width = width;
 	film->height = height;
 	film->type = type;
 	film->bitmap = bitmap;
+	film->exrPixelType = exrPixelType;
+	film->exrCompression = exrCompression;
 	return film;
 }
 
@@ -334,9 +443,12 @@ void HDRBitmapFilm::Allocate( int width, int height )
 void HDRBitmapFilm::Rescale( const Math::Float& weight )
 {
 	auto& data = bitmap.InternalData();
-	for (auto& v : data)
+	const long long n = static_cast<long long>(data.size());
+	auto* p = &data[0];
+	#pragma omp parallel for
+	for (long long i = 0; i < n; i++)
 	{
-		v *= weight;
+		p[i] *= weight;
 	}
 }
 
@@ -23,6 +23,8 @@
 #include <lightmetrica/logger.h>
 #include <lightmetrica/assert.h>
 #include <lightmetrica/bitmap.h>
+#include <lightmetrica/sharedfilm.h>
+#include <lightmetrica/bitmapwriter.h>
 #include <FreeImage.h>
 
 LM_NAMESPACE_BEGIN
@@ -35,7 +37,7 @@ public:
 
 public:
 
-	LDRBitmapFilm() {}
+	LDRBitmapFilm() : transfer(BitmapTransferFunction::Gamma) {}
 	virtual ~LDRBitmapFilm() {}
 
 public:
@@ -49,9 +51,12 @@ public:
 	virtual void RecordContribution(const Math::Vec2& rasterPos, const Math::Vec3& contrb) override;
 	virtual void AccumulateContribution(const Math::Vec2& rasterPos, const Math::Vec3& contrb) override;
 	virtual void AccumulateContribution(const Film& film) override;
+	virtual void AccumulateContributions(const Splat* splats, size_t n, const Math::Float& weight) override;
 	virtual void Rescale(const Math::Float& weight) override;
 	virtual Film* Clone() const override;
 	virtual void Clear() override;
+	virtual void SetSharedMode(bool enable) override;
+	virtual void Flush() override { if (shared) shared->Flush(); }
 
 public:
 
@@ -72,6 +77,8 @@ private:
 	int height;
 	BitmapImageType type;		// Type of the image to be saved
 	BitmapImage bitmap;
+	std::unique_ptr<SharedFilm> shared;		// Shared film (enabled only in shared mode)
+	BitmapTransferFunction transfer;		// Transfer function for the conversion to 8-bit image
 
 };
 
@@ -97,6 +104,23 @@ bool LDRBitmapFilm::Load( const ConfigNode& node, const Assets& assets )
 		return false;
 	}
 
+	// Find 'transfer' element (optional)
+	auto transferNode = node.Child("transfer");
+	if (transferNode.Empty() || transferNode.Value() == "gamma")
+	{
+		// Gamma correction with gamma = 2.2 by default
+		transfer = BitmapTransferFunction::Gamma;
+	}
+	else if (transferNode.Value() == "srgb")
+	{
+		transfer = BitmapTransferFunction::SRGB;
+	}
+	else
+	{
+		LM_LOG_ERROR("Invalid transfer function '" + transferNode.Value() + "'");
+		return false;
+	}
+
 	// Allocate image data
 	Allocate(width, height);
 
@@ -178,9 +202,58 @@ void LDRBitmapFilm::AccumulateContribution( const Film& film )
 	const auto& otherData = dynamic_cast<const LDRBitmapFilm&>(film).bitmap.InternalData();
 	auto& data = bitmap.InternalData();
 	LM_ASSERT(data.size() == otherData.size());
-	for (size_t i = 0; i < data.size(); i++)
+	const long long n = static_cast<long long>(data.size());
+	auto* dst = &data[0];
+	const auto* src = &otherData[0];
+	#pragma omp parallel for
+	for (long long i = 0; i < n; i++)
+	{
+		dst[i] += src[i];
+	}
+}
+
+void LDRBitmapFilm::AccumulateContributions( const Splat* splats, size_t n, const Math::Float& weight )
+{
+	// Process splats by chunks in order to keep the indices on the stack
+	const size_t ChunkSize = 64;
+	int indices[ChunkSize];
+	size_t invalid = 0;
+	auto& data = bitmap.InternalData();
+	for (size_t begin = 0; begin < n; begin += ChunkSize)
+	{
+		const size_t size = Math::Min(ChunkSize, n - begin);
+		invalid += ComputePixelIndices(splats + begin, size, width, height, indices);
+		for (size_t i = 0; i < size; i++)
+		{
+			if (indices[i] < 0)
+			{
+				continue;
+			}
+
+			// Accumulate contribution
+			const auto contrb = splats[begin + i].L * weight;
+			const size_t idx = static_cast<size_t>(indices[i]);
+			data[3 * idx    ] += contrb[0];
+			data[3 * idx + 1] += contrb[1];
+			data[3 * idx + 2] += contrb[2];
+		}
+	}
+
+	if (invalid > 0)
 	{
-		data[i] += otherData[i];
+		LM_LOG_WARN(boost::str(boost::format("Ignored %d splats with invalid raster positions") % invalid));
+	}
+}
+
+void LDRBitmapFilm::SetSharedMode( bool enable )
+{
+	if (enable)
+	{
+		shared.reset(new SharedFilm(bitmap, width, height));
+	}
+	else
+	{
+		shared.reset();
 	}
 }
 
@@ -197,36 +270,7 @@ bool LDRBitmapFilm::RescaleAndSave( const std::string& path, const Math::Float&
 		LM_LOG_WARN("Output image path is not specified. Using '" + imagePath + "' as default.");
 	}
 
-	// Create bitmap
-	// 128 bit RGBA float image
-	// Note: EXR - FIT_RGBAF, HDR - FIT_RGBF
-	FIBITMAP* fibitmap = FreeImage_AllocateT(FIT_RGBF, width, height);
-	if (!fibitmap)
-	{
-		LM_LOG_ERROR("Failed to allocate bitmap");
-		return false;
-	}
-
-	// Copy data
-	auto& data = bitmap.InternalData();
-	for (int y = 0; y < height; y++)
-	{
-		FIRGBF* bits = (FIRGBF*)FreeImage_GetScanLine(fibitmap, y);
-		for (int x = 0; x < width; x++)
-		{
-			int idx = y * width + x;
-			bits[x].red		= Math::Cast<float>(data[3 * idx    ] * weight);
-			bits[x].green	= Math::Cast<float>(data[3 * idx + 1] * weight);
-			bits[x].blue	= Math::Cast<float>(data[3 * idx + 2] * weight);
-		}
-	}
-
-	// ----------------------------------------------------------------------
-
 	// Tone mapping
-	//auto* tonemappedBitmap = FreeImage_ToneMapping(fibitmap, FITMO_FATTAL02);
-	//auto* tonemappedBitmap = FreeImage_TmoDrago03(fibitmap);
-
 	FIBITMAP* tonemappedBitmap = FreeImage_Allocate(width, height, 24, FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK);
 	if (!tonemappedBitmap)
 	{
@@ -234,23 +278,8 @@ bool LDRBitmapFilm::RescaleAndSave( const std::string& path, const Math::Float&
 		return false;
 	}
 
-	// Multiplier for gamma correction
-	const double Exp = 1.0 / 2.2;
-
-	// Number of bytes per pixel
-	const int Bytespp = 3;
-	for (int y = 0; y < height; y++)
-	{
-		BYTE* bits = FreeImage_GetScanLine(tonemappedBitmap, y);
-		for (int x = 0; x < width; x++)
-		{
-			int idx = y * width + x;
-			bits[FI_RGBA_RED]   = static_cast<BYTE>(Math::Clamp(Math::Pow(Math::Cast<double>(data[3 * idx    ] * weight), Exp), 0.0, 1.0) * 255.0);
-			bits[FI_RGBA_GREEN] = static_cast<BYTE>(Math::Clamp(Math::Pow(Math::Cast<double>(data[3 * idx + 1] * weight), Exp), 0.0, 1.0) * 255.0);
-			bits[FI_RGBA_BLUE]  = static_cast<BYTE>(Math::Clamp(Math::Pow(Math::Cast<double>(data[3 * idx + 2] * weight), Exp), 0.0, 1.0) * 255.0);
-			bits += Bytespp;
-		}
-	}
+	// FreeImage stores the pixels in BGR order on little endian machines
+	BitmapImageWriter::ConvertTo8Bit(bitmap, width, height, weight, transfer, FI_RGBA_RED == 2, FreeImage_GetBits(tonemappedBitmap), FreeImage_GetPitch(tonemappedBitmap));
 
 	// ----------------------------------------------------------------------
 
@@ -258,20 +287,18 @@ bool LDRBitmapFilm::RescaleAndSave( const std::string& path, const Math::Float&
 	BOOL result = false;
 	if (type == BitmapImageType::PNG)
 	{
-		result = FreeImage_Save(FIF_PNG, tonemappedBitmap, imagePath.c_str(), PNG_DEFAULT);;
+		result = FreeImage_Save(FIF_PNG, tonemappedBitmap, imagePath.c_str(), PNG_DEFAULT);
 	}
 
 	if (!result)
 	{
 		LM_LOG_DEBUG("Failed to save image : " + imagePath);
-		FreeImage_Unload(fibitmap);
 		FreeImage_Unload(tonemappedBitmap);
 		return false;
 	}
 
 	LM_LOG_INFO("Successfully saved to " + imagePath);
 
-	FreeImage_Unload(fibitmap);
 	FreeImage_Unload(tonemappedBitmap);
 
 	return true;
@@ -279,11 +306,18 @@ bool LDRBitmapFilm::RescaleAndSave( const std::string& path, const Math::Float&
 
 Film* LDRBitmapFilm::Clone() const
 {
+	if (shared)
+	{
+		// Create lightweight per-thread film in shared mode
+		return shared->CreateThreadFilm();
+	}
+
 	auto* film = new LDRBitmapFilm;
 	film->width = width;
 	film->height = height;
 	film->type = type;
 	film->bitmap = bitmap;
+	film->transfer = transfer;
 	return film;
 }
 
@@ -306,9 +340,12 @@ void LDRBitmapFilm::Allocate( int width, int height )
 void LDRBitmapFilm::Rescale( const Math::Float& weight )
 {
 	auto& data = bitmap.InternalData();
-	for (auto& v : data)
+	const long long n = static_cast<long long>(data.size());
+	auto* p = &data[0];
+	#pragma omp parallel for
+	for (long long i = 0; i < n; i++)
 	{
-		v *= weight;
+		p[i] *= weight;
 	}
 }
 
@@ -26,6 +26,7 @@
 #include <lightmetrica/pugihelper.h>
 #include <lightmetrica/math.stats.h>
 #include <lightmetrica/math.linalgebra.h>
+#include <lightmetrica/math.distribution.h>
 #include <lightmetrica/confignode.h>
 #include <lightmetrica/align.h>
 
@@ -67,20 +68,22 @@ public:
 	virtual void RegisterPrimitives(const std::vector<Primitive*>& primitives) override;
 	virtual void PostConfigure(const Scene& scene) override {}
 	virtual EmitterShape* CreateEmitterShape() const override { return nullptr; }
-	virtual AABB GetAABB() const override { return AABB(); }		// Not used (included in triangles)
+	virtual AABB GetAABB() const override { return aabb; }
 
 public:
 
 	virtual bool EnvironmentLight() const override { return false; }
+	virtual Math::Vec3 Power() const override { return power; }
 
 private:
 
 	Math::Vec3 Le;
 	typedef std::tuple<Math::Vec3, Math::Vec3, Math::Vec3> TrianglePosition;
 	std::vector<TrianglePosition, aligned_allocator<TrianglePosition, std::alignment_of<TrianglePosition>::value>> triangles;
-	std::vector<Math::Float> triangleAreaCdf;
+	Math::DiscreteAliasDistribution1D triangleAreaDist;
 	Math::Float area, invArea;
 	Math::Vec3 power;
+	AABB aabb;
 
 };
 
@@ -108,9 +111,9 @@ bool AreaLight::Load( const ConfigNode& node, const Assets& /*assets*/ )
 
 void AreaLight::RegisterPrimitives( const std::vector<Primitive*>& primitives )
 {
-	// Create CDF
-	triangleAreaCdf.clear();
-	triangleAreaCdf.push_back(Math::Float(0));
+	// Create distribution according to the area of the triangles
+	aabb = AABB();
+	triangleAreaDist.Clear();
 	for (size_t i = 0; i < primitives.size(); i++)
 	{
 		auto& primitive = primitives[i];
@@ -125,20 +128,18 @@ void AreaLight::RegisterPrimitives( const std::vector<Primitive*>& primitives )
 			Math::Vec3 p2(primitive->transform * Math::Vec4(ps[3*v2], ps[3*v2+1], ps[3*v2+2], Math::Float(1)));
 			Math::Vec3 p3(primitive->transform * Math::Vec4(ps[3*v3], ps[3*v3+1], ps[3*v3+2], Math::Float(1)));
 			triangles.push_back(std::make_tuple(p1, p2, p3));
+			aabb = aabb.Union(p1).Union(p2).Union(p3);
 
 			// Area of the triangle
 			auto area = Math::Length(Math::Cross(p2 - p1, p3 - p1)) / Math::Float(2);
-			triangleAreaCdf.push_back(triangleAreaCdf.back() + area);
+			triangleAreaDist.Add(area);
 		}
 	}
 
 	// Normalize
-	area = triangleAreaCdf.back();
+	area = triangleAreaDist.Sum();
 	invArea = Math::Float(1) / area;
-	for (auto& v : triangleAreaCdf)
-	{
-		v *= invArea;
-	}
+	triangleAreaDist.Normalize();
 
 	power = Le * Math::Constants::Pi() * area;
 }
@@ -148,13 +149,8 @@ void AreaLight::SamplePosition( const Math::Vec2& sample, SurfaceGeometry& geom,
 	Math::Vec2 ps(sample);
 
 	// Choose a primitive according to the area
-	int index =
-		Math::Clamp(
-		static_cast<int>(std::upper_bound(triangleAreaCdf.begin(), triangleAreaCdf.end(), ps.y) - triangleAreaCdf.begin() - 1),
-		0, static_cast<int>(triangleAreaCdf.size()) - 2);
-
-	// Reuse sample
-	ps.y = (ps.y - triangleAreaCdf[index]) / (triangleAreaCdf[index+1] - triangleAreaCdf[index]);
+	// #ps.y is reused for sampling the position in the triangle
+	int index = static_cast<int>(triangleAreaDist.SampleReuse(ps.y));
 
 	// Triangle vertex positions
 	const auto& p1 = std::get<0>(triangles[index]);
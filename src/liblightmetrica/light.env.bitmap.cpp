@@ -28,12 +28,18 @@
 #include <lightmetrica/texture.h>
 #include <lightmetrica/assets.h>
 #include <lightmetrica/math.transform.h>
+#include <lightmetrica/math.distribution.h>
+#include <lightmetrica/logger.h>
 
 LM_NAMESPACE_BEGIN
 
 /*!
 	Bitmap environment light.
 	Implements environment light with environment map.
+	If the importance sampling is enabled, the positions on the bounding sphere
+	are sampled according to the luminance of the environment map.
+	The distribution is created on the spherical coordinates (\phi / 2\pi, \theta / \pi)
+	in the frame of the light probe, where the cells are weighted by sin(\theta).
 */
 class EnvmapEnvironmentLight final : public Light
 {
@@ -72,10 +78,15 @@ public:
 public:
 
 	virtual bool EnvironmentLight() const override { return true; }
+	virtual Math::Vec3 Power() const override { return power; }
 
 private:
 
 	Math::Vec3 EvaluateLightProbe(const Math::Vec3& d) const;
+	Math::Vec2 DirectionToSpherical(const Math::Vec3& d) const;
+	Math::Vec3 SphericalToDirection(const Math::Vec2& uv) const;
+	Math::Float SphericalJacobian(const Math::Vec2& uv) const;
+	void CreateDistribution();
 
 private:
 
@@ -84,6 +95,11 @@ private:
 	Math::Float area;			//!< Area of the bounding sphere.
 	Math::Float invArea;		//!< Inverse of #area.
 	Math::Float rotate;			//!< Rotation of environemnt map (counterclockwise).
+	Math::Vec3 power;			//!< Power of the light.
+
+	bool importanceSampling;						//!< True if the importance sampling is enabled.
+	int distResolution;								//!< Resolution of #dist in \theta (twice in \phi).
+	Math::PiecewiseConstantDistribution2D dist;		//!< Distribution on the spherical coordinates.
 
 };
 
@@ -106,9 +122,79 @@ bool EnvmapEnvironmentLight::Load(const ConfigNode& node, const Assets& assets)
 
 	node.ChildValueOrDefault("rotate", Math::Float(0), rotate);
 
+	// Importance sampling
+	node.ChildValueOrDefault("importance_sampling", true, importanceSampling);
+	node.ChildValueOrDefault("importance_sampling_resolution", 256, distResolution);
+	if (importanceSampling)
+	{
+		if (distResolution <= 0)
+		{
+			LM_LOG_ERROR("Invalid value for 'importance_sampling_resolution'");
+			return false;
+		}
+
+		CreateDistribution();
+	}
+
 	return true;
 }
 
+void EnvmapEnvironmentLight::CreateDistribution()
+{
+	// Values of the cells
+	// The luminance weighted by sin(\theta) is averaged over the stratified points in the cell.
+	const int Subsamples = 2;
+	const int width = 2 * distResolution;
+	const int height = distResolution;
+	std::vector<Math::Float> values(width * height);
+	std::vector<Math::Float> sinThetas(width * height);
+	Math::Float sumValues(0);
+	Math::Float sumSinThetas(0);
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			Math::Float value(0);
+			Math::Float sinTheta(0);
+			for (int sy = 0; sy < Subsamples; sy++)
+			{
+				for (int sx = 0; sx < Subsamples; sx++)
+				{
+					const auto uv = Math::Vec2(
+						(Math::Float(x) + (Math::Float(sx) + Math::Float(0.5)) / Math::Float(Subsamples)) / Math::Float(width),
+						(Math::Float(y) + (Math::Float(sy) + Math::Float(0.5)) / Math::Float(Subsamples)) / Math::Float(height));
+					const auto s = std::sin(Math::Constants::Pi() * uv.y);
+					value += Math::Max(Math::Float(0), Math::Luminance(EvaluateLightProbe(SphericalToDirection(uv)))) * s;
+					sinTheta += s;
+				}
+			}
+
+			const int i = width * y + x;
+			values[i] = value / Math::Float(Subsamples * Subsamples);
+			sinThetas[i] = sinTheta / Math::Float(Subsamples * Subsamples);
+			sumValues += values[i];
+			sumSinThetas += sinThetas[i];
+		}
+	}
+
+	if (sumValues == Math::Float(0))
+	{
+		LM_LOG_WARN("Environment map is black. Disabling importance sampling");
+		importanceSampling = false;
+		return;
+	}
+
+	// Add small fraction of the average luminance to the cells
+	// in order to keep the PDF positive for all directions
+	const auto floor = Math::Float(0.01) * sumValues / sumSinThetas;
+	for (int i = 0; i < width * height; i++)
+	{
+		values[i] += floor * sinThetas[i];
+	}
+
+	dist.Build(values, width, height);
+}
+
 void EnvmapEnvironmentLight::PostConfigure(const Scene& scene)
 {
 	// Create bounding sphere
@@ -119,6 +205,20 @@ void EnvmapEnvironmentLight::PostConfigure(const Scene& scene)
 	// Compute area
 	area = Math::Float(4) * Math::Constants::Pi() * bsphere.radius * bsphere.radius;
 	invArea = Math::Float(1) / area;
+
+	// Compute power
+	// The luminance is averaged over the stratified directions on the sphere
+	const int Resolution = 64;
+	Math::Vec3 sumLe;
+	for (int i = 0; i < Resolution; i++)
+	{
+		for (int j = 0; j < Resolution; j++)
+		{
+			const auto u = (Math::Vec2(Math::Float(i), Math::Float(j)) + Math::Vec2(Math::Float(0.5))) / Math::Float(Resolution);
+			sumLe += EvaluateLightProbe(Math::UniformSampleSphere(u));
+		}
+	}
+	power = sumLe / Math::Float(Resolution * Resolution) * Math::Constants::Pi() * area;
 }
 
 EmitterShape* EnvmapEnvironmentLight::CreateEmitterShape() const
@@ -219,12 +319,27 @@ Math::PDFEval EnvmapEnvironmentLight::EvaluateDirectionPDF(const GeneralizedBSDF
 
 void EnvmapEnvironmentLight::SamplePosition(const Math::Vec2& sample, SurfaceGeometry& geom, Math::PDFEval& pdf) const
 {
-	auto d = Math::UniformSampleSphere(sample);
+	Math::Vec3 d;
+	if (importanceSampling)
+	{
+		// Sample a direction according to the environment map
+		// The PDF in the area measure on the sphere is the PDF in the solid angle measure divided by r^2
+		Math::Float pdfUV;
+		const auto uv = dist.Sample(sample, pdfUV);
+		const auto J = SphericalJacobian(uv);
+		d = SphericalToDirection(uv);
+		pdf = Math::PDFEval(J > Math::Float(0) ? pdfUV / J / (bsphere.radius * bsphere.radius) : Math::Float(0), Math::ProbabilityMeasure::Area);
+	}
+	else
+	{
+		d = Math::UniformSampleSphere(sample);
+		pdf = Math::PDFEval(invArea, Math::ProbabilityMeasure::Area);
+	}
+
 	geom.degenerated = false;
 	geom.p = bsphere.center + d * bsphere.radius;
 	geom.gn = geom.sn = -d;
 	geom.ComputeTangentSpace();
-	pdf = Math::PDFEval(invArea, Math::ProbabilityMeasure::Area);
 }
 
 Math::Vec3 EnvmapEnvironmentLight::EvaluatePosition(const SurfaceGeometry& geom) const
@@ -234,7 +349,14 @@ Math::Vec3 EnvmapEnvironmentLight::EvaluatePosition(const SurfaceGeometry& geom)
 
 Math::PDFEval EnvmapEnvironmentLight::EvaluatePositionPDF(const SurfaceGeometry& geom) const
 {
-	return Math::PDFEval(invArea, Math::ProbabilityMeasure::Area);
+	if (!importanceSampling)
+	{
+		return Math::PDFEval(invArea, Math::ProbabilityMeasure::Area);
+	}
+
+	const auto uv = DirectionToSpherical(Math::Normalize(geom.p - bsphere.center));
+	const auto J = SphericalJacobian(uv);
+	return Math::PDFEval(J > Math::Float(0) ? dist.EvaluatePDF(uv) / J / (bsphere.radius * bsphere.radius) : Math::Float(0), Math::ProbabilityMeasure::Area);
 }
 
 Math::Vec3 EnvmapEnvironmentLight::EvaluateLightProbe(const Math::Vec3& d) const
@@ -249,6 +371,35 @@ Math::Vec3 EnvmapEnvironmentLight::EvaluateLightProbe(const Math::Vec3& d) const
 	return Le->Evaluate(uv);
 }
 
+Math::Vec2 EnvmapEnvironmentLight::DirectionToSpherical(const Math::Vec3& d) const
+{
+	// Direction in the frame of the light probe
+	const auto t = Math::Vec3(Math::Rotate(-rotate, Math::Vec3(0, 1, 0)) * Math::Vec4(d));
+	const auto theta = std::acos(Math::Clamp(t.z, Math::Float(-1), Math::Float(1)));
+	auto phi = std::atan2(t.y, t.x);
+	if (phi < Math::Float(0))
+	{
+		phi += Math::Float(2) * Math::Constants::Pi();
+	}
+
+	return Math::Vec2(phi * Math::Constants::InvTwoPi(), theta * Math::Constants::InvPi());
+}
+
+Math::Vec3 EnvmapEnvironmentLight::SphericalToDirection(const Math::Vec2& uv) const
+{
+	const auto theta = Math::Constants::Pi() * uv.y;
+	const auto phi = Math::Float(2) * Math::Constants::Pi() * uv.x;
+	const auto sinTheta = std::sin(theta);
+	const auto t = Math::Vec3(sinTheta * std::cos(phi), sinTheta * std::sin(phi), std::cos(theta));
+	return Math::Normalize(Math::Vec3(Math::Rotate(rotate, Math::Vec3(0, 1, 0)) * Math::Vec4(t)));
+}
+
+Math::Float EnvmapEnvironmentLight::SphericalJacobian(const Math::Vec2& uv) const
+{
+	// d\omega = sin(\theta) d\theta d\phi = 2 \pi^2 sin(\theta) du dv
+	return Math::Float(2) * Math::Constants::Pi() * Math::Constants::Pi() * std::sin(Math::Constants::Pi() * uv.y);
+}
+
 LM_COMPONENT_REGISTER_IMPL(EnvmapEnvironmentLight, Light);
 
 LM_NAMESPACE_END
\ No newline at end of file
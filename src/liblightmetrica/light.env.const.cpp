@@ -69,6 +69,7 @@ public:
 public:
 
 	virtual bool EnvironmentLight() const override { return true; }
+	virtual Math::Vec3 Power() const override { return Le * Math::Constants::Pi() * area; }
 
 private:
 
@@ -0,0 +1,264 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+#include <lightmetrica/lightselector.h>
+#include <lightmetrica/light.h>
+#include <lightmetrica/logger.h>
+#include <lightmetrica/aabb.h>
+#include <algorithm>
+
+LM_NAMESPACE_BEGIN
+
+/*!
+	Light BVH selector.
+	Chooses a light by traversing the bounding volume hierarchy of the lights.
+	In each node, a child is chosen with the probability proportional to the importance of the child
+	estimated by the power of the lights divided by the squared distance
+	from the shading point to the center of the bound.
+	The distance is clamped by the half diagonal of the bound in order to
+	avoid the singularity for the shading points inside the bound.
+	The orientation of the lights is not taken into account.
+	Environment lights, which cannot be bounded, are chosen uniformly
+	with the fixed probability #environment lights / (#environment lights + 1)
+	regardless of the power, and the BVH is traversed otherwise.
+	If the shading point is not given, the selection among the bounded lights
+	is equivalent to the power-based selection.
+	Reference: A. Conty Estevez and C. Kulla, Importance sampling of many lights
+	with adaptive tree splitting, Procs. of HPG 2018.
+*/
+class BVHLightSelector final : public LightSelector
+{
+public:
+
+	LM_COMPONENT_IMPL_DEF("bvh");
+
+private:
+
+	struct Node
+	{
+		AABB bound;				// Bound of the lights in the node
+		Math::Float power;		// Sum of the luminance of the power of the lights in the node
+		int parent;				// Index of the parent node (-1 for the root)
+		int left, right;		// Indices of the child nodes (-1 for the leaf)
+		int lightIndex;			// Index of the light (only for the leaf)
+	};
+
+public:
+
+	virtual bool Configure(const ConfigNode& node, const Assets& assets) override { return true; }
+	virtual bool Build(const std::vector<const Light*>& lights) override;
+	virtual int Sample(const Math::Vec3* p, Math::Float& u, Math::PDFEval& selectionPdf) const override;
+	virtual Math::PDFEval EvaluatePdf(const Math::Vec3* p, int index) const override;
+
+private:
+
+	int Build(const std::vector<AABB>& bounds, const std::vector<Math::Float>& powers, int begin, int end, int parent);
+	Math::Float Importance(const Node& node, const Math::Vec3* p) const;
+	Math::Float LeftProbability(const Node& node, const Math::Vec3* p) const;
+	Math::Float EnvironmentLightSelectionProb() const;
+
+private:
+
+	std::vector<Node> nodes;				// Nodes of the BVH (the root is the first node)
+	std::vector<int> lightIndices;			// Indices of the bounded lights, sorted in the build
+	std::vector<int> leafNodeIndices;		// Indices of the leaf node for each light (-1 for environment lights)
+	std::vector<int> envLightIndices;		// Indices of the environment lights
+
+};
+
+bool BVHLightSelector::Build( const std::vector<const Light*>& lights )
+{
+	nodes.clear();
+	lightIndices.clear();
+	envLightIndices.clear();
+	leafNodeIndices.assign(lights.size(), -1);
+
+	// Separate environment lights
+	std::vector<AABB> bounds(lights.size());
+	std::vector<Math::Float> powers(lights.size());
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		const int li = static_cast<int>(i);
+		if (lights[i]->EnvironmentLight())
+		{
+			envLightIndices.push_back(li);
+		}
+		else
+		{
+			lightIndices.push_back(li);
+			bounds[i] = lights[i]->GetAABB();
+			powers[i] = Math::Max(Math::Float(0), Math::Luminance(lights[i]->Power()));
+		}
+	}
+
+	// Build BVH
+	if (!lightIndices.empty())
+	{
+		nodes.reserve(2 * lightIndices.size() - 1);
+		Build(bounds, powers, 0, static_cast<int>(lightIndices.size()), -1);
+	}
+
+	LM_LOG_INFO("Created light BVH with " + std::to_string(nodes.size()) + " nodes");
+	return true;
+}
+
+int BVHLightSelector::Build( const std::vector<AABB>& bounds, const std::vector<Math::Float>& powers, int begin, int end, int parent )
+{
+	const int nodeIndex = static_cast<int>(nodes.size());
+	nodes.push_back(Node());
+	nodes[nodeIndex].parent = parent;
+	nodes[nodeIndex].left = nodes[nodeIndex].right = -1;
+	nodes[nodeIndex].lightIndex = -1;
+
+	if (end - begin == 1)
+	{
+		// Leaf node
+		const int li = lightIndices[begin];
+		nodes[nodeIndex].bound = bounds[li];
+		nodes[nodeIndex].power = powers[li];
+		nodes[nodeIndex].lightIndex = li;
+		leafNodeIndices[li] = nodeIndex;
+		return nodeIndex;
+	}
+
+	// Split at the median of the centroids according to the longest axis of the centroid bound
+	AABB centroidBound;
+	for (int i = begin; i < end; i++)
+	{
+		const auto& bound = bounds[lightIndices[i]];
+		centroidBound = centroidBound.Union((bound.min + bound.max) * Math::Float(0.5));
+	}
+
+	const int splitAxis = centroidBound.LongestAxis();
+	const int mid = (begin + end) / 2;
+	std::nth_element(lightIndices.begin() + begin, lightIndices.begin() + mid, lightIndices.begin() + end,
+		[&](int i1, int i2) { return bounds[i1].min[splitAxis] + bounds[i1].max[splitAxis] < bounds[i2].min[splitAxis] + bounds[i2].max[splitAxis]; });
+
+	// Internal node
+	// Note that #nodes might be reallocated in the recursive calls
+	const int left = Build(bounds, powers, begin, mid, nodeIndex);
+	const int right = Build(bounds, powers, mid, end, nodeIndex);
+	nodes[nodeIndex].left = left;
+	nodes[nodeIndex].right = right;
+	nodes[nodeIndex].bound = nodes[left].bound.Union(nodes[right].bound);
+	nodes[nodeIndex].power = nodes[left].power + nodes[right].power;
+
+	return nodeIndex;
+}
+
+Math::Float BVHLightSelector::Importance( const Node& node, const Math::Vec3* p ) const
+{
+	if (p == nullptr)
+	{
+		return node.power;
+	}
+
+	const auto center = (node.bound.min + node.bound.max) * Math::Float(0.5);
+	const auto halfDiagonal = (node.bound.max - node.bound.min) * Math::Float(0.5);
+	const auto distSq = Math::Max(Math::Length2(*p - center), Math::Max(Math::Length2(halfDiagonal), Math::Constants::Eps()));
+	return node.power / distSq;
+}
+
+Math::Float BVHLightSelector::LeftProbability( const Node& node, const Math::Vec3* p ) const
+{
+	const auto leftImportance = Importance(nodes[node.left], p);
+	const auto rightImportance = Importance(nodes[node.right], p);
+	const auto sum = leftImportance + rightImportance;
+	return sum > Math::Float(0) ? leftImportance / sum : Math::Float(0.5);
+}
+
+Math::Float BVHLightSelector::EnvironmentLightSelectionProb() const
+{
+	if (envLightIndices.empty())
+	{
+		return Math::Float(0);
+	}
+
+	const auto numEnvLights = static_cast<Math::Float>(envLightIndices.size());
+	return numEnvLights / (numEnvLights + Math::Float(nodes.empty() ? 0 : 1));
+}
+
+int BVHLightSelector::Sample( const Math::Vec3* p, Math::Float& u, Math::PDFEval& selectionPdf ) const
+{
+	// Choose environment lights or the BVH
+	Math::Float pdf(1);
+	const auto envProb = EnvironmentLightSelectionProb();
+	if (u < envProb)
+	{
+		const auto numEnvLights = static_cast<int>(envLightIndices.size());
+		const auto v = u / envProb * Math::Float(numEnvLights);
+		const int i = Math::Min(Math::Cast<int>(v), numEnvLights - 1);
+		u = Math::Min(v - Math::Float(i), Math::Float(1) - std::numeric_limits<Math::Float>::epsilon());
+		selectionPdf = Math::PDFEval(envProb / Math::Float(numEnvLights), Math::ProbabilityMeasure::Discrete);
+		return envLightIndices[i];
+	}
+
+	u = (u - envProb) / (Math::Float(1) - envProb);
+	pdf *= Math::Float(1) - envProb;
+
+	// Traverse BVH
+	int nodeIndex = 0;
+	while (nodes[nodeIndex].lightIndex < 0)
+	{
+		const auto& node = nodes[nodeIndex];
+		const auto leftProb = LeftProbability(node, p);
+		if (u < leftProb)
+		{
+			u /= leftProb;
+			pdf *= leftProb;
+			nodeIndex = node.left;
+		}
+		else
+		{
+			u = (u - leftProb) / (Math::Float(1) - leftProb);
+			pdf *= Math::Float(1) - leftProb;
+			nodeIndex = node.right;
+		}
+
+		u = Math::Min(u, Math::Float(1) - std::numeric_limits<Math::Float>::epsilon());
+	}
+
+	selectionPdf = Math::PDFEval(pdf, Math::ProbabilityMeasure::Discrete);
+	return nodes[nodeIndex].lightIndex;
+}
+
+Math::PDFEval BVHLightSelector::EvaluatePdf( const Math::Vec3* p, int index ) const
+{
+	const auto envProb = EnvironmentLightSelectionProb();
+	const int leafNodeIndex = leafNodeIndices[index];
+	if (leafNodeIndex < 0)
+	{
+		return Math::PDFEval(envProb / Math::Float(envLightIndices.size()), Math::ProbabilityMeasure::Discrete);
+	}
+
+	// Trace back to the root
+	Math::Float pdf = Math::Float(1) - envProb;
+	for (int child = leafNodeIndex, parent = nodes[child].parent; parent >= 0; child = parent, parent = nodes[parent].parent)
+	{
+		const auto leftProb = LeftProbability(nodes[parent], p);
+		pdf *= nodes[parent].left == child ? leftProb : Math::Float(1) - leftProb;
+	}
+
+	return Math::PDFEval(pdf, Math::ProbabilityMeasure::Discrete);
+}
+
+LM_COMPONENT_REGISTER_IMPL(BVHLightSelector, LightSelector);
+
+LM_NAMESPACE_END
\ No newline at end of file
@@ -0,0 +1,93 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+#include <lightmetrica/lightselector.h>
+#include <lightmetrica/light.h>
+#include <lightmetrica/logger.h>
+#include <lightmetrica/math.distribution.h>
+
+LM_NAMESPACE_BEGIN
+
+/*!
+	Power-based light selector.
+	Chooses a light with the probability proportional to the power of the light,
+	which is effective for the scenes with the lights of very different power.
+	Falls back to the uniform selection if all lights have zero power.
+*/
+class PowerLightSelector final : public LightSelector
+{
+public:
+
+	LM_COMPONENT_IMPL_DEF("power");
+
+public:
+
+	virtual bool Configure(const ConfigNode& node, const Assets& assets) override { return true; }
+	virtual bool Build(const std::vector<const Light*>& lights) override;
+	virtual int Sample(const Math::Vec3* p, Math::Float& u, Math::PDFEval& selectionPdf) const override;
+	virtual Math::PDFEval EvaluatePdf(const Math::Vec3* p, int index) const override;
+
+private:
+
+	Math::DiscreteAliasDistribution1D dist;		// Distribution proportional to the power of the lights
+
+};
+
+bool PowerLightSelector::Build( const std::vector<const Light*>& lights )
+{
+	// Create distribution according to the luminance of the power
+	dist.Clear();
+	Math::Float sum(0);
+	for (const auto* light : lights)
+	{
+		const auto power = Math::Max(Math::Float(0), Math::Luminance(light->Power()));
+		dist.Add(power);
+		sum += power;
+	}
+
+	if (sum == Math::Float(0))
+	{
+		LM_LOG_WARN("Total power of the lights is zero. Using uniform selection");
+		dist.Clear();
+		for (size_t i = 0; i < lights.size(); i++)
+		{
+			dist.Add(Math::Float(1));
+		}
+	}
+
+	dist.Normalize();
+	return true;
+}
+
+int PowerLightSelector::Sample( const Math::Vec3* /*p*/, Math::Float& u, Math::PDFEval& selectionPdf ) const
+{
+	const int li = static_cast<int>(dist.SampleReuse(u));
+	selectionPdf = Math::PDFEval(dist.EvaluatePDF(li), Math::ProbabilityMeasure::Discrete);
+	return li;
+}
+
+Math::PDFEval PowerLightSelector::EvaluatePdf( const Math::Vec3* /*p*/, int index ) const
+{
+	return Math::PDFEval(dist.EvaluatePDF(index), Math::ProbabilityMeasure::Discrete);
+}
+
+LM_COMPONENT_REGISTER_IMPL(PowerLightSelector, LightSelector);
+
+LM_NAMESPACE_END
\ No newline at end of file
@@ -0,0 +1,63 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+#include <lightmetrica/lightselector.h>
+
+LM_NAMESPACE_BEGIN
+
+/*!
+	Uniform light selector.
+	Chooses a light uniformly from the lights in the scene.
+*/
+class UniformLightSelector final : public LightSelector
+{
+public:
+
+	LM_COMPONENT_IMPL_DEF("uniform");
+
+public:
+
+	virtual bool Configure(const ConfigNode& node, const Assets& assets) override { return true; }
+	virtual bool Build(const std::vector<const Light*>& lights) override { numLights = static_cast<int>(lights.size()); return true; }
+	virtual int Sample(const Math::Vec3* p, Math::Float& u, Math::PDFEval& selectionPdf) const override;
+	virtual Math::PDFEval EvaluatePdf(const Math::Vec3* p, int index) const override;
+
+private:
+
+	int numLights;
+
+};
+
+int UniformLightSelector::Sample( const Math::Vec3* /*p*/, Math::Float& u, Math::PDFEval& selectionPdf ) const
+{
+	int li = Math::Min(static_cast<int>(u * numLights), numLights - 1);
+	u = u * numLights - Math::Float(li);
+	selectionPdf = Math::PDFEval(Math::Float(1) / Math::Float(numLights), Math::ProbabilityMeasure::Discrete);
+	return li;
+}
+
+Math::PDFEval UniformLightSelector::EvaluatePdf( const Math::Vec3* /*p*/, int /*index*/ ) const
+{
+	return Math::PDFEval(Math::Float(1) / Math::Float(numLights), Math::ProbabilityMeasure::Discrete);
+}
+
+LM_COMPONENT_REGISTER_IMPL(UniformLightSelector, LightSelector);
+
+LM_NAMESPACE_END
\ No newline at end of file
@@ -34,6 +34,7 @@
 #include <lightmetrica/renderutils.h>
 #include <lightmetrica/assert.h>
 #include <lightmetrica/defaultexperiments.h>
+#include <lightmetrica/align.h>
 #include <thread>
 #include <atomic>
 #include <omp.h>
@@ -98,6 +99,7 @@ public:
 		: renderer(renderer)
 		, sampler(sampler)
 		, film(film)
+		, sampleIndex(0)
 	{
 
 	}
@@ -110,12 +112,20 @@ public:
 
 	virtual void ProcessSingleSample(const Scene& scene) override;
 	virtual const Film* GetFilm() const override { return film.get(); }
+	virtual void SetSampleIndex(long long index) override { sampleIndex = index; }
 
 private:
 
 	const LighttraceRenderer& renderer;
 	std::unique_ptr<Sampler> sampler;
 	std::unique_ptr<Film> film;
+	long long sampleIndex;
+
+private:
+
+	// Contributions of a sample are accumulated to the film at once
+	// Reused in the same thread in order to avoid unnecessary memory allocation
+	std::vector<Splat, aligned_allocator<Splat, std::alignment_of<Splat>::value>> splats;
 
 };
 
@@ -129,9 +139,9 @@ bool LighttraceRenderer::Configure(const ConfigNode& node, const Assets& assets,
 	// Sampler
 	auto samplerNode = node.Child("sampler");
 	auto samplerNodeType = samplerNode.AttributeValue("type");
-	if (samplerNodeType != "random")
+	if (samplerNodeType != "random" && samplerNodeType != "sobol" && samplerNodeType != "halton")
 	{
-		LM_LOG_ERROR("Invalid sampler type. This renderer requires 'random' sampler");
+		LM_LOG_ERROR("Invalid sampler type. This renderer requires 'random', 'sobol', or 'halton' sampler");
 		return false;
 	}
 	initialSampler.reset(ComponentFactory::Create<ConfigurableSampler>(samplerNodeType));
@@ -173,6 +183,14 @@ void LighttraceRenderer_RenderProcess::ProcessSingleSample(const Scene& scene)
 {
 	SurfaceGeometry geomL;
 	Math::PDFEval pdfPL;
+	splats.clear();
+
+	// Light particles are not associated with pixels, so the samples are
+	// generated from a single sequence indexed by the global sample index
+	// Dimensions of the samples:
+	//   [0, 2) : Position on the light
+	//   [2 + 8i, 10 + 8i) : Position on camera, RR, and BSDF sampling for the i-th vertex
+	sampler->BeginSample(0, sampleIndex++);
 
 	// Sample a position on the light
 	auto lightSampleP = sampler->NextVec2();
@@ -195,6 +213,8 @@ void LighttraceRenderer_RenderProcess::ProcessSingleSample(const Scene& scene)
 
 	while (true)
 	{
+		sampler->SetDimension(2 + 8 * depth);
+
 		// Skip if current BSDF is directionally degenerated
 		if ((currBsdf->BSDFTypes() & GeneralizedBSDFType::NonDelta) > 0)
 		{
@@ -232,9 +252,9 @@ void LighttraceRenderer_RenderProcess::ProcessSingleSample(const Scene& scene)
 					// Positional component of We
 					auto positionalWe = scene.MainCamera()->EvaluatePosition(geomE);
 
-					// Evaluate contribution and accumulate to film
+					// Evaluate contribution and record the splat
 					auto contrb = throughput * fsL * G * fsE * positionalWe / pdfPE.v;
-					film->AccumulateContribution(rasterPos, contrb);
+					splats.emplace_back(rasterPos, contrb);
 				}
 			}
 		}
@@ -297,6 +317,12 @@ void LighttraceRenderer_RenderProcess::ProcessSingleSample(const Scene& scene)
 		currBsdf = isect.bsdf;
 		depth++;
 	}
+
+	// Accumulate contributions to the film
+	if (!splats.empty())
+	{
+		film->AccumulateContributions(&splats[0], splats.size(), Math::Float(1));
+	}
 }
 
 LM_COMPONENT_REGISTER_IMPL(LighttraceRenderer, Renderer);
@@ -0,0 +1,417 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+#include <lightmetrica/configurablesampler.h>
+#include <lightmetrica/logger.h>
+#include <lightmetrica/confignode.h>
+#include <lightmetrica/assets.h>
+#include <lightmetrica/random.h>
+
+LM_NAMESPACE_BEGIN
+
+namespace
+{
+
+	// Converts a value in [0, 1) to Math::Float
+	// The value is truncated to the precision in order not to be rounded up
+	// across the boundaries of the strata (or to one)
+	LM_FORCE_INLINE Math::Float DoubleToFloat(double v)
+	{
+		const double Scale = static_cast<double>(1ULL << std::numeric_limits<Math::Float>::digits);
+		return Math::Float(std::floor(v * Scale) / Scale);
+	}
+
+	LM_FORCE_INLINE Math::Float UIntToFloat(unsigned int v)
+	{
+		return DoubleToFloat(v * (1.0 / 4294967296.0));
+	}
+
+	LM_FORCE_INLINE unsigned int ReverseBits(unsigned int v)
+	{
+		v = ((v >> 1) & 0x55555555U) | ((v & 0x55555555U) << 1);
+		v = ((v >> 2) & 0x33333333U) | ((v & 0x33333333U) << 2);
+		v = ((v >> 4) & 0x0F0F0F0FU) | ((v & 0x0F0F0F0FU) << 4);
+		v = ((v >> 8) & 0x00FF00FFU) | ((v & 0x00FF00FFU) << 8);
+		return (v >> 16) | (v << 16);
+	}
+
+	// Combines a value and a seed into a well-mixed 32-bit value
+	LM_FORCE_INLINE unsigned int Hash(unsigned int v, unsigned int seed)
+	{
+		v ^= seed * 0x9E3779B9U;
+		v ^= v >> 16;
+		v *= 0x7FEB352DU;
+		v ^= v >> 15;
+		v *= 0x846CA68BU;
+		v ^= v >> 16;
+		return v;
+	}
+
+	/*
+		Nested uniform (Owen) scrambling in base 2.
+		A hash-based permutation which flips each bit depending only on the lower bits
+		(Laine and Karras 2011) is applied to the bit-reversed value,
+		so that each bit of #v is flipped depending only on the higher bits.
+		Refer to "Practical Hash-based Owen Scrambling" [Burley 2020].
+	*/
+	LM_FORCE_INLINE unsigned int NestedUniformScramble(unsigned int v, unsigned int seed)
+	{
+		v = ReverseBits(v);
+		v += seed;
+		v ^= v * 0x6C50B47CU;
+		v ^= v * 0xB82F1E52U;
+		v ^= v * 0xC7AFE638U;
+		v ^= v * 0x8D22F6E6U;
+		return ReverseBits(v);
+	}
+
+	// The second dimension of the Sobol sequence (primitive polynomial x + 1)
+	LM_FORCE_INLINE unsigned int SobolSecondDimension(unsigned int index)
+	{
+		unsigned int result = 0;
+		for (unsigned int v = 1U << 31; index != 0; index >>= 1, v ^= v >> 1)
+		{
+			if (index & 1)
+			{
+				result ^= v;
+			}
+		}
+		return result;
+	}
+
+	/*
+		Prime numbers.
+		Bases of the Halton sequence.
+	*/
+	class Primes
+	{
+	public:
+
+		static const int Count = 256;
+
+	public:
+
+		Primes()
+		{
+			int n = 2;
+			for (int i = 0; i < Count; n++)
+			{
+				bool prime = true;
+				for (int j = 0; j < i && primes[j] * primes[j] <= n; j++)
+				{
+					if (n % primes[j] == 0)
+					{
+						prime = false;
+						break;
+					}
+				}
+				if (prime)
+				{
+					primes[i++] = n;
+				}
+			}
+		}
+
+		static int Get(int i)
+		{
+			static const Primes instance;
+			return instance.primes[i];
+		}
+
+	private:
+
+		int primes[Count];
+
+	};
+
+}
+
+/*!
+	Low-discrepancy sampler.
+	A base class for the samplers based on low-discrepancy sequences.
+	Samples are the points of the per-pixel sequences specified by #BeginSample.
+	The sequences are decorrelated among pixels and dimensions by scrambling
+	with the seeds computed from the pixel index, the dimension, and #scrambleSeed.
+	Before the first call of #BeginSample, the sampler behaves as a random sampler,
+	which is utilized e.g. for the generation of seeds of the render processes.
+*/
+class LowDiscrepancySampler : public ConfigurableSampler
+{
+public:
+
+	LowDiscrepancySampler()
+		: scrambleSeed(0)
+		, active(false)
+		, pixelSeed(0)
+		, sampleIndex(0)
+		, dimension(0)
+	{
+
+	}
+
+public:
+
+	virtual bool Configure(const ConfigNode& node, const Assets& assets) override
+	{
+		// Load parameters
+		std::string rngType;
+		node.ChildValueOrDefault("rng", std::string("sfmt"), rngType);
+		if (!ComponentFactory::CheckRegistered<Random>(rngType))
+		{
+			LM_LOG_ERROR("Unsupported random number generator '" + rngType + "'");
+			return false;
+		}
+
+		// Seed for random number
+		node.ChildValueOrDefault("rng_seed", -1, initialSeed);
+		if (initialSeed < 0)
+		{
+			initialSeed = static_cast<int>(std::time(nullptr));
+		}
+
+		// Seed for scrambling
+		// The seed must be shared among the render processes in order to
+		// generate the same sequence for the pixel regardless of the threads.
+		int seed;
+		node.ChildValueOrDefault("scramble_seed", 0, seed);
+		scrambleSeed = static_cast<unsigned int>(seed);
+
+		// Create random number generator
+		rng.reset(ComponentFactory::Create<Random>(rngType));
+		SetSeed(initialSeed);
+
+		return true;
+	}
+
+	virtual void SetSeed(unsigned int seed) override
+	{
+		initialSeed = seed;
+		rng->SetSeed(initialSeed);
+	}
+
+	virtual Math::Float Next() override
+	{
+		if (!active)
+		{
+			return rng->Next();
+		}
+
+		return Sample(dimension++);
+	}
+
+	virtual unsigned int NextUInt() override
+	{
+		if (!active)
+		{
+			return rng->NextUInt();
+		}
+
+		return static_cast<unsigned int>(Sample(dimension++) * 4294967296.0);
+	}
+
+	virtual Math::Vec2 NextVec2() override
+	{
+		if (!active)
+		{
+			auto u1 = rng->Next();
+			auto u2 = rng->Next();
+			return Math::Vec2(u1, u2);
+		}
+
+		// Two-dimensional samples are aligned to even dimensions
+		// in order to be stratified as a pair
+		dimension += dimension & 1;
+		auto u = Sample2D(dimension);
+		dimension += 2;
+		return u;
+	}
+
+	virtual Random* Rng() override
+	{
+		return rng.get();
+	}
+
+	virtual bool RequiresSampleIndex() const override
+	{
+		return true;
+	}
+
+	virtual void BeginSample(long long pixel, long long index) override
+	{
+		active = true;
+		pixelSeed = Hash(static_cast<unsigned int>(pixel) ^ static_cast<unsigned int>(pixel >> 32), scrambleSeed);
+		sampleIndex = static_cast<unsigned long long>(index);
+		dimension = 0;
+	}
+
+	virtual void SetDimension(int dimension) override
+	{
+		this->dimension = dimension;
+	}
+
+protected:
+
+	/*!
+		Copy the configuration to the cloned sampler.
+		\param sampler Cloned sampler.
+	*/
+	void CloneTo(LowDiscrepancySampler* sampler) const
+	{
+		sampler->rng.reset(ComponentFactory::Create<Random>(rng->ComponentImplTypeName()));
+		sampler->scrambleSeed = scrambleSeed;
+		sampler->SetSeed(initialSeed);
+	}
+
+	/*!
+		Generate an element of the current point.
+		\param dimension Dimension.
+		\return Sampled value in [0, 1).
+	*/
+	virtual Math::Float Sample(int dimension) const = 0;
+
+	/*!
+		Generate two elements of the current point.
+		\param dimension First dimension (even number).
+		\return Sampled values in [0, 1)^2.
+	*/
+	virtual Math::Vec2 Sample2D(int dimension) const = 0;
+
+protected:
+
+	std::unique_ptr<Random> rng;			//!< Random number generator
+	int initialSeed;						//!< Seed of #rng
+	unsigned int scrambleSeed;				//!< Global seed for scrambling
+	bool active;							//!< True after the first #BeginSample
+	unsigned int pixelSeed;					//!< Seed for the current pixel
+	unsigned long long sampleIndex;			//!< Sample index in the current pixel
+	int dimension;							//!< Dimension of the next sample
+
+};
+
+// --------------------------------------------------------------------------------
+
+/*!
+	Sobol sampler.
+	A sampler with Owen-scrambled Sobol sequence.
+	The dimensions are grouped into pairs, and each pair is generated from
+	the first two dimensions of the Sobol sequence (i.e., (0, 2)-sequence in base 2)
+	with independent shuffling of the indices and nested uniform scrambling.
+	This padding approach retains the two-dimensional stratification
+	for arbitrary number of dimensions [Burley 2020].
+*/
+class SobolSampler final : public LowDiscrepancySampler
+{
+public:
+
+	LM_COMPONENT_IMPL_DEF("sobol");
+
+public:
+
+	virtual Sampler* Clone() const override
+	{
+		auto* sampler = new SobolSampler;
+		CloneTo(sampler);
+		return sampler;
+	}
+
+protected:
+
+	virtual Math::Float Sample(int dimension) const override
+	{
+		const auto seed = Hash(pixelSeed, static_cast<unsigned int>(dimension >> 1));
+		const auto index = NestedUniformScramble(static_cast<unsigned int>(sampleIndex), seed);
+		const auto v = (dimension & 1) == 0 ? ReverseBits(index) : SobolSecondDimension(index);
+		return UIntToFloat(NestedUniformScramble(v, Hash(seed, (dimension & 1) + 1)));
+	}
+
+	virtual Math::Vec2 Sample2D(int dimension) const override
+	{
+		const auto seed = Hash(pixelSeed, static_cast<unsigned int>(dimension >> 1));
+		const auto index = NestedUniformScramble(static_cast<unsigned int>(sampleIndex), seed);
+		return Math::Vec2(
+			UIntToFloat(NestedUniformScramble(ReverseBits(index), Hash(seed, 1))),
+			UIntToFloat(NestedUniformScramble(SobolSecondDimension(index), Hash(seed, 2))));
+	}
+
+};
+
+// --------------------------------------------------------------------------------
+
+/*!
+	Halton sampler.
+	A sampler with Halton sequence with per-pixel random digit scrambling.
+	The i-th dimension is the radical inverse in the base of the i-th prime number.
+	The digits of each level are permuted by the random shift
+	depending on the pixel, the dimension, and the level.
+	The dimensions larger than the number of prepared prime numbers
+	reuse the bases with different scrambling.
+*/
+class HaltonSampler final : public LowDiscrepancySampler
+{
+public:
+
+	LM_COMPONENT_IMPL_DEF("halton");
+
+public:
+
+	virtual Sampler* Clone() const override
+	{
+		auto* sampler = new HaltonSampler;
+		CloneTo(sampler);
+		return sampler;
+	}
+
+protected:
+
+	virtual Math::Float Sample(int dimension) const override
+	{
+		const auto base = static_cast<unsigned int>(Primes::Get(dimension % Primes::Count));
+		const auto seed = Hash(pixelSeed, static_cast<unsigned int>(dimension));
+		const double invBase = 1.0 / base;
+
+		// Scrambled radical inverse
+		// The zero digits after the last non-zero digit are also scrambled
+		// until the contribution is below the precision
+		auto index = sampleIndex;
+		double result = 0;
+		double invBaseN = 1;
+		for (unsigned int level = 0; index > 0 || invBaseN > std::numeric_limits<Math::Float>::epsilon(); level++)
+		{
+			const auto digit = static_cast<unsigned int>(index % base);
+			const auto shift = Hash(level, seed) % base;
+			invBaseN *= invBase;
+			result += ((digit + shift) % base) * invBaseN;
+			index /= base;
+		}
+
+		return DoubleToFloat(result);
+	}
+
+	virtual Math::Vec2 Sample2D(int dimension) const override
+	{
+		return Math::Vec2(Sample(dimension), Sample(dimension + 1));
+	}
+
+};
+
+LM_COMPONENT_REGISTER_IMPL(SobolSampler, ConfigurableSampler);
+LM_COMPONENT_REGISTER_IMPL(HaltonSampler, ConfigurableSampler);
+
+LM_NAMESPACE_END
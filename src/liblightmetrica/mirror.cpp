@@ -52,6 +52,7 @@ public:
 	virtual Math::Vec3 EvaluateDirection(const GeneralizedBSDFEvaluateQuery& query, const SurfaceGeometry& geom) const override;
 	virtual Math::PDFEval EvaluateDirectionPDF(const GeneralizedBSDFEvaluateQuery& query, const SurfaceGeometry& geom) const override;
 	virtual int BSDFTypes() const override { return GeneralizedBSDFType::SpecularReflection; }
+	virtual void PropagateRayDifferential(const GeneralizedBSDFSampleQuery& query, const SurfaceGeometry& geom, const GeneralizedBSDFSampleResult& result, RayDifferential& rd) const override;
 
 private:
 
@@ -214,6 +215,12 @@ Math::PDFEval PerfectMirrorBSDF::EvaluateDirectionPDF( const GeneralizedBSDFEval
 	return Math::PDFEval(Math::Float(1) / Math::CosThetaZUp(localWi), Math::ProbabilityMeasure::ProjectedSolidAngle);
 }
 
+void PerfectMirrorBSDF::PropagateRayDifferential( const GeneralizedBSDFSampleQuery& /*query*/, const SurfaceGeometry& geom, const GeneralizedBSDFSampleResult& /*result*/, RayDifferential& rd ) const
+{
+	// Reflection w.r.t. the shading normal
+	rd.Reflect(geom.sn);
+}
+
 LM_COMPONENT_REGISTER_IMPL(PerfectMirrorBSDF, BSDF);
 
 LM_NAMESPACE_END
\ No newline at end of file
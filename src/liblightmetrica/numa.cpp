@@ -0,0 +1,282 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+#include <lightmetrica/numa.h>
+#include <lightmetrica/align.h>
+#include <lightmetrica/logger.h>
+#if LM_PLATFORM_LINUX
+#include <sched.h>
+#include <pthread.h>
+#endif
+#if LM_NUMA
+#include <numa.h>
+#endif
+
+LM_NAMESPACE_BEGIN
+
+namespace
+{
+
+#if LM_COMPILER_MSVC
+__declspec(thread) int CurrentNode = -1;
+#elif LM_COMPILER_GCC
+__thread int CurrentNode = -1;
+#endif
+
+/*
+	NUMA topology.
+	Loaded once from sysfs on the first use.
+*/
+struct NUMATopology
+{
+
+	std::vector<std::vector<int>> nodeCPUs;		// CPUs for each node
+	std::vector<int> cpuNodes;					// Node index for each CPU (-1 if not available)
+
+	NUMATopology()
+	{
+#if LM_PLATFORM_LINUX
+		// CPUs allowed for the process
+		cpu_set_t allowed;
+		CPU_ZERO(&allowed);
+		if (sched_getaffinity(0, sizeof(cpu_set_t), &allowed) != 0)
+		{
+			LM_LOG_WARN("Failed to get CPU affinity of the process");
+		}
+
+		// Enumerate nodes
+		for (int node = 0; ; node++)
+		{
+			const auto path = boost::str(boost::format("/sys/devices/system/node/node%d/cpulist") % node);
+			std::ifstream ifs(path);
+			if (!ifs.is_open())
+			{
+				break;
+			}
+
+			// CPU list is formatted as e.g. "0-7,16-23"
+			std::string line;
+			std::getline(ifs, line);
+			std::vector<int> cpus;
+			std::stringstream ss(line);
+			std::string range;
+			while (std::getline(ss, range, ','))
+			{
+				int begin, end;
+				if (std::sscanf(range.c_str(), "%d-%d", &begin, &end) != 2)
+				{
+					if (std::sscanf(range.c_str(), "%d", &begin) != 1)
+					{
+						continue;
+					}
+					end = begin;
+				}
+				for (int cpu = begin; cpu <= end; cpu++)
+				{
+					if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))
+					{
+						cpus.push_back(cpu);
+					}
+				}
+			}
+
+			nodeCPUs.push_back(cpus);
+		}
+
+		// If sysfs does not expose the nodes, regard all allowed CPUs as a single node
+		if (nodeCPUs.empty())
+		{
+			std::vector<int> cpus;
+			for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+			{
+				if (CPU_ISSET(cpu, &allowed))
+				{
+					cpus.push_back(cpu);
+				}
+			}
+			nodeCPUs.push_back(cpus);
+		}
+
+		// Inverse map
+		for (size_t node = 0; node < nodeCPUs.size(); node++)
+		{
+			for (int cpu : nodeCPUs[node])
+			{
+				if (cpu >= static_cast<int>(cpuNodes.size()))
+				{
+					cpuNodes.resize(cpu + 1, -1);
+				}
+				cpuNodes[cpu] = static_cast<int>(node);
+			}
+		}
+#else
+		nodeCPUs.push_back(std::vector<int>());
+#endif
+	}
+
+	static const NUMATopology& Instance()
+	{
+		static NUMATopology instance;
+		return instance;
+	}
+
+};
+
+}
+
+int NUMAUtils::NumNodes()
+{
+	return static_cast<int>(NUMATopology::Instance().nodeCPUs.size());
+}
+
+std::vector<int> NUMAUtils::NodeCPUs( int node )
+{
+	const auto& topology = NUMATopology::Instance();
+	if (node < 0 || node >= static_cast<int>(topology.nodeCPUs.size()))
+	{
+		return std::vector<int>();
+	}
+
+	return topology.nodeCPUs[node];
+}
+
+std::vector<int> NUMAUtils::AssignCPUs( int numThreads )
+{
+	// Nodes which have at least one CPU available
+	const auto& topology = NUMATopology::Instance();
+	std::vector<int> nodes;
+	for (size_t node = 0; node < topology.nodeCPUs.size(); node++)
+	{
+		if (!topology.nodeCPUs[node].empty())
+		{
+			nodes.push_back(static_cast<int>(node));
+		}
+	}
+
+	std::vector<int> cpus;
+	if (nodes.empty())
+	{
+		return cpus;
+	}
+
+	// Round-robin over nodes, and over CPUs in each node.
+	// If the number of threads exceeds the number of CPUs, CPUs are shared.
+	std::vector<size_t> next(topology.nodeCPUs.size(), 0);
+	for (int i = 0; i < numThreads; i++)
+	{
+		int node = nodes[i % nodes.size()];
+		const auto& nodeCPUs = topology.nodeCPUs[node];
+		cpus.push_back(nodeCPUs[next[node]++ % nodeCPUs.size()]);
+	}
+
+	return cpus;
+}
+
+bool NUMAUtils::BindCurrentThread( int cpu )
+{
+#if LM_PLATFORM_LINUX
+	const auto& topology = NUMATopology::Instance();
+	if (cpu < 0 || cpu >= static_cast<int>(topology.cpuNodes.size()) || topology.cpuNodes[cpu] < 0)
+	{
+		LM_LOG_WARN("Invalid CPU index : " + std::to_string(cpu));
+		return false;
+	}
+
+	cpu_set_t cpuset;
+	CPU_ZERO(&cpuset);
+	CPU_SET(cpu, &cpuset);
+	if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) != 0)
+	{
+		LM_LOG_WARN("Failed to set thread affinity (CPU #" + std::to_string(cpu) + ")");
+		return false;
+	}
+
+	CurrentNode = topology.cpuNodes[cpu];
+
+#if LM_NUMA
+	// Prefer allocation on the local node
+	if (numa_available() >= 0)
+	{
+		numa_set_localalloc();
+	}
+#endif
+
+	return true;
+#else
+	LM_LOG_WARN("Thread binding is not supported in the platform");
+	return false;
+#endif
+}
+
+void NUMAUtils::UnbindCurrentThread()
+{
+#if LM_PLATFORM_LINUX
+	const auto& topology = NUMATopology::Instance();
+	cpu_set_t cpuset;
+	CPU_ZERO(&cpuset);
+	for (const auto& cpus : topology.nodeCPUs)
+	{
+		for (int cpu : cpus)
+		{
+			CPU_SET(cpu, &cpuset);
+		}
+	}
+	pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+#endif
+
+	CurrentNode = -1;
+}
+
+int NUMAUtils::CurrentThreadNode()
+{
+	return CurrentNode;
+}
+
+void* NUMAUtils::Allocate( size_t size, int node )
+{
+#if LM_NUMA
+	if (numa_available() >= 0)
+	{
+		return numa_alloc_onnode(size, node);
+	}
+#endif
+
+	return aligned_malloc(size, 64);
+}
+
+void NUMAUtils::Free( void* p, size_t size )
+{
+	if (p == nullptr)
+	{
+		return;
+	}
+
+#if LM_NUMA
+	if (numa_available() >= 0)
+	{
+		numa_free(p, size);
+		return;
+	}
+#endif
+
+	aligned_free(p);
+}
+
+LM_NAMESPACE_END
@@ -23,6 +23,7 @@
 #include <lightmetrica/camera.h>
 #include <lightmetrica/film.h>
 #include <lightmetrica/ray.h>
+#include <lightmetrica/raydifferential.h>
 #include <lightmetrica/intersection.h>
 #include <lightmetrica/primitive.h>
 #include <lightmetrica/light.h>
@@ -33,6 +34,7 @@
 #include <lightmetrica/logger.h>
 #include <lightmetrica/confignode.h>
 #include <lightmetrica/assert.h>
+#include <lightmetrica/renderutils.h>
 #include <lightmetrica/defaultexperiments.h>
 
 LM_NAMESPACE_BEGIN
@@ -71,6 +73,7 @@ private:
 
 	int rrDepth;											// Depth of beginning RR
 	int maxPathVertices;									// Maximum number of light path vertices
+	bool rayDifferentials;									// Trace ray differentials for texture filtering
 	std::unique_ptr<ConfigurableSampler> initialSampler;	// Sampler
 
 private:
@@ -96,6 +99,7 @@ public:
 		: renderer(renderer)
 		, sampler(sampler)
 		, film(film)
+		, sampleIndex(0)
 	{
 
 	}
@@ -108,12 +112,14 @@ public:
 
 	virtual void ProcessSingleSample(const Scene& scene) override;
 	virtual const Film* GetFilm() const override { return film.get(); }
+	virtual void SetSampleIndex(long long index) override { sampleIndex = index; }
 
 private:
 
 	const PathtraceRenderer& renderer;
 	std::unique_ptr<Sampler> sampler;
 	std::unique_ptr<Film> film;
+	long long sampleIndex;
 
 };
 
@@ -124,6 +130,7 @@ bool PathtraceRenderer::Configure(const ConfigNode& node, const Assets& assets,
 	// Load parameters
 	node.ChildValueOrDefault("rr_depth", 1, rrDepth);
 	node.ChildValueOrDefault("max_path_vertices", -1, maxPathVertices);
+	node.ChildValueOrDefault("ray_differentials", false, rayDifferentials);
 
 	// Sampler
 	auto samplerNode = node.Child("sampler");
@@ -165,7 +172,11 @@ RenderProcess* PathtraceRenderer::CreateRenderProcess(const Scene& scene, int th
 void PathtraceRenderer_RenderProcess::ProcessSingleSample(const Scene& scene)
 {
 	// Raster position
-	auto rasterPos = sampler->NextVec2();
+	// Dimensions of the samples:
+	//   [0, 2) : Raster position
+	//   [2, 4) : Position on camera
+	//   [4 + 4i, 8 + 4i) : BSDF sampling and RR for the i-th bounce
+	auto rasterPos = RenderUtils::BeginSample(*sampler, *film, sampleIndex++);
 
 	// Sample position on camera
 	SurfaceGeometry geomE;
@@ -187,6 +198,11 @@ void PathtraceRenderer_RenderProcess::ProcessSingleSample(const Scene& scene)
 	ray.minT = Math::Float(0);
 	ray.maxT = Math::Constants::Inf();
 
+	// Ray differential
+	// Enabled only if the camera supports it
+	RayDifferential rd;
+	bool useRayDifferential = renderer.rayDifferentials && scene.MainCamera()->GenerateRayDifferential(rasterPos, geomE, rd);
+
 	Math::Vec3 throughput = We_Estimated;
 	Math::Vec3 L;
 	int numPathVertices = 1;
@@ -207,6 +223,11 @@ void PathtraceRenderer_RenderProcess::ProcessSingleSample(const Scene& scene)
 			break;
 		}
 
+		if (useRayDifferential)
+		{
+			rd.Transfer(ray, isect.geom);
+		}
+
 		if (isect.light)
 		{
 			// Evaluate Le
@@ -222,6 +243,7 @@ void PathtraceRenderer_RenderProcess::ProcessSingleSample(const Scene& scene)
 		// --------------------------------------------------------------------------------
 
 		// Sample BSDF
+		sampler->SetDimension(4 + 4 * (numPathVertices - 1));
 		GeneralizedBSDFSampleQuery bsdfSQ;
 		bsdfSQ.sample = sampler->NextVec2();
 		bsdfSQ.uComp = sampler->Next();
@@ -239,6 +261,11 @@ void PathtraceRenderer_RenderProcess::ProcessSingleSample(const Scene& scene)
 		// Update throughput
 		throughput *= fs_Estimated;
 
+		if (useRayDifferential)
+		{
+			isect.bsdf->PropagateRayDifferential(bsdfSQ, isect.geom, bsdfSR, rd);
+		}
+
 		// Setup next ray
 		ray.d = bsdfSR.wo;
 		ray.o = isect.geom.p;
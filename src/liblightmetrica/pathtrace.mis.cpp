@@ -98,6 +98,7 @@ public:
 		: renderer(renderer)
 		, sampler(sampler)
 		, film(film)
+		, sampleIndex(0)
 	{
 
 	}
@@ -110,12 +111,14 @@ public:
 
 	virtual void ProcessSingleSample(const Scene& scene) override;
 	virtual const Film* GetFilm() const override { return film.get(); }
+	virtual void SetSampleIndex(long long index) override { sampleIndex = index; }
 
 private:
 
 	const MISPathtraceRenderer& renderer;
 	std::unique_ptr<Sampler> sampler;
 	std::unique_ptr<Film> film;
+	long long sampleIndex;
 
 };
 
@@ -166,6 +169,13 @@ RenderProcess* MISPathtraceRenderer::CreateRenderProcess(const Scene& scene, int
 
 void MISPathtraceRenderer_RenderProcess::ProcessSingleSample(const Scene& scene) 
 {
+	// Raster position
+	// Dimensions of the samples:
+	//   [0, 2) : Raster position
+	//   [2, 4) : Position on camera
+	//   [4 + 8i, 12 + 8i) : Light sampling, RR, and BSDF sampling for the i-th vertex
+	const auto rasterSample = RenderUtils::BeginSample(*sampler, *film, sampleIndex++);
+
 	// Sample position on camera
 	SurfaceGeometry geomE;
 	Math::PDFEval pdfPE;
@@ -189,6 +199,8 @@ void MISPathtraceRenderer_RenderProcess::ProcessSingleSample(const Scene& scene)
 			break;
 		}
 
+		sampler->SetDimension(4 + 8 * (numPathVertices - 1));
+
 		// --------------------------------------------------------------------------------
 
 		// Skip if current BSDF is directionally degenerated
@@ -199,7 +211,7 @@ void MISPathtraceRenderer_RenderProcess::ProcessSingleSample(const Scene& scene)
 			Math::PDFEval pdfPL;
 			auto lightSampleP = sampler->NextVec2();
 			Math::PDFEval lightSelectionPdf;
-			const auto* light = scene.SampleLightSelection(lightSampleP, lightSelectionPdf);
+			const auto* light = scene.SampleLightSelection(currGeom.p, lightSampleP, lightSelectionPdf);
 			light->SamplePosition(lightSampleP, geomL, pdfPL);
 			pdfPL.v *= lightSelectionPdf.v;
 
@@ -278,8 +290,9 @@ void MISPathtraceRenderer_RenderProcess::ProcessSingleSample(const Scene& scene)
 		// --------------------------------------------------------------------------------
 
 		// Sample generalized BSDF
+		// The direction from the camera is sampled with the raster position
 		GeneralizedBSDFSampleQuery bsdfSQ;
-		bsdfSQ.sample = sampler->NextVec2();
+		bsdfSQ.sample = numPathVertices == 1 ? rasterSample : sampler->NextVec2();
 		bsdfSQ.uComp = sampler->Next();
 		bsdfSQ.transportDir = TransportDirection::EL;
 		bsdfSQ.type = GeneralizedBSDFType::All;
@@ -346,7 +359,7 @@ void MISPathtraceRenderer_RenderProcess::ProcessSingleSample(const Scene& scene)
 				{
 					// PDF for direct light sampling
 					auto G = RenderUtils::GeneralizedGeometryTerm(currGeom, isect.geom);
-					auto pdfD_DirectLight = Math::IsZero(G) ? Math::Float(0) : scene.LightSelectionPdf().v * light->EvaluatePositionPDF(isect.geom).v / G;
+					auto pdfD_DirectLight = Math::IsZero(G) ? Math::Float(0) : scene.LightSelectionPdf(currGeom.p, light).v * light->EvaluatePositionPDF(isect.geom).v / G;
 
 					// MIS weight
 					auto w = bsdfSR.pdf.v / (bsdfSR.pdf.v + pdfD_DirectLight);
@@ -25,6 +25,7 @@
 #include <lightmetrica/logger.h>
 #include <lightmetrica/math.functions.h>
 #include <lightmetrica/ray.h>
+#include <lightmetrica/raydifferential.h>
 #include <lightmetrica/confignode.h>
 #include <lightmetrica/assert.h>
 #include <lightmetrica/surfacegeometry.h>
@@ -43,7 +44,12 @@ public:
 
 public:
 
-	PerspectiveCamera() {}
+	PerspectiveCamera()
+		: film(nullptr)
+	{
+
+	}
+
 	~PerspectiveCamera() {}
 
 public:
@@ -72,8 +78,24 @@ public:
 public:
 
 	virtual bool RayToRasterPosition(const Math::Vec3& p, const Math::Vec3& d, Math::Vec2& rasterPos) const override;
+	virtual bool GenerateRayDifferential(const Math::Vec2& rasterPos, const SurfaceGeometry& geom, RayDifferential& rd) const override;
 	virtual Film* GetFilm() const override { return film; }
 
+private:
+
+	/*
+		Calculate the direction of the primary ray
+		in world coordinates from the raster position
+	*/
+	Math::Vec3 RasterPositionToDirection(const Math::Vec2& rasterPos) const;
+
+	/*
+		Calculate the direction of the primary ray
+		in world coordinates from the raster position,
+		also returning the direction in camera coordinates
+	*/
+	Math::Vec3 RasterPositionToDirection(const Math::Vec2& rasterPos, Math::Vec3& dirTCam) const;
+
 private:
 
 	/*
@@ -197,15 +219,9 @@ bool PerspectiveCamera::SampleDirection( const GeneralizedBSDFSampleQuery& query
 		return false;
 	}
 
-	// Raster position in [-1, 1]^2
-	auto ndcRasterPos = Math::Vec3(query.sample * Math::Float(2) - Math::Vec2(Math::Float(1)), Math::Float(0));
-
-	// Convert raster position to camera coordinates
-	auto dirTCam4 = invProjectionMatrix * Math::Vec4(ndcRasterPos, Math::Float(1));
-	auto dirTCam3 = Math::Normalize(Math::Vec3(dirTCam4) / dirTCam4.w);
-
+	Math::Vec3 dirTCam3;
 	result.sampledType = GeneralizedBSDFType::NonDeltaEyeDirection;
-	result.wo = Math::Normalize(Math::Vec3(invViewMatrix * Math::Vec4(dirTCam3, Math::Float(0))));
+	result.wo = RasterPositionToDirection(query.sample, dirTCam3);
 	result.pdf = Math::PDFEval(
 		EvaluateImportance(-Math::CosThetaZUp(dirTCam3)),
 		Math::ProbabilityMeasure::ProjectedSolidAngle);
@@ -220,15 +236,9 @@ Math::Vec3 PerspectiveCamera::SampleAndEstimateDirection( const GeneralizedBSDFS
 		return Math::Vec3();
 	}
 
-	// Raster position in [-1, 1]^2
-	auto ndcRasterPos = Math::Vec3(query.sample * Math::Float(2) - Math::Vec2(Math::Float(1)), Math::Float(0));
-
-	// Convert raster position to camera coordinates
-	auto dirTCam4 = invProjectionMatrix * Math::Vec4(ndcRasterPos, Math::Float(1));
-	auto dirTCam3 = Math::Normalize(Math::Vec3(dirTCam4) / dirTCam4.w);
-
+	Math::Vec3 dirTCam3;
 	result.sampledType = GeneralizedBSDFType::NonDeltaEyeDirection;
-	result.wo = Math::Normalize(Math::Vec3(invViewMatrix * Math::Vec4(dirTCam3, Math::Float(0))));
+	result.wo = RasterPositionToDirection(query.sample, dirTCam3);
 	result.pdf = Math::PDFEval(
 		EvaluateImportance(-Math::CosThetaZUp(dirTCam3)),
 		Math::ProbabilityMeasure::ProjectedSolidAngle);
@@ -246,15 +256,9 @@ bool PerspectiveCamera::SampleAndEstimateDirectionBidir( const GeneralizedBSDFSa
 		return false;
 	}
 
-	// Raster position in [-1, 1]^2
-	auto ndcRasterPos = Math::Vec3(query.sample * Math::Float(2) - Math::Vec2(Math::Float(1)), Math::Float(0));
-
-	// Convert raster position to camera coordinates
-	auto dirTCam4 = invProjectionMatrix * Math::Vec4(ndcRasterPos, Math::Float(1));
-	auto dirTCam3 = Math::Normalize(Math::Vec3(dirTCam4) / dirTCam4.w);
-
+	Math::Vec3 dirTCam3;
 	result.sampledType = GeneralizedBSDFType::NonDeltaEyeDirection;
-	result.wo = Math::Normalize(Math::Vec3(invViewMatrix * Math::Vec4(dirTCam3, Math::Float(0))));
+	result.wo = RasterPositionToDirection(query.sample, dirTCam3);
 	result.pdf[query.transportDir] = Math::PDFEval(EvaluateImportance(-Math::CosThetaZUp(dirTCam3)), Math::ProbabilityMeasure::ProjectedSolidAngle);
 	result.pdf[1-query.transportDir] = Math::PDFEval(Math::Float(0), Math::ProbabilityMeasure::ProjectedSolidAngle);
 	result.weight[query.transportDir] = Math::Vec3(Math::Float(1));
@@ -382,6 +386,41 @@ Math::PDFEval PerspectiveCamera::EvaluateDirectionPDF( const GeneralizedBSDFEval
 		Math::ProbabilityMeasure::ProjectedSolidAngle);
 }
 
+bool PerspectiveCamera::GenerateRayDifferential( const Math::Vec2& rasterPos, const SurfaceGeometry& /*geom*/, RayDifferential& rd ) const
+{
+	if (!film)
+	{
+		return false;
+	}
+
+	// Differences of the directions offset by a pixel
+	auto d = RasterPositionToDirection(rasterPos);
+	rd.dodx = Math::Vec3();
+	rd.dody = Math::Vec3();
+	rd.dddx = RasterPositionToDirection(rasterPos + Math::Vec2(Math::Float(1) / Math::Float(film->Width()), Math::Float(0))) - d;
+	rd.dddy = RasterPositionToDirection(rasterPos + Math::Vec2(Math::Float(0), Math::Float(1) / Math::Float(film->Height()))) - d;
+
+	return true;
+}
+
+Math::Vec3 PerspectiveCamera::RasterPositionToDirection( const Math::Vec2& rasterPos ) const
+{
+	Math::Vec3 dirTCam;
+	return RasterPositionToDirection(rasterPos, dirTCam);
+}
+
+Math::Vec3 PerspectiveCamera::RasterPositionToDirection( const Math::Vec2& rasterPos, Math::Vec3& dirTCam ) const
+{
+	// Raster position in [-1, 1]^2
+	auto ndcRasterPos = Math::Vec3(rasterPos * Math::Float(2) - Math::Vec2(Math::Float(1)), Math::Float(0));
+
+	// Convert raster position to camera coordinates
+	auto dirTCam4 = invProjectionMatrix * Math::Vec4(ndcRasterPos, Math::Float(1));
+	dirTCam = Math::Normalize(Math::Vec3(dirTCam4) / dirTCam4.w);
+
+	return Math::Normalize(Math::Vec3(invViewMatrix * Math::Vec4(dirTCam, Math::Float(0))));
+}
+
 LM_COMPONENT_REGISTER_IMPL(PerspectiveCamera, Camera);
 
 LM_NAMESPACE_END
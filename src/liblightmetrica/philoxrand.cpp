@@ -0,0 +1,125 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+#include <lightmetrica/random.h>
+
+LM_NAMESPACE_BEGIN
+
+/*!
+	Philox random number generator.
+	A counter-based random number generator (Philox4x32-10) introduced in
+	Salmon et al., Parallel random numbers: as easy as 1, 2, 3, SC 2011.
+	The n-th number is a function of the seed and n, so that
+	the generator can skip an arbitrary number of samples in constant time.
+*/
+class PhiloxRandom final : public Random
+{
+public:
+
+	LM_COMPONENT_IMPL_DEF("philox");
+
+public:
+
+	PhiloxRandom()
+		: counter(0)
+		, cachedBlock(~0ULL)
+	{
+		key[0] = key[1] = 0;
+	}
+
+public:
+
+	virtual unsigned int NextUInt()
+	{
+		const unsigned long long block = counter >> 2;
+		if (block != cachedBlock)
+		{
+			Generate(block);
+		}
+		return buffer[counter++ & 3];
+	}
+
+	virtual void SetSeed(unsigned int seed)
+	{
+		key[0] = seed;
+		key[1] = 0;
+		counter = 0;
+		cachedBlock = ~0ULL;
+	}
+
+	virtual void Skip(unsigned long long n) { counter += n; }
+
+	virtual void FillUInt(unsigned int* values, size_t n)
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			values[i] = NextUInt();
+		}
+	}
+
+	virtual Random* Clone() const { return new PhiloxRandom; }
+
+private:
+
+	// Generates a block of 4 numbers for the given counter value
+	void Generate(unsigned long long block)
+	{
+		const unsigned int M0 = 0xD2511F53;
+		const unsigned int M1 = 0xCD9E8D57;
+		const unsigned int W0 = 0x9E3779B9;
+		const unsigned int W1 = 0xBB67AE85;
+
+		unsigned int c[4] = { static_cast<unsigned int>(block), static_cast<unsigned int>(block >> 32), 0, 0 };
+		unsigned int k[2] = { key[0], key[1] };
+		for (int round = 0; round < 10; round++)
+		{
+			const unsigned long long p0 = static_cast<unsigned long long>(M0) * c[0];
+			const unsigned long long p1 = static_cast<unsigned long long>(M1) * c[2];
+			const unsigned int t[4] =
+			{
+				static_cast<unsigned int>(p1 >> 32) ^ c[1] ^ k[0],
+				static_cast<unsigned int>(p1),
+				static_cast<unsigned int>(p0 >> 32) ^ c[3] ^ k[1],
+				static_cast<unsigned int>(p0)
+			};
+			c[0] = t[0]; c[1] = t[1]; c[2] = t[2]; c[3] = t[3];
+			k[0] += W0;
+			k[1] += W1;
+		}
+
+		buffer[0] = c[0];
+		buffer[1] = c[1];
+		buffer[2] = c[2];
+		buffer[3] = c[3];
+		cachedBlock = block;
+	}
+
+private:
+
+	unsigned int key[2];				// Key (generated from the seed)
+	unsigned long long counter;			// Index of the next number
+	unsigned long long cachedBlock;		// Index of the block stored in #buffer
+	unsigned int buffer[4];				// Generated numbers
+
+};
+
+LM_COMPONENT_REGISTER_IMPL(PhiloxRandom, Random);
+
+LM_NAMESPACE_END
@@ -22,6 +22,7 @@
 #include <lightmetrica/renderproc.h>
 #include <lightmetrica/pm.photon.h>
 #include <lightmetrica/pm.photonmap.h>
+#include <lightmetrica/pm.photontracer.h>
 #include <lightmetrica/pm.kernel.h>
 #include <lightmetrica/confignode.h>
 #include <lightmetrica/logger.h>
@@ -42,8 +43,6 @@
 
 LM_NAMESPACE_BEGIN
 
-typedef std::pair<const Photon*, Math::Float> CollectedPhotonInfo;
-
 /*!
 	Photon mapping renderer.
 	Implements photon mapping. Unoptimized version.
@@ -74,7 +73,6 @@ public:
 
 private:
 
-	void TracePhotons(const Scene& scene, Photons& photons, long long& tracedPaths) const;
 	void VisualizePhotons(const Scene& scene, Film& film) const;
 
 private:
@@ -132,7 +130,7 @@ private:
 	const PhotonMappingRenderer& renderer;
 	std::unique_ptr<Sampler> sampler;
 	std::unique_ptr<Film> film;
-	std::vector<CollectedPhotonInfo> collectedPhotonInfo;
+	std::vector<PhotonMap::CollectedPhotonInfo> collectedPhotonInfo;
 
 };
 
@@ -163,6 +161,7 @@ bool PhotonMappingRenderer::Configure(const ConfigNode& node, const Assets& asse
 	{
 		return false;
 	}
+	photonMap->SetQueryRadius(maxNNQueryDist);
 
 	// 'pde_kernel'
 	std::string pdeKernelType;
@@ -219,8 +218,7 @@ bool PhotonMappingRenderer::Preprocess(const Scene& scene, const RenderProcessSc
 		LM_LOG_INDENTER();
 
 		tracedLightPaths = 0;
-		photons.reserve(maxPhotons);
-		TracePhotons(scene, photons, tracedLightPaths);
+		PhotonTracer::TracePhotons(scene, *initialSampler, numPhotonTraceSamples, maxPhotons, photons, tracedLightPaths);
 
 		LM_LOG_INFO("Completed");
 		LM_LOG_INFO("Traced " + std::to_string(tracedLightPaths) + " light paths");
@@ -282,113 +280,6 @@ void PhotonMappingRenderer::VisualizePhotons(const Scene& scene, Film& film) con
 	}
 }
 
-void PhotonMappingRenderer::TracePhotons(const Scene& scene, Photons& photons, long long& tracedPaths) const
-{
-	std::unique_ptr<Sampler> sampler(initialSampler->Clone());
-	sampler->SetSeed(initialSampler->NextUInt());
-	
-	for (long long sample = 0; sample < numPhotonTraceSamples && static_cast<long long>(photons.size()) < maxPhotons; sample++)
-	{
-		tracedPaths++;
-
-		SurfaceGeometry geomL;
-		Math::PDFEval pdfPL;
-
-		// Sample a position on the light
-		auto lightSampleP = sampler->NextVec2();
-		Math::PDFEval lightSelectionPdf;
-		const auto* light = scene.SampleLightSelection(lightSampleP, lightSelectionPdf);
-		light->SamplePosition(lightSampleP, geomL, pdfPL);
-		pdfPL.v *= lightSelectionPdf.v;
-
-		// Evaluate positional component of Le
-		auto positionalLe = light->EvaluatePosition(geomL);
-
-		// Trace light particle and evaluate importance
-		auto throughput = positionalLe / pdfPL.v;
-		auto currGeom = geomL;
-		Math::Vec3 currWi;
-		const GeneralizedBSDF* currBsdf = light;
-		int depth = 0;
-
-		while (true)
-		{
-			// Sample generalized BSDF
-			GeneralizedBSDFSampleQuery bsdfSQ;
-			bsdfSQ.sample = sampler->NextVec2();
-			bsdfSQ.uComp = sampler->Next();
-			bsdfSQ.transportDir = TransportDirection::LE;
-			bsdfSQ.type = GeneralizedBSDFType::All;
-			bsdfSQ.wi = currWi;
-
-			GeneralizedBSDFSampleResult bsdfSR;
-			auto fs_Estimated = currBsdf->SampleAndEstimateDirection(bsdfSQ, currGeom, bsdfSR);
-			if (Math::IsZero(fs_Estimated))
-			{
-				break;
-			}
-
-			auto nextThroughput = throughput * fs_Estimated;
-
-			// Russian roulette for path termination
-			if (depth >= 1)
-			{
-				auto continueProb = Math::Min(Math::Float(1), Math::Luminance(nextThroughput) / Math::Luminance(throughput));
-				if (sampler->Next() > continueProb)
-				{
-					break;
-				}
-
-				throughput = nextThroughput / continueProb;
-			}
-			else
-			{
-				throughput = nextThroughput;
-			}
-
-			// --------------------------------------------------------------------------------
-
-			// Setup next ray
-			Ray ray;
-			ray.d = bsdfSR.wo;
-			ray.o = currGeom.p;
-			ray.minT = Math::Constants::Eps();
-			ray.maxT = Math::Constants::Inf();
-
-			// Intersection query
-			Intersection isect;
-			if (!scene.Intersect(ray, isect))
-			{
-				break;
-			}
-
-			// --------------------------------------------------------------------------------
-
-			// If intersected surface is non-specular, store the photon into photon map
-			if ((isect.bsdf->BSDFTypes() & GeneralizedBSDFType::NonDelta) > 0)
-			{
-				Photon photon;
-				photon.p = isect.geom.p;
-				photon.throughput = throughput;
-				photon.wi = -ray.d;
-				photons.push_back(photon);
-				if (photons.size() == static_cast<size_t>(maxPhotons))
-				{
-					break;
-				}
-			}
-
-			// --------------------------------------------------------------------------------
-
-			// Update information
-			currGeom = isect.geom;
-			currWi = -ray.d;
-			currBsdf = isect.bsdf;
-			depth++;
-		}
-	}
-}
-
 // --------------------------------------------------------------------------------
 
 void PhotonMappingRenderer_RenderProcess::ProcessSingleSample(const Scene& scene)
@@ -477,35 +368,7 @@ void PhotonMappingRenderer_RenderProcess::ProcessSingleSample(const Scene& scene
 		{
 			// Collect near photons
 			Math::Float maxDist2 = renderer.maxNNQueryDist2;
-			collectedPhotonInfo.clear();
-			const size_t n = static_cast<size_t>(renderer.numNNQueryPhotons);
-			renderer.photonMap->CollectPhotons(isect.geom.p, maxDist2, [&n, this](const Math::Vec3& p, const Photon& photon, Math::Float& maxDist2)
-			{
-				auto dist2 = Math::Length2(photon.p - p);
-				const auto comp = [](const CollectedPhotonInfo& p1, const CollectedPhotonInfo& p2)
-				{
-					return p1.second < p2.second;
-				};
-
-				if (collectedPhotonInfo.size() < n)
-				{
-					collectedPhotonInfo.emplace_back(&photon, dist2);
-					if (collectedPhotonInfo.size() == n)
-					{
-						// Create heap
-						std::make_heap(collectedPhotonInfo.begin(), collectedPhotonInfo.end(), comp);
-						maxDist2 = collectedPhotonInfo.front().second;
-					}
-				}
-				else
-				{
-					// Update heap
-					std::pop_heap(collectedPhotonInfo.begin(), collectedPhotonInfo.end(), comp);
-					collectedPhotonInfo.back() = std::make_pair(&photon, dist2);
-					std::push_heap(collectedPhotonInfo.begin(), collectedPhotonInfo.end(), comp);
-					maxDist2 = collectedPhotonInfo.front().second;
-				}
-			});
+			renderer.photonMap->CollectNearestPhotons(isect.geom.p, renderer.numNNQueryPhotons, maxDist2, collectedPhotonInfo);
 
 			// Density estimation
 			for (const auto& info : collectedPhotonInfo)
@@ -0,0 +1,96 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+#include <lightmetrica/pm.photonmap.h>
+#include <lightmetrica/hashgrid.h>
+
+LM_NAMESPACE_BEGIN
+
+/*!
+	Hash grid photon map.
+	Implements photon map with hashed uniform grid (see #HashGrid).
+	The grid is specialized for the fixed-radius queries.
+	The size of a cell is twice the query radius,
+	so that a query visits at most 2x2x2 cells.
+*/
+class HashGridPhotonMap final : public PhotonMap
+{
+public:
+
+	LM_COMPONENT_IMPL_DEF("hashgrid");
+
+public:
+
+	HashGridPhotonMap()
+		: queryRadius(0)
+	{
+
+	}
+
+public:
+
+	virtual void Build(const Photons& photons) override;
+	virtual void CollectPhotons(const Math::Vec3& p, Math::Float& maxDist2, const PhotonCollectFunc& collectFunc) const override;
+	virtual void CollectNearestPhotons(const Math::Vec3& p, int k, Math::Float& maxDist2, std::vector<CollectedPhotonInfo>& collected) const override;
+	virtual void GetPhotons(std::vector<const Photon*>& photons) const override;
+	virtual void SetQueryRadius(Math::Float radius) override { queryRadius = radius; }
+
+private:
+
+	Math::Float queryRadius;				//!< Maximum query radius specified by SetQueryRadius
+	HashGrid<Photon> grid;					//!< Grid of the photons
+
+};
+
+void HashGridPhotonMap::Build( const Photons& photons )
+{
+	// If the query radius is not specified, the cell size is determined from the bound of the photons
+	grid.Build(photons, Math::Float(2) * queryRadius);
+}
+
+void HashGridPhotonMap::CollectPhotons( const Math::Vec3& p, Math::Float& maxDist2, const PhotonCollectFunc& collectFunc ) const
+{
+	grid.Traverse(p, maxDist2, [&p, &collectFunc](const Photon& photon, Math::Float /*dist2*/, Math::Float& maxDist2)
+	{
+		collectFunc(p, photon, maxDist2);
+	});
+}
+
+void HashGridPhotonMap::CollectNearestPhotons( const Math::Vec3& p, int k, Math::Float& maxDist2, std::vector<CollectedPhotonInfo>& collected ) const
+{
+	collected.clear();
+	grid.Traverse(p, maxDist2, [k, &collected](const Photon& photon, Math::Float dist2, Math::Float& maxDist2)
+	{
+		AddNearestPhoton(photon, dist2, static_cast<size_t>(k), maxDist2, collected);
+	});
+}
+
+void HashGridPhotonMap::GetPhotons( std::vector<const Photon*>& photons ) const
+{
+	photons.clear();
+	for (const auto& photon : grid.Data())
+	{
+		photons.push_back(&photon);
+	}
+}
+
+LM_COMPONENT_REGISTER_IMPL(HashGridPhotonMap, PhotonMap);
+
+LM_NAMESPACE_END
\ No newline at end of file
@@ -20,50 +20,42 @@
 #include "pch.h"
 #include <lightmetrica/pm.photonmap.h>
 #include <lightmetrica/aabb.h>
+#include <lightmetrica/align.h>
+#include <lightmetrica/math.simd.h>
+#include <omp.h>
 
 LM_NAMESPACE_BEGIN
 
-/*!
-	Kd-tree node.
-	Compressed Kd-tree node for photon map.
-*/
-struct PhotonKdTreeNode
+namespace
 {
 
-	// Initialize as internal node
-	void InitializeIntermediateNode(const Math::Float& p, unsigned int axis)
-	{
-		splitPos = p;
-		splitAxis = axis;
-		hasLeftChild = 0;
-		rightChild = (1<<29)-1;
-	}
+	// Number of photons in a leaf bucket
+	const int BucketSize = 8;
+
+	// Size of the traversal stack
+	// The depth of the tree never exceeds the number of bits of the node index
+	const int TraversalStackSize = 64;
 
-	// Initialize as leaf node
-	void InitializeLeaf()
+	// Replace a component of the vector
+	LM_FORCE_INLINE Math::Vec3 ReplaceComponent(const Math::Vec3& v, int axis, Math::Float value)
 	{
-		splitAxis = 3;
-		rightChild = (1<<29)-1;
-		hasLeftChild = 0;
+		return Math::Vec3(
+			axis == 0 ? value : v.x,
+			axis == 1 ? value : v.y,
+			axis == 2 ? value : v.z);
 	}
 
-	bool Leaf() const { return splitAxis == 3; }
-
-	Math::Float splitPos;
-	
-	// 0 - split axis is X
-	// 1 - split axis is Y
-	// 2 - split axis is Z
-	// 3 - leaf node
-	unsigned int splitAxis		: 2;
-	unsigned int hasLeftChild	: 1;
-	unsigned int rightChild		: 29;
-
-};
+}
 
 /*!
 	Kd-tree photon map.
-	Implements photon map with Kd-tree.
+	Implements photon map with left-balanced kd-tree.
+	The tree is a complete binary tree stored without pointers,
+	where the children of the node i are the nodes 2i+1 and 2i+2.
+	The leaves are buckets of #BucketSize photons filled from left to right,
+	so that the range of the photons in a leaf is computed from the node index.
+	The positions of the photons are also stored in SoA layout
+	for the SIMD distance computation over the buckets.
 */
 class KdTreePhotonMap final : public PhotonMap
 {
@@ -71,136 +63,253 @@ public:
 
 	LM_COMPONENT_IMPL_DEF("kdtree");
 
+public:
+
+	KdTreePhotonMap()
+		: numLeaves(0)
+	{
+
+	}
+
 public:
 
 	virtual void Build(const Photons& photons) override;
 	virtual void CollectPhotons(const Math::Vec3& p, Math::Float& maxDist2, const PhotonCollectFunc& collectFunc) const override;
+	virtual void CollectNearestPhotons(const Math::Vec3& p, int k, Math::Float& maxDist2, std::vector<CollectedPhotonInfo>& collected) const override;
 	virtual void GetPhotons(std::vector<const Photon*>& photons) const override;
 
 private:
 
-	void RecursiveBuild(size_t nodeIndex, int start, int end, const Photons& photons, std::vector<size_t>& photonIndices, unsigned int& nextNodeIndex);
-	void RecursiveCollectPhotons(size_t nodeIndex, const Math::Vec3& p, Math::Float& maxDist2, const PhotonCollectFunc& collectFunc) const;
+	/*!
+		Traverse the tree.
+		Dispatches #collectFunc for the photons nearer than #maxDist2.
+		The function can shrink #maxDist2 in order to cull the remaining nodes.
+		\tparam CollectFunc Function of the signature void (const Photon&, Math::Float dist2, Math::Float& maxDist2).
+		\param p Query point.
+		\param maxDist2 Squared maximum distance.
+		\param collectFunc Function called for each collected photon.
+	*/
+	template <typename CollectFunc>
+	void Traverse(const Math::Vec3& p, Math::Float& maxDist2, const CollectFunc& collectFunc) const;
+
+	/*!
+		Compute squared distances to the photons in a bucket.
+		\param p Query point.
+		\param leafIndex Index of the leaf.
+		\param dist2 Squared distances for #BucketSize photons.
+	*/
+	void BucketDistances(const Math::Vec3& p, int leafIndex, Math::Float* dist2) const;
 
-public:
+private:
+
+	typedef std::vector<Math::Float, aligned_allocator<Math::Float, 16>> AlignedFloats;
 
-	std::vector<PhotonKdTreeNode> nodes;
-	Photons data;
+	int numLeaves;							//!< Number of leaves (power of two)
+	std::vector<Math::Float> splitPos;		//!< Split positions of the internal nodes
+	std::vector<unsigned char> splitAxis;	//!< Split axes of the internal nodes
+	Photons data;							//!< Photons ordered by the leaves
+	AlignedFloats positions[3];				//!< Positions of the photons in SoA layout, padded by the infinity
 
 };
 
 void KdTreePhotonMap::Build( const Photons& photons )
 {
-	// Reverse node and data store
-	nodes.assign(photons.size(), PhotonKdTreeNode());
-	data.assign(photons.size(), Photon());
+	data = photons;
+	const size_t n = data.size();
 
-	// Temporary array
-	std::vector<size_t> photonIndices(photons.size());
-	for (size_t i = 0; i < photons.size(); i++)
+	// Number of leaves
+	numLeaves = 1;
+	while (static_cast<size_t>(numLeaves) * BucketSize < n)
 	{
-		photonIndices[i] = i;
+		numLeaves *= 2;
 	}
 
-	// Build recursively
-	unsigned int nextNodeIndex = 1;
-	RecursiveBuild(0, 0, static_cast<int>(photons.size()), photons, photonIndices, nextNodeIndex);
-}
+	const int numInternalNodes = numLeaves - 1;
+	splitPos.assign(numInternalNodes, Math::Float(0));
+	splitAxis.assign(numInternalNodes, 0);
 
-void KdTreePhotonMap::RecursiveBuild( size_t nodeIndex, int start, int end, const Photons& photons, std::vector<size_t>& photonIndices, unsigned int& nextNodeIndex )
-{
-	// Leaf node
-	if (start + 1 == end)
+	// Bounds of the internal nodes
+	// Bounds of the children are obtained by clipping the bound of the parent,
+	// so that the bound of the photons is computed only once
+	std::vector<AABB, aligned_allocator<AABB, std::alignment_of<AABB>::value>> bounds(numInternalNodes);
+	if (numInternalNodes > 0)
 	{
-		nodes[nodeIndex].InitializeLeaf();
-		data[nodeIndex] = photons[photonIndices[start]];
-		return;
+		for (const auto& photon : data)
+		{
+			bounds[0] = bounds[0].Union(photon.p);
+		}
 	}
 
-	// Split axis and position
-	AABB bound;
-	for (int i = start; i < end; i++)
+	// Build level by level
+	// Nodes in the same level partition disjoint ranges of the photons
+	for (int levelBegin = 0, numNodes = 1; numNodes < numLeaves; levelBegin += numNodes, numNodes *= 2)
 	{
-		bound = bound.Union(photons[photonIndices[i]].p);
+		// Number of photons assigned to a node in the level
+		const size_t span = static_cast<size_t>(numLeaves / numNodes) * BucketSize;
+
+		#pragma omp parallel for schedule(dynamic, 1)
+		for (int j = 0; j < numNodes; j++)
+		{
+			const int nodeIndex = levelBegin + j;
+			const auto& bound = bounds[nodeIndex];
+			const size_t begin = std::min(j * span, n);
+			const size_t mid = std::min(j * span + span / 2, n);
+			const size_t end = std::min((j + 1) * span, n);
+
+			// Split the photons such that the left child is fully occupied
+			const int axis = bound.LongestAxis();
+			splitAxis[nodeIndex] = static_cast<unsigned char>(axis);
+			if (mid < end)
+			{
+				std::nth_element(data.begin() + begin, data.begin() + mid, data.begin() + end, [axis](const Photon& p1, const Photon& p2)
+				{
+					return p1.p[axis] < p2.p[axis];
+				});
+				splitPos[nodeIndex] = data[mid].p[axis];
+			}
+			else
+			{
+				// Right child is empty
+				splitPos[nodeIndex] = std::numeric_limits<Math::Float>::infinity();
+			}
+
+			// Bounds of the children
+			const int leftIndex = 2 * nodeIndex + 1;
+			if (leftIndex < numInternalNodes)
+			{
+				auto& leftBound = bounds[leftIndex];
+				auto& rightBound = bounds[leftIndex + 1];
+				leftBound = bound;
+				rightBound = bound;
+				leftBound.max = ReplaceComponent(bound.max, axis, std::min(bound.max[axis], splitPos[nodeIndex]));
+				rightBound.min = ReplaceComponent(bound.min, axis, std::max(bound.min[axis], splitPos[nodeIndex]));
+			}
+		}
 	}
-	int splitAxis = bound.LongestAxis();
-	int splitPos = (start + end) / 2;
-	std::nth_element(&photonIndices[start], &photonIndices[splitPos], &photonIndices[end-1]+1, [&](size_t i1, size_t i2)
-	{
-		const auto& p1 = photons[i1];
-		const auto& p2 = photons[i2];
-		return p1.p[splitAxis] == p2.p[splitAxis] ? i1 < i2 : p1.p[splitAxis] < p2.p[splitAxis];
-	});
-	
-	// Create intermediate node
-	const auto& splitPhoton = photons[photonIndices[splitPos]];
-	nodes[nodeIndex].InitializeIntermediateNode(splitPhoton.p[splitAxis], splitAxis);
-	data[nodeIndex] = splitPhoton;
-
-	// Continue recursively
-	if (start < splitPos)
+
+	// Positions in SoA layout
+	const size_t paddedSize = static_cast<size_t>(numLeaves) * BucketSize;
+	for (int axis = 0; axis < 3; axis++)
 	{
-		nodes[nodeIndex].hasLeftChild = 1;
-		RecursiveBuild(nextNodeIndex++, start, splitPos, photons, photonIndices, nextNodeIndex);
+		positions[axis].assign(paddedSize, std::numeric_limits<Math::Float>::infinity());
 	}
-	if (splitPos + 1 < end)
+
+	#pragma omp parallel for
+	for (long long i = 0; i < static_cast<long long>(n); i++)
 	{
-		nodes[nodeIndex].rightChild = nextNodeIndex++;
-		RecursiveBuild(nodes[nodeIndex].rightChild, splitPos+1, end, photons, photonIndices, nextNodeIndex);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			positions[axis][i] = data[i].p[axis];
+		}
 	}
 }
 
-void KdTreePhotonMap::CollectPhotons( const Math::Vec3& p, Math::Float& maxDist2, const PhotonCollectFunc& collectFunc ) const
+void KdTreePhotonMap::BucketDistances( const Math::Vec3& p, int leafIndex, Math::Float* dist2 ) const
 {
-	RecursiveCollectPhotons(0, p, maxDist2, collectFunc);
+	const size_t base = static_cast<size_t>(leafIndex) * BucketSize;
+
+#if LM_SSE2 && LM_SINGLE_PRECISION
+	const __m128 px = _mm_set1_ps(p.x);
+	const __m128 py = _mm_set1_ps(p.y);
+	const __m128 pz = _mm_set1_ps(p.z);
+	for (int i = 0; i < BucketSize; i += 4)
+	{
+		const __m128 dx = _mm_sub_ps(_mm_load_ps(&positions[0][base + i]), px);
+		const __m128 dy = _mm_sub_ps(_mm_load_ps(&positions[1][base + i]), py);
+		const __m128 dz = _mm_sub_ps(_mm_load_ps(&positions[2][base + i]), pz);
+		_mm_storeu_ps(dist2 + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+	}
+#else
+	for (int i = 0; i < BucketSize; i++)
+	{
+		const auto dx = positions[0][base + i] - p.x;
+		const auto dy = positions[1][base + i] - p.y;
+		const auto dz = positions[2][base + i] - p.z;
+		dist2[i] = dx * dx + dy * dy + dz * dz;
+	}
+#endif
 }
 
-void KdTreePhotonMap::RecursiveCollectPhotons( size_t nodeIndex, const Math::Vec3& p, Math::Float& maxDist2, const PhotonCollectFunc& collectFunc ) const
+template <typename CollectFunc>
+void KdTreePhotonMap::Traverse( const Math::Vec3& p, Math::Float& maxDist2, const CollectFunc& collectFunc ) const
 {
-	const auto& node = nodes[nodeIndex];
-	if (!node.Leaf())
+	if (data.empty())
 	{
-		// Process children
-		int axis = node.splitAxis;
-		auto dist2 = (p[axis] - node.splitPos) * (p[axis] - node.splitPos);
-		if (p[axis] <= node.splitPos)
+		return;
+	}
+
+	// Stack of the far children and the squared distances to the split planes
+	int stackNodes[TraversalStackSize];
+	Math::Float stackDist2[TraversalStackSize];
+	int stackSize = 0;
+
+	const int numInternalNodes = numLeaves - 1;
+	const size_t n = data.size();
+	int nodeIndex = 0;
+
+	while (true)
+	{
+		// Descend to the leaf nearer to the query point
+		while (nodeIndex < numInternalNodes)
 		{
-			// Query point is located on left half -> left points are nearer
-			if (node.hasLeftChild)
-			{
-				// Left children
-				RecursiveCollectPhotons(nodeIndex + 1, p, maxDist2, collectFunc);
-			}
-			if (dist2 < maxDist2 && node.rightChild < static_cast<unsigned int>(nodes.size()))
-			{
-				// Right children
-				// Distances to the all photons in right half is no less than #dist2
-				RecursiveCollectPhotons(node.rightChild, p, maxDist2, collectFunc);
-			}
+			const int axis = splitAxis[nodeIndex];
+			const auto d = p[axis] - splitPos[nodeIndex];
+			const int leftIndex = 2 * nodeIndex + 1;
+
+			// Distances to the all photons in the far half is no less than |d|
+			stackNodes[stackSize] = d <= Math::Float(0) ? leftIndex + 1 : leftIndex;
+			stackDist2[stackSize] = d * d;
+			stackSize++;
+			nodeIndex = d <= Math::Float(0) ? leftIndex : leftIndex + 1;
 		}
-		else
+
+		// Process the bucket
+		const int leafIndex = nodeIndex - numInternalNodes;
+		const size_t base = static_cast<size_t>(leafIndex) * BucketSize;
+		if (base < n)
 		{
-			// Query point is located on right half -> right points are nearer
-			if (node.rightChild < static_cast<unsigned int>(nodes.size()))
+			Math::Float dist2[BucketSize];
+			BucketDistances(p, leafIndex, dist2);
+
+			const int count = static_cast<int>(std::min(n - base, static_cast<size_t>(BucketSize)));
+			for (int i = 0; i < count; i++)
 			{
-				// Right children
-				RecursiveCollectPhotons(node.rightChild, p, maxDist2, collectFunc);
+				if (dist2[i] < maxDist2)
+				{
+					collectFunc(data[base + i], dist2[i], maxDist2);
+				}
 			}
-			if (dist2 < maxDist2 && node.hasLeftChild)
+		}
+
+		// Pop the next node which is not culled by the current #maxDist2
+		do
+		{
+			if (stackSize == 0)
 			{
-				// Left children
-				// Distances to the all photons in left half is no less than #dist2
-				RecursiveCollectPhotons(nodeIndex + 1, p, maxDist2, collectFunc);
+				return;
 			}
-		}
+			stackSize--;
+		} while (stackDist2[stackSize] >= maxDist2);
+
+		nodeIndex = stackNodes[stackSize];
 	}
+}
 
-	// Dispatch photon collect function
-	auto dist2 = Math::Length2(data[nodeIndex].p - p);
-	if (dist2 < maxDist2)
+void KdTreePhotonMap::CollectPhotons( const Math::Vec3& p, Math::Float& maxDist2, const PhotonCollectFunc& collectFunc ) const
+{
+	Traverse(p, maxDist2, [&p, &collectFunc](const Photon& photon, Math::Float /*dist2*/, Math::Float& maxDist2)
 	{
-		collectFunc(p, data[nodeIndex], maxDist2);
-	}
+		collectFunc(p, photon, maxDist2);
+	});
+}
+
+void KdTreePhotonMap::CollectNearestPhotons( const Math::Vec3& p, int k, Math::Float& maxDist2, std::vector<CollectedPhotonInfo>& collected ) const
+{
+	collected.clear();
+	Traverse(p, maxDist2, [k, &collected](const Photon& photon, Math::Float dist2, Math::Float& maxDist2)
+	{
+		AddNearestPhoton(photon, dist2, static_cast<size_t>(k), maxDist2, collected);
+	});
 }
 
 void KdTreePhotonMap::GetPhotons( std::vector<const Photon*>& photons ) const
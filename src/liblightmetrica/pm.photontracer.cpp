@@ -0,0 +1,229 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+#include <lightmetrica/pm.photontracer.h>
+#include <lightmetrica/sampler.h>
+#include <lightmetrica/surfacegeometry.h>
+#include <lightmetrica/generalizedbsdf.h>
+#include <lightmetrica/light.h>
+#include <lightmetrica/scene.h>
+#include <lightmetrica/ray.h>
+#include <lightmetrica/intersection.h>
+#include <lightmetrica/bsdf.h>
+#include <atomic>
+#include <omp.h>
+
+LM_NAMESPACE_BEGIN
+
+namespace
+{
+
+	/*
+		Claim a block of the budget shared among threads.
+		Claims at most #blockSize elements of [0, budget) as [begin, end).
+		Returns false if the budget is exhausted.
+	*/
+	bool ClaimBudget(std::atomic<long long>& counter, long long blockSize, long long budget, long long& begin, long long& end)
+	{
+		begin = counter.fetch_add(blockSize);
+		if (begin >= budget)
+		{
+			return false;
+		}
+
+		end = std::min(begin + blockSize, budget);
+		return true;
+	}
+
+	/*
+		Trace photons in a thread.
+		Samples and photons are claimed from the budgets shared among threads.
+	*/
+	void TracePhotonsInThread(const Scene& scene, Sampler& sampler, long long numSamples, long long maxPhotons, Photons& photons, long long& tracedPaths, std::atomic<long long>& claimedSamples, std::atomic<long long>& claimedPhotons)
+	{
+		// Samples and photons are claimed by blocks
+		// in order to reduce the contention of the shared counters
+		const long long SampleBlockSize = 64;
+		const long long PhotonBlockSize = 1024;
+
+		long long sample = 0, sampleEnd = 0;
+		long long photonSlot = 0, photonSlotEnd = 0;
+		bool exhausted = false;
+
+		while (!exhausted)
+		{
+			if (sample == sampleEnd && !ClaimBudget(claimedSamples, SampleBlockSize, numSamples, sample, sampleEnd))
+			{
+				break;
+			}
+
+			if (photonSlot == photonSlotEnd && !ClaimBudget(claimedPhotons, PhotonBlockSize, maxPhotons, photonSlot, photonSlotEnd))
+			{
+				break;
+			}
+
+			sample++;
+			tracedPaths++;
+
+			SurfaceGeometry geomL;
+			Math::PDFEval pdfPL;
+
+			// Sample a position on the light
+			auto lightSampleP = sampler.NextVec2();
+			Math::PDFEval lightSelectionPdf;
+			const auto* light = scene.SampleLightSelection(lightSampleP, lightSelectionPdf);
+			light->SamplePosition(lightSampleP, geomL, pdfPL);
+			pdfPL.v *= lightSelectionPdf.v;
+
+			// Evaluate positional component of Le
+			auto positionalLe = light->EvaluatePosition(geomL);
+
+			// Trace light particle and evaluate importance
+			auto throughput = positionalLe / pdfPL.v;
+			auto currGeom = geomL;
+			Math::Vec3 currWi;
+			const GeneralizedBSDF* currBsdf = light;
+			int depth = 0;
+
+			while (true)
+			{
+				// Sample generalized BSDF
+				GeneralizedBSDFSampleQuery bsdfSQ;
+				bsdfSQ.sample = sampler.NextVec2();
+				bsdfSQ.uComp = sampler.Next();
+				bsdfSQ.transportDir = TransportDirection::LE;
+				bsdfSQ.type = GeneralizedBSDFType::All;
+				bsdfSQ.wi = currWi;
+
+				GeneralizedBSDFSampleResult bsdfSR;
+				auto fs_Estimated = currBsdf->SampleAndEstimateDirection(bsdfSQ, currGeom, bsdfSR);
+				if (Math::IsZero(fs_Estimated))
+				{
+					break;
+				}
+
+				auto nextThroughput = throughput * fs_Estimated;
+
+				// Russian roulette for path termination
+				if (depth >= 1)
+				{
+					auto continueProb = Math::Min(Math::Float(1), Math::Luminance(nextThroughput) / Math::Luminance(throughput));
+					if (sampler.Next() > continueProb)
+					{
+						break;
+					}
+
+					throughput = nextThroughput / continueProb;
+				}
+				else
+				{
+					throughput = nextThroughput;
+				}
+
+				// --------------------------------------------------------------------------------
+
+				// Setup next ray
+				Ray ray;
+				ray.d = bsdfSR.wo;
+				ray.o = currGeom.p;
+				ray.minT = Math::Constants::Eps();
+				ray.maxT = Math::Constants::Inf();
+
+				// Intersection query
+				Intersection isect;
+				if (!scene.Intersect(ray, isect))
+				{
+					break;
+				}
+
+				// --------------------------------------------------------------------------------
+
+				// If intersected surface is non-specular, store the photon into photon map
+				if ((isect.bsdf->BSDFTypes() & GeneralizedBSDFType::NonDelta) > 0)
+				{
+					Photon photon;
+					photon.p = isect.geom.p;
+					photon.throughput = throughput;
+					photon.wi = -ray.d;
+					photons.push_back(photon);
+
+					// Stop tracing if the photon budget is exhausted
+					if (++photonSlot == photonSlotEnd && !ClaimBudget(claimedPhotons, PhotonBlockSize, maxPhotons, photonSlot, photonSlotEnd))
+					{
+						exhausted = true;
+						break;
+					}
+				}
+
+				// --------------------------------------------------------------------------------
+
+				// Update information
+				currGeom = isect.geom;
+				currWi = -ray.d;
+				currBsdf = isect.bsdf;
+				depth++;
+			}
+		}
+	}
+
+}
+
+void PhotonTracer::TracePhotons( const Scene& scene, Sampler& initialSampler, long long numSamples, long long maxPhotons, Photons& photons, long long& tracedPaths )
+{
+	// Photons are traced in parallel, where each thread has its own sampler and photon buffer.
+	// The number of samples and the number of photons are the budgets shared among threads.
+	const int numThreads = omp_get_max_threads();
+	std::vector<std::unique_ptr<Sampler>> samplers;
+	for (int thread = 0; thread < numThreads; thread++)
+	{
+		samplers.emplace_back(initialSampler.Clone());
+		samplers.back()->SetSeed(initialSampler.NextUInt());
+	}
+
+	std::vector<Photons> threadPhotons(numThreads);
+	std::vector<long long> threadTracedPaths(numThreads, 0);
+	std::atomic<long long> claimedSamples(0);
+	std::atomic<long long> claimedPhotons(0);
+
+	#pragma omp parallel for schedule(static, 1)
+	for (int thread = 0; thread < numThreads; thread++)
+	{
+		TracePhotonsInThread(scene, *samplers[thread], numSamples, maxPhotons, threadPhotons[thread], threadTracedPaths[thread], claimedSamples, claimedPhotons);
+	}
+
+	// Concatenate photons from each thread
+	std::vector<size_t> offsets(numThreads + 1, 0);
+	for (int thread = 0; thread < numThreads; thread++)
+	{
+		offsets[thread + 1] = offsets[thread] + threadPhotons[thread].size();
+		tracedPaths += threadTracedPaths[thread];
+	}
+
+	photons.resize(offsets[numThreads]);
+
+	#pragma omp parallel for schedule(static, 1)
+	for (int thread = 0; thread < numThreads; thread++)
+	{
+		std::copy(threadPhotons[thread].begin(), threadPhotons[thread].end(), photons.begin() + offsets[thread]);
+		Photons().swap(threadPhotons[thread]);
+	}
+}
+
+LM_NAMESPACE_END
\ No newline at end of file
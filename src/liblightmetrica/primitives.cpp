@@ -137,6 +137,7 @@ bool PrimitivesImpl::Load( const ConfigNode& node, const Assets& assets )
 			return false;
 		}
 
+		environmentLight->SetLightIndex(static_cast<int>(lights.size()));
 		lights.push_back(environmentLight);
 	}
 
@@ -166,9 +167,9 @@ bool PrimitivesImpl::Load( const ConfigNode& node, const Assets& assets )
 	}
 
 	// ## Light
-	referencedPrimitives.clear();
 	for (auto* light : lights)
 	{
+		referencedPrimitives.clear();
 		for (auto& primitive : primitives)
 		{
 			if (primitive->light == light)
@@ -178,7 +179,7 @@ bool PrimitivesImpl::Load( const ConfigNode& node, const Assets& assets )
 		}
 		light->RegisterPrimitives(referencedPrimitives);
 	}
-	if (environmentLightNode.Empty() && referencedPrimitives.empty())
+	if (lights.empty())
 	{
 		LM_LOG_WARN("Missing lights in the scene");
 	}
@@ -310,7 +311,14 @@ bool PrimitivesImpl::Traverse( const ConfigNode& node, const Assets& assets, con
 		}
 
 		// Register the light to the scene
-		lights.push_back(primitive->light);
+		// A light shared by multiple primitives is registered once
+		auto* light = primitive->light;
+		const int lightIndex = light->LightIndex();
+		if (lightIndex < 0 || lightIndex >= static_cast<int>(lights.size()) || lights[lightIndex] != light)
+		{
+			light->SetLightIndex(static_cast<int>(lights.size()));
+			lights.push_back(light);
+		}
 	}
 
 	// ## Process camera
@@ -93,9 +93,10 @@ private:
 private:
 
 	Math::Float normFactor;									//!< Normalization factor
-	std::unique_ptr<RewindableSampler> rewindableSampler;	//!< Rewindable sampler for light path generation
-	std::vector<PSSMLTPathSeed> seedCandidates;				//!< Candidates of seeds for each thread
-	Math::DiscreteDistribution1D seedCandidateDist;			//!< Distribution for seed selection
+	std::unique_ptr<RewindableSampler> rewindableSampler;	//!< Rewindable sampler for restoring seed paths
+	std::vector<unsigned int> streamSeeds;					//!< Seeds of the rewindable sampler for each stream
+	std::vector<PSSMLTPathSeedReservoir> seedReservoirs;	//!< Reservoirs of seeds for each stream
+	Math::DiscreteAliasDistribution1D seedReservoirDist;	//!< Distribution for reservoir selection
 
 };
 
@@ -208,39 +209,74 @@ bool BPTOptimizedPSSMLTRenderer::Preprocess( const Scene& scene, const RenderPro
 
 	// --------------------------------------------------------------------------------
 
-	// Initialize sampler
+	// # Initialize samplers
+
+	// Seed paths are sampled in parallel, where each thread takes its own stream of the rewindable sampler.
+	// A seed is identified by the stream index and the sample index in the stream.
+	// Counter-based generator is used so that rewinding to the seeds is done in constant time
+	const int numStreams = omp_get_max_threads();
+	std::vector<unsigned int> reservoirSeeds;
+	streamSeeds.clear();
+	for (int stream = 0; stream < numStreams; stream++)
+	{
+		streamSeeds.push_back(initialSampler->NextUInt());
+		reservoirSeeds.push_back(initialSampler->NextUInt());
+	}
+
 	rewindableSampler.reset(ComponentFactory::Create<RewindableSampler>());
-	rewindableSampler->Configure(initialSampler->Rng()->Clone());
-	rewindableSampler->SetSeed(initialSampler->NextUInt());
+	rewindableSampler->Configure(ComponentFactory::Create<Random>("philox"));
 
 	// --------------------------------------------------------------------------------
 
 	// # Sample candidates for seeds
 
 	// Take #numSeedSamples path samples and generate seeds for each thread
-	// This process must be done in a single thread in order to keep consistency of sample indexes
+	// Each stream keeps a fixed number of candidates in the reservoir
+	// so that the memory usage does not depend on #numSeedSamples
 
-	PSSMLTSplats splats;
-	Math::Float sumI(0);
+	seedReservoirs.assign(numStreams, PSSMLTPathSeedReservoir());
+	std::atomic<long long> processedSamples(0);
 
-	for (long long sample = 0; sample < numSeedSamples; sample++)
+	#pragma omp parallel for schedule(static, 1)
+	for (int stream = 0; stream < numStreams; stream++)
 	{
-		// Current sample index
-		int index = rewindableSampler->SampleIndex();
+		std::unique_ptr<RewindableSampler> streamSampler(ComponentFactory::Create<RewindableSampler>());
+		streamSampler->Configure(ComponentFactory::Create<Random>("philox"));
+		streamSampler->SetSeed(streamSeeds[stream]);
+
+		std::unique_ptr<Random> rng(ComponentFactory::Create<Random>("philox"));
+		rng->SetSeed(reservoirSeeds[stream]);
 
-		// Sample light paths
-		// We note that path sampler might generate multiple light paths
-		pathSampler->SampleAndEvaluateBidir(scene, *rewindableSampler, *rewindableSampler, splats, rrDepth, -1);
+		std::unique_ptr<PSSMLTPathSampler> streamPathSampler(pathSampler->Clone());
+		auto& reservoir = seedReservoirs[stream];
+		reservoir.Initialize(numStreams);
 
-		// Calculate sum of luminance
-		auto I = splats.SumI();
-		if (!Math::IsZero(I))
+		PSSMLTSplats splats;
+		const long long sampleBegin = numSeedSamples * stream / numStreams;
+		const long long sampleEnd = numSeedSamples * (stream + 1) / numStreams;
+
+		for (long long sample = sampleBegin; sample < sampleEnd; sample++)
 		{
-			sumI += I;
-			seedCandidates.emplace_back(index, I);
+			// Current sample index
+			long long index = streamSampler->SampleIndex();
+
+			// Sample light paths
+			// We note that path sampler might generate multiple light paths
+			streamPathSampler->SampleAndEvaluateBidir(scene, *streamSampler, *streamSampler, splats, rrDepth, -1);
+
+			// Add to the reservoir
+			auto I = splats.SumI();
+			if (!Math::IsZero(I))
+			{
+				reservoir.Add(PSSMLTPathSeed(stream, index, I), *rng);
+			}
+
+			processedSamples++;
+			if (omp_get_thread_num() == 0)
+			{
+				signal_ReportProgress(static_cast<double>(processedSamples) / numSeedSamples, false);
+			}
 		}
-
-		signal_ReportProgress(static_cast<double>(sample) / numSeedSamples, false);
 	}
 
 	// --------------------------------------------------------------------------------
@@ -248,15 +284,21 @@ bool BPTOptimizedPSSMLTRenderer::Preprocess( const Scene& scene, const RenderPro
 	// # Normalization factor & CDF
 
 	// Normalization factor
+	Math::Float sumI(0);
+	for (const auto& reservoir : seedReservoirs)
+	{
+		sumI += reservoir.sumI;
+	}
 	normFactor = sumI / Math::Float(numSeedSamples);
 
-	// Create CDF
-	for (auto& candidate : seedCandidates)
+	// Create CDF for reservoir selection
+	seedReservoirDist.Clear();
+	for (const auto& reservoir : seedReservoirs)
 	{
-		seedCandidateDist.Add(candidate.I);
+		seedReservoirDist.Add(reservoir.sumI);
 	}
 
-	seedCandidateDist.Normalize();
+	seedReservoirDist.Normalize();
 
 	// --------------------------------------------------------------------------------
 
@@ -267,14 +309,27 @@ bool BPTOptimizedPSSMLTRenderer::Preprocess( const Scene& scene, const RenderPro
 
 RenderProcess* BPTOptimizedPSSMLTRenderer::CreateRenderProcess(const Scene& scene, int threadID, int numThreads)
 {
-	if (seedCandidates.size() < static_cast<size_t>(numThreads))
+	long long numCandidates = 0;
+	for (const auto& reservoir : seedReservoirs)
+	{
+		numCandidates += reservoir.numCandidates;
+	}
+	if (numCandidates < numThreads)
 	{
 		LM_LOG_ERROR("Number of candidates is too small");
 		return nullptr;
 	}
+	if (static_cast<size_t>(numThreads) > seedReservoirs.front().seeds.size())
+	{
+		LM_LOG_ERROR("Number of render processes exceeds the number of seeds in the reservoirs");
+		return nullptr;
+	}
 
 	// Choose a seed
-	const auto& seed = seedCandidates[seedCandidateDist.Sample(initialSampler->Next())];
+	// A reservoir is selected according to the sum of luminance of the candidates in the stream,
+	// and the seeds in the reservoir are independently sampled proportional to the luminance,
+	// thus the seed is selected proportional to the luminance among all candidates.
+	const auto seed = seedReservoirs[seedReservoirDist.Sample(initialSampler->Next())].Next();
 
 	// Create a process
 	std::unique_ptr<BPTOptimizedPSSMLTRenderer_RenderProcess> process(new BPTOptimizedPSSMLTRenderer_RenderProcess(*this, initialSampler->Clone(), pathSampler->Clone(), scene.MainCamera()->GetFilm()->Clone()));
@@ -292,12 +347,15 @@ bool BPTOptimizedPSSMLTRenderer_RenderProcess::Configure(const Scene& scene, con
 {
 	// Configure and set seeds
 	subpathSamplerL->Configure(renderer.initialSampler->Rng()->Clone(), renderer.kernelSizeS1, renderer.kernelSizeS2);
+	subpathSamplerL->Reserve(pathSampler->PrimarySampleDimensionsHint(-1));
 	subpathSamplerL->SetSeed(renderer.initialSampler->NextUInt());
 	subpathSamplerE->Configure(renderer.initialSampler->Rng()->Clone(), renderer.kernelSizeS1, renderer.kernelSizeS2);
+	subpathSamplerE->Reserve(pathSampler->PrimarySampleDimensionsHint(-1));
 	subpathSamplerE->SetSeed(renderer.initialSampler->NextUInt());
 	randomSampler->SetSeed(renderer.initialSampler->NextUInt());
 
 	// Restore state of the seed path
+	renderer.rewindableSampler->SetSeed(renderer.streamSeeds[seed.stream]);
 	renderer.rewindableSampler->Rewind(seed.index);
 	subpathSamplerL->BeginRestore(*renderer.rewindableSampler);
 	subpathSamplerE->BeginRestore(*renderer.rewindableSampler);
@@ -106,22 +106,52 @@ private:
 	Math::Float largeStepProb;								//!< Large step mutation probability
 	Math::Float kernelSizeS1;								//!< Minimum kernel size
 	Math::Float kernelSizeS2;								//!< Maximum kernel size
+	int numChains;											//!< Number of chains per render process
 
 private:
 
 	Math::Float normFactor;									//!< Normalization factor
-	std::unique_ptr<RewindableSampler> rewindableSampler;	//!< Rewindable sampler for light path generation
-	std::vector<PSSMLTPathSeed> seedCandidates;				//!< Candidates of seeds for each thread
-	Math::DiscreteDistribution1D seedCandidateDist;			//!< Distribution for seed selection
+	std::unique_ptr<RewindableSampler> rewindableSampler;	//!< Rewindable sampler for restoring seed paths
+	std::vector<unsigned int> streamSeeds;					//!< Seeds of the rewindable sampler for each stream
+	std::vector<PSSMLTPathSeedReservoir> seedReservoirs;	//!< Reservoirs of seeds for each stream
+	Math::DiscreteAliasDistribution1D seedReservoirDist;	//!< Distribution for reservoir selection
 
 };
 
 // --------------------------------------------------------------------------------
 
+/*!
+	Markov chain for PSSMLTRenderer.
+	Manages the state of a chain in the render process.
+*/
+struct PSSMLTRenderer_Chain
+{
+
+	PSSMLTRenderer_Chain()
+		: sampler(ComponentFactory::Create<PSSMLTPrimarySampler>())
+		, currentIdx(0)
+		, enableLargeStep(false)
+	{
+
+	}
+
+	PSSMLTSplats& Current() { return records[currentIdx]; }
+	PSSMLTSplats& Proposed() { return records[1-currentIdx]; }
+
+	std::unique_ptr<PSSMLTPrimarySampler> sampler;			//!< Kelemen's lazy sampler
+	PSSMLTSplats records[2];								//!< Path sample records (current or proposed)
+	int currentIdx;											//!< Index of current record
+	bool enableLargeStep;									//!< True if the proposed path is sampled by the large step mutation
+
+};
+
 /*!
 	Render process for PSSMLTRenderer.
 	The class is responsible for per-thread execution of rendering tasks
 	and managing thread-dependent resources.
+	The process runs one or more independent chains.
+	The proposed paths of multiple chains are sampled in lockstep,
+	so that the path sampler can trace the rays of the chains in a batch.
 */
 class PSSMLTRenderer_RenderProcess final : public SamplingBasedRenderProcess
 {
@@ -132,8 +162,6 @@ public:
 		, randomSampler(randomSampler)
 		, pathSampler(pathSampler)
 		, film(film)
-		, sampler(ComponentFactory::Create<PSSMLTPrimarySampler>())
-		, currentIdx(0)
 	{
 
 	}
@@ -149,12 +177,7 @@ public:
 
 public:
 
-	bool Configure(const Scene& scene, const PSSMLTPathSeed& seed);
-
-private:
-
-	PSSMLTSplats& Current() { return records[currentIdx]; }
-	PSSMLTSplats& Proposed() { return records[1-currentIdx]; }
+	bool Configure(const Scene& scene, const std::vector<PSSMLTPathSeed>& seeds);
 
 private:
 
@@ -162,9 +185,9 @@ private:
 	std::unique_ptr<Sampler> randomSampler;					//!< Ordinary random sampler
 	std::unique_ptr<PSSMLTPathSampler> pathSampler;			//!< Path sampler
 	std::unique_ptr<Film> film;								//!< Film
-	std::unique_ptr<PSSMLTPrimarySampler> sampler;			//!< Kelemen's lazy sampler
-	PSSMLTSplats records[2];								//!< Path sample records (current or proposed)
-	int currentIdx;											//!< Index of current record
+	std::vector<std::unique_ptr<PSSMLTRenderer_Chain>> chains;	//!< Chains
+	std::vector<Sampler*> chainSamplers;					//!< Samplers of the chains (for batched sampling)
+	std::vector<PSSMLTSplats*> proposedRecords;				//!< Proposed records of the chains (for batched sampling)
 
 };
 
@@ -238,6 +261,12 @@ bool PSSMLTRenderer::Configure(const ConfigNode& node, const Assets& assets, con
 	node.ChildValueOrDefault("large_step_prob", Math::Float(0.1), largeStepProb);
 	node.ChildValueOrDefault("kernel_size_s1", Math::Float(1.0 / 1024.0), kernelSizeS1);
 	node.ChildValueOrDefault("kernel_size_s2", Math::Float(1.0 / 64.0), kernelSizeS2);
+	node.ChildValueOrDefault("num_chains", 1, numChains);
+	if (numChains < 1)
+	{
+		LM_LOG_ERROR("Invalid number of chains");
+		return false;
+	}
 
 #if LM_EXPERIMENTAL_MODE
 	// Experiments
@@ -264,39 +293,76 @@ bool PSSMLTRenderer::Preprocess( const Scene& scene, const RenderProcessSchedule
 
 	// --------------------------------------------------------------------------------
 
-	// # Initialize sampler
+	// # Initialize samplers
+
+	// Seed paths are sampled in parallel, where each thread takes its own stream of the rewindable sampler.
+	// A seed is identified by the stream index and the sample index in the stream.
+	// Counter-based generator is used so that rewinding to the seeds is done in constant time
+	const int numStreams = omp_get_max_threads();
+	std::vector<unsigned int> reservoirSeeds;
+	streamSeeds.clear();
+	for (int stream = 0; stream < numStreams; stream++)
+	{
+		streamSeeds.push_back(initialSampler->NextUInt());
+		reservoirSeeds.push_back(initialSampler->NextUInt());
+	}
+
 	rewindableSampler.reset(ComponentFactory::Create<RewindableSampler>());
-	rewindableSampler->Configure(initialSampler->Rng()->Clone());
-	rewindableSampler->SetSeed(initialSampler->NextUInt());
+	rewindableSampler->Configure(ComponentFactory::Create<Random>("philox"));
 
 	// --------------------------------------------------------------------------------
 
 	// # Sample candidates for seeds
 
 	// Take #numSeedSamples path samples and generate seeds for each thread
-	// This process must be done in a single thread in order to keep consistency of sample indexes
+	// Each stream keeps a fixed number of candidates in the reservoir
+	// so that the memory usage does not depend on #numSeedSamples.
+	// A reservoir holds enough seeds for all chains of all threads,
+	// so that a seed is never reused even if the same reservoir is always selected.
 
-	PSSMLTSplats splats;
-	Math::Float sumI(0);
+	seedReservoirs.assign(numStreams, PSSMLTPathSeedReservoir());
+	std::atomic<long long> processedSamples(0);
 
-	for (long long sample = 0; sample < numSeedSamples; sample++)
+	#pragma omp parallel for schedule(static, 1)
+	for (int stream = 0; stream < numStreams; stream++)
 	{
-		// Current sample index
-		int index = rewindableSampler->SampleIndex();
+		std::unique_ptr<RewindableSampler> streamSampler(ComponentFactory::Create<RewindableSampler>());
+		streamSampler->Configure(ComponentFactory::Create<Random>("philox"));
+		streamSampler->SetSeed(streamSeeds[stream]);
+
+		std::unique_ptr<Random> rng(ComponentFactory::Create<Random>("philox"));
+		rng->SetSeed(reservoirSeeds[stream]);
+
+		std::unique_ptr<PSSMLTPathSampler> streamPathSampler(pathSampler->Clone());
+		auto& reservoir = seedReservoirs[stream];
+		reservoir.Initialize(static_cast<size_t>(numStreams) * numChains);
 
-		// Sample light paths
-		// We note that path sampler might generate multiple light paths
-		pathSampler->SampleAndEvaluate(scene, *rewindableSampler, splats, rrDepth, -1);
+		PSSMLTSplats splats;
+		const long long sampleBegin = numSeedSamples * stream / numStreams;
+		const long long sampleEnd = numSeedSamples * (stream + 1) / numStreams;
 
-		// Calculate sum of luminance
-		auto I = splats.SumI();
-		if (!Math::IsZero(I))
+		for (long long sample = sampleBegin; sample < sampleEnd; sample++)
 		{
-			sumI += I;
-			seedCandidates.emplace_back(index, I);
-		}
+			// Current sample index
+			long long index = streamSampler->SampleIndex();
+
+			// Sample light paths
+			// We note that path sampler might generate multiple light paths
+			streamPathSampler->SampleAndEvaluate(scene, *streamSampler, splats, rrDepth, -1);
+
+			// Add to the reservoir
+			auto I = splats.SumI();
+			if (!Math::IsZero(I))
+			{
+				reservoir.Add(PSSMLTPathSeed(stream, index, I), *rng);
+			}
 
-		signal_ReportProgress(static_cast<double>(sample) / numSeedSamples, false);
+			processedSamples++;
+			if (omp_get_thread_num() == 0)
+			{
+				signal_ReportProgress(static_cast<double>(processedSamples) / numSeedSamples, false);
+			}
+		}
 	}
 
 	// --------------------------------------------------------------------------------
@@ -304,15 +370,21 @@ bool PSSMLTRenderer::Preprocess( const Scene& scene, const RenderProcessSchedule
 	// # Normalization factor & CDF
 
 	// Normalization factor
+	Math::Float sumI(0);
+	for (const auto& reservoir : seedReservoirs)
+	{
+		sumI += reservoir.sumI;
+	}
 	normFactor = sumI / Math::Float(numSeedSamples);
 
-	// Create CDF
-	for (auto& candidate : seedCandidates)
+	// Create CDF for reservoir selection
+	seedReservoirDist.Clear();
+	for (const auto& reservoir : seedReservoirs)
 	{
-		seedCandidateDist.Add(candidate.I);
+		seedReservoirDist.Add(reservoir.sumI);
 	}
 
-	seedCandidateDist.Normalize();
+	seedReservoirDist.Normalize();
 
 	// --------------------------------------------------------------------------------
 
@@ -323,18 +395,35 @@ bool PSSMLTRenderer::Preprocess( const Scene& scene, const RenderProcessSchedule
 
 RenderProcess* PSSMLTRenderer::CreateRenderProcess(const Scene& scene, int threadID, int numThreads)
 {
-	if (seedCandidates.size() < static_cast<size_t>(numThreads))
+	long long numCandidates = 0;
+	for (const auto& reservoir : seedReservoirs)
+	{
+		numCandidates += reservoir.numCandidates;
+	}
+	if (numCandidates < static_cast<long long>(numThreads) * numChains)
 	{
 		LM_LOG_ERROR("Number of candidates is too small");
 		return nullptr;
 	}
+	if (static_cast<size_t>(numThreads) * numChains > seedReservoirs.front().seeds.size())
+	{
+		LM_LOG_ERROR("Number of chains exceeds the number of seeds in the reservoirs");
+		return nullptr;
+	}
 
-	// Choose a seed
-	const auto& seed = seedCandidates[seedCandidateDist.Sample(initialSampler->Next())];
+	// Choose seeds for each chain
+	// A reservoir is selected according to the sum of luminance of the candidates in the stream,
+	// and the seeds in the reservoir are independently sampled proportional to the luminance,
+	// thus the seed is selected proportional to the luminance among all candidates.
+	std::vector<PSSMLTPathSeed> seeds;
+	for (int i = 0; i < numChains; i++)
+	{
+		seeds.push_back(seedReservoirs[seedReservoirDist.Sample(initialSampler->Next())].Next());
+	}
 
 	// Create a process
 	std::unique_ptr<PSSMLTRenderer_RenderProcess> process(new PSSMLTRenderer_RenderProcess(*this, initialSampler->Clone(), pathSampler->Clone(), scene.MainCamera()->GetFilm()->Clone()));
-	if (!process->Configure(scene, seed))
+	if (!process->Configure(scene, seeds))
 	{
 		return nullptr;
 	}
@@ -344,84 +433,126 @@ RenderProcess* PSSMLTRenderer::CreateRenderProcess(const Scene& scene, int threa
 
 // --------------------------------------------------------------------------------
 
-bool PSSMLTRenderer_RenderProcess::Configure(const Scene& scene, const PSSMLTPathSeed& seed)
+bool PSSMLTRenderer_RenderProcess::Configure(const Scene& scene, const std::vector<PSSMLTPathSeed>& seeds)
 {
 	// Configure and set seeds
-	sampler->Configure(renderer.initialSampler->Rng()->Clone(), renderer.kernelSizeS1, renderer.kernelSizeS2);
-	sampler->SetSeed(renderer.initialSampler->NextUInt());
+	chains.clear();
+	for (size_t i = 0; i < seeds.size(); i++)
+	{
+		chains.emplace_back(new PSSMLTRenderer_Chain);
+		auto& sampler = chains.back()->sampler;
+		sampler->Configure(renderer.initialSampler->Rng()->Clone(), renderer.kernelSizeS1, renderer.kernelSizeS2);
+		sampler->Reserve(pathSampler->PrimarySampleDimensionsHint(-1));
+		sampler->SetSeed(renderer.initialSampler->NextUInt());
+	}
 	randomSampler->SetSeed(renderer.initialSampler->NextUInt());
 
-	// Restore state of the seed path
-	renderer.rewindableSampler->Rewind(seed.index);
-	sampler->BeginRestore(*renderer.rewindableSampler);
-	renderer.pathSampler->SampleAndEvaluate(scene, *sampler, Current(), renderer.rrDepth, -1);
-	sampler->EndRestore();
-
-	// Sanity check
-	if (Math::Abs(Current().SumI() - seed.I) > Math::Constants::Eps())
+	chainSamplers.clear();
+	for (size_t i = 0; i < seeds.size(); i++)
 	{
-		LM_LOG_ERROR("Failed to reconstruct a seed path, invalid luminance");
-		return false;
+		auto& chain = *chains[i];
+		const auto& seed = seeds[i];
+
+		// Restore state of the seed path
+		renderer.rewindableSampler->SetSeed(renderer.streamSeeds[seed.stream]);
+		renderer.rewindableSampler->Rewind(seed.index);
+		chain.sampler->BeginRestore(*renderer.rewindableSampler);
+		renderer.pathSampler->SampleAndEvaluate(scene, *chain.sampler, chain.Current(), renderer.rrDepth, -1);
+		chain.sampler->EndRestore();
+
+		// Sanity check
+		if (Math::Abs(chain.Current().SumI() - seed.I) > Math::Constants::Eps())
+		{
+			LM_LOG_ERROR("Failed to reconstruct a seed path, invalid luminance");
+			return false;
+		}
+
+		chainSamplers.push_back(chain.sampler.get());
 	}
 
+	proposedRecords.assign(chains.size(), nullptr);
+
 	return true;
 }
 
 void PSSMLTRenderer_RenderProcess::ProcessSingleSample(const Scene& scene)
 {
-	auto& current  = Current();
-	auto& proposed = Proposed();
+	const int numChains = static_cast<int>(chains.size());
 
 	// Enable large step mutation
-	bool enableLargeStep = randomSampler->Next() < renderer.largeStepProb;
-	sampler->EnableLargeStepMutation(enableLargeStep);
-
-	// Sample and evaluate proposed path
-	pathSampler->SampleAndEvaluate(scene, *sampler, proposed, renderer.rrDepth, -1);
-
-	// Compute acceptance ratio
-	auto currentI  = current.SumI();
-	auto proposedI = proposed.SumI();
-	auto a = Math::IsZero(currentI) ? Math::Float(1) : Math::Min(Math::Float(1), proposedI / currentI);
+	for (int i = 0; i < numChains; i++)
+	{
+		auto& chain = *chains[i];
+		chain.enableLargeStep = randomSampler->Next() < renderer.largeStepProb;
+		chain.sampler->EnableLargeStepMutation(chain.enableLargeStep);
+		proposedRecords[i] = &chain.Proposed();
+	}
 
-	// Determine accept or reject
-	if (randomSampler->Next() < a)
+	// Sample and evaluate proposed paths
+	// The proposed paths of multiple chains are sampled in lockstep
+	if (numChains == 1)
 	{
-		sampler->Accept();
-		currentIdx = 1 - currentIdx;
+		pathSampler->SampleAndEvaluate(scene, *chainSamplers[0], *proposedRecords[0], renderer.rrDepth, -1);
 	}
 	else
 	{
-		sampler->Reject();
+		pathSampler->SampleAndEvaluateBatch(scene, &chainSamplers[0], &proposedRecords[0], numChains, renderer.rrDepth, -1);
 	}
 
-	// Accumulate contribution
-	switch (renderer.estimatorMode)
+	// Contribution of each chain is scaled so that
+	// a sample of the process corresponds to a mutation
+	const Math::Float weight = Math::Float(1) / Math::Float(numChains);
+
+	for (int i = 0; i < numChains; i++)
 	{
-		case PSSMLTEstimatorMode::MeanValueSubstitution:
+		auto& chain = *chains[i];
+		auto& current  = chain.Current();
+		auto& proposed = chain.Proposed();
+
+		// Compute acceptance ratio
+		auto currentI  = current.SumI();
+		auto proposedI = proposed.SumI();
+		auto a = Math::IsZero(currentI) ? Math::Float(1) : Math::Min(Math::Float(1), proposedI / currentI);
+
+		// Determine accept or reject
+		if (randomSampler->Next() < a)
 		{
-			if (proposedI > Math::Float(0))
-			{
-				current.AccumulateContributionToFilm(*film, (1 - a) * renderer.normFactor / currentI);
-				proposed.AccumulateContributionToFilm(*film, a * renderer.normFactor / proposedI);
-			}
-			else
-			{
-				current.AccumulateContributionToFilm(*film, renderer.normFactor / currentI);
-			}
-			break;
+			chain.sampler->Accept();
+			chain.currentIdx = 1 - chain.currentIdx;
 		}
-		case PSSMLTEstimatorMode::MeanValueSubstitution_LargeStepMIS:
+		else
 		{
-			current.AccumulateContributionToFilm(*film, (1 - a) / (currentI / renderer.normFactor + renderer.largeStepProb));
-			proposed.AccumulateContributionToFilm(*film, (a + (enableLargeStep ? Math::Float(1) : Math::Float(0))) / (proposedI / renderer.normFactor + renderer.largeStepProb));
-			break;
+			chain.sampler->Reject();
 		}
-		case PSSMLTEstimatorMode::Normal:
+
+		// Accumulate contribution
+		switch (renderer.estimatorMode)
 		{
-			auto& current = Current();
-			current.AccumulateContributionToFilm(*film, renderer.normFactor / current.SumI());
-			break;
+			case PSSMLTEstimatorMode::MeanValueSubstitution:
+			{
+				if (proposedI > Math::Float(0))
+				{
+					current.AccumulateContributionToFilm(*film, weight * (1 - a) * renderer.normFactor / currentI);
+					proposed.AccumulateContributionToFilm(*film, weight * a * renderer.normFactor / proposedI);
+				}
+				else
+				{
+					current.AccumulateContributionToFilm(*film, weight * renderer.normFactor / currentI);
+				}
+				break;
+			}
+			case PSSMLTEstimatorMode::MeanValueSubstitution_LargeStepMIS:
+			{
+				current.AccumulateContributionToFilm(*film, weight * (1 - a) / (currentI / renderer.normFactor + renderer.largeStepProb));
+				proposed.AccumulateContributionToFilm(*film, weight * (a + (chain.enableLargeStep ? Math::Float(1) : Math::Float(0))) / (proposedI / renderer.normFactor + renderer.largeStepProb));
+				break;
+			}
+			case PSSMLTEstimatorMode::Normal:
+			{
+				auto& current = chain.Current();
+				current.AccumulateContributionToFilm(*film, weight * renderer.normFactor / current.SumI());
+				break;
+			}
 		}
 	}
 }
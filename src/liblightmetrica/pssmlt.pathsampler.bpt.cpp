@@ -56,6 +56,7 @@ public:
 
 	virtual bool Configure(const ConfigNode& node, const Assets& assets) override;
 	virtual PSSMLTPathSampler* Clone() const override;
+	virtual int PrimarySampleDimensionsHint(int maxPathVertices) const override;
 	virtual void SampleAndEvaluate(const Scene& scene, Sampler& sampler, PSSMLTSplats& splats, int rrDepth, int maxPathVertices) override;
 	virtual void SampleAndEvaluateBidir(const Scene& scene, Sampler& subpathSamplerL, Sampler& subpathSamplerE, PSSMLTSplats& splats, int rrDepth, int maxPathVertices) override;
 	virtual void SampleAndEvaluateBidirSpecified(const Scene& scene, Sampler& subpathSamplerL, Sampler& subpathSamplerE, PSSMLTSplat& splat, int rrDepth, int maxPathVertices, int s, int t) override;
@@ -117,6 +118,17 @@ PSSMLTPathSampler* PSSMLTBPTPathSampler::Clone() const
 	return sampler;
 }
 
+int PSSMLTBPTPathSampler::PrimarySampleDimensionsHint( int maxPathVertices ) const
+{
+	// Number of vertices assumed for the subpaths without limits
+	const int numPathVertices = maxPathVertices < 0 ? 16 : maxPathVertices;
+
+	// Endpoint of each subpath (5 for light, 4 for eye) and
+	// BSDF sampling and RR for each intermediate vertex (4).
+	// Both subpaths are sampled from the same sampler with #SampleAndEvaluate.
+	return 5 + 4 + 2 * 4 * numPathVertices;
+}
+
 void PSSMLTBPTPathSampler::SampleAndEvaluate( const Scene& scene, Sampler& sampler, PSSMLTSplats& splats, int rrDepth, int maxPathVertices )
 {
 	SampleAndEvaluateBidir(scene, sampler, sampler, splats, rrDepth, maxPathVertices);
@@ -164,7 +176,7 @@ void PSSMLTBPTPathSampler::SampleAndEvaluateBidir( const Scene& scene, Sampler&
 
 			// Evaluate contribution and record the splat
 			auto C = misWeight->Evaluate(fullpath) * Cstar;
-			splats.splats.emplace_back(s, t, rasterPosition, C);
+			splats.splats.emplace_back(rasterPosition, C);
 		}
 	}
 }
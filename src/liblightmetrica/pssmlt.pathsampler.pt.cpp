@@ -32,9 +32,24 @@
 #include <lightmetrica/confignode.h>
 #include <lightmetrica/assets.h>
 #include <lightmetrica/logger.h>
+#include <lightmetrica/align.h>
 
 LM_NAMESPACE_BEGIN
 
+/*!
+	State of a path being sampled by PSSMLTPTPathSampler.
+*/
+struct PSSMLTPTPathState
+{
+	Sampler* sampler;			//!< Sampler
+	PSSMLTSplats* splats;		//!< Resulting splats
+	Math::Vec2 rasterPos;		//!< Raster position
+	Ray ray;					//!< Current ray
+	Math::Vec3 throughput;		//!< Current throughput
+	Math::Vec3 L;				//!< Accumulated contribution
+	int numPathVertices;		//!< Current number of vertices
+};
+
 /*!
 	Path tracing sampler.
 	Implements path sampler for PSSMLT with (unidirectional) path tracing.
@@ -49,10 +64,43 @@ public:
 
 	virtual bool Configure(const ConfigNode& node, const Assets& assets) override;
 	virtual PSSMLTPathSampler* Clone() const override;
+	virtual int PrimarySampleDimensionsHint(int maxPathVertices) const override;
 	virtual void SampleAndEvaluate(const Scene& scene, Sampler& sampler, PSSMLTSplats& splats, int rrDepth, int maxPathVertices) override;
+	virtual void SampleAndEvaluateBatch(const Scene& scene, Sampler* const* samplers, PSSMLTSplats* const* splats, int n, int rrDepth, int maxPathVertices) override;
 	virtual void SampleAndEvaluateBidir(const Scene& scene, Sampler& subpathSamplerL, Sampler& subpathSamplerE, PSSMLTSplats& splats, int rrDepth, int maxPathVertices) override;
 	virtual void SampleAndEvaluateBidirSpecified(const Scene& scene, Sampler& subpathSamplerL, Sampler& subpathSamplerE, PSSMLTSplat& splat, int rrDepth, int maxPathVertices, int s, int t) override;
 
+private:
+
+	/*!
+		Begin to sample a path.
+		Samples the raster position and the initial ray from the camera.
+	*/
+	void BeginPath(const Scene& scene, Sampler& sampler, PSSMLTSplats& splats, PSSMLTPTPathState& path) const;
+
+	/*!
+		Process an intersected vertex of the path.
+		Accumulates the emitted contribution and samples the next ray.
+		\retval true The path continues.
+		\retval false The path is terminated.
+	*/
+	bool ProcessVertex(const Scene& scene, const Intersection& isect, int rrDepth, int maxPathVertices, PSSMLTPTPathState& path) const;
+
+	/*!
+		End to sample a path.
+		Stores the contribution to the splats.
+	*/
+	void EndPath(PSSMLTPTPathState& path) const;
+
+private:
+
+	// Buffers for #SampleAndEvaluateBatch
+	std::vector<PSSMLTPTPathState, aligned_allocator<PSSMLTPTPathState, std::alignment_of<PSSMLTPTPathState>::value>> paths;
+	std::vector<Ray, aligned_allocator<Ray, std::alignment_of<Ray>::value>> rays;
+	std::vector<Intersection, aligned_allocator<Intersection, std::alignment_of<Intersection>::value>> isects;
+	std::vector<int> pathIndices;
+	std::unique_ptr<bool[]> hits;
+
 };
 
 bool PSSMLTPTPathSampler::Configure( const ConfigNode& node, const Assets& assets )
@@ -66,13 +114,109 @@ PSSMLTPathSampler* PSSMLTPTPathSampler::Clone() const
 	return sampler;
 }
 
+int PSSMLTPTPathSampler::PrimarySampleDimensionsHint( int maxPathVertices ) const
+{
+	// Number of vertices assumed for the paths without limits
+	const int numPathVertices = maxPathVertices < 0 ? 16 : maxPathVertices;
+
+	// Raster position and position on camera (4),
+	// BSDF sampling and RR for each vertex (4)
+	return 4 + 4 * numPathVertices;
+}
+
 void PSSMLTPTPathSampler::SampleAndEvaluate( const Scene& scene, Sampler& sampler, PSSMLTSplats& splats, int rrDepth, int maxPathVertices )
+{
+	PSSMLTPTPathState path;
+	BeginPath(scene, sampler, splats, path);
+
+	while (true)
+	{
+		if (maxPathVertices != -1 && path.numPathVertices > maxPathVertices)
+		{
+			break;
+		}
+
+		// Check intersection
+		Intersection isect;
+		if (!scene.Intersect(path.ray, isect))
+		{
+			break;
+		}
+
+		if (!ProcessVertex(scene, isect, rrDepth, maxPathVertices, path))
+		{
+			break;
+		}
+	}
+
+	EndPath(path);
+}
+
+void PSSMLTPTPathSampler::SampleAndEvaluateBatch( const Scene& scene, Sampler* const* samplers, PSSMLTSplats* const* splats, int n, int rrDepth, int maxPathVertices )
+{
+	if (static_cast<int>(paths.size()) < n)
+	{
+		paths.resize(n);
+		rays.resize(n);
+		isects.resize(n);
+		pathIndices.resize(n);
+		hits.reset(new bool[n]);
+	}
+
+	// Begin to sample paths
+	int numActive = 0;
+	for (int i = 0; i < n; i++)
+	{
+		BeginPath(scene, *samplers[i], *splats[i], paths[i]);
+		pathIndices[numActive++] = i;
+	}
+
+	// Advance the paths bounce by bounce
+	// The rays of the active paths are traced in a batch
+	while (numActive > 0)
+	{
+		int numRays = 0;
+		for (int k = 0; k < numActive; k++)
+		{
+			const int i = pathIndices[k];
+			if (maxPathVertices != -1 && paths[i].numPathVertices > maxPathVertices)
+			{
+				continue;
+			}
+
+			rays[numRays] = paths[i].ray;
+			pathIndices[numRays++] = i;
+		}
+
+		scene.IntersectBatch(&rays[0], &isects[0], hits.get(), numRays);
+
+		// Process intersected vertices and compact the list of active paths
+		numActive = 0;
+		for (int k = 0; k < numRays; k++)
+		{
+			const int i = pathIndices[k];
+			if (hits[k] && ProcessVertex(scene, isects[k], rrDepth, maxPathVertices, paths[i]))
+			{
+				pathIndices[numActive++] = i;
+			}
+		}
+	}
+
+	for (int i = 0; i < n; i++)
+	{
+		EndPath(paths[i]);
+	}
+}
+
+void PSSMLTPTPathSampler::BeginPath( const Scene& scene, Sampler& sampler, PSSMLTSplats& splats, PSSMLTPTPathState& path ) const
 {
 	// Clear result
+	path.sampler = &sampler;
+	path.splats = &splats;
 	splats.splats.clear();
 
 	// Raster position
-	auto rasterPos = sampler.NextVec2();
+	path.rasterPos = sampler.NextVec2();
 
 	// Sample position on camera
 	SurfaceGeometry geomE;
@@ -82,98 +226,93 @@ void PSSMLTPTPathSampler::SampleAndEvaluate( const Scene& scene, Sampler& sample
 	// Sample ray direction
 	GeneralizedBSDFSampleQuery bsdfSQ;
 	GeneralizedBSDFSampleResult bsdfSR;
-	bsdfSQ.sample = rasterPos;
+	bsdfSQ.sample = path.rasterPos;
 	bsdfSQ.transportDir = TransportDirection::EL;
 	bsdfSQ.type = GeneralizedBSDFType::EyeDirection;
 	auto We_Estimated = scene.MainCamera()->SampleAndEstimateDirection(bsdfSQ, geomE, bsdfSR);
 
 	// Construct initial ray
-	Ray ray;
-	ray.o = geomE.p;
-	ray.d = bsdfSR.wo;
-	ray.minT = Math::Float(0);
-	ray.maxT = Math::Constants::Inf();
+	path.ray.o = geomE.p;
+	path.ray.d = bsdfSR.wo;
+	path.ray.minT = Math::Float(0);
+	path.ray.maxT = Math::Constants::Inf();
+
+	path.throughput = We_Estimated;
+	path.L = Math::Vec3();
+	path.numPathVertices = 1;
+}
 
-	Math::Vec3 throughput = We_Estimated;
-	Math::Vec3 L;
-	int numPathVertices = 1;
+bool PSSMLTPTPathSampler::ProcessVertex( const Scene& scene, const Intersection& isect, int rrDepth, int maxPathVertices, PSSMLTPTPathState& path ) const
+{
+	auto& sampler = *path.sampler;
+	auto& ray = path.ray;
 
-	while (true)
+	const auto* light = isect.light;
+	if (light)
 	{
-		if (maxPathVertices != -1 && numPathVertices > maxPathVertices)
-		{
-			break;
-		}
-
-		// Check intersection
-		Intersection isect;
-		if (!scene.Intersect(ray, isect))
-		{
-			break;
-		}
-
-		const auto* light = isect.light;
-		if (light)
-		{
-			// Evaluate Le
-			GeneralizedBSDFEvaluateQuery bsdfEQ;
-			bsdfEQ.transportDir = TransportDirection::LE;
-			bsdfEQ.type = GeneralizedBSDFType::LightDirection;
-			bsdfEQ.wo = -ray.d;
-			auto LeD = light->EvaluateDirection(bsdfEQ, isect.geom);
-			auto LeP = light->EvaluatePosition(isect.geom);
-			L += throughput * LeD * LeP;
-		}
+		// Evaluate Le
+		GeneralizedBSDFEvaluateQuery bsdfEQ;
+		bsdfEQ.transportDir = TransportDirection::LE;
+		bsdfEQ.type = GeneralizedBSDFType::LightDirection;
+		bsdfEQ.wo = -ray.d;
+		auto LeD = light->EvaluateDirection(bsdfEQ, isect.geom);
+		auto LeP = light->EvaluatePosition(isect.geom);
+		path.L += path.throughput * LeD * LeP;
+	}
 
-		// --------------------------------------------------------------------------------
+	// --------------------------------------------------------------------------------
 
-		// Sample BSDF
-		GeneralizedBSDFSampleQuery bsdfSQ;
-		bsdfSQ.sample = sampler.NextVec2();
-		bsdfSQ.uComp = sampler.Next();
-		bsdfSQ.type = GeneralizedBSDFType::AllBSDF;
-		bsdfSQ.transportDir = TransportDirection::EL;
-		bsdfSQ.wi = -ray.d;
+	// Sample BSDF
+	GeneralizedBSDFSampleQuery bsdfSQ;
+	bsdfSQ.sample = sampler.NextVec2();
+	bsdfSQ.uComp = sampler.Next();
+	bsdfSQ.type = GeneralizedBSDFType::AllBSDF;
+	bsdfSQ.transportDir = TransportDirection::EL;
+	bsdfSQ.wi = -ray.d;
 
-		GeneralizedBSDFSampleResult bsdfSR;
-		auto fs_Estimated = isect.bsdf->SampleAndEstimateDirection(bsdfSQ, isect.geom, bsdfSR);
-		if (Math::IsZero(fs_Estimated))
-		{
-			break;
-		}
+	GeneralizedBSDFSampleResult bsdfSR;
+	auto fs_Estimated = isect.bsdf->SampleAndEstimateDirection(bsdfSQ, isect.geom, bsdfSR);
+	if (Math::IsZero(fs_Estimated))
+	{
+		return false;
+	}
 
-		// Update throughput
-		throughput *= fs_Estimated;
+	// Update throughput
+	path.throughput *= fs_Estimated;
 
-		// Setup next ray
-		ray.d = bsdfSR.wo;
-		ray.o = isect.geom.p;
-		ray.minT = Math::Constants::Eps();
-		ray.maxT = Math::Constants::Inf();
+	// Setup next ray
+	ray.d = bsdfSR.wo;
+	ray.o = isect.geom.p;
+	ray.minT = Math::Constants::Eps();
+	ray.maxT = Math::Constants::Inf();
 
-		// --------------------------------------------------------------------------------
+	// --------------------------------------------------------------------------------
 
-		if (numPathVertices >= rrDepth)
+	if (path.numPathVertices >= rrDepth)
+	{
+		// Russian roulette for path termination
+		Math::Float p = Math::Min(Math::Float(0.5), Math::Luminance(path.throughput));
+		if (sampler.Next() > p)
 		{
-			// Russian roulette for path termination
-			Math::Float p = Math::Min(Math::Float(0.5), Math::Luminance(throughput));
-			if (sampler.Next() > p)
-			{
-				break;
-			}
-
-			throughput /= p;
+			return false;
 		}
 
-		numPathVertices++;
+		path.throughput /= p;
+	}
 
-		if (maxPathVertices != -1 && numPathVertices >= maxPathVertices)
-		{
-			break;
-		}
+	path.numPathVertices++;
+
+	if (maxPathVertices != -1 && path.numPathVertices >= maxPathVertices)
+	{
+		return false;
 	}
 
-	splats.splats.emplace_back(rasterPos, L);
+	return true;
+}
+
+void PSSMLTPTPathSampler::EndPath( PSSMLTPTPathState& path ) const
+{
+	path.splats->splats.emplace_back(path.rasterPos, path.L);
 }
 
 void PSSMLTPTPathSampler::SampleAndEvaluateBidir( const Scene& scene, Sampler& subpathSamplerL, Sampler& subpathSamplerE, PSSMLTSplats& splats, int rrDepth, int maxDepth )
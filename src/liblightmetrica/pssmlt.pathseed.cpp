@@ -0,0 +1,71 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+#include <lightmetrica/pssmlt.pathseed.h>
+#include <lightmetrica/random.h>
+#include <lightmetrica/assert.h>
+
+LM_NAMESPACE_BEGIN
+
+void PSSMLTPathSeedReservoir::Initialize( size_t size )
+{
+	seeds.assign(size, PSSMLTPathSeed(-1, -1, Math::Float(0)));
+	sumI = Math::Float(0);
+	numCandidates = 0;
+	next = 0;
+}
+
+void PSSMLTPathSeedReservoir::Add( const PSSMLTPathSeed& candidate, Random& rng )
+{
+	numCandidates++;
+	sumI += candidate.I;
+
+	// Probability of the replacement for each slot
+	const double p = static_cast<double>(candidate.I) / static_cast<double>(sumI);
+	if (p >= 1)
+	{
+		std::fill(seeds.begin(), seeds.end(), candidate);
+		return;
+	}
+
+	// Enumerate the slots to be replaced by skipping
+	// geometrically distributed number of slots,
+	// which requires O(p * #seeds) operations in average
+	const double logQ = std::log1p(-p);
+	for (size_t i = 0; ; i++)
+	{
+		const double skip = std::floor(std::log(1.0 - static_cast<double>(rng.Next())) / logQ);
+		if (static_cast<double>(i) + skip >= static_cast<double>(seeds.size()))
+		{
+			break;
+		}
+
+		i += static_cast<size_t>(skip);
+		seeds[i] = candidate;
+	}
+}
+
+const PSSMLTPathSeed& PSSMLTPathSeedReservoir::Next()
+{
+	LM_ASSERT(!seeds.empty());
+	return seeds[next++ % seeds.size()];
+}
+
+LM_NAMESPACE_END
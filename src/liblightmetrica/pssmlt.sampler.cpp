@@ -23,23 +23,44 @@
 
 LM_NAMESPACE_BEGIN
 
-struct PSSMLTPrimarySample
+namespace
 {
-	PSSMLTPrimarySample(const Math::Float& value)
-		: value(value)
-		, modify(0)
-	{}
-
-	Math::Float value;		//!< Sample value
-	long long modify;		//!< Last modified time
-};
 
+	// Number of mutations evaluated at once in the lazy evaluation
+	const int MutationBatchSize = 64;
+
+}
+
+/*!
+	Default implementation of the primary sampler.
+	The primary samples are stored in preallocated flat arrays of values and
+	modified times (structure of arrays), which only grow if a path requires
+	more dimensions than the hint given by #Reserve.
+	The modified time of each sample serves as an epoch of the sample:
+	only the samples touched in the current mutation are saved
+	to the preallocated backup arrays and restored with #Reject.
+	The large step mutation replaces all the samples at once
+	with the random numbers generated in bulk, and
+	the lazy evaluation of the consecutive small step mutations
+	evaluates the kernels in batch.
+*/
 class PSSMLTPrimarySamplerImpl final : public PSSMLTPrimarySampler
 {
 public:
 
 	LM_COMPONENT_IMPL_DEF("default");
 
+public:
+
+	PSSMLTPrimarySamplerImpl()
+		: numDimensions(0)
+		, numTouched(0)
+		, numBackupAll(0)
+		, largeStepApplied(false)
+	{
+
+	}
+
 public:
 
 	virtual Sampler* Clone() const override
@@ -54,6 +75,7 @@ public:
 		largeStepTime = 0;
 		enableLargeStep = false;
 		currentIndex = 0;
+		ClearBackup();
 		rng->SetSeed(seed);
 	}
 
@@ -93,6 +115,14 @@ public:
 		largeStepTime = 0;
 		enableLargeStep = false;
 		currentIndex = 0;
+		numDimensions = 0;
+		ClearBackup();
+		mutationBuffer.resize(MutationBatchSize);
+	}
+
+	virtual void Reserve(int numDimensions) override
+	{
+		Grow(numDimensions);
 	}
 
 	virtual void Accept() override
@@ -104,21 +134,25 @@ public:
 		}
 
 		time++;
-		prevSamples.clear();
+		ClearBackup();
 		currentIndex = 0;
 	}
 
 	virtual void Reject() override
 	{
-		// Restore samples
-		for (auto& v : prevSamples)
+		// Restore samples replaced by the large step
+		std::copy(backupValues.begin(), backupValues.begin() + numBackupAll, values.begin());
+		std::copy(backupModify.begin(), backupModify.begin() + numBackupAll, modify.begin());
+
+		// Restore touched samples in the reverse order
+		for (int k = numTouched - 1; k >= 0; k--)
 		{
-			int i = std::get<0>(v);
-			auto& prevSample = std::get<1>(v);
-			u[i] = prevSample;
+			const int i = touchedIndices[k];
+			values[i] = touchedValues[k];
+			modify[i] = touchedModify[k];
 		}
 
-		prevSamples.clear();
+		ClearBackup();
 		currentIndex = 0;
 	}
 
@@ -147,11 +181,7 @@ public:
 
 	virtual void GetCurrentSampleState(std::vector<Math::Float>& samples) const override
 	{
-		samples.clear();
-		for (auto& sample : u)
-		{
-			samples.push_back(sample.value);
-		}
+		samples.assign(values.begin(), values.begin() + numDimensions);
 	}
 
 	virtual void GetCurrentSampleState(std::vector<Math::Float>& samples, int numSamples) override
@@ -159,9 +189,9 @@ public:
 		samples.clear();
 		for (int i = 0; i < numSamples; i++)
 		{
-			if (i < static_cast<int>(u.size()))
+			if (i < numDimensions)
 			{
-				samples.push_back(u[i].value);
+				samples.push_back(values[i]);
 			}
 			else
 			{
@@ -177,25 +207,40 @@ private:
 	Math::Float PrimarySample(int i)
 	{
 		// Not sampled yet
-		while (i >= static_cast<int>(u.size()))
+		if (i >= numDimensions)
 		{
-			u.emplace_back(rng->Next());
+			Grow(i + 1);
+			for (; numDimensions <= i; numDimensions++)
+			{
+				values[numDimensions] = rng->Next();
+				modify[numDimensions] = 0;
+			}
 		}
 
 		// If the modified time of the requested sample is not updated
 		// it requires the lazy evaluation of mutations.
-		if (u[i].modify < time)
+		if (modify[i] < time)
 		{
 			if (enableLargeStep)
 			{
 				// Large step case
 
-				// Save sample in order to restore previous state
-				prevSamples.emplace_back(i, u[i]);
+				// Replace all the current samples at once
+				if (!largeStepApplied)
+				{
+					LargeStep();
+				}
 
-				// Update the modified time and value
-				u[i].modify = time;
-				u[i].value = rng->Next();
+				// Samples appended after the replacement
+				if (modify[i] < time)
+				{
+					// Save sample in order to restore previous state
+					Backup(i);
+
+					// Update the modified time and value
+					modify[i] = time;
+					values[i] = rng->Next();
+				}
 			}
 			else
 			{
@@ -205,75 +250,156 @@ private:
 				// large step mutation, then update sample to the state.
 				// Note that there is no need to go back before largeStepTime
 				// because these samples are independent of the sample on largeStepTime.
-				if (u[i].modify < largeStepTime)
+				if (modify[i] < largeStepTime)
 				{
-					u[i].modify = largeStepTime;
-					u[i].value = rng->Next();
+					modify[i] = largeStepTime;
+					values[i] = rng->Next();
 				}
 
 				// Lazy evaluation of Mutate
-				while (u[i].modify < time - 1)
+				if (modify[i] < time - 1)
 				{
-					u[i].value = Mutate(u[i].value);
-					u[i].modify++;
+					values[i] = Mutate(values[i], time - 1 - modify[i]);
+					modify[i] = time - 1;
 				}
 
 				// Save state
-				prevSamples.emplace_back(i, u[i]);
+				Backup(i);
 
 				// Update the modified time and value
-				u[i].value = Mutate(u[i].value);
-				u[i].modify++;
+				values[i] = Mutate(values[i], 1);
+				modify[i]++;
 			}
 		}
 
-		return u[i].value;
+		return values[i];
+	}
+
+	/*!
+		Large step mutation for all the current samples.
+		The previous samples are saved at once and
+		the new samples are generated in bulk.
+	*/
+	void LargeStep()
+	{
+		largeStepApplied = true;
+		numBackupAll = numDimensions;
+		std::copy(values.begin(), values.begin() + numDimensions, backupValues.begin());
+		std::copy(modify.begin(), modify.begin() + numDimensions, backupModify.begin());
+		rng->Fill(values.data(), numDimensions);
+		std::fill(modify.begin(), modify.begin() + numDimensions, time);
 	}
 
-	Math::Float Mutate(const Math::Float& value)
+	/*!
+		Apply small step mutations.
+		Applies #n consecutive mutations to the value at once.
+		The offsets of the mutations are evaluated in batch
+		and accumulated before wrapping the value into [0, 1].
+		\param value Sample value.
+		\param n Number of mutations.
+		\return Mutated value.
+	*/
+	Math::Float Mutate(const Math::Float& value, long long n)
 	{
-		auto u = rng->Next();
-		bool positive = u < Math::Float(0.5);
+		double offset = 0;
+		auto* u = mutationBuffer.data();
+		while (n > 0)
+		{
+			const int m = static_cast<int>(std::min<long long>(n, MutationBatchSize));
+			rng->Fill(u, m);
 
-		// Convert to [0, 1]
-		u = positive ? u * Math::Float(2) : Math::Float(2) * (u - Math::Float(0.5)); 
+			// Evaluate the kernels
+			// The first half of [0, 1) is mapped to the positive direction
+			for (int k = 0; k < m; k++)
+			{
+				const bool positive = u[k] < Math::Float(0.5);
+				const auto v = positive ? u[k] * Math::Float(2) : Math::Float(2) * (u[k] - Math::Float(0.5));
+				u[k] = positive ? std::exp(logRatio * v) : -std::exp(logRatio * v);
+			}
 
-#if 1
-		auto dv = s2 * std::exp(logRatio * u);
-#else
-		auto dv = kernelSizeScale * s2 * std::exp(logRatio * u);
-#endif
+			for (int k = 0; k < m; k++)
+			{
+				offset += u[k];
+			}
 
-		Math::Float result = value;
-		if (positive)
-		{
-			result += dv;
-			if (result > Math::Float(1)) result -= Math::Float(1);
+			n -= m;
 		}
-		else
+
+		double result = static_cast<double>(value) + static_cast<double>(s2) * offset;
+		result -= std::floor(result);
+		return Math::Float(result);
+	}
+
+	/*!
+		Save the sample.
+		The saved sample is restored if the mutation is rejected.
+		\param i Index of the sample.
+	*/
+	void Backup(int i)
+	{
+		touchedIndices[numTouched] = i;
+		touchedValues[numTouched] = values[i];
+		touchedModify[numTouched] = modify[i];
+		numTouched++;
+	}
+
+	void ClearBackup()
+	{
+		numTouched = 0;
+		numBackupAll = 0;
+		largeStepApplied = false;
+	}
+
+	/*!
+		Grow the storage.
+		The capacity is doubled if it is not enough for #n samples.
+		\param n Required number of samples.
+	*/
+	void Grow(int n)
+	{
+		if (n <= static_cast<int>(values.size()))
 		{
-			result -= dv;
-			if (result < Math::Float(0)) result += Math::Float(1);
+			return;
 		}
 
-		return result;
+		const size_t size = std::max(static_cast<size_t>(n), values.size() * 2);
+		values.resize(size);
+		modify.resize(size);
+		backupValues.resize(size);
+		backupModify.resize(size);
+		touchedIndices.resize(size);
+		touchedValues.resize(size);
+		touchedModify.resize(size);
 	}
 
 public:
 
-	Math::Float s1, s2;													//!< Kernel size parameters
-	Math::Float logRatio;												//!< Temporary variable (for efficiency)
+	Math::Float s1, s2;								//!< Kernel size parameters
+	Math::Float logRatio;							//!< Temporary variable (for efficiency)
+
+	Random* rng;									//!< Current random number generator
+	std::unique_ptr<Random> managedRng;				//!< Managed instance of RNG
+
+	long long time;									//!< Number of accepted mutations
+	long long largeStepTime;						//!< Time of the last accepted large step
+	bool enableLargeStep;							//!< Indicates the next mutation is the large step
+
+	int currentIndex;								//!< Current sample index
+	int numDimensions;								//!< Number of current samples
+	std::vector<Math::Float> values;				//!< Values of current samples
+	std::vector<long long> modify;					//!< Last modified times of current samples
 
-	Random* rng;														//!< Current random number generator
-	std::unique_ptr<Random> managedRng;									//!< Managed instance of RNG
+	int numTouched;									//!< Number of samples saved by #Backup
+	std::vector<int> touchedIndices;				//!< Indices of saved samples
+	std::vector<Math::Float> touchedValues;			//!< Values of saved samples
+	std::vector<long long> touchedModify;			//!< Modified times of saved samples
 
-	long long time;														//!< Number of accepted mutations
-	long long largeStepTime;											//!< Time of the last accepted large step
-	bool enableLargeStep;												//!< Indicates the next mutation is the large step
+	int numBackupAll;								//!< Number of samples saved by the large step
+	bool largeStepApplied;							//!< True if the large step is applied in the current mutation
+	std::vector<Math::Float> backupValues;			//!< Values of the samples saved by the large step
+	std::vector<long long> backupModify;			//!< Modified times of the samples saved by the large step
 
-	int currentIndex;													//!< Current sample index
-	std::vector<PSSMLTPrimarySample> u;									//!< List of current samples
-	std::vector<std::tuple<int, PSSMLTPrimarySample>> prevSamples;		//!< Temporary list for preserving previous samples (restored if rejected)
+	std::vector<Math::Float> mutationBuffer;		//!< Temporary buffer for the batch evaluation of the mutations
 
 };
 
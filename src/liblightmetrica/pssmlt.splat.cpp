@@ -34,9 +34,9 @@ Math::Float PSSMLTSplats::SumI() const
 
 void PSSMLTSplats::AccumulateContributionToFilm( Film& film, const Math::Float& weight ) const
 {
-	for (auto& splat : splats)
+	if (!splats.empty())
 	{
-		film.AccumulateContribution(splat.rasterPos, splat.L * weight);
+		film.AccumulateContributions(&splats[0], splats.size(), weight);
 	}
 }
 
@@ -30,6 +30,8 @@ LM_NAMESPACE_BEGIN
 	Random sampler.
 	A sampler implementation with simple random number generation.
 	This implementation simply routes random number generator.
+	Numbers are generated by blocks with Random::FillUInt and buffered
+	in order to avoid a virtual function call of the generator per number.
 */
 class RandomSampler final : public ConfigurableSampler
 {
@@ -59,7 +61,7 @@ public:
 		
 		// Create random number generator
 		rng.reset(ComponentFactory::Create<Random>(rngType));
-		rng->SetSeed(initialSeed);
+		SetSeed(initialSeed);
 
 		return true;
 	}
@@ -76,21 +78,24 @@ public:
 	{
 		initialSeed = seed;
 		rng->SetSeed(initialSeed);
+		pos = BufferSize;
 	}
 
 	virtual Math::Float Next() override
 	{
-		return rng->Next();
+		return Math::Float(NextBuffered() * (1.0/4294967296.0));
 	}
 
 	virtual unsigned int NextUInt() override
 	{
-		return rng->NextUInt();
+		return NextBuffered();
 	}
 
 	virtual Math::Vec2 NextVec2() override
 	{
-		return rng->NextVec2();
+		auto u1 = Next();
+		auto u2 = Next();
+		return Math::Vec2(u1, u2);
 	}
 
 	virtual Random* Rng() override
@@ -100,8 +105,24 @@ public:
 
 private:
 
+	LM_FORCE_INLINE unsigned int NextBuffered()
+	{
+		if (pos == BufferSize)
+		{
+			rng->FillUInt(buffer, BufferSize);
+			pos = 0;
+		}
+		return buffer[pos++];
+	}
+
+private:
+
+	static const size_t BufferSize = 256;
+
 	std::unique_ptr<Random> rng;
 	int initialSeed;
+	unsigned int buffer[BufferSize];	// Generated numbers
+	size_t pos;							// Position of the next number in #buffer
 
 };
 
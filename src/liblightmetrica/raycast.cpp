@@ -81,6 +81,11 @@ private:
 public:
 
 	virtual void ProcessSinglePixel(const Scene& scene, const Math::Vec2i& pixel) override;
+	virtual void ProcessTile(const Scene& scene, const Math::Vec2i& begin, const Math::Vec2i& end) override;
+
+private:
+
+	void ProcessPixel(const Scene& scene, const SurfaceGeometry& geomE, const Math::Vec2i& pixel) const;
 
 };
 
@@ -94,6 +99,32 @@ RenderProcess* RaycastRenderer::CreateRenderProcess(const Scene& scene, int thre
 // --------------------------------------------------------------------------------
 
 void RaycastRenderer_RenderProcess::ProcessSinglePixel(const Scene& scene, const Math::Vec2i& pixel)
+{
+	// Note : position sampling is not used here (thus DoF is disabled)
+	SurfaceGeometry geomE;
+	Math::PDFEval pdfPE;
+	scene.MainCamera()->SamplePosition(Math::Vec2(), geomE, pdfPE);
+	ProcessPixel(scene, geomE, pixel);
+}
+
+void RaycastRenderer_RenderProcess::ProcessTile(const Scene& scene, const Math::Vec2i& begin, const Math::Vec2i& end)
+{
+	// Camera position is shared among the primary rays in the tile,
+	// so the rays are traced in succession with the same origin.
+	SurfaceGeometry geomE;
+	Math::PDFEval pdfPE;
+	scene.MainCamera()->SamplePosition(Math::Vec2(), geomE, pdfPE);
+
+	for (int y = begin.y; y < end.y; y++)
+	{
+		for (int x = begin.x; x < end.x; x++)
+		{
+			ProcessPixel(scene, geomE, Math::Vec2i(x, y));
+		}
+	}
+}
+
+void RaycastRenderer_RenderProcess::ProcessPixel(const Scene& scene, const SurfaceGeometry& geomE, const Math::Vec2i& pixel) const
 {
 	auto* film = scene.MainCamera()->GetFilm();
 
@@ -103,11 +134,6 @@ void RaycastRenderer_RenderProcess::ProcessSinglePixel(const Scene& scene, const
 		(Math::Float(0.5) + Math::Float(pixel.y)) / Math::Float(film->Height()));
 
 	// Generate ray
-	// Note : position sampling is not used here (thus DoF is disabled)
-	SurfaceGeometry geomE;
-	Math::PDFEval pdfPE, pdfDE;
-	scene.MainCamera()->SamplePosition(Math::Vec2(), geomE, pdfPE);
-
 	GeneralizedBSDFSampleQuery bsdfSQ;
 	GeneralizedBSDFSampleResult bsdfSR;
 	bsdfSQ.sample = rasterPos;
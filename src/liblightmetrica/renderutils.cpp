@@ -23,6 +23,8 @@
 #include <lightmetrica/ray.h>
 #include <lightmetrica/intersection.h>
 #include <lightmetrica/scene.h>
+#include <lightmetrica/sampler.h>
+#include <lightmetrica/film.h>
 
 LM_NAMESPACE_BEGIN
 
@@ -79,4 +81,34 @@ Math::Float RenderUtils::GeneralizedGeometryTermWithVisibility( const Scene& sce
 	return GeneralizedGeometryTerm(geom1, geom2);
 }
 
+Math::Vec2 RenderUtils::BeginSample( Sampler& sampler, const Film& film, long long sampleIndex )
+{
+	if (!sampler.RequiresSampleIndex())
+	{
+		return sampler.NextVec2();
+	}
+
+	// Assign pixels in round-robin order
+	const long long width = film.Width();
+	const long long numPixels = width * film.Height();
+	const long long pixel = sampleIndex % numPixels;
+	sampler.BeginSample(pixel, sampleIndex / numPixels);
+
+	// Jitter inside the pixel
+	auto u = sampler.NextVec2();
+	return Math::Vec2(
+		(Math::Float(pixel % width) + u.x) / Math::Float(film.Width()),
+		(Math::Float(pixel / width) + u.y) / Math::Float(film.Height()));
+}
+
+Math::Float RenderUtils::ProgressiveRadius2( Math::Float radius2, Math::Float initialRadius, Math::Float alpha, long long iteration )
+{
+	if (iteration == 0)
+	{
+		return initialRadius * initialRadius;
+	}
+
+	return radius2 * (Math::Float(iteration) + alpha) / Math::Float(iteration + 1);
+}
+
 LM_NAMESPACE_END
\ No newline at end of file
@@ -74,22 +74,15 @@ public:
 		this->rng.reset(rng);
 	}
 
-	virtual void Rewind(int index) override
+	virtual void Rewind(long long index) override
 	{
-		// Reset the initial seed
-		currentIndex = 0;
+		// Reset the initial seed and skip samples until the given index
 		rng->SetSeed(initialSeed);
-
-		// Generate samples until the given index
-		while (currentIndex < index)
-		{
-			// Discard the value
-			currentIndex++;
-			rng->Next();
-		}
+		rng->Skip(static_cast<unsigned long long>(index));
+		currentIndex = index;
 	}
 
-	virtual int SampleIndex() const override
+	virtual long long SampleIndex() const override
 	{
 		return currentIndex;
 	}
@@ -98,7 +91,7 @@ private:
 	
 	unsigned int initialSeed;		// Initial seed
 	std::unique_ptr<Random> rng;	// Random number generator
-	int currentIndex;				// Number of generated samples
+	long long currentIndex;			// Number of generated samples
 
 };
 
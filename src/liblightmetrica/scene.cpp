@@ -26,10 +26,14 @@
 #include <lightmetrica/primitive.h>
 #include <lightmetrica/primitives.h>
 #include <lightmetrica/camera.h>
+#include <lightmetrica/light.h>
+#include <lightmetrica/lightselector.h>
+#include <lightmetrica/logger.h>
 
 LM_NAMESPACE_BEGIN
 
 Scene::Scene()
+	: lightSelector(ComponentFactory::Create<LightSelector>("uniform"))
 {
 
 }
@@ -42,6 +46,16 @@ Scene::~Scene()
 void Scene::Load( Primitives* primitives )
 {
 	this->primitives.reset(primitives);
+	BuildLightSelector();
+}
+
+void Scene::LoadLightSelector( LightSelector* lightSelector )
+{
+	this->lightSelector.reset(lightSelector);
+	if (primitives != nullptr)
+	{
+		BuildLightSelector();
+	}
 }
 
 bool Scene::PostConfigure()
@@ -52,6 +66,38 @@ bool Scene::PostConfigure()
 		return false;
 	}
 
+	// Rebuild light selector
+	// Note that the power of some lights are determined in the post configuration
+	return BuildLightSelector();
+}
+
+bool Scene::BuildLightSelector()
+{
+	if (lightSelector == nullptr)
+	{
+		LM_LOG_ERROR("Invalid light selector");
+		return false;
+	}
+
+	std::vector<const Light*> lights;
+	for (int i = 0; i < primitives->NumLights(); i++)
+	{
+		const auto* light = primitives->LightByIndex(i);
+		if (light->LightIndex() != i)
+		{
+			LM_LOG_ERROR("Invalid light index");
+			return false;
+		}
+
+		lights.push_back(light);
+	}
+
+	if (!lightSelector->Build(lights))
+	{
+		LM_LOG_ERROR("Failed to build light selector");
+		return false;
+	}
+
 	return true;
 }
 
@@ -71,6 +117,45 @@ bool Scene::Intersect( Ray& ray, Intersection& isect ) const
 	return isectT || primitives->IntersectEmitterShapes(ray, isect);
 }
 
+void Scene::IntersectBatch( Ray* rays, Intersection* isects, bool* hits, int n ) const
+{
+	IntersectTrianglesBatch(rays, isects, hits, n);
+	for (int i = 0; i < n; i++)
+	{
+		hits[i] = hits[i] || primitives->IntersectEmitterShapes(rays[i], isects[i]);
+	}
+}
+
+void Scene::IntersectTrianglesBatch( Ray* rays, Intersection* isects, bool* hits, int n ) const
+{
+	for (int i = 0; i < n; i++)
+	{
+		hits[i] = IntersectTriangles(rays[i], isects[i]);
+	}
+}
+
+void Scene::OccludedBatch( Ray* rays, bool* occluded, int n ) const
+{
+	OccludedTrianglesBatch(rays, occluded, n);
+	for (int i = 0; i < n; i++)
+	{
+		if (!occluded[i])
+		{
+			Intersection isect;
+			occluded[i] = primitives->IntersectEmitterShapes(rays[i], isect);
+		}
+	}
+}
+
+void Scene::OccludedTrianglesBatch( Ray* rays, bool* occluded, int n ) const
+{
+	Intersection isect;
+	for (int i = 0; i < n; i++)
+	{
+		occluded[i] = IntersectTriangles(rays[i], isect);
+	}
+}
+
 const Camera* Scene::MainCamera() const
 {
 	return primitives->MainCamera();
@@ -78,24 +163,31 @@ const Camera* Scene::MainCamera() const
 
 const Light* Scene::SampleLightSelection( Math::Vec2& lightSampleP, Math::PDFEval& selectionPdf ) const
 {
-	int nl = primitives->NumLights();
-	int li = Math::Min(static_cast<int>(lightSampleP.x * nl), nl - 1);
-	lightSampleP.x = lightSampleP.x * nl - Math::Float(li);
-	selectionPdf = Math::PDFEval(Math::Float(1) / Math::Float(nl), Math::ProbabilityMeasure::Discrete);
+	int li = lightSelector->Sample(nullptr, lightSampleP.x, selectionPdf);
+	return primitives->LightByIndex(li);
+}
+
+const Light* Scene::SampleLightSelection( const Math::Vec3& p, Math::Vec2& lightSampleP, Math::PDFEval& selectionPdf ) const
+{
+	int li = lightSelector->Sample(&p, lightSampleP.x, selectionPdf);
 	return primitives->LightByIndex(li);
 }
 
 const Light* Scene::SampleLightSelection( const Math::Float& lightSample, Math::PDFEval& selectionPdf ) const
 {
-	int nl = primitives->NumLights();
-	int li = Math::Min(static_cast<int>(lightSample * nl), nl - 1);
-	selectionPdf = Math::PDFEval(Math::Float(1) / Math::Float(nl), Math::ProbabilityMeasure::Discrete);
+	auto u = lightSample;
+	int li = lightSelector->Sample(nullptr, u, selectionPdf);
 	return primitives->LightByIndex(li);
 }
 
-Math::PDFEval Scene::LightSelectionPdf() const
+Math::PDFEval Scene::LightSelectionPdf( const Light* light ) const
 {
-	return Math::PDFEval(Math::Float(1) / Math::Float(primitives->NumLights()), Math::ProbabilityMeasure::Discrete);
+	return lightSelector->EvaluatePdf(nullptr, light->LightIndex());
+}
+
+Math::PDFEval Scene::LightSelectionPdf( const Math::Vec3& p, const Light* light ) const
+{
+	return lightSelector->EvaluatePdf(&p, light->LightIndex());
 }
 
 void Scene::StoreIntersectionFromBarycentricCoords( unsigned int primitiveIndex, unsigned int triangleIndex, const Ray& ray, const Math::Vec2& b, Intersection& isect ) const
@@ -139,6 +231,18 @@ void Scene::StoreIntersectionFromBarycentricCoords( unsigned int primitiveIndex,
 		Math::Vec2 uv2(texcoords[2*v2], texcoords[2*v2+1]);
 		Math::Vec2 uv3(texcoords[2*v3], texcoords[2*v3+1]);
 		isect.geom.uv = uv1 * Math::Float(Math::Float(1) - b[0] - b[1]) + uv2 * b[0] + uv3 * b[1];
+
+		// Partial derivatives w.r.t. texture coordinates
+		// Utilized for the computation of the footprint of ray differentials
+		auto duv13 = uv1 - uv3;
+		auto duv23 = uv2 - uv3;
+		auto det = duv13.x * duv23.y - duv13.y * duv23.x;
+		if (!Math::IsZero(det))
+		{
+			auto invDet = Math::Float(1) / det;
+			isect.geom.dpdu = ((p1 - p3) * duv23.y - (p2 - p3) * duv13.y) * invDet;
+			isect.geom.dpdv = ((p2 - p3) * duv13.x - (p1 - p3) * duv23.x) * invDet;
+		}
 	}
 
 	// Scene surface is not degenerated
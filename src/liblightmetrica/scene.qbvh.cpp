@@ -20,6 +20,7 @@
 #include "pch.h"
 #include "simdsupport.h"
 #include <lightmetrica/scene.h>
+#include <lightmetrica/intersection.h>
 #include <lightmetrica/logger.h>
 #include <lightmetrica/triaccel.h>
 #include <lightmetrica/primitive.h>
@@ -29,6 +30,8 @@
 #include <lightmetrica/align.h>
 #include <lightmetrica/triangleref.h>
 #include <lightmetrica/confignode.h>
+#include <lightmetrica/numa.h>
+#include <thread>
 
 LM_NAMESPACE_BEGIN
 
@@ -42,6 +45,8 @@ struct LM_ALIGN_16 Ray4
 	__m128 dx, dy, dz;
 	__m128 minT, maxT;
 
+	LM_FORCE_INLINE Ray4() {}
+
 	LM_FORCE_INLINE Ray4(const Ray& ray)
 	{
 		ox = _mm_set1_ps(ray.o.x);
@@ -327,6 +332,53 @@ enum class QBVHIntersectionMode
 	Triaccel		// Use Triaccels quad triangles for ray-triangle intersection query
 };
 
+/*
+	Read-only data used in the traversal.
+	Points to either the original data or the copy placed on a NUMA node.
+*/
+struct QBVHTraversalData
+{
+
+	QBVHNode* const* nodes;
+	QuadTriangle* const* quadTris;
+	const TriAccel* triAccels;
+
+	void* memory;			// Memory allocated for the replica (nullptr for the original data)
+	size_t memorySize;
+
+};
+
+/*
+	State of the traversal of a ray.
+	Separated from the traversal loop in order to
+	interleave the traversals of multiple rays.
+*/
+struct LM_ALIGN_16 QBVHTraversalState
+{
+
+	// Stack size for traversal
+	static const int StackSize = 64;
+
+	Ray4 ray4;
+	__m128 invRayDirMinT[3];
+	__m128 invRayDirMaxT[3];
+	int rayDirSign[3];
+
+	// Stack for traversal
+	// Note : do not use dynamic allocation (like std::vector)
+	int stack[StackSize];
+	int stackIndex;
+
+	bool intersected;
+	unsigned int intersectedTriIndex;
+	unsigned int intersectedQuadOffset;		// Only for IntersectionMode::SSE
+	Math::Vec2 intersectedTriB;
+
+};
+
+// Number of rays traversed simultaneously in the batched queries
+const int QBVHTraversalBatchSize = 16;
+
 // --------------------------------------------------------------------------------
 
 /*!
@@ -353,6 +405,8 @@ public:
 
 	virtual bool Build() override;
 	virtual bool IntersectTriangles(Ray& ray, Intersection& isect) const override;
+	virtual void IntersectTrianglesBatch(Ray* rays, Intersection* isects, bool* hits, int n) const override;
+	virtual void OccludedTrianglesBatch(Ray* rays, bool* occluded, int n) const override;
 	virtual AABB GetAABBTriangles() const override { return aabbTris; }
 	virtual boost::signals2::connection Connect_ReportBuildProgress(const std::function<void(double, bool) >& func) override { return signal_ReportBuildProgress.connect(func); }
 	virtual bool Configure(const ConfigNode& node) override;
@@ -384,6 +438,33 @@ private:
 	void CreateLeafNode(unsigned int begin, unsigned int end, int parent, int child, const AABB& bound);
 	void CreateIntermediateNode(int parent, int child, const AABB& bound, unsigned int& createdNodeIndex);
 
+	/*
+		Create a copy of the traversal data on the NUMA node.
+		The function must be called from a thread bound to the node.
+	*/
+	QBVHTraversalData CreateReplica(int node) const;
+
+	/*
+		Select the traversal data.
+		Returns the replica on the local NUMA node if available.
+	*/
+	QBVHTraversalData CurrentTraversalData() const;
+
+	/*
+		Functions for the traversal.
+		#TraversalStep processes a node on the top of the stack,
+		which is repeated until the stack is empty.
+	*/
+	void BeginTraversal(const Ray& ray, QBVHTraversalState& state) const;
+	void TraversalStep(const QBVHTraversalData& data, Ray& ray, QBVHTraversalState& state) const;
+	bool EndTraversal(const QBVHTraversalData& data, const Ray& ray, const QBVHTraversalState& state, Intersection& isect) const;
+
+	/*
+		Interleaved traversals of #m rays.
+		If #anyHit is true, the traversal of a ray is terminated on the first hit.
+	*/
+	void TraversalBatch(const QBVHTraversalData& data, Ray* rays, QBVHTraversalState* states, int m, bool anyHit) const;
+
 private:
 
 	boost::signals2::signal<void (double, bool)> signal_ReportBuildProgress;
@@ -399,10 +480,14 @@ private:
 	std::vector<unsigned int> triIndices;	// List of triangle indices. The list is rearranged through build process.
 	std::vector<QBVHNode*> nodes;			// List of QBVH nodes
 
+	bool numaReplication;					// Replicates traversal data for each NUMA node if true
+	std::vector<QBVHTraversalData> replicas;	// Replicated traversal data indexed by NUMA node
+
 };
 
 QBVHScene::~QBVHScene()
 {
+	for (auto& replica : replicas) NUMAUtils::Free(replica.memory, replica.memorySize);
 	for (auto* node : nodes)	LM_SAFE_DELETE(node);
 	for (auto* quad : quadTris)	LM_SAFE_DELETE(quad);
 	triRefs.clear();
@@ -447,6 +532,8 @@ bool QBVHScene::Configure( const ConfigNode& node )
 		maxElementsInLeaf = 16;
 	}
 
+	node.ChildValueOrDefault("numa_replication", false, numaReplication);
+
 	return true;
 }
 
@@ -515,6 +602,35 @@ bool QBVHScene::Build()
 		LM_LOG_INFO("Completed in " + std::to_string(elapsed) + " seconds");
 	}
 
+	// Replicate traversal data for each NUMA node
+	// Threads bound to a node by the render process scheduler uses the local copy
+	if (numaReplication && NUMAUtils::NumNodes() > 1)
+	{
+		LM_LOG_INFO(boost::str(boost::format("Replicating QBVH for %d NUMA nodes") % NUMAUtils::NumNodes()));
+		LM_LOG_INDENTER();
+
+		replicas.resize(NUMAUtils::NumNodes());
+		std::vector<std::thread> threads;
+		for (int node = 0; node < NUMAUtils::NumNodes(); node++)
+		{
+			threads.emplace_back([this, node]()
+			{
+				// Copy in a thread bound to the node for the first-touch policy
+				const auto cpus = NUMAUtils::NodeCPUs(node);
+				if (cpus.empty() || !NUMAUtils::BindCurrentThread(cpus.front()))
+				{
+					replicas[node] = QBVHTraversalData{ nodes.data(), quadTris.data(), triAccels.data(), nullptr, 0 };
+					return;
+				}
+				replicas[node] = CreateReplica(node);
+			});
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
 	signal_ReportBuildProgress(1, true);
 
 	return true;
@@ -834,15 +950,74 @@ void QBVHScene::CreateIntermediateNode( int parent, int child, const AABB& bound
 	}
 }
 
-bool QBVHScene::IntersectTriangles( Ray& ray, Intersection& isect ) const
+QBVHTraversalData QBVHScene::CreateReplica( int node ) const
 {
-	bool intersected = false;
-	unsigned int intersectedTriIndex = 0;
-	unsigned int intersectedQuadOffset = 0;		// Only for IntersectionMode::SSE
-	Math::Vec2 intersectedTriB;
+	// Memory layout : [node pointers][quad pointers][nodes][quads][triaccels]
+	// Every section is aligned to 64 bytes (note that QBVHNode and QuadTriangle requires 16 bytes alignment)
+	const auto Align = [](size_t size) { return (size + 63) & ~static_cast<size_t>(63); };
+	const size_t nodePtrsOffset = 0;
+	const size_t quadPtrsOffset = nodePtrsOffset + Align(sizeof(QBVHNode*) * nodes.size());
+	const size_t nodesOffset = quadPtrsOffset + Align(sizeof(QuadTriangle*) * quadTris.size());
+	const size_t quadsOffset = nodesOffset + Align(sizeof(QBVHNode) * nodes.size());
+	const size_t triAccelsOffset = quadsOffset + Align(sizeof(QuadTriangle) * quadTris.size());
+	const size_t size = triAccelsOffset + Align(sizeof(TriAccel) * triAccels.size());
+
+	QBVHTraversalData replica;
+	replica.memory = NUMAUtils::Allocate(size, node);
+	replica.memorySize = size;
+
+	auto* memory = static_cast<unsigned char*>(replica.memory);
+	auto** nodePtrs = reinterpret_cast<QBVHNode**>(memory + nodePtrsOffset);
+	auto** quadPtrs = reinterpret_cast<QuadTriangle**>(memory + quadPtrsOffset);
+	auto* nodesCopy = reinterpret_cast<QBVHNode*>(memory + nodesOffset);
+	auto* quadsCopy = reinterpret_cast<QuadTriangle*>(memory + quadsOffset);
+	auto* triAccelsCopy = reinterpret_cast<TriAccel*>(memory + triAccelsOffset);
+
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		nodePtrs[i] = new (nodesCopy + i) QBVHNode(*nodes[i]);
+	}
+	for (size_t i = 0; i < quadTris.size(); i++)
+	{
+		quadPtrs[i] = new (quadsCopy + i) QuadTriangle(*quadTris[i]);
+	}
+	std::uninitialized_copy(triAccels.begin(), triAccels.end(), triAccelsCopy);
+
+	replica.nodes = nodePtrs;
+	replica.quadTris = quadPtrs;
+	replica.triAccels = triAccelsCopy;
+
+	return replica;
+}
+
+QBVHTraversalData QBVHScene::CurrentTraversalData() const
+{
+	if (!replicas.empty())
+	{
+		int node = NUMAUtils::CurrentThreadNode();
+		if (node >= 0)
+		{
+			return replicas[node];
+		}
+	}
+
+	QBVHTraversalData data;
+	data.nodes = nodes.data();
+	data.quadTris = quadTris.data();
+	data.triAccels = triAccels.data();
+	data.memory = nullptr;
+	data.memorySize = 0;
+	return data;
+}
+
+LM_FORCE_INLINE void QBVHScene::BeginTraversal( const Ray& ray, QBVHTraversalState& state ) const
+{
+	state.intersected = false;
+	state.intersectedTriIndex = 0;
+	state.intersectedQuadOffset = 0;
 
 	// Some required data for intersection query
-	Ray4 ray4(ray);
+	state.ray4 = Ray4(ray);
 
 #if 0
 	const __m128 Zero = _mm_setzero_ps();
@@ -857,100 +1032,95 @@ bool QBVHScene::IntersectTriangles( Ray& ray, Intersection& isect ) const
 	invRayDirZeroMask[1] = _mm_cmpeq_ps(Zero, invRayDir[1]);
 	invRayDirZeroMask[2] = _mm_cmpeq_ps(Zero, invRayDir[2]);
 #else
-	__m128 invRayDirMinT[3], invRayDirMaxT[3];
-	invRayDirMinT[0] = _mm_set1_ps(Math::IsZero(ray.d.x) ? Math::Constants::Eps() : Math::Float(1) / ray.d.x);
-	invRayDirMinT[1] = _mm_set1_ps(Math::IsZero(ray.d.y) ? Math::Constants::Eps() : Math::Float(1) / ray.d.y);
-	invRayDirMinT[2] = _mm_set1_ps(Math::IsZero(ray.d.z) ? Math::Constants::Eps() : Math::Float(1) / ray.d.z);
-	invRayDirMaxT[0] = _mm_set1_ps(Math::IsZero(ray.d.x) ? Math::Constants::Inf() : Math::Float(1) / ray.d.x);
-	invRayDirMaxT[1] = _mm_set1_ps(Math::IsZero(ray.d.y) ? Math::Constants::Inf() : Math::Float(1) / ray.d.y);
-	invRayDirMaxT[2] = _mm_set1_ps(Math::IsZero(ray.d.z) ? Math::Constants::Inf() : Math::Float(1) / ray.d.z);
+	state.invRayDirMinT[0] = _mm_set1_ps(Math::IsZero(ray.d.x) ? Math::Constants::Eps() : Math::Float(1) / ray.d.x);
+	state.invRayDirMinT[1] = _mm_set1_ps(Math::IsZero(ray.d.y) ? Math::Constants::Eps() : Math::Float(1) / ray.d.y);
+	state.invRayDirMinT[2] = _mm_set1_ps(Math::IsZero(ray.d.z) ? Math::Constants::Eps() : Math::Float(1) / ray.d.z);
+	state.invRayDirMaxT[0] = _mm_set1_ps(Math::IsZero(ray.d.x) ? Math::Constants::Inf() : Math::Float(1) / ray.d.x);
+	state.invRayDirMaxT[1] = _mm_set1_ps(Math::IsZero(ray.d.y) ? Math::Constants::Inf() : Math::Float(1) / ray.d.y);
+	state.invRayDirMaxT[2] = _mm_set1_ps(Math::IsZero(ray.d.z) ? Math::Constants::Inf() : Math::Float(1) / ray.d.z);
 #endif
 
-	int rayDirSign[3];
-	rayDirSign[0] = ray.d.x < 0.0f;
-	rayDirSign[1] = ray.d.y < 0.0f;
-	rayDirSign[2] = ray.d.z < 0.0f;
-
-	// Stack for traversal
-	// Note : do not use dynamic allocation (like std::vector)
-	const int StackSize = 64;
-	int stack[StackSize];
-	int stackIndex = 0;
+	state.rayDirSign[0] = ray.d.x < 0.0f;
+	state.rayDirSign[1] = ray.d.y < 0.0f;
+	state.rayDirSign[2] = ray.d.z < 0.0f;
 
 	// Initial state
-	stack[0] = 0;
+	state.stack[0] = 0;
+	state.stackIndex = 0;
+}
 
-	// Depth first traversal of QBVH
-	while (stackIndex >= 0)
+LM_FORCE_INLINE void QBVHScene::TraversalStep( const QBVHTraversalData& data, Ray& ray, QBVHTraversalState& state ) const
+{
+	int d = state.stack[state.stackIndex--];
+	if (d < 0)
 	{
-		int data = stack[stackIndex--];
-		if (data < 0)
+		// Leaf node
+		
+		// If the node is empty, ignore it
+		if (d == QBVHNode::EmptyLeafNode)
 		{
-			// Leaf node
-			
-			// If the node is empty, ignore it
-			if (data == QBVHNode::EmptyLeafNode)
-			{
-				continue;
-			}
+			return;
+		}
 
-			// Intersection
-			unsigned int size, offset;
-			QBVHNode::ExtractLeafData(data, size, offset);
-			for (unsigned int i = offset; i < offset + size; i++)
+		// Intersection
+		unsigned int size, offset;
+		QBVHNode::ExtractLeafData(d, size, offset);
+		for (unsigned int i = offset; i < offset + size; i++)
+		{
+			if (mode == QBVHIntersectionMode::SSE)
 			{
-				if (mode == QBVHIntersectionMode::SSE)
+				Math::Vec2 b;
+				unsigned int quadOffset;
+				if (data.quadTris[i]->Intersect(state.ray4, ray, b, quadOffset))
 				{
-					Math::Vec2 b;
-					unsigned int quadOffset;
-					if (quadTris[i]->Intersect(ray4, ray, b, quadOffset))
-					{
-						intersectedTriIndex = i;
-						intersectedQuadOffset = quadOffset;
-						intersectedTriB = b;
-						intersected = true;
-					}
+					state.intersectedTriIndex = i;
+					state.intersectedQuadOffset = quadOffset;
+					state.intersectedTriB = b;
+					state.intersected = true;
 				}
-				else if (mode == QBVHIntersectionMode::Triaccel)
+			}
+			else if (mode == QBVHIntersectionMode::Triaccel)
+			{
+				Math::Float t;
+				Math::Vec2 b;
+				if (data.triAccels[i].Intersect(ray, ray.minT, ray.maxT, b[0], b[1], t))
 				{
-					Math::Float t;
-					Math::Vec2 b;
-					if (triAccels[i].Intersect(ray, ray.minT, ray.maxT, b[0], b[1], t))
-					{
-						ray.maxT = t;
-						intersectedTriIndex = i;
-						intersectedTriB = b;
-						intersected = true;
-					}
+					ray.maxT = t;
+					state.intersectedTriIndex = i;
+					state.intersectedTriB = b;
+					state.intersected = true;
 				}
 			}
 		}
-		else
-		{
-			// Intermediate node
-			// Check intersection to 4 bounds simultaneously
-			auto* node = nodes[data];
-			int mask = node->Intersect(ray4, invRayDirMinT, invRayDirMaxT, rayDirSign);
-			if (mask & 0x1) stack[++stackIndex] = node->children[0];
-			if (mask & 0x2) stack[++stackIndex] = node->children[1];
-			if (mask & 0x4) stack[++stackIndex] = node->children[2];
-			if (mask & 0x8) stack[++stackIndex] = node->children[3];
-		}
 	}
+	else
+	{
+		// Intermediate node
+		// Check intersection to 4 bounds simultaneously
+		auto* node = data.nodes[d];
+		int mask = node->Intersect(state.ray4, state.invRayDirMinT, state.invRayDirMaxT, state.rayDirSign);
+		if (mask & 0x1) state.stack[++state.stackIndex] = node->children[0];
+		if (mask & 0x2) state.stack[++state.stackIndex] = node->children[1];
+		if (mask & 0x4) state.stack[++state.stackIndex] = node->children[2];
+		if (mask & 0x8) state.stack[++state.stackIndex] = node->children[3];
+	}
+}
 
-	if (intersected)
+LM_FORCE_INLINE bool QBVHScene::EndTraversal( const QBVHTraversalData& data, const Ray& ray, const QBVHTraversalState& state, Intersection& isect ) const
+{
+	if (state.intersected)
 	{
 		// Store some information to the intersection structure
 		if (mode == QBVHIntersectionMode::SSE)
 		{
-			auto* quad = quadTris[intersectedTriIndex];
-			auto& triRef = triRefs[quad->triRefIndex[intersectedQuadOffset]];
-			StoreIntersectionFromBarycentricCoords(triRef.primitiveIndex, triRef.faceIndex, ray, intersectedTriB, isect);
+			auto* quad = data.quadTris[state.intersectedTriIndex];
+			auto& triRef = triRefs[quad->triRefIndex[state.intersectedQuadOffset]];
+			StoreIntersectionFromBarycentricCoords(triRef.primitiveIndex, triRef.faceIndex, ray, state.intersectedTriB, isect);
 		}
 		else if (mode == QBVHIntersectionMode::Triaccel)
 		{
-			auto& triAccel = triAccels[intersectedTriIndex];
-			StoreIntersectionFromBarycentricCoords(triAccel.primIndex, triAccel.shapeIndex, ray, intersectedTriB, isect);
+			auto& triAccel = data.triAccels[state.intersectedTriIndex];
+			StoreIntersectionFromBarycentricCoords(triAccel.primIndex, triAccel.shapeIndex, ray, state.intersectedTriB, isect);
 		}
 
 		return true;
@@ -959,6 +1129,106 @@ bool QBVHScene::IntersectTriangles( Ray& ray, Intersection& isect ) const
 	return false;
 }
 
+bool QBVHScene::IntersectTriangles( Ray& ray, Intersection& isect ) const
+{
+	// Select traversal data
+	// Use the replica on the local NUMA node if available
+	const auto data = CurrentTraversalData();
+
+	// Depth first traversal of QBVH
+	QBVHTraversalState state;
+	BeginTraversal(ray, state);
+	while (state.stackIndex >= 0)
+	{
+		TraversalStep(data, ray, state);
+	}
+
+	return EndTraversal(data, ray, state, isect);
+}
+
+LM_FORCE_INLINE void QBVHScene::TraversalBatch( const QBVHTraversalData& data, Ray* rays, QBVHTraversalState* states, int m, bool anyHit ) const
+{
+	int active[QBVHTraversalBatchSize];
+	for (int i = 0; i < m; i++)
+	{
+		BeginTraversal(rays[i], states[i]);
+		active[i] = i;
+	}
+
+	// Interleaved depth first traversal of QBVH
+	// Each ray visits one node in turn and the node to be visited next by the ray
+	// is prefetched, so that the memory latency is hidden by the traversal of other rays
+	int numActive = m;
+	while (numActive > 0)
+	{
+		for (int k = 0; k < numActive;)
+		{
+			const int i = active[k];
+			auto& state = states[i];
+			TraversalStep(data, rays[i], state);
+			if (state.stackIndex < 0 || (anyHit && state.intersected))
+			{
+				// Finished
+				active[k] = active[--numActive];
+				continue;
+			}
+
+			const int next = state.stack[state.stackIndex];
+			if (next >= 0)
+			{
+				_mm_prefetch(reinterpret_cast<const char*>(data.nodes[next]), _MM_HINT_T0);
+			}
+			else if (next != QBVHNode::EmptyLeafNode)
+			{
+				unsigned int size, offset;
+				QBVHNode::ExtractLeafData(next, size, offset);
+				if (mode == QBVHIntersectionMode::SSE)
+				{
+					_mm_prefetch(reinterpret_cast<const char*>(data.quadTris[offset]), _MM_HINT_T0);
+				}
+				else
+				{
+					_mm_prefetch(reinterpret_cast<const char*>(&data.triAccels[offset]), _MM_HINT_T0);
+				}
+			}
+
+			k++;
+		}
+	}
+}
+
+void QBVHScene::IntersectTrianglesBatch( Ray* rays, Intersection* isects, bool* hits, int n ) const
+{
+	const auto data = CurrentTraversalData();
+	QBVHTraversalState states[QBVHTraversalBatchSize];
+	for (int begin = 0; begin < n; begin += QBVHTraversalBatchSize)
+	{
+		const int m = std::min(QBVHTraversalBatchSize, n - begin);
+		TraversalBatch(data, rays + begin, states, m, false);
+		for (int i = 0; i < m; i++)
+		{
+			hits[begin + i] = EndTraversal(data, rays[begin + i], states[i], isects[begin + i]);
+		}
+	}
+}
+
+void QBVHScene::OccludedTrianglesBatch( Ray* rays, bool* occluded, int n ) const
+{
+	// Shadow rays are terminated on the first hit
+	// and the intersection data is not reconstructed
+	const auto data = CurrentTraversalData();
+	QBVHTraversalState states[QBVHTraversalBatchSize];
+	for (int begin = 0; begin < n; begin += QBVHTraversalBatchSize)
+	{
+		const int m = std::min(QBVHTraversalBatchSize, n - begin);
+		TraversalBatch(data, rays + begin, states, m, true);
+		for (int i = 0; i < m; i++)
+		{
+			occluded[begin + i] = states[i].intersected;
+		}
+	}
+}
+
 LM_COMPONENT_REGISTER_IMPL(QBVHScene, Scene);
 
 #endif
@@ -106,6 +106,12 @@ bool MPIRenderProcessScheduler::Configure(const ConfigNode& node, const Assets&
 
 bool MPIRenderProcessScheduler::Render(Renderer& renderer, const Scene& scene) const
 {
+	if (renderer.NumSamplesPerIteration() > 0)
+	{
+		LM_LOG_ERROR("Iterative renderers are not supported by this scheduler");
+		return false;
+	}
+
 	auto* masterFilm = scene.MainCamera()->GetFilm();
 
 	// --------------------------------------------------------------------------------
@@ -134,9 +140,10 @@ bool MPIRenderProcessScheduler::Render(Renderer& renderer, const Scene& scene) c
 		// ## Assign initial tasks to slave processes
 		for (int i = 1; i < numProcs; i++)
 		{
-			// Number of samples to be processed by this task
+			// Index of the first sample and number of samples to be processed by this task
 			long long samples = terminationMode == TerminationMode::Time ? samplesPerTask : Math::Min(samplesPerTask, numSamples - queriedSamples);
-			MPI_Send(&samples, 1, MPI_LONG_LONG, i, TagType_AssignTask, MPI_COMM_WORLD);
+			long long task[] = { queriedSamples, samples };
+			MPI_Send(task, 2, MPI_LONG_LONG, i, TagType_AssignTask, MPI_COMM_WORLD);
 			queriedSamples += samples;
 		}
 
@@ -188,7 +195,8 @@ bool MPIRenderProcessScheduler::Render(Renderer& renderer, const Scene& scene) c
 			   (terminationMode == TerminationMode::Samples && queriedSamples < numSamples))
 			{
 				long long samples = terminationMode == TerminationMode::Time ? samplesPerTask : Math::Min(samplesPerTask, numSamples - queriedSamples);
-				MPI_Send(&samples, 1, MPI_LONG_LONG, status.MPI_SOURCE, TagType_AssignTask, MPI_COMM_WORLD);
+				long long task[] = { queriedSamples, samples };
+				MPI_Send(task, 2, MPI_LONG_LONG, status.MPI_SOURCE, TagType_AssignTask, MPI_COMM_WORLD);
 				queriedSamples += samples;
 			}
 		}
@@ -242,8 +250,9 @@ bool MPIRenderProcessScheduler::Render(Renderer& renderer, const Scene& scene) c
 		while (true)
 		{
 			// ### Receive a task
-			long long assignedSamples;
-			MPI_Recv(&assignedSamples, 1, MPI_LONG_LONG, 0, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+			// The task consists of the index of the first sample and the number of samples
+			long long task[2];
+			MPI_Recv(task, 2, MPI_LONG_LONG, 0, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
 
 			if (status.MPI_TAG == TagType_Exit)
 			{
@@ -253,6 +262,8 @@ bool MPIRenderProcessScheduler::Render(Renderer& renderer, const Scene& scene) c
 			// --------------------------------------------------------------------------------
 
 			// ### Rendering
+			const long long sampleOffset = task[0];
+			const long long assignedSamples = task[1];
 			std::atomic<long long> processedSamples(0);
 
 			// Number of blocks to be separated
@@ -273,6 +284,7 @@ bool MPIRenderProcessScheduler::Render(Renderer& renderer, const Scene& scene) c
 
 				for (long long sample = sampleBegin; sample < sampleEnd; sample++)
 				{
+					process->SetSampleIndex(sampleOffset + sample);
 					process->ProcessSingleSample(scene);
 				}
 			}
@@ -25,6 +25,7 @@
 #include <lightmetrica/scene.h>
 #include <lightmetrica/camera.h>
 #include <lightmetrica/bitmapfilm.h>
+#include <lightmetrica/numa.h>
 #include <thread>
 #include <atomic>
 #include <omp.h>
@@ -36,6 +37,14 @@ LM_NAMESPACE_BEGIN
 	Creates and schedules render processes among threads.
 	Multi-threading is supported by OpenMP.
 	We note that this scheduler requires SamplingBasedRenderProcess.
+	For iterative renderers (see Renderer::NumSamplesPerIteration), each pass processes
+	the samples of an iteration after Renderer::PreprocessIteration,
+	and the termination is checked only at the end of the iterations.
+	If 'numa' option is enabled, render threads are bound to the CPUs distributed
+	among NUMA nodes and render processes (including per-thread films)
+	are created by the bound threads so that the memory is placed on the local node.
+	If 'shared_film' option is enabled, the film is shared among threads
+	instead of creating full copies of the film for each thread (see Film::SetSharedMode).
 	\sa SamplingBasedRenderProcess.
 */
 class MTRenderProcessScheduler final : public SamplingBasedRenderProcessScheduler
@@ -64,6 +73,9 @@ private:
 	int numThreads;							//!< Number of threads
 	long long samplesPerBlock;				//!< Samples to be processed per block
 	Math::Float progressImageInterval;		//!< Seconds between progress images' output (if -1, disabled)
+	bool numa;								//!< Enables NUMA-aware thread placement
+	std::vector<int> threadCPUs;			//!< CPU indices for each thread (only for NUMA mode)
+	bool sharedFilm;						//!< Shares the film among threads
 
 };
 
@@ -84,6 +96,25 @@ bool MTRenderProcessScheduler::Configure(const ConfigNode& node, const Assets& a
 	}
 	node.ChildValueOrDefault("progress_image_interval", Math::Float(-1), progressImageInterval);
 
+	// NUMA-aware thread placement
+	node.ChildValueOrDefault("numa", false, numa);
+	if (numa)
+	{
+		threadCPUs = NUMAUtils::AssignCPUs(numThreads);
+		if (threadCPUs.empty())
+		{
+			LM_LOG_WARN("No CPUs available for thread binding, disabling 'numa'");
+			numa = false;
+		}
+		else
+		{
+			LM_LOG_INFO(boost::str(boost::format("NUMA-aware thread placement (%d nodes)") % NUMAUtils::NumNodes()));
+		}
+	}
+
+	// Shared film mode
+	node.ChildValueOrDefault("shared_film", false, sharedFilm);
+
 	// Set number of threads
 	omp_set_num_threads(numThreads);
 
@@ -96,16 +127,30 @@ bool MTRenderProcessScheduler::Render(Renderer& renderer, const Scene& scene) co
 	std::atomic<long long> processedBlocks(0);
 	std::atomic<long long> processedSamples(0);
 
+	// Samples processed in a pass
+	// For iterative renderers, a pass corresponds to an iteration
+	const long long samplesPerIteration = renderer.NumSamplesPerIteration();
+	const bool iterative = samplesPerIteration > 0;
+	const long long passSamples = iterative ? samplesPerIteration : numSamples;
+	const long long numPasses = iterative ? (numSamples + samplesPerIteration - 1) / samplesPerIteration : 1;
+
 	// Number of blocks to be separated
-	long long blocks = (numSamples + samplesPerBlock) / samplesPerBlock;
+	long long blocks = (passSamples + samplesPerBlock) / samplesPerBlock;
 
 	signal_ReportProgress(0, false);
 
 	// --------------------------------------------------------------------------------
 
 	// # Create processes
-	std::vector<std::unique_ptr<SamplingBasedRenderProcess>> processes;
-	for (int i = 0; i < numThreads; i++)
+	// In shared film mode, the films cloned in the processes are lightweight per-thread films
+	if (sharedFilm)
+	{
+		masterFilm->SetSharedMode(true);
+	}
+
+	std::vector<std::unique_ptr<SamplingBasedRenderProcess>> processes(numThreads);
+	bool failed = false;
+	auto createProcess = [&](int i) -> bool
 	{
 		// Create & check compatibility
 		std::unique_ptr<RenderProcess> p(renderer.CreateRenderProcess(scene, i, numThreads));
@@ -121,7 +166,88 @@ bool MTRenderProcessScheduler::Render(Renderer& renderer, const Scene& scene) co
 		}
 
 		// Add a process
-		processes.emplace_back(dynamic_cast<SamplingBasedRenderProcess*>(p.release()));
+		processes[i].reset(dynamic_cast<SamplingBasedRenderProcess*>(p.release()));
+		return true;
+	};
+
+	bool bindThreads = numa;
+	if (bindThreads)
+	{
+		// Bind threads and create processes in the bound threads.
+		// Memory allocated in the process (e.g., cloned films) is first touched by the local thread.
+		// Processes are created sequentially to keep the seeds of the samplers deterministic.
+		// With schedule(static, 1), i-th iteration is processed by i-th thread.
+		// If the runtime gives a smaller team, the threads cannot be bound one-to-one to the CPUs,
+		// so no thread is bound and the processes are created sequentially below.
+		#pragma omp parallel num_threads(numThreads)
+		{
+			if (omp_get_num_threads() < numThreads)
+			{
+				#pragma omp single
+				{
+					bindThreads = false;
+				}
+			}
+			else
+			{
+				NUMAUtils::BindCurrentThread(threadCPUs[omp_get_thread_num()]);
+
+				#pragma omp for ordered schedule(static, 1)
+				for (int i = 0; i < numThreads; i++)
+				{
+					#pragma omp ordered
+					{
+						if (!createProcess(i))
+						{
+							failed = true;
+						}
+					}
+				}
+			}
+		}
+
+		if (!bindThreads)
+		{
+			LM_LOG_WARN("Failed to create " + std::to_string(numThreads) + " threads for thread binding, disabling 'numa'");
+		}
+	}
+
+	if (!bindThreads)
+	{
+		for (int i = 0; i < numThreads; i++)
+		{
+			if (!createProcess(i))
+			{
+				failed = true;
+				break;
+			}
+		}
+	}
+
+	// All processes must be created
+	for (int i = 0; !failed && i < numThreads; i++)
+	{
+		if (processes[i] == nullptr)
+		{
+			LM_LOG_ERROR("Render process is not created (thread #" + std::to_string(i) + ")");
+			failed = true;
+		}
+	}
+
+	if (failed)
+	{
+		if (bindThreads)
+		{
+			// Release the binding of the threads
+			#pragma omp parallel num_threads(numThreads)
+			{
+				NUMAUtils::UnbindCurrentThread();
+			}
+		}
+
+		processes.clear();
+		masterFilm->SetSharedMode(false);
+		return false;
 	}
 
 	// --------------------------------------------------------------------------------
@@ -133,14 +259,24 @@ bool MTRenderProcessScheduler::Render(Renderer& renderer, const Scene& scene) co
 	auto startTime = std::chrono::high_resolution_clock::now();
 	auto prevStartTime = startTime;
 	int intermediateImageOutputCount = 0;
+	long long pass = 0;
 
 	while (true)
 	{
+		// Global preprocess of the iteration
+		if (iterative && !renderer.PreprocessIteration(scene, pass))
+		{
+			LM_LOG_ERROR("Failed to preprocess iteration #" + std::to_string(pass));
+			cancel = true;
+			break;
+		}
+
 		#pragma omp parallel for
 		for (long long block = 0; block < blocks; block++)
 		{
-			#pragma omp flush (done)
-			if (done)
+			// Iterations are not interrupted except for cancellation
+			#pragma omp flush (done, cancel)
+			if (cancel || (done && !iterative))
 			{
 				continue;
 			}
@@ -155,12 +291,13 @@ bool MTRenderProcessScheduler::Render(Renderer& renderer, const Scene& scene) co
 
 				// Sample range
 				long long sampleBegin = samplesPerBlock * block;
-				long long sampleEnd = Math::Min(sampleBegin + samplesPerBlock, numSamples);
+				long long sampleEnd = Math::Min(sampleBegin + samplesPerBlock, passSamples);
 
 				processedSamples += sampleEnd - sampleBegin;
 
 				for (long long sample = sampleBegin; sample < sampleEnd; sample++)
 				{
+					process->SetSampleIndex(pass * passSamples + sample);
 					process->ProcessSingleSample(scene);
 				}
 			}
@@ -168,7 +305,7 @@ bool MTRenderProcessScheduler::Render(Renderer& renderer, const Scene& scene) co
 			{
 				LM_LOG_ERROR(boost::str(boost::format("EXCEPTION (thread #%d) | %s") % omp_get_thread_num() % e.what()));
 				cancel = done = true;
-				#pragma omp flush (done)
+				#pragma omp flush (done, cancel)
 			}
 
 			// --------------------------------------------------------------------------------
@@ -177,7 +314,7 @@ bool MTRenderProcessScheduler::Render(Renderer& renderer, const Scene& scene) co
 			processedBlocks++;
 			if (terminationMode == TerminationMode::Samples)
 			{
-				auto progress = static_cast<double>(processedBlocks) / blocks;
+				auto progress = static_cast<double>(processedBlocks) / (blocks * numPasses);
 				signal_ReportProgress(progress, false);
 			}
 			else if (terminationMode == TerminationMode::Time)
@@ -214,10 +351,17 @@ bool MTRenderProcessScheduler::Render(Renderer& renderer, const Scene& scene) co
 				}
 
 				// Same intermediate image
-				masterFilm->Clear();
-				for (int i = 0; i < numThreads; i++)
+				if (sharedFilm)
 				{
-					masterFilm->AccumulateContribution(*processes[i]->GetFilm());
+					masterFilm->Flush();
+				}
+				else
+				{
+					masterFilm->Clear();
+					for (int i = 0; i < numThreads; i++)
+					{
+						masterFilm->AccumulateContribution(*processes[i]->GetFilm());
+					}
 				}
 
 				// Rescale & save
@@ -230,26 +374,49 @@ bool MTRenderProcessScheduler::Render(Renderer& renderer, const Scene& scene) co
 			}
 		}
 
-		if (done || terminationMode == TerminationMode::Samples)
+		if (done || (terminationMode == TerminationMode::Samples && pass + 1 >= numPasses))
 		{
 			break;
 		}
+
+		pass++;
 	}
 
 	signal_ReportProgress(1, true);
 
+	if (bindThreads)
+	{
+		// Release the binding of the threads
+		#pragma omp parallel num_threads(numThreads)
+		{
+			NUMAUtils::UnbindCurrentThread();
+		}
+	}
+
 	if (cancel)
 	{
 		LM_LOG_ERROR("Render operation has been canceled");
+		processes.clear();
+		masterFilm->SetSharedMode(false);
 		return false;
 	}
 
 	// --------------------------------------------------------------------------------
 
 	// # Accumulate rendered results for all threads to one film
-	for (int i = 0; i < numThreads; i++)
+	if (sharedFilm)
 	{
-		masterFilm->AccumulateContribution(*processes[i]->GetFilm());
+		// Flush remaining contributions and release per-thread films
+		masterFilm->Flush();
+		processes.clear();
+		masterFilm->SetSharedMode(false);
+	}
+	else
+	{
+		for (int i = 0; i < numThreads; i++)
+		{
+			masterFilm->AccumulateContribution(*processes[i]->GetFilm());
+		}
 	}
 
 	// Rescale master film
@@ -31,10 +31,74 @@
 
 LM_NAMESPACE_BEGIN
 
+/*!
+	Tile order.
+	Order of the tiles dispatched to the threads.
+*/
+enum class TileOrder
+{
+	Scanline,		//!< Scanline order
+	Morton,			//!< Morton (Z-order) curve
+	Hilbert			//!< Hilbert curve
+};
+
+namespace
+{
+
+	/*
+		Morton code of (x, y).
+		Interleaves lower 16 bits of x and y.
+	*/
+	unsigned int MortonIndex(unsigned int x, unsigned int y)
+	{
+		const auto Part1By1 = [](unsigned int v)
+		{
+			v &= 0x0000ffff;
+			v = (v | (v << 8)) & 0x00ff00ff;
+			v = (v | (v << 4)) & 0x0f0f0f0f;
+			v = (v | (v << 2)) & 0x33333333;
+			v = (v | (v << 1)) & 0x55555555;
+			return v;
+		};
+		return Part1By1(x) | (Part1By1(y) << 1);
+	}
+
+	/*
+		Index of (x, y) on the Hilbert curve covering n x n grid.
+		n must be a power of two.
+	*/
+	unsigned int HilbertIndex(unsigned int n, unsigned int x, unsigned int y)
+	{
+		unsigned int d = 0;
+		for (unsigned int s = n / 2; s > 0; s /= 2)
+		{
+			unsigned int rx = (x & s) > 0 ? 1 : 0;
+			unsigned int ry = (y & s) > 0 ? 1 : 0;
+			d += s * s * ((3 * rx) ^ ry);
+
+			// Rotate the quadrant
+			if (ry == 0)
+			{
+				if (rx == 1)
+				{
+					x = s - 1 - x;
+					y = s - 1 - y;
+				}
+				std::swap(x, y);
+			}
+		}
+		return d;
+	}
+
+}
+
 /*!
 	Deterministic multithreaded render process scheduler.
 	Creates and schedules render processes among threads.
 	Multi-threading is supported by OpenMP.
+	The image is split into square tiles, which are dynamically dispatched
+	to the threads in the order along the space-filling curve
+	specified by 'tile_order' for the coherency of the primary rays.
 	We note that this scheduler requires DeterministicPixelBasedRenderProcess.
 	\sa DeterministicPixelBasedRenderProcess.
 */
@@ -57,7 +121,9 @@ private:
 
 private:
 
-	int numThreads;
+	int numThreads;				//!< Number of threads
+	int tileSize;				//!< Width and height of a tile in pixels
+	TileOrder tileOrder;		//!< Order of the tiles
 
 };
 
@@ -70,6 +136,24 @@ bool DeterministicMTRenderProcessScheduler::Configure(const ConfigNode& node, co
 		numThreads = Math::Max(1, static_cast<int>(std::thread::hardware_concurrency()) + numThreads);
 	}
 
+	node.ChildValueOrDefault("tile_size", 16, tileSize);
+	if (tileSize <= 0)
+	{
+		LM_LOG_ERROR("Invalid value for 'tile_size'");
+		return false;
+	}
+
+	std::string tileOrderName;
+	node.ChildValueOrDefault<std::string>("tile_order", "hilbert", tileOrderName);
+	if (tileOrderName == "scanline")		{ tileOrder = TileOrder::Scanline; }
+	else if (tileOrderName == "morton")		{ tileOrder = TileOrder::Morton; }
+	else if (tileOrderName == "hilbert")	{ tileOrder = TileOrder::Hilbert; }
+	else
+	{
+		LM_LOG_ERROR("Invalid value for 'tile_order' : " + tileOrderName);
+		return false;
+	}
+
 	// Set number of threads
 	omp_set_num_threads(numThreads);
 
@@ -104,18 +188,53 @@ bool DeterministicMTRenderProcessScheduler::Render(Renderer& renderer, const Sce
 	// # Render loop
 
 	auto* film = scene.MainCamera()->GetFilm();
-	std::atomic<int> processedLines(0);
+	const int width = film->Width();
+	const int height = film->Height();
+
+	// Create tiles ordered along the curve
+	// For non power-of-two grids, the curve index is computed
+	// in the enclosing power-of-two grid and the tiles are sorted by the index.
+	const int tilesX = (width + tileSize - 1) / tileSize;
+	const int tilesY = (height + tileSize - 1) / tileSize;
+	unsigned int gridSize = 1;
+	while (gridSize < static_cast<unsigned int>(Math::Max(tilesX, tilesY)))
+	{
+		gridSize *= 2;
+	}
+
+	std::vector<std::pair<unsigned int, Math::Vec2i>> tiles;
+	for (int ty = 0; ty < tilesY; ty++)
+	{
+		for (int tx = 0; tx < tilesX; tx++)
+		{
+			unsigned int index;
+			if (tileOrder == TileOrder::Morton)			{ index = MortonIndex(tx, ty); }
+			else if (tileOrder == TileOrder::Hilbert)	{ index = HilbertIndex(gridSize, tx, ty); }
+			else										{ index = static_cast<unsigned int>(ty * tilesX + tx); }
+			tiles.emplace_back(index, Math::Vec2i(tx, ty));
+		}
+	}
+	std::sort(tiles.begin(), tiles.end(), [](const std::pair<unsigned int, Math::Vec2i>& a, const std::pair<unsigned int, Math::Vec2i>& b) { return a.first < b.first; });
+
+	std::atomic<int> processedTiles(0);
+	const int numTiles = static_cast<int>(tiles.size());
 
 	signal_ReportProgress(0, false);
 
-	#pragma omp parallel for
-	for (int y = 0; y < film->Height(); y++)
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (int i = 0; i < numTiles; i++)
 	{
 		auto& process = processes[omp_get_thread_num()];
-		for (int x = 0; x < film->Width(); x++)
-		{
-			process->ProcessSinglePixel(scene, Math::Vec2i(x, y));
-		}
+
+		// Pixel range of the tile
+		const auto& tile = tiles[i].second;
+		Math::Vec2i begin(tile.x * tileSize, tile.y * tileSize);
+		Math::Vec2i end(Math::Min(begin.x + tileSize, width), Math::Min(begin.y + tileSize, height));
+		process->ProcessTile(scene, begin, end);
+
+		// Progress report
+		int processed = ++processedTiles;
+		signal_ReportProgress(static_cast<double>(processed) / numTiles, false);
 	}
 
 	signal_ReportProgress(1, true);
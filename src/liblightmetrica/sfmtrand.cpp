@@ -23,6 +23,7 @@
 #include <lightmetrica/align.h>
 #include <lightmetrica/assert.h>
 #include <SFMT.h>
+#include <cstring>
 
 LM_NAMESPACE_BEGIN
 
@@ -31,8 +32,9 @@ LM_NAMESPACE_BEGIN
 	An random number generator using SIMD-oriented Fast Mersenne Twister (SFMT)
 	using an implementation by Mutsuo Saito and Makoto Matsumoto:
 	http://www.math.sci.hiroshima-u.ac.jp/~m-mat/MT/SFMT/
+	Numbers are generated by blocks with sfmt_fill_array32 and buffered.
 */
-class SFMTRandom : public Random
+class SFMTRandom final : public Random
 {
 public:
 
@@ -40,13 +42,61 @@ public:
 
 public:
 
-	virtual unsigned int NextUInt() { return sfmt_genrand_uint32(&sfmt); }
-	virtual void SetSeed( unsigned int seed ) { sfmt_init_gen_rand(&sfmt, seed); }
+	SFMTRandom() : pos(BufferSize) {}
+
+public:
+
+	virtual unsigned int NextUInt()
+	{
+		if (pos == BufferSize)
+		{
+			Generate();
+		}
+		return buffer[pos++];
+	}
+
+	virtual void SetSeed( unsigned int seed )
+	{
+		sfmt_init_gen_rand(&sfmt, seed);
+		pos = BufferSize;
+	}
+
+	virtual void FillUInt( unsigned int* values, size_t n )
+	{
+		while (n > 0)
+		{
+			if (pos == BufferSize)
+			{
+				Generate();
+			}
+
+			const size_t size = Math::Min(n, static_cast<size_t>(BufferSize - pos));
+			std::memcpy(values, buffer + pos, size * sizeof(unsigned int));
+			values += size;
+			pos += static_cast<int>(size);
+			n -= size;
+		}
+	}
+
 	virtual Random* Clone() const { return new SFMTRandom; }
 
 private:
 
+	void Generate()
+	{
+		// sfmt_fill_array32 requires the size to be a multiple of 4 and at least SFMT_N32,
+		// and the array to be aligned to 16 bytes
+		sfmt_fill_array32(&sfmt, buffer, BufferSize);
+		pos = 0;
+	}
+
+private:
+
+	static const int BufferSize = SFMT_N32 * 4;
+
 	sfmt_t sfmt;
+	LM_ALIGN_16 uint32_t buffer[BufferSize];	// Generated numbers
+	int pos;									// Position of the next number in #buffer
 
 };
 
@@ -0,0 +1,336 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+#include <lightmetrica/sharedfilm.h>
+#include <lightmetrica/film.h>
+#include <lightmetrica/bitmap.h>
+#include <lightmetrica/logger.h>
+
+LM_NAMESPACE_BEGIN
+
+/*
+	Buffered splat.
+	Contribution to be accumulated to the pixel.
+*/
+struct SharedFilmSplat
+{
+	unsigned int index;		// Pixel index
+	Math::Vec3 contrb;		// Contribution
+};
+
+/*!
+	Per-thread film for the shared film.
+	Buffers the contributions and flushes them to the shared bitmap.
+*/
+class SharedFilmThreadFilm final : public Film
+{
+public:
+
+	LM_COMPONENT_IMPL_DEF("shared");
+
+public:
+
+	SharedFilmThreadFilm(SharedFilm::Impl* owner, int width, int height, size_t bufferSize);
+	virtual ~SharedFilmThreadFilm();
+
+public:
+
+	virtual bool Load(const ConfigNode& node, const Assets& assets) override { return false; }
+
+public:
+
+	virtual int Width() const override { return width; }
+	virtual int Height() const override { return height; }
+	virtual void RecordContribution(const Math::Vec2& rasterPos, const Math::Vec3& contrb) override;
+	virtual void AccumulateContribution(const Math::Vec2& rasterPos, const Math::Vec3& contrb) override;
+	virtual void AccumulateContribution(const Film& film) override { LM_LOG_WARN("Unsupported operation for per-thread shared film"); }
+	virtual void AccumulateContributions(const Splat* splats, size_t n, const Math::Float& weight) override;
+	virtual void Rescale(const Math::Float& weight) override { LM_LOG_WARN("Unsupported operation for per-thread shared film"); }
+	virtual Film* Clone() const override;
+	virtual void Clear() override { buffer.clear(); }
+	virtual void SetSharedMode(bool enable) override {}
+	virtual void Flush() override;
+
+public:
+
+	void Detach() { owner = nullptr; }
+
+private:
+
+	bool PixelIndex(const Math::Vec2& rasterPos, unsigned int& index) const;
+
+private:
+
+	SharedFilm::Impl* owner;
+	int width;
+	int height;
+	size_t bufferSize;
+	std::vector<SharedFilmSplat> buffer;
+
+};
+
+// --------------------------------------------------------------------------------
+
+class SharedFilm::Impl
+{
+public:
+
+	Impl(BitmapImage& bitmap, int width, int height, size_t bufferSize)
+		: bitmap(bitmap)
+		, width(width)
+		, height(height)
+		, bufferSize(bufferSize)
+	{
+		// Striped locks
+		// Each lock protects the band of rows
+		numStripes = Math::Max(1, Math::Min(height, 256));
+		locks.reset(new std::mutex[numStripes]);
+	}
+
+	~Impl()
+	{
+		// Detach remaining per-thread films
+		std::unique_lock<std::mutex> lock(threadFilmsMutex);
+		for (auto* threadFilm : threadFilms)
+		{
+			threadFilm->Detach();
+		}
+	}
+
+public:
+
+	Film* CreateThreadFilm()
+	{
+		auto* threadFilm = new SharedFilmThreadFilm(this, width, height, bufferSize);
+		std::unique_lock<std::mutex> lock(threadFilmsMutex);
+		threadFilms.push_back(threadFilm);
+		return threadFilm;
+	}
+
+	void Unregister(SharedFilmThreadFilm* threadFilm)
+	{
+		std::unique_lock<std::mutex> lock(threadFilmsMutex);
+		threadFilms.erase(std::remove(threadFilms.begin(), threadFilms.end(), threadFilm), threadFilms.end());
+	}
+
+	void Flush()
+	{
+		std::unique_lock<std::mutex> lock(threadFilmsMutex);
+		for (auto* threadFilm : threadFilms)
+		{
+			threadFilm->Flush();
+		}
+	}
+
+	/*
+		Accumulate splats to the bitmap.
+		#splats must be sorted by the pixel index.
+	*/
+	void Accumulate(const std::vector<SharedFilmSplat>& splats)
+	{
+		auto& data = bitmap.InternalData();
+		size_t i = 0;
+		while (i < splats.size())
+		{
+			// Acquire the lock for the stripe and process all splats in the stripe
+			int stripe = Stripe(splats[i].index);
+			std::unique_lock<std::mutex> lock(locks[stripe]);
+			for (; i < splats.size() && Stripe(splats[i].index) == stripe; i++)
+			{
+				const auto& splat = splats[i];
+				data[3 * splat.index    ] += splat.contrb[0];
+				data[3 * splat.index + 1] += splat.contrb[1];
+				data[3 * splat.index + 2] += splat.contrb[2];
+			}
+		}
+	}
+
+	void Record(unsigned int index, const Math::Vec3& contrb)
+	{
+		auto& data = bitmap.InternalData();
+		std::unique_lock<std::mutex> lock(locks[Stripe(index)]);
+		data[3 * index    ] = contrb[0];
+		data[3 * index + 1] = contrb[1];
+		data[3 * index + 2] = contrb[2];
+	}
+
+private:
+
+	int Stripe(unsigned int index) const
+	{
+		return static_cast<int>(index / width) * numStripes / height;
+	}
+
+private:
+
+	BitmapImage& bitmap;
+	int width;
+	int height;
+	size_t bufferSize;
+
+	int numStripes;
+	std::unique_ptr<std::mutex[]> locks;
+
+	std::mutex threadFilmsMutex;
+	std::vector<SharedFilmThreadFilm*> threadFilms;
+
+};
+
+// --------------------------------------------------------------------------------
+
+SharedFilmThreadFilm::SharedFilmThreadFilm( SharedFilm::Impl* owner, int width, int height, size_t bufferSize )
+	: owner(owner)
+	, width(width)
+	, height(height)
+	, bufferSize(bufferSize)
+{
+	buffer.reserve(bufferSize);
+}
+
+SharedFilmThreadFilm::~SharedFilmThreadFilm()
+{
+	// Note that buffered contributions are not flushed here
+	// because the shared film might be already rescaled.
+	if (owner)
+	{
+		owner->Unregister(this);
+	}
+}
+
+bool SharedFilmThreadFilm::PixelIndex( const Math::Vec2& rasterPos, unsigned int& index ) const
+{
+	// Check raster position
+	if (rasterPos.x < 0 || 1 < rasterPos.x || rasterPos.y < 0 || 1 < rasterPos.y)
+	{
+		LM_LOG_WARN(boost::str(boost::format("Invalid raster position (%d, %d)") % rasterPos.x % rasterPos.y));
+		return false;
+	}
+
+	// Convert raster position to pixel position
+	Math::Vec2i pixelPos(
+		Math::Clamp(Math::Cast<int>(Math::Float(rasterPos.x * Math::Float(width))), 0, width-1),
+		Math::Clamp(Math::Cast<int>(Math::Float(rasterPos.y * Math::Float(height))), 0, height-1));
+
+	index = static_cast<unsigned int>(pixelPos.y * width + pixelPos.x);
+	return true;
+}
+
+void SharedFilmThreadFilm::RecordContribution( const Math::Vec2& rasterPos, const Math::Vec3& contrb )
+{
+	unsigned int index;
+	if (owner && PixelIndex(rasterPos, index))
+	{
+		owner->Record(index, contrb);
+	}
+}
+
+void SharedFilmThreadFilm::AccumulateContribution( const Math::Vec2& rasterPos, const Math::Vec3& contrb )
+{
+	unsigned int index;
+	if (!PixelIndex(rasterPos, index))
+	{
+		return;
+	}
+
+	SharedFilmSplat splat;
+	splat.index = index;
+	splat.contrb = contrb;
+	buffer.push_back(splat);
+
+	if (buffer.size() >= bufferSize)
+	{
+		Flush();
+	}
+}
+
+void SharedFilmThreadFilm::AccumulateContributions( const Splat* splats, size_t n, const Math::Float& weight )
+{
+	const size_t ChunkSize = 64;
+	int indices[ChunkSize];
+	size_t invalid = 0;
+	for (size_t begin = 0; begin < n; begin += ChunkSize)
+	{
+		const size_t size = Math::Min(ChunkSize, n - begin);
+		invalid += ComputePixelIndices(splats + begin, size, width, height, indices);
+		for (size_t i = 0; i < size; i++)
+		{
+			if (indices[i] < 0)
+			{
+				continue;
+			}
+
+			SharedFilmSplat splat;
+			splat.index = static_cast<unsigned int>(indices[i]);
+			splat.contrb = splats[begin + i].L * weight;
+			buffer.push_back(splat);
+		}
+
+		if (buffer.size() >= bufferSize)
+		{
+			Flush();
+		}
+	}
+
+	if (invalid > 0)
+	{
+		LM_LOG_WARN(boost::str(boost::format("Ignored %d splats with invalid raster positions") % invalid));
+	}
+}
+
+Film* SharedFilmThreadFilm::Clone() const
+{
+	return owner ? owner->CreateThreadFilm() : nullptr;
+}
+
+void SharedFilmThreadFilm::Flush()
+{
+	if (owner && !buffer.empty())
+	{
+		std::sort(buffer.begin(), buffer.end(), [](const SharedFilmSplat& a, const SharedFilmSplat& b){ return a.index < b.index; });
+		owner->Accumulate(buffer);
+	}
+
+	buffer.clear();
+}
+
+// --------------------------------------------------------------------------------
+
+SharedFilm::SharedFilm( BitmapImage& bitmap, int width, int height, size_t bufferSize )
+	: p(new Impl(bitmap, width, height, bufferSize))
+{
+
+}
+
+SharedFilm::~SharedFilm()
+{
+	LM_SAFE_DELETE(p);
+}
+
+Film* SharedFilm::CreateThreadFilm()
+{
+	return p->CreateThreadFilm();
+}
+
+void SharedFilm::Flush()
+{
+	p->Flush();
+}
+
+LM_NAMESPACE_END
@@ -0,0 +1,406 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+#include <lightmetrica/renderer.h>
+#include <lightmetrica/renderproc.h>
+#include <lightmetrica/pm.photon.h>
+#include <lightmetrica/pm.photonmap.h>
+#include <lightmetrica/pm.photontracer.h>
+#include <lightmetrica/pm.kernel.h>
+#include <lightmetrica/confignode.h>
+#include <lightmetrica/logger.h>
+#include <lightmetrica/configurablesampler.h>
+#include <lightmetrica/surfacegeometry.h>
+#include <lightmetrica/generalizedbsdf.h>
+#include <lightmetrica/light.h>
+#include <lightmetrica/camera.h>
+#include <lightmetrica/scene.h>
+#include <lightmetrica/ray.h>
+#include <lightmetrica/intersection.h>
+#include <lightmetrica/bsdf.h>
+#include <lightmetrica/primitive.h>
+#include <lightmetrica/film.h>
+#include <lightmetrica/renderutils.h>
+
+LM_NAMESPACE_BEGIN
+
+/*!
+	Stochastic progressive photon mapping renderer.
+	Implements progressive photon mapping with the probabilistic formulation.
+	The rendering is separated into iterations, each of which consists of
+	a photon pass followed by a camera pass with the photon map of the iteration.
+	The radius of the density estimation is reduced globally for each iteration,
+	so that the average of the estimates of the iterations converges to the correct solution.
+	The memory usage is bounded by the photons of an iteration.
+	References:
+	  - T. Hachisuka and H. W. Jensen, Stochastic progressive photon mapping,
+	    ACM Transactions on Graphics (Procs. of SIGGRAPH Asia 2009), 28(5), 2009.
+	  - C. Knaus and M. Zwicker, Progressive photon mapping: A probabilistic approach,
+	    ACM Transactions on Graphics, 30(3), 2011.
+*/
+class SPPMRenderer final : public Renderer
+{
+private:
+
+	friend class SPPMRenderer_RenderProcess;
+
+public:
+
+	LM_COMPONENT_IMPL_DEF("sppm");
+
+public:
+
+	virtual std::string Type() const override { return ImplTypeName(); }
+	virtual bool Configure(const ConfigNode& node, const Assets& assets, const Scene& scene, const RenderProcessScheduler& sched) override;
+	virtual bool Preprocess(const Scene& scene, const RenderProcessScheduler& sched) override;
+	virtual bool Postprocess(const Scene& scene, const RenderProcessScheduler& sched) const override { return true; }
+	virtual RenderProcess* CreateRenderProcess(const Scene& scene, int threadID, int numThreads) override;
+	virtual long long NumSamplesPerIteration() const override { return numSamplesPerIteration; }
+	virtual bool PreprocessIteration(const Scene& scene, long long iteration) override;
+	virtual boost::signals2::connection Connect_ReportProgress(const std::function<void(double, bool)>& func) override { return signal_ReportProgress.connect(func); }
+
+private:
+
+	boost::signals2::signal<void (double, bool)> signal_ReportProgress;
+
+private:
+
+	long long numPhotonTraceSamples;							// Number of samples emitted in photon pass of an iteration
+	long long maxPhotons;										// Maximum number of photons stored in photon pass of an iteration
+	long long numSamplesPerIteration;							// Number of samples in camera pass of an iteration
+	Math::Float initialRadius;									// Radius of density estimation in the first iteration
+	Math::Float alpha;											// Parameter to control the reduction of the radius
+	std::unique_ptr<ConfigurableSampler> initialSampler;		// Sampler
+
+private:
+
+	std::unique_ptr<PhotonMap> photonMap;						// Photon map of the current iteration
+	std::unique_ptr<PhotonDensityEstimationKernel> pdeKernel;	// Photon density estimation kernel
+	Photons photons;											// Photons of the current iteration (reused among iterations)
+	long long tracedLightPaths;									// # of traced light paths in the current iteration
+	Math::Float radius2;										// Squared radius of density estimation in the current iteration
+
+};
+
+// --------------------------------------------------------------------------------
+
+/*!
+	Render process for SPPMRenderer.
+	The class is responsible for per-thread execution of the camera passes.
+	Each sample traces a camera path and estimates the radiance
+	with the photon map of the current iteration.
+*/
+class SPPMRenderer_RenderProcess final : public SamplingBasedRenderProcess
+{
+public:
+
+	SPPMRenderer_RenderProcess(const SPPMRenderer& renderer, Sampler* sampler, Film* film)
+		: renderer(renderer)
+		, sampler(sampler)
+		, film(film)
+	{
+
+	}
+
+private:
+
+	LM_DISABLE_COPY_AND_MOVE(SPPMRenderer_RenderProcess);
+
+public:
+
+	virtual void ProcessSingleSample(const Scene& scene) override;
+	virtual const Film* GetFilm() const override { return film.get(); }
+
+private:
+
+	const SPPMRenderer& renderer;
+	std::unique_ptr<Sampler> sampler;
+	std::unique_ptr<Film> film;
+
+};
+
+// --------------------------------------------------------------------------------
+
+bool SPPMRenderer::Configure(const ConfigNode& node, const Assets& assets, const Scene& scene, const RenderProcessScheduler& sched)
+{
+	node.ChildValueOrDefault("num_photon_trace_samples", 100000LL, numPhotonTraceSamples);
+	node.ChildValueOrDefault("max_photons", 100000LL, maxPhotons);
+	if (numPhotonTraceSamples <= 0 || maxPhotons <= 0)
+	{
+		LM_LOG_ERROR("Invalid value for 'num_photon_trace_samples' or 'max_photons'");
+		return false;
+	}
+
+	// 'num_samples_per_iteration'
+	// Defaults to the number of pixels, i.e., one sample per pixel in average
+	const auto* film = scene.MainCamera()->GetFilm();
+	node.ChildValueOrDefault("num_samples_per_iteration", static_cast<long long>(film->Width()) * film->Height(), numSamplesPerIteration);
+	if (numSamplesPerIteration <= 0)
+	{
+		LM_LOG_ERROR("Invalid value for 'num_samples_per_iteration'");
+		return false;
+	}
+
+	// 'initial_radius' and 'alpha'
+	node.ChildValueOrDefault("initial_radius", Math::Float(0.1), initialRadius);
+	node.ChildValueOrDefault("alpha", Math::Float(0.7), alpha);
+	if (initialRadius <= Math::Float(0))
+	{
+		LM_LOG_ERROR("Invalid value for 'initial_radius'");
+		return false;
+	}
+	if (alpha <= Math::Float(0) || alpha >= Math::Float(1))
+	{
+		LM_LOG_ERROR("Invalid value for 'alpha'. The value must be in (0, 1)");
+		return false;
+	}
+
+	// 'photon_map_impl'
+	// Fixed-radius queries are efficiently handled by the hash grid
+	std::string photonMapImplType;
+	node.ChildValueOrDefault("photon_map_impl", std::string("hashgrid"), photonMapImplType);
+	if (!ComponentFactory::CheckRegistered<PhotonMap>(photonMapImplType))
+	{
+		LM_LOG_ERROR("Unsupported photon map implementation '" + photonMapImplType + "'");
+		return false;
+	}
+	photonMap.reset(ComponentFactory::Create<PhotonMap>(photonMapImplType));
+	if (photonMap == nullptr)
+	{
+		return false;
+	}
+
+	// 'pde_kernel'
+	std::string pdeKernelType;
+	node.ChildValueOrDefault("pde_kernel", std::string("simpson"), pdeKernelType);
+	if (!ComponentFactory::CheckRegistered<PhotonDensityEstimationKernel>(pdeKernelType))
+	{
+		LM_LOG_ERROR("Unsupported photon density estimation kernel type '" + pdeKernelType + "'");
+		return false;
+	}
+	pdeKernel.reset(ComponentFactory::Create<PhotonDensityEstimationKernel>(pdeKernelType));
+	if (pdeKernel == nullptr)
+	{
+		return false;
+	}
+
+	// Sampler
+	auto samplerNode = node.Child("sampler");
+	auto samplerNodeType = samplerNode.AttributeValue("type");
+	if (samplerNodeType != "random")
+	{
+		LM_LOG_ERROR("Invalid sampler type. This renderer requires 'random' sampler");
+		return false;
+	}
+	initialSampler.reset(ComponentFactory::Create<ConfigurableSampler>(samplerNodeType));
+	if (initialSampler == nullptr || !initialSampler->Configure(samplerNode, assets))
+	{
+		LM_LOG_ERROR("Invalid sampler");
+		return false;
+	}
+
+	return true;
+}
+
+bool SPPMRenderer::Preprocess(const Scene& scene, const RenderProcessScheduler& sched)
+{
+	// Photons are traced in each iteration
+	signal_ReportProgress(0, false);
+	tracedLightPaths = 0;
+	radius2 = initialRadius * initialRadius;
+	signal_ReportProgress(1, true);
+	return true;
+}
+
+bool SPPMRenderer::PreprocessIteration(const Scene& scene, long long iteration)
+{
+	// Radius reduction [Knaus & Zwicker 2011]
+	radius2 = RenderUtils::ProgressiveRadius2(radius2, initialRadius, alpha, iteration);
+
+	// Photon pass
+	tracedLightPaths = 0;
+	PhotonTracer::TracePhotons(scene, *initialSampler, numPhotonTraceSamples, maxPhotons, photons, tracedLightPaths);
+	if (tracedLightPaths == 0)
+	{
+		LM_LOG_ERROR("No light paths are traced");
+		return false;
+	}
+
+	// Build photon map
+	photonMap->SetQueryRadius(std::sqrt(radius2));
+	photonMap->Build(photons);
+
+	// Report the progress of the radius reduction only for the (2^k)-th iterations
+	// in order not to flood the log with thousands of short iterations
+	if (((iteration + 1) & iteration) == 0)
+	{
+		LM_LOG_DEBUG("Iteration " + std::to_string(iteration) + " : radius = " + std::to_string(std::sqrt(radius2)) + ", photons = " + std::to_string(photons.size()));
+	}
+	return true;
+}
+
+RenderProcess* SPPMRenderer::CreateRenderProcess(const Scene& scene, int threadID, int numThreads)
+{
+	auto* sampler = initialSampler->Clone();
+	sampler->SetSeed(initialSampler->NextUInt());
+	return new SPPMRenderer_RenderProcess(*this, sampler, scene.MainCamera()->GetFilm()->Clone());
+}
+
+// --------------------------------------------------------------------------------
+
+void SPPMRenderer_RenderProcess::ProcessSingleSample(const Scene& scene)
+{
+	// Sample position on camera
+	SurfaceGeometry geomE;
+	Math::PDFEval pdfPE;
+	scene.MainCamera()->SamplePosition(sampler->NextVec2(), geomE, pdfPE);
+
+	// Evaluate positional component of We
+	auto positionalWe = scene.MainCamera()->EvaluatePosition(geomE);
+
+	auto throughput = positionalWe / pdfPE.v;
+	auto currGeom = geomE;
+	Math::Vec3 currWi;
+	const GeneralizedBSDF* currBsdf = scene.MainCamera();
+	int currType = GeneralizedBSDFType::All;
+	Math::Vec2 rasterPos;
+	Math::Vec3 L;
+
+	while (true)
+	{
+		// Sample generalized BSDF
+		GeneralizedBSDFSampleQuery bsdfSQ;
+		bsdfSQ.sample = sampler->NextVec2();
+		bsdfSQ.uComp = sampler->Next();
+		bsdfSQ.transportDir = TransportDirection::EL;
+		bsdfSQ.type = currType;
+		bsdfSQ.wi = currWi;
+
+		GeneralizedBSDFSampleResult bsdfSR;
+		auto fs_Estimated = currBsdf->SampleAndEstimateDirection(bsdfSQ, currGeom, bsdfSR);
+		if (Math::IsZero(fs_Estimated))
+		{
+			break;
+		}
+
+		// Update throughput
+		throughput *= fs_Estimated;
+
+		// Compute raster position if needed
+		if (currBsdf == scene.MainCamera())
+		{
+			if (!scene.MainCamera()->RayToRasterPosition(currGeom.p, bsdfSR.wo, rasterPos))
+			{
+				break;
+			}
+		}
+
+		// --------------------------------------------------------------------------------
+
+		// Setup next ray
+		Ray ray;
+		ray.d = bsdfSR.wo;
+		ray.o = currGeom.p;
+		ray.minT = Math::Constants::Eps();
+		ray.maxT = Math::Constants::Inf();
+
+		// Intersection query
+		Intersection isect;
+		if (!scene.Intersect(ray, isect))
+		{
+			break;
+		}
+
+		// Intersected with light
+		// ES*L paths are handled separately
+		const auto* light = isect.light;
+		if (light)
+		{
+			// Evaluate Le
+			GeneralizedBSDFEvaluateQuery bsdfEQ;
+			bsdfEQ.transportDir = TransportDirection::LE;
+			bsdfEQ.type = GeneralizedBSDFType::LightDirection;
+			bsdfEQ.wo = -ray.d;
+			auto LeD = light->EvaluateDirection(bsdfEQ, isect.geom);
+			auto LeP = light->EvaluatePosition(isect.geom);
+			L += throughput * LeD * LeP;
+		}
+
+		// --------------------------------------------------------------------------------
+
+		// If intersected surface is non-specular, compute radiance from photon map
+		// The non-specular components are accounted for by the photon density estimation,
+		// so that only the specular components are sampled to continue the path.
+		int nextType = GeneralizedBSDFType::All;
+		if ((isect.bsdf->BSDFTypes() & GeneralizedBSDFType::NonDelta) > 0)
+		{
+			// Collect photons within the radius of the current iteration
+			// The photons are collected without k-NN query, that is, the number of photons is not limited
+			const auto radius2 = renderer.radius2;
+			auto maxDist2 = radius2;
+			renderer.photonMap->CollectPhotons(isect.geom.p, maxDist2, [&](const Math::Vec3& p, const Photon& photon, Math::Float& /*maxDist2*/)
+			{
+				// Evaluate photon density estimation kernel
+				// Do not to forget to divide by #tracedLightPaths of the iteration
+				auto k = renderer.pdeKernel->Evaluate(p, photon, radius2);
+				auto pde = k / (radius2 * renderer.tracedLightPaths);
+
+				GeneralizedBSDFEvaluateQuery bsdfEQ;
+				bsdfEQ.transportDir = TransportDirection::EL;
+				bsdfEQ.type = GeneralizedBSDFType::NonDelta;
+				bsdfEQ.wi = -ray.d;
+				bsdfEQ.wo = photon.wi;
+				auto fs = isect.bsdf->EvaluateDirection(bsdfEQ, isect.geom);
+				if (Math::IsZero(fs))
+				{
+					return;
+				}
+
+				L += throughput * pde * fs * photon.throughput;
+			});
+
+			// For BSDFs with specular component it needs to continue
+			if ((isect.bsdf->BSDFTypes() & GeneralizedBSDFType::Specular) == 0)
+			{
+				break;
+			}
+
+			nextType = GeneralizedBSDFType::Specular;
+		}
+
+		// --------------------------------------------------------------------------------
+
+		// Update information
+		currGeom = isect.geom;
+		currWi = -ray.d;
+		currBsdf = isect.bsdf;
+		currType = nextType;
+	}
+
+	// Record to film
+	if (!Math::IsZero(L))
+	{
+		film->AccumulateContribution(rasterPos, L);
+	}
+}
+
+LM_COMPONENT_REGISTER_IMPL(SPPMRenderer, Renderer);
+
+LM_NAMESPACE_END
\ No newline at end of file
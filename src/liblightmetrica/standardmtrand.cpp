@@ -27,7 +27,7 @@ LM_NAMESPACE_BEGIN
 	Standard Mersenne Twister random number generator.
 	An implementation of random number generator using std::mt19937.
 */
-class StandardMTRandom : public Random
+class StandardMTRandom final : public Random
 {
 public:
 
@@ -37,6 +37,7 @@ public:
 
 	virtual unsigned int NextUInt() { return uniformInt(engine); }
 	virtual void SetSeed( unsigned int seed ) { engine.seed(seed); uniformInt.reset(); }
+	virtual void FillUInt( unsigned int* values, size_t n ) { for (size_t i = 0; i < n; i++) values[i] = uniformInt(engine); }
 	virtual Random* Clone() const { return new StandardMTRandom; }
 
 private:
@@ -0,0 +1,331 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "pch.h"
+#include <lightmetrica/texturetilecache.h>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+
+LM_NAMESPACE_BEGIN
+
+namespace
+{
+
+	/*
+		Shard of the texture tile cache.
+		The tiles are managed by a list ordered by the last access (the front is the most recent)
+		and a hash map from the keys to the elements of the list.
+		The member functions must be called with #mutex being locked.
+	*/
+	class TextureTileCacheShard
+	{
+	private:
+
+		typedef TextureTileCache::TileData TileData;
+
+		struct Entry
+		{
+			unsigned long long key;
+			std::shared_ptr<const TileData> tile;
+		};
+
+		typedef std::list<Entry> EntryList;
+
+	public:
+
+		TextureTileCacheShard()
+			: memoryBudget(0)
+			, memoryUsage(0)
+		{
+
+		}
+
+	public:
+
+		void SetMemoryBudget(size_t bytes)
+		{
+			memoryBudget = bytes;
+			Evict();
+		}
+
+		size_t MemoryUsage() const
+		{
+			return memoryUsage;
+		}
+
+		void EraseTexture(int textureID)
+		{
+			for (auto it = entries.begin(); it != entries.end();)
+			{
+				if (static_cast<int>(it->key >> 32) == textureID)
+				{
+					Erase(it++);
+				}
+				else
+				{
+					++it;
+				}
+			}
+		}
+
+		// Find the tile and mark it as the most recently used one
+		std::shared_ptr<const TileData> Find(unsigned long long key)
+		{
+			auto it = entryMap.find(key);
+			if (it == entryMap.end())
+			{
+				return nullptr;
+			}
+
+			entries.splice(entries.begin(), entries, it->second);
+			return it->second->tile;
+		}
+
+		void Insert(unsigned long long key, const std::shared_ptr<const TileData>& tile)
+		{
+			Entry entry;
+			entry.key = key;
+			entry.tile = tile;
+			entries.push_front(entry);
+			entryMap[key] = entries.begin();
+			memoryUsage += tile->size();
+			Evict();
+		}
+
+		void Clear()
+		{
+			entries.clear();
+			entryMap.clear();
+			memoryUsage = 0;
+		}
+
+	private:
+
+		// Discard the least recently used tiles until the usage is within the budget
+		// The most recently used tile is always kept
+		void Evict()
+		{
+			while (memoryUsage > memoryBudget && entries.size() > 1)
+			{
+				Erase(std::prev(entries.end()));
+			}
+		}
+
+		void Erase(EntryList::iterator it)
+		{
+			memoryUsage -= it->tile->size();
+			entryMap.erase(it->key);
+			entries.erase(it);
+		}
+
+	public:
+
+		std::mutex mutex;
+
+	private:
+
+		size_t memoryBudget;
+		size_t memoryUsage;
+		EntryList entries;
+		std::unordered_map<unsigned long long, EntryList::iterator> entryMap;
+
+	};
+
+}
+
+/*!
+	Implementation of TextureTileCache.
+	The cache is divided into shards with their own locks and LRU lists
+	in order to reduce the contention of the lookups from the render threads.
+	Neighbouring tiles of a texture are stored in different shards.
+*/
+class TextureTileCache::Impl
+{
+public:
+
+	Impl()
+		: memoryBudget(512ULL << 20)
+		, nextTextureID(0)
+	{
+		UpdateShardBudgets();
+	}
+
+public:
+
+	void SetMemoryBudget(size_t bytes)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		memoryBudget = bytes;
+		UpdateShardBudgets();
+	}
+
+	size_t MemoryBudget() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return memoryBudget;
+	}
+
+	size_t MemoryUsage()
+	{
+		size_t usage = 0;
+		for (auto& shard : shards)
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			usage += shard.MemoryUsage();
+		}
+		return usage;
+	}
+
+	int RegisterTexture()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return nextTextureID++;
+	}
+
+	void UnregisterTexture(int textureID)
+	{
+		for (auto& shard : shards)
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			shard.EraseTexture(textureID);
+		}
+	}
+
+	std::shared_ptr<const TileData> Lookup(int textureID, int tileIndex, const TileLoaderFunc& loader)
+	{
+		const auto key = (static_cast<unsigned long long>(textureID) << 32) | static_cast<unsigned int>(tileIndex);
+		auto& shard = shards[static_cast<unsigned int>(tileIndex + textureID) % NumShards];
+
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			auto tile = shard.Find(key);
+			if (tile)
+			{
+				return tile;
+			}
+		}
+
+		// Load the tile outside of the lock
+		// in order not to block the lookups of the other threads
+		std::shared_ptr<TileData> tile(new TileData);
+		if (!loader(*tile))
+		{
+			return nullptr;
+		}
+
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		// The tile might be loaded by the other thread
+		auto existingTile = shard.Find(key);
+		if (existingTile)
+		{
+			return existingTile;
+		}
+
+		shard.Insert(key, tile);
+		return tile;
+	}
+
+	void Clear()
+	{
+		for (auto& shard : shards)
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			shard.Clear();
+		}
+	}
+
+private:
+
+	// The memory budget is evenly divided into the shards
+	void UpdateShardBudgets()
+	{
+		for (auto& shard : shards)
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			shard.SetMemoryBudget(memoryBudget / NumShards);
+		}
+	}
+
+private:
+
+	mutable std::mutex mutex;		// Mutex for #memoryBudget and #nextTextureID
+	size_t memoryBudget;
+	int nextTextureID;
+	TextureTileCacheShard shards[NumShards];
+
+};
+
+// --------------------------------------------------------------------------------
+
+TextureTileCache::TextureTileCache()
+	: p(new Impl)
+{
+
+}
+
+TextureTileCache::~TextureTileCache()
+{
+	LM_SAFE_DELETE(p);
+}
+
+TextureTileCache& TextureTileCache::Instance()
+{
+	static TextureTileCache instance;
+	return instance;
+}
+
+void TextureTileCache::SetMemoryBudget( size_t bytes )
+{
+	p->SetMemoryBudget(bytes);
+}
+
+size_t TextureTileCache::MemoryBudget() const
+{
+	return p->MemoryBudget();
+}
+
+size_t TextureTileCache::MemoryUsage() const
+{
+	return p->MemoryUsage();
+}
+
+int TextureTileCache::RegisterTexture()
+{
+	return p->RegisterTexture();
+}
+
+void TextureTileCache::UnregisterTexture( int textureID )
+{
+	p->UnregisterTexture(textureID);
+}
+
+std::shared_ptr<const TextureTileCache::TileData> TextureTileCache::Lookup( int textureID, int tileIndex, const TileLoaderFunc& loader )
+{
+	return p->Lookup(textureID, tileIndex, loader);
+}
+
+void TextureTileCache::Clear()
+{
+	p->Clear();
+}
+
+LM_NAMESPACE_END
\ No newline at end of file
@@ -0,0 +1,534 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "pch.h"
+#include <lightmetrica/texture.h>
+#include <lightmetrica/texturetilecache.h>
+#include <lightmetrica/halfutils.h>
+#include <lightmetrica/logger.h>
+#include <lightmetrica/confignode.h>
+#include <lightmetrica/pathutils.h>
+#include <FreeImage.h>
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <mutex>
+#include <cstring>
+
+LM_NAMESPACE_BEGIN
+
+namespace
+{
+
+	// Format of the texels in the tiled file
+	enum class TiledTexelFormat
+	{
+		UInt8 = 0,		// 8-bit unsigned integer per channel (for LDR images)
+		Half = 1		// Half precision floating-point number per channel (for HDR images)
+	};
+
+	/*
+		Header of the tiled file.
+		The header is followed by the sizes of the mip-map levels (pairs of width and height)
+		and the tiles of all levels. The tiles of a level are stored in row major order,
+		and each tile consists of tileSize * tileSize texels of three channels.
+		The texels out of the level are filled by the nearest texels on the edge.
+	*/
+	struct TiledFileHeader
+	{
+		char magic[8];
+		int version;
+		int format;
+		int tileSize;
+		int verticalFlip;
+		int numLevels;
+	};
+
+	const char TiledFileMagic[8] = { 'L', 'M', 'T', 'I', 'L', 'E', 'D', '\0' };
+	const int TiledFileVersion = 1;
+
+}
+
+/*!
+	Tiled bitmap texture.
+	Implements a mip-mapped texture whose texels are divided into tiles.
+	The image is converted to a tiled file in the preprocess,
+	where the texels are stored in the native format of the image, i.e.,
+	8-bit integer for LDR images and half precision floating-point number for HDR images.
+	The tiles are loaded lazily via the process-wide texture tile cache,
+	so that the memory usage of the textures is bounded by the budget of the cache.
+	The texture is evaluated with bilinear filtering,
+	or trilinear filtering if the footprint of the lookup is given.
+*/
+class TiledBitmapTexture final : public Texture
+{
+public:
+
+	LM_COMPONENT_IMPL_DEF("bitmap.tiled");
+
+private:
+
+	struct Level
+	{
+		int width, height;		// Size of the level
+		int tilesX, tilesY;		// Number of tiles
+		int firstTile;			// Index of the first tile of the level
+	};
+
+public:
+
+	TiledBitmapTexture()
+		: textureID(TextureTileCache::Instance().RegisterTexture())
+	{
+
+	}
+
+	virtual ~TiledBitmapTexture()
+	{
+		TextureTileCache::Instance().UnregisterTexture(textureID);
+	}
+
+public:
+
+	virtual bool Load(const ConfigNode& node, const Assets& assets) override;
+
+public:
+
+	virtual Math::Vec3 Evaluate(const Math::Vec2& uv) const override;
+	virtual Math::Vec3 Evaluate(const Math::Vec2& uv, const Math::Float& footprint) const override;
+
+private:
+
+	bool CreateTiledFile(const std::string& path, const std::string& tiledPath, bool verticalFlip, int tileSize) const;
+	bool OpenTiledFile(const std::string& tiledPath, bool verticalFlip, int tileSize);
+	bool LoadTile(int tileIndex, TextureTileCache::TileData& data) const;
+	Math::Vec3 EvaluateBilinear(int level, const Math::Vec2& uv) const;
+	std::shared_ptr<const TextureTileCache::TileData> Tile(int level, int tileX, int tileY) const;
+	Math::Vec3 Texel(const TextureTileCache::TileData* tile, int x, int y) const;
+
+private:
+
+	int textureID;					// ID of the texture in the tile cache
+	TiledTexelFormat format;		// Format of the texels
+	int tileSize;					// Number of texels in a row of a tile
+	size_t tileBytes;				// Size of a tile in bytes
+	long long dataOffset;			// Offset of the tiles in the tiled file
+	std::vector<Level> levels;		// Mip-map levels
+
+	mutable std::ifstream file;		// Tiled file
+	mutable std::mutex fileMutex;	// Mutex for #file
+
+};
+
+bool TiledBitmapTexture::Load( const ConfigNode& node, const Assets& /*assets*/ )
+{
+	// 'path' element
+	std::string path;
+	if (!node.ChildValue("path", path))
+	{
+		return false;
+	}
+
+	path = PathUtils::ResolveAssetPath(*node.GetConfig(), path);
+
+	// 'vertical_flip' element
+	bool verticalFlip;
+	node.ChildValueOrDefault("vertical_flip", false, verticalFlip);
+
+	// 'tiled_path' element
+	// Path to the preprocessed tiled file
+	std::string tiledPath;
+	if (node.ChildValue("tiled_path", tiledPath))
+	{
+		tiledPath = PathUtils::ResolveAssetPath(*node.GetConfig(), tiledPath);
+	}
+	else
+	{
+		tiledPath = path + ".tiled";
+	}
+
+	// 'tile_size' element
+	int tileSize;
+	node.ChildValueOrDefault("tile_size", 64, tileSize);
+	if (tileSize <= 0)
+	{
+		LM_LOG_ERROR("Invalid tile size");
+		return false;
+	}
+
+	// Use the existing tiled file if it is newer than the image
+	namespace fs = boost::filesystem;
+	boost::system::error_code ec;
+	const bool upToDate = fs::exists(tiledPath, ec) && fs::last_write_time(tiledPath, ec) >= fs::last_write_time(path, ec);
+	if (upToDate && OpenTiledFile(tiledPath, verticalFlip, tileSize))
+	{
+		return true;
+	}
+
+	// Preprocess
+	{
+		LM_LOG_INFO("Creating tiled file " + tiledPath);
+		LM_LOG_INDENTER();
+		if (!CreateTiledFile(path, tiledPath, verticalFlip, tileSize))
+		{
+			return false;
+		}
+	}
+
+	return OpenTiledFile(tiledPath, verticalFlip, tileSize);
+}
+
+bool TiledBitmapTexture::CreateTiledFile( const std::string& path, const std::string& tiledPath, bool verticalFlip, int tileSize ) const
+{
+	// Load image
+	auto format = FreeImage_GetFileType(path.c_str(), 0);
+	if (format == FIF_UNKNOWN)
+	{
+		format = FreeImage_GetFIFFromFilename(path.c_str());
+	}
+	if (format == FIF_UNKNOWN || !FreeImage_FIFSupportsReading(format))
+	{
+		LM_LOG_ERROR("Unsupported image format");
+		return false;
+	}
+
+	auto* fibitmap = FreeImage_Load(format, path.c_str(), 0);
+	if (!fibitmap)
+	{
+		LM_LOG_ERROR("Failed to load an image " + path);
+		return false;
+	}
+
+	const int width = FreeImage_GetWidth(fibitmap);
+	const int height = FreeImage_GetHeight(fibitmap);
+	const auto type = FreeImage_GetImageType(fibitmap);
+	const auto bpp = FreeImage_GetBPP(fibitmap);
+	if (!(type == FIT_RGBF || type == FIT_RGBAF || (type == FIT_BITMAP && (bpp == 24 || bpp == 32))))
+	{
+		FreeImage_Unload(fibitmap);
+		LM_LOG_ERROR("Unsupportted format");
+		return false;
+	}
+
+	// Same orientation as the default bitmap texture
+	if (!verticalFlip)
+	{
+		FreeImage_FlipVertical(fibitmap);
+	}
+
+	// Read image data
+	// The texels are converted to floating-point numbers for the creation of the mip-maps
+	std::vector<float> data(3 * width * height);
+	for (int y = 0; y < height; y++)
+	{
+		auto* out = &data[3 * width * y];
+		if (type == FIT_RGBF || type == FIT_RGBAF)
+		{
+			const int stride = type == FIT_RGBF ? 3 : 4;
+			const auto* bits = reinterpret_cast<const float*>(FreeImage_GetScanLine(fibitmap, y));
+			for (int x = 0; x < width; x++)
+			{
+				out[3*x  ] = bits[stride*x  ];
+				out[3*x+1] = bits[stride*x+1];
+				out[3*x+2] = bits[stride*x+2];
+			}
+		}
+		else
+		{
+			const auto* bits = FreeImage_GetScanLine(fibitmap, y);
+			for (int x = 0; x < width; x++)
+			{
+				out[3*x  ] = bits[FI_RGBA_RED  ] / 255.0f;
+				out[3*x+1] = bits[FI_RGBA_GREEN] / 255.0f;
+				out[3*x+2] = bits[FI_RGBA_BLUE ] / 255.0f;
+				bits += bpp / 8;
+			}
+		}
+	}
+
+	FreeImage_Unload(fibitmap);
+
+	// Number of mip-map levels
+	std::vector<std::pair<int, int>> levelSizes(1, std::make_pair(width, height));
+	while (levelSizes.back().first > 1 || levelSizes.back().second > 1)
+	{
+		levelSizes.push_back(std::make_pair(Math::Max(1, levelSizes.back().first / 2), Math::Max(1, levelSizes.back().second / 2)));
+	}
+
+	// Write header
+	std::ofstream ofs(tiledPath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!ofs)
+	{
+		LM_LOG_ERROR("Failed to create tiled file " + tiledPath);
+		return false;
+	}
+
+	TiledFileHeader header;
+	std::memcpy(header.magic, TiledFileMagic, sizeof(header.magic));
+	header.version = TiledFileVersion;
+	header.format = static_cast<int>(type == FIT_BITMAP ? TiledTexelFormat::UInt8 : TiledTexelFormat::Half);
+	header.tileSize = tileSize;
+	header.verticalFlip = verticalFlip ? 1 : 0;
+	header.numLevels = static_cast<int>(levelSizes.size());
+	ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	for (const auto& size : levelSizes)
+	{
+		ofs.write(reinterpret_cast<const char*>(&size.first), sizeof(int));
+		ofs.write(reinterpret_cast<const char*>(&size.second), sizeof(int));
+	}
+
+	// Write tiles for each level
+	// Only the current and the next levels are kept in memory
+	const bool halfFormat = header.format == static_cast<int>(TiledTexelFormat::Half);
+	const size_t bytesPerChannel = halfFormat ? 2 : 1;
+	std::vector<char> tile(tileSize * tileSize * 3 * bytesPerChannel);
+	for (size_t level = 0; level < levelSizes.size(); level++)
+	{
+		const int w = levelSizes[level].first;
+		const int h = levelSizes[level].second;
+		const int tilesX = (w + tileSize - 1) / tileSize;
+		const int tilesY = (h + tileSize - 1) / tileSize;
+		for (int ty = 0; ty < tilesY; ty++)
+		{
+			for (int tx = 0; tx < tilesX; tx++)
+			{
+				for (int y = 0; y < tileSize; y++)
+				{
+					for (int x = 0; x < tileSize; x++)
+					{
+						const int sx = Math::Min(tx * tileSize + x, w - 1);
+						const int sy = Math::Min(ty * tileSize + y, h - 1);
+						for (int c = 0; c < 3; c++)
+						{
+							const auto v = data[3 * (w * sy + sx) + c];
+							const size_t i = 3 * (tileSize * y + x) + c;
+							if (halfFormat)
+							{
+								const auto hv = HalfUtils::FloatToHalf(v);
+								std::memcpy(&tile[2 * i], &hv, sizeof(hv));
+							}
+							else
+							{
+								tile[i] = static_cast<char>(static_cast<unsigned char>(Math::Clamp(static_cast<int>(v * 255.0f + 0.5f), 0, 255)));
+							}
+						}
+					}
+				}
+
+				ofs.write(&tile[0], tile.size());
+			}
+		}
+
+		// Create next level with 2x2 box filter
+		if (level + 1 < levelSizes.size())
+		{
+			const int nw = levelSizes[level + 1].first;
+			const int nh = levelSizes[level + 1].second;
+			std::vector<float> next(3 * nw * nh);
+			for (int y = 0; y < nh; y++)
+			{
+				for (int x = 0; x < nw; x++)
+				{
+					const int x0 = Math::Min(2 * x, w - 1), x1 = Math::Min(2 * x + 1, w - 1);
+					const int y0 = Math::Min(2 * y, h - 1), y1 = Math::Min(2 * y + 1, h - 1);
+					for (int c = 0; c < 3; c++)
+					{
+						next[3 * (nw * y + x) + c] = 0.25f * (
+							data[3 * (w * y0 + x0) + c] + data[3 * (w * y0 + x1) + c] +
+							data[3 * (w * y1 + x0) + c] + data[3 * (w * y1 + x1) + c]);
+					}
+				}
+			}
+			data.swap(next);
+		}
+	}
+
+	if (!ofs)
+	{
+		LM_LOG_ERROR("Failed to write tiled file " + tiledPath);
+		return false;
+	}
+
+	return true;
+}
+
+bool TiledBitmapTexture::OpenTiledFile( const std::string& tiledPath, bool verticalFlip, int tileSize )
+{
+	std::lock_guard<std::mutex> lock(fileMutex);
+	TextureTileCache::Instance().UnregisterTexture(textureID);
+
+	file.close();
+	file.clear();
+	file.open(tiledPath, std::ios::in | std::ios::binary);
+	if (!file)
+	{
+		LM_LOG_ERROR("Failed to open tiled file " + tiledPath);
+		return false;
+	}
+
+	// Read header
+	TiledFileHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || std::memcmp(header.magic, TiledFileMagic, sizeof(header.magic)) != 0 || header.version != TiledFileVersion)
+	{
+		LM_LOG_WARN("Invalid tiled file " + tiledPath);
+		return false;
+	}
+	if (header.tileSize != tileSize || (header.verticalFlip != 0) != verticalFlip)
+	{
+		LM_LOG_WARN("Tiled file " + tiledPath + " is inconsistent with the configuration");
+		return false;
+	}
+
+	format = static_cast<TiledTexelFormat>(header.format);
+	this->tileSize = header.tileSize;
+	tileBytes = static_cast<size_t>(tileSize * tileSize * 3) * (format == TiledTexelFormat::Half ? 2 : 1);
+
+	// Read levels
+	levels.clear();
+	int numTiles = 0;
+	for (int i = 0; i < header.numLevels; i++)
+	{
+		Level level;
+		file.read(reinterpret_cast<char*>(&level.width), sizeof(int));
+		file.read(reinterpret_cast<char*>(&level.height), sizeof(int));
+		level.tilesX = (level.width + tileSize - 1) / tileSize;
+		level.tilesY = (level.height + tileSize - 1) / tileSize;
+		level.firstTile = numTiles;
+		numTiles += level.tilesX * level.tilesY;
+		levels.push_back(level);
+	}
+
+	if (!file || levels.empty())
+	{
+		LM_LOG_WARN("Invalid tiled file " + tiledPath);
+		return false;
+	}
+
+	dataOffset = static_cast<long long>(file.tellg());
+	LM_LOG_INFO("Loaded tiled file " + tiledPath + " (" + std::to_string(levels[0].width) + "x" + std::to_string(levels[0].height) + ", " + std::to_string(levels.size()) + " levels, " + std::to_string(numTiles) + " tiles)");
+
+	return true;
+}
+
+bool TiledBitmapTexture::LoadTile( int tileIndex, TextureTileCache::TileData& data ) const
+{
+	std::lock_guard<std::mutex> lock(fileMutex);
+	data.resize(tileBytes);
+	file.seekg(dataOffset + static_cast<long long>(tileIndex) * static_cast<long long>(tileBytes));
+	file.read(reinterpret_cast<char*>(&data[0]), tileBytes);
+	if (!file)
+	{
+		file.clear();
+		LM_LOG_ERROR("Failed to read tile " + std::to_string(tileIndex));
+		return false;
+	}
+
+	return true;
+}
+
+std::shared_ptr<const TextureTileCache::TileData> TiledBitmapTexture::Tile( int level, int tileX, int tileY ) const
+{
+	const int tileIndex = levels[level].firstTile + levels[level].tilesX * tileY + tileX;
+	return TextureTileCache::Instance().Lookup(textureID, tileIndex, [this, tileIndex](TextureTileCache::TileData& data)
+	{
+		return LoadTile(tileIndex, data);
+	});
+}
+
+Math::Vec3 TiledBitmapTexture::Texel( const TextureTileCache::TileData* tile, int x, int y ) const
+{
+	if (!tile)
+	{
+		return Math::Vec3();
+	}
+
+	const size_t i = 3 * (tileSize * (y % tileSize) + (x % tileSize));
+	if (format == TiledTexelFormat::Half)
+	{
+		unsigned short v[3];
+		std::memcpy(v, &(*tile)[2 * i], sizeof(v));
+		return Math::Vec3(Math::Float(HalfUtils::HalfToFloat(v[0])), Math::Float(HalfUtils::HalfToFloat(v[1])), Math::Float(HalfUtils::HalfToFloat(v[2])));
+	}
+
+	const auto* v = &(*tile)[i];
+	return Math::Vec3(Math::Float(v[0]), Math::Float(v[1]), Math::Float(v[2])) / Math::Float(255);
+}
+
+Math::Vec3 TiledBitmapTexture::EvaluateBilinear( int level, const Math::Vec2& uv ) const
+{
+	// 'repeat' texture coordinates
+	const auto& l = levels[level];
+	const auto x = Math::Fract(uv.x) * Math::Float(l.width) - Math::Float(0.5);
+	const auto y = Math::Fract(uv.y) * Math::Float(l.height) - Math::Float(0.5);
+	const auto fx = std::floor(x);
+	const auto fy = std::floor(y);
+	const auto dx = x - fx;
+	const auto dy = y - fy;
+	const int x0 = (static_cast<int>(fx) + l.width) % l.width;
+	const int y0 = (static_cast<int>(fy) + l.height) % l.height;
+	const int x1 = (x0 + 1) % l.width;
+	const int y1 = (y0 + 1) % l.height;
+
+	// Resolve the tiles of the footprint
+	// The four texels are usually in the same tile, so each distinct tile is looked up only once
+	const int tx0 = x0 / tileSize, tx1 = x1 / tileSize;
+	const int ty0 = y0 / tileSize, ty1 = y1 / tileSize;
+	const auto tile00 = Tile(level, tx0, ty0);
+	const auto tile10 = tx1 == tx0 ? tile00 : Tile(level, tx1, ty0);
+	const auto tile01 = ty1 == ty0 ? tile00 : Tile(level, tx0, ty1);
+	const auto tile11 = ty1 == ty0 ? tile10 : tx1 == tx0 ? tile01 : Tile(level, tx1, ty1);
+
+	return
+		Texel(tile00.get(), x0, y0) * ((Math::Float(1) - dx) * (Math::Float(1) - dy)) +
+		Texel(tile10.get(), x1, y0) * (dx * (Math::Float(1) - dy)) +
+		Texel(tile01.get(), x0, y1) * ((Math::Float(1) - dx) * dy) +
+		Texel(tile11.get(), x1, y1) * (dx * dy);
+}
+
+Math::Vec3 TiledBitmapTexture::Evaluate( const Math::Vec2& uv ) const
+{
+	return EvaluateBilinear(0, uv);
+}
+
+Math::Vec3 TiledBitmapTexture::Evaluate( const Math::Vec2& uv, const Math::Float& footprint ) const
+{
+	// Choose the levels according to the number of texels in the footprint
+	const int maxLevel = static_cast<int>(levels.size()) - 1;
+	const auto texels = footprint * Math::Float(Math::Max(levels[0].width, levels[0].height));
+	if (!(texels > Math::Float(1)))
+	{
+		return EvaluateBilinear(0, uv);
+	}
+
+	const auto level = Math::Min(Math::Float(std::log2(texels)), Math::Float(maxLevel));
+	const int level0 = Math::Min(static_cast<int>(level), maxLevel);
+	if (level0 == maxLevel)
+	{
+		return EvaluateBilinear(maxLevel, uv);
+	}
+
+	// Trilinear filtering
+	const auto t = level - Math::Float(level0);
+	return EvaluateBilinear(level0, uv) * (Math::Float(1) - t) + EvaluateBilinear(level0 + 1, uv) * t;
+}
+
+LM_COMPONENT_REGISTER_IMPL(TiledBitmapTexture, Texture);
+
+LM_NAMESPACE_END
\ No newline at end of file
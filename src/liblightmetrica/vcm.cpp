@@ -0,0 +1,358 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+#include <lightmetrica/renderer.h>
+#include <lightmetrica/renderproc.h>
+#include <lightmetrica/bpt.subpath.h>
+#include <lightmetrica/bpt.fullpath.h>
+#include <lightmetrica/bpt.pool.h>
+#include <lightmetrica/bpt.lighttracer.h>
+#include <lightmetrica/bpt.connection.h>
+#include <lightmetrica/vcm.utils.h>
+#include <lightmetrica/hashgrid.h>
+#include <lightmetrica/confignode.h>
+#include <lightmetrica/logger.h>
+#include <lightmetrica/configurablesampler.h>
+#include <lightmetrica/generalizedbsdf.h>
+#include <lightmetrica/camera.h>
+#include <lightmetrica/scene.h>
+#include <lightmetrica/ray.h>
+#include <lightmetrica/film.h>
+#include <lightmetrica/align.h>
+#include <lightmetrica/renderutils.h>
+
+LM_NAMESPACE_BEGIN
+
+/*!
+	Vertex connection and merging renderer.
+	Combines the vertex connection of bidirectional path tracing and
+	the vertex merging of progressive photon mapping with multiple importance sampling.
+	The rendering is separated into iterations. In each iteration the light sub-paths
+	are traced in parallel and their vertices are stored in a hash grid.
+	Then each sample of the iteration samples an eye sub-path and a light sub-path,
+	evaluates all strategies connecting the sub-paths as BPT does,
+	and merges the eye vertices with the light vertices in the grid.
+	The merging radius is reduced globally for each iteration as in SPPM.
+	The MIS weights combining both kinds of strategies are evaluated
+	in constant time per full-path (see #VCMUtils).
+	References:
+	  - I. Georgiev et al., Light transport simulation with vertex connection and merging,
+	    ACM Transactions on Graphics (Procs. of SIGGRAPH Asia 2012), 31(6), 2012.
+	  - T. Hachisuka et al., A path space extension for robust light transport simulation,
+	    ACM Transactions on Graphics (Procs. of SIGGRAPH Asia 2012), 31(6), 2012.
+*/
+class VCMRenderer final : public Renderer
+{
+private:
+
+	friend class VCMRenderer_RenderProcess;
+
+public:
+
+	LM_COMPONENT_IMPL_DEF("vcm");
+
+public:
+
+	virtual std::string Type() const override { return ImplTypeName(); }
+	virtual bool Configure(const ConfigNode& node, const Assets& assets, const Scene& scene, const RenderProcessScheduler& sched) override;
+	virtual bool Preprocess(const Scene& scene, const RenderProcessScheduler& sched) override;
+	virtual bool Postprocess(const Scene& scene, const RenderProcessScheduler& sched) const override { return true; }
+	virtual RenderProcess* CreateRenderProcess(const Scene& scene, int threadID, int numThreads) override;
+	virtual long long NumSamplesPerIteration() const override { return numSamplesPerIteration; }
+	virtual bool PreprocessIteration(const Scene& scene, long long iteration) override;
+	virtual boost::signals2::connection Connect_ReportProgress(const std::function<void(double, bool)>& func) override { return signal_ReportProgress.connect(func); }
+
+private:
+
+	boost::signals2::signal<void (double, bool)> signal_ReportProgress;
+
+private:
+
+	int rrDepth;												// Depth of beginning RR
+	int maxPathVertices;										// Maximum number of light path vertices
+	long long numSamplesPerIteration;							// Number of samples (and light sub-paths for merging) of an iteration
+	Math::Float initialRadius;									// Merging radius in the first iteration
+	Math::Float alpha;											// Parameter to control the reduction of the radius
+	std::unique_ptr<ConfigurableSampler> initialSampler;		// Sampler
+
+private:
+
+	typedef BPTLightSubpathTracer<VCMLightVertex> LightSubpathTracer;
+	typedef HashGrid<VCMLightVertex> LightVertexGrid;
+
+	LightSubpathTracer lightTracer;								// Light sub-path tracer holding the light vertices of the current iteration
+	LightVertexGrid lightVertexGrid;							// Hash grid of the light vertices of the current iteration
+	Math::Float radius2;										// Squared merging radius of the current iteration
+	Math::Float eta;											// Ratio of the PDFs of merging and connection strategies, i.e., \pi r^2 * #light sub-paths
+
+};
+
+// --------------------------------------------------------------------------------
+
+/*!
+	Render process for VCMRenderer.
+	The class is responsible for per-thread execution of the samples of the iterations.
+*/
+class VCMRenderer_RenderProcess final : public SamplingBasedRenderProcess
+{
+public:
+
+	VCMRenderer_RenderProcess(const VCMRenderer& renderer, Sampler* sampler, Film* film)
+		: renderer(renderer)
+		, sampler(sampler)
+		, film(film)
+		, sampleIndex(0)
+		, subpathL(TransportDirection::LE)
+		, subpathE(TransportDirection::EL)
+	{
+
+	}
+
+private:
+
+	LM_DISABLE_COPY_AND_MOVE(VCMRenderer_RenderProcess);
+
+public:
+
+	virtual void ProcessSingleSample(const Scene& scene) override;
+	virtual const Film* GetFilm() const override { return film.get(); }
+	virtual void SetSampleIndex(long long index) override { sampleIndex = index; }
+
+private:
+
+	const VCMRenderer& renderer;
+	std::unique_ptr<Sampler> sampler;
+	std::unique_ptr<Film> film;
+	long long sampleIndex;
+
+private:
+
+	// Sub-paths are reused in the same thread in order to
+	// avoid unnecessary memory allocation
+	BPTPathVertexPool pool;			//!< Memory pool for path vertices
+	BPTSubpath subpathL;			//!< Light subpath
+	BPTSubpath subpathE;			//!< Eye subpath
+	std::vector<Math::Float> mergePartialSumsL;		//!< Partial sums of the merging strategies for #subpathL
+	std::vector<Math::Float> mergePartialSumsE;		//!< Partial sums of the merging strategies for #subpathE
+
+	// Contributions of a sample are accumulated to the film at once
+	std::vector<Splat, aligned_allocator<Splat, std::alignment_of<Splat>::value>> splats;		//!< Splats of the current sample
+
+	// Shadow rays of all connections of a sample are traced in a batch
+	BPTConnectionBatch connectionBatch;		//!< Connections of the current sample
+
+};
+
+// --------------------------------------------------------------------------------
+
+bool VCMRenderer::Configure(const ConfigNode& node, const Assets& assets, const Scene& scene, const RenderProcessScheduler& sched)
+{
+	// Load parameters
+	node.ChildValueOrDefault("rr_depth", 1, rrDepth);
+	node.ChildValueOrDefault("max_path_vertices", -1, maxPathVertices);
+
+	// 'num_samples_per_iteration'
+	// Defaults to the number of pixels, i.e., one sample per pixel in average.
+	// The same number of light sub-paths are traced for vertex merging in each iteration.
+	const auto* film = scene.MainCamera()->GetFilm();
+	node.ChildValueOrDefault("num_samples_per_iteration", static_cast<long long>(film->Width()) * film->Height(), numSamplesPerIteration);
+	if (numSamplesPerIteration <= 0)
+	{
+		LM_LOG_ERROR("Invalid value for 'num_samples_per_iteration'");
+		return false;
+	}
+
+	// 'initial_radius' and 'alpha'
+	node.ChildValueOrDefault("initial_radius", Math::Float(0.1), initialRadius);
+	node.ChildValueOrDefault("alpha", Math::Float(0.7), alpha);
+	if (initialRadius <= Math::Float(0))
+	{
+		LM_LOG_ERROR("Invalid value for 'initial_radius'");
+		return false;
+	}
+	if (alpha <= Math::Float(0) || alpha >= Math::Float(1))
+	{
+		LM_LOG_ERROR("Invalid value for 'alpha'. The value must be in (0, 1)");
+		return false;
+	}
+
+	// Sampler
+	auto samplerNode = node.Child("sampler");
+	auto samplerNodeType = samplerNode.AttributeValue("type");
+	if (samplerNodeType != "random" && samplerNodeType != "sobol" && samplerNodeType != "halton")
+	{
+		LM_LOG_ERROR("Invalid sampler type. This renderer requires 'random', 'sobol', or 'halton' sampler");
+		return false;
+	}
+	initialSampler.reset(ComponentFactory::Create<ConfigurableSampler>(samplerNodeType));
+	if (initialSampler == nullptr || !initialSampler->Configure(samplerNode, assets))
+	{
+		LM_LOG_ERROR("Invalid sampler");
+		return false;
+	}
+
+	return true;
+}
+
+bool VCMRenderer::Preprocess(const Scene& scene, const RenderProcessScheduler& sched)
+{
+	signal_ReportProgress(0, false);
+
+	// Light sub-paths of the iterations are traced in parallel,
+	// where each thread has its own sampler and buffer of light vertices
+	lightTracer.Initialize(*initialSampler);
+
+	radius2 = initialRadius * initialRadius;
+	signal_ReportProgress(1, true);
+	return true;
+}
+
+bool VCMRenderer::PreprocessIteration(const Scene& scene, long long iteration)
+{
+	// Radius reduction [Knaus & Zwicker 2011]
+	radius2 = RenderUtils::ProgressiveRadius2(radius2, initialRadius, alpha, iteration);
+
+	// The number of the light sub-paths for merging is same as the number of samples
+	eta = Math::Constants::Pi() * radius2 * Math::Float(numSamplesPerIteration);
+
+	// Trace light sub-paths and store the vertices which can be merged
+	// The buffer of the partial sums is captured by value so that each thread has its own copy
+	std::vector<Math::Float> mergePartialSums;
+	lightTracer.Trace(scene, numSamplesPerIteration, rrDepth, maxPathVertices, [mergePartialSums](const BPTSubpath& subpath, VCMLightVertices& vertices) mutable
+	{
+		VCMUtils::EvaluateMergePartialSums(subpath, mergePartialSums);
+		VCMUtils::AppendLightVertices(subpath, mergePartialSums, vertices);
+	});
+
+	// Build hash grid specialized for the merging radius
+	lightVertexGrid.Build(lightTracer.Vertices(), Math::Float(2) * std::sqrt(radius2));
+
+	return true;
+}
+
+RenderProcess* VCMRenderer::CreateRenderProcess(const Scene& scene, int threadID, int numThreads)
+{
+	auto* sampler = initialSampler->Clone();
+	sampler->SetSeed(initialSampler->NextUInt());
+	return new VCMRenderer_RenderProcess(*this, sampler, scene.MainCamera()->GetFilm()->Clone());
+}
+
+// --------------------------------------------------------------------------------
+
+void VCMRenderer_RenderProcess::ProcessSingleSample(const Scene& scene)
+{
+	// Release and clear paths
+	pool.Release();
+	subpathL.Clear();
+	subpathE.Clear();
+	splats.clear();
+	connectionBatch.Clear();
+
+	// Sample sub-paths
+	// The dimensions are same as BidirectionalPathtraceRenderer
+	const auto rasterPos = RenderUtils::BeginSample(*sampler, *film, sampleIndex++);
+	subpathL.Sample(scene, *sampler, pool, renderer.rrDepth, renderer.maxPathVertices, 2, nullptr);
+	subpathE.Sample(scene, *sampler, pool, renderer.rrDepth, renderer.maxPathVertices, 8, &rasterPos);
+	VCMUtils::EvaluateMergePartialSums(subpathL, mergePartialSumsL);
+	VCMUtils::EvaluateMergePartialSums(subpathE, mergePartialSumsE);
+
+	// --------------------------------------------------------------------------------
+
+	// # Vertex connection
+	// Evaluated in the same way as BidirectionalPathtraceRenderer,
+	// where the shadow rays of the connections are traced in a batch
+	connectionBatch.AddFullPaths(scene, subpathL, subpathE, renderer.maxPathVertices, [this](const BPTFullPath& fullPath)
+	{
+		return VCMUtils::EvaluateConnectionMISWeight(fullPath, mergePartialSumsL, mergePartialSumsE, renderer.eta);
+	});
+
+	connectionBatch.TraceShadowRays(scene);
+	for (const auto& connection : connectionBatch.Connections())
+	{
+		if (connectionBatch.Occluded(connection))
+		{
+			continue;
+		}
+
+		splats.emplace_back(connection.rasterPosition, connection.weight * connection.Cstar);
+	}
+
+	// --------------------------------------------------------------------------------
+
+	// # Vertex merging
+	// Merges the eye sub-path vertex z_{t-1} (t >= 2) with the light vertices within the radius.
+	// The contribution of a merged full-path is \alpha^L_{k+1} f_s(z_{t-1}) \alpha^E_t / \eta
+	// where the merging kernel is constant 1 / (\pi r^2).
+	const int nE = static_cast<int>(subpathE.vertices.size());
+	for (int t = 2; t <= nE; t++)
+	{
+		const auto* z = subpathE.vertices[t-1];
+		if ((z->bsdf->BSDFTypes() & GeneralizedBSDFType::NonDelta) == 0)
+		{
+			continue;
+		}
+
+		Math::Vec2 rasterPosition;
+		const auto alphaE = subpathE.EvaluateSubpathAlpha(t, rasterPosition);
+		if (Math::IsZero(alphaE))
+		{
+			continue;
+		}
+
+		Math::Vec3 L;
+		auto maxDist2 = renderer.radius2;
+		renderer.lightVertexGrid.Traverse(z->geom.p, maxDist2, [&](const VCMLightVertex& y, Math::Float /*dist2*/, Math::Float& /*maxDist2*/)
+		{
+			// The merged full-path has k + t vertices
+			if (renderer.maxPathVertices != -1 && y.numVertices + t - 1 > renderer.maxPathVertices)
+			{
+				return;
+			}
+
+			GeneralizedBSDFEvaluateQuery bsdfEQ;
+			bsdfEQ.type = GeneralizedBSDFType::NonDelta;
+			bsdfEQ.transportDir = TransportDirection::EL;
+			bsdfEQ.wi = z->wi;
+			bsdfEQ.wo = y.wi;
+			const auto fs = z->bsdf->EvaluateDirection(bsdfEQ, z->geom);
+			if (Math::IsZero(fs))
+			{
+				return;
+			}
+
+			L += VCMUtils::EvaluateMergingMISWeight(z, mergePartialSumsE[t-1], y, renderer.eta) * fs * y.throughput;
+		});
+
+		if (!Math::IsZero(L))
+		{
+			splats.emplace_back(rasterPosition, alphaE * L / renderer.eta);
+		}
+	}
+
+	// Accumulate contributions to the film
+	if (!splats.empty())
+	{
+		film->AccumulateContributions(&splats[0], splats.size(), Math::Float(1));
+	}
+}
+
+LM_COMPONENT_REGISTER_IMPL(VCMRenderer, Renderer);
+
+LM_NAMESPACE_END
\ No newline at end of file
@@ -0,0 +1,165 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+#include <lightmetrica/vcm.utils.h>
+#include <lightmetrica/bpt.subpath.h>
+#include <lightmetrica/bpt.fullpath.h>
+#include <lightmetrica/generalizedbsdf.h>
+#include <lightmetrica/renderutils.h>
+
+LM_NAMESPACE_BEGIN
+
+void VCMUtils::EvaluateMergePartialSums( const BPTSubpath& subpath, std::vector<Math::Float>& sums )
+{
+	const int n = static_cast<int>(subpath.vertices.size());
+	const int dir = subpath.transportDir;
+	sums.resize(n);
+	if (n == 0)
+	{
+		return;
+	}
+
+	sums[0] = Math::Float(0);
+	for (int k = 1; k < n; k++)
+	{
+		const auto* pv = subpath.vertices[k-1];
+		const Math::Float m = k >= 2 && (pv->bsdf->BSDFTypes() & GeneralizedBSDFType::NonDelta) != 0 ? Math::Float(1) : Math::Float(0);
+		const auto pvPdfD = pv->pdfD[dir].v;
+		const auto pvPdfDRev = pv->pdfD[1-dir].v;
+		sums[k] = !Math::IsZero(pvPdfD) ? (m + pvPdfDRev * pvPdfDRev * sums[k-1]) / (pvPdfD * pvPdfD) : Math::Float(0);
+	}
+}
+
+void VCMUtils::AppendLightVertices( const BPTSubpath& subpath, const std::vector<Math::Float>& mergeSums, VCMLightVertices& vertices )
+{
+	// The vertex on the light (k = 0) cannot be merged
+	const int n = static_cast<int>(subpath.vertices.size());
+	for (int k = 1; k < n; k++)
+	{
+		const auto* v = subpath.vertices[k];
+		if ((v->bsdf->BSDFTypes() & GeneralizedBSDFType::NonDelta) == 0)
+		{
+			continue;
+		}
+
+		Math::Vec2 rasterPosition;
+		VCMLightVertex lightVertex;
+		lightVertex.throughput = subpath.EvaluateSubpathAlpha(k + 1, rasterPosition);
+		if (Math::IsZero(lightVertex.throughput))
+		{
+			break;
+		}
+
+		lightVertex.p = v->geom.p;
+		lightVertex.wi = v->wi;
+		lightVertex.misInvPdfSq = v->misInvPdfSq;
+		lightVertex.misPartialSum = v->misPartialSum;
+		lightVertex.misMergePartialSum = mergeSums[k];
+		lightVertex.numVertices = k + 1;
+		vertices.push_back(lightVertex);
+	}
+}
+
+Math::Float VCMUtils::EvaluateConnectionMISWeight( const BPTFullPath& fullPath, const std::vector<Math::Float>& mergePartialSumsL, const std::vector<Math::Float>& mergePartialSumsE, const Math::Float& eta )
+{
+	const int s = fullPath.s;
+	const int t = fullPath.t;
+	const auto eta2 = eta * eta;
+
+	// Sum of (p_i/p_s)^2 for the strategies other than p_s
+	// The merging at the endpoints of the full-path is not possible
+	Math::Float sumL(0);
+	Math::Float sumE(0);
+
+	if (s == 0)
+	{
+		const auto* z = fullPath.eyeSubpath.vertices[t-1];
+		const auto pdfA = z->pdfP.v;
+		const auto pdfDRev = fullPath.pdfDE[TransportDirection::LE].v;
+		sumE = pdfA * pdfA * (z->misInvPdfSq + pdfDRev * pdfDRev * (z->misPartialSum + eta2 * mergePartialSumsE[t-1]));
+	}
+	else if (t == 0)
+	{
+		const auto* y = fullPath.lightSubpath.vertices[s-1];
+		const auto pdfA = y->pdfP.v;
+		const auto pdfDRev = fullPath.pdfDL[TransportDirection::EL].v;
+		sumL = pdfA * pdfA * (y->misInvPdfSq + pdfDRev * pdfDRev * (y->misPartialSum + eta2 * mergePartialSumsL[s-1]));
+	}
+	else
+	{
+		const auto* y = fullPath.lightSubpath.vertices[s-1];
+		const auto* z = fullPath.eyeSubpath.vertices[t-1];
+		if ((y->bsdf->BSDFTypes() & GeneralizedBSDFType::NonDelta) == 0 || (z->bsdf->BSDFTypes() & GeneralizedBSDFType::NonDelta) == 0)
+		{
+			return Math::Float(0);
+		}
+
+		const auto G = RenderUtils::GeneralizedGeometryTerm(y->geom, z->geom);
+
+		// Light sub-path side
+		// y_{s-1} can be merged if it is not the vertex on the light
+		{
+			const auto pdfAFromE = fullPath.pdfDE[TransportDirection::EL].v * G;
+			const auto pdfDRev = fullPath.pdfDL[TransportDirection::EL].v;
+			const auto m = s >= 2 ? eta2 : Math::Float(0);
+			sumL = pdfAFromE * pdfAFromE * (y->misInvPdfSq + m + pdfDRev * pdfDRev * (y->misPartialSum + eta2 * mergePartialSumsL[s-1]));
+		}
+
+		// Eye sub-path side
+		{
+			const auto pdfAFromL = fullPath.pdfDL[TransportDirection::LE].v * G;
+			const auto pdfDRev = fullPath.pdfDE[TransportDirection::LE].v;
+			const auto m = t >= 2 ? eta2 : Math::Float(0);
+			sumE = pdfAFromL * pdfAFromL * (z->misInvPdfSq + m + pdfDRev * pdfDRev * (z->misPartialSum + eta2 * mergePartialSumsE[t-1]));
+		}
+	}
+
+	return Math::Float(1) / (Math::Float(1) + sumL + sumE);
+}
+
+Math::Float VCMUtils::EvaluateMergingMISWeight( const BPTPathVertex* z, const Math::Float& zMergePartialSum, const VCMLightVertex& y, const Math::Float& eta )
+{
+	// PDFs of sampling y_{k-1} and z_{t-2} from the merged vertex
+	GeneralizedBSDFEvaluateQuery bsdfEQ;
+	bsdfEQ.type = GeneralizedBSDFType::NonDelta;
+	bsdfEQ.transportDir = TransportDirection::EL;
+	bsdfEQ.wi = z->wi;
+	bsdfEQ.wo = y.wi;
+	const auto pdfDRevL = z->bsdf->EvaluateDirectionPDF(bsdfEQ, z->geom).v;
+
+	bsdfEQ.transportDir = TransportDirection::LE;
+	bsdfEQ.wi = y.wi;
+	bsdfEQ.wo = z->wi;
+	const auto pdfDRevE = z->bsdf->EvaluateDirectionPDF(bsdfEQ, z->geom).v;
+
+	// Sum of (p_i/p_{VM})^2 where the merging strategy has the PDF \eta p_A(x) p_{k+1} for the merged vertex x.
+	// The connection strategies are relative to the merging strategy by the factor 1 / \eta^2,
+	// and the merging strategy itself is counted once in the light sub-path side.
+	const auto sumVC =
+		y.misInvPdfSq + pdfDRevL * pdfDRevL * y.misPartialSum +
+		z->misInvPdfSq + pdfDRevE * pdfDRevE * z->misPartialSum;
+	const auto sumVM =
+		pdfDRevL * pdfDRevL * y.misMergePartialSum +
+		pdfDRevE * pdfDRevE * zMergePartialSum;
+
+	return Math::Float(1) / (Math::Float(1) + sumVC / (eta * eta) + sumVM);
+}
+
+LM_NAMESPACE_END
\ No newline at end of file
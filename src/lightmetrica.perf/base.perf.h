@@ -23,4 +23,28 @@
 
 #include <lightmetrica.test/base.h>
 
+LM_NAMESPACE_BEGIN
+LM_TEST_NAMESPACE_BEGIN
+
+/*
+	Measure the elapsed time of a benchmark.
+	Prints the elapsed time, the time per operation, and the value returned by #func
+	(e.g. a sum of the results in order to prevent the computation to be optimized away).
+	\param name Name of the benchmark.
+	\param count Number of operations in #func.
+	\param func Benchmark function returning a value convertible to double.
+*/
+template <typename Func>
+void MeasurePerformance(const std::string& name, long long count, const Func& func)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	auto result = static_cast<double>(func());
+	auto end = std::chrono::high_resolution_clock::now();
+	double elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()) / 1000.0;
+	std::cout << boost::str(boost::format("%-32s : %10.3f ms (%6.3f ns/op, result = %f)") % name % elapsed % (elapsed * 1e6 / count) % result) << std::endl;
+}
+
+LM_TEST_NAMESPACE_END
+LM_NAMESPACE_END
+
 #endif // __LM_PERF_BASE_PERF_H__
@@ -0,0 +1,95 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "pch.h"
+#include "base.perf.h"
+#include <lightmetrica/math.distribution.h>
+#include <lightmetrica/random.h>
+
+LM_NAMESPACE_BEGIN
+LM_TEST_NAMESPACE_BEGIN
+
+/*
+	Microbenchmark of discrete distributions.
+	Compares the construction and the sampling of
+	the CDF-based distribution (binary search) and the alias table.
+*/
+class DiscreteDistributionPerfTest : public TestBase
+{
+protected:
+
+	template <typename Distribution>
+	void Run(const std::string& name, const std::vector<Math::Float>& values, const std::vector<Math::Float>& samples)
+	{
+		Distribution dist;
+		MeasurePerformance(name + " (build)", static_cast<long long>(values.size()), [&]()
+		{
+			dist.Clear();
+			for (const auto& v : values)
+			{
+				dist.Add(v);
+			}
+			dist.Normalize();
+			return 0.0;
+		});
+
+		MeasurePerformance(name + " (sample)", static_cast<long long>(samples.size()), [&]()
+		{
+			double sum = 0;
+			for (const auto& u : samples)
+			{
+				sum += static_cast<double>(dist.Sample(u));
+			}
+			return sum;
+		});
+	}
+
+protected:
+
+	static const int NumSamples = 1 << 24;
+
+};
+
+TEST_F(DiscreteDistributionPerfTest, Sample)
+{
+	std::unique_ptr<Random> rng(ComponentFactory::Create<Random>("sfmt"));
+	rng->SetSeed(1);
+
+	std::vector<Math::Float> samples(NumSamples);
+	rng->Fill(&samples[0], NumSamples);
+
+	// Number of elements, e.g., number of triangles of an area light
+	const int Sizes[] = { 1 << 4, 1 << 10, 1 << 16, 1 << 20 };
+	for (int size : Sizes)
+	{
+		std::vector<Math::Float> values(size);
+		for (auto& v : values)
+		{
+			v = rng->Next();
+		}
+
+		std::cout << "Number of elements : " << size << std::endl;
+		Run<Math::DiscreteDistribution1D>("cdf", values, samples);
+		Run<Math::DiscreteAliasDistribution1D>("alias", values, samples);
+	}
+}
+
+LM_TEST_NAMESPACE_END
+LM_NAMESPACE_END
\ No newline at end of file
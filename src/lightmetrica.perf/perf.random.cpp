@@ -0,0 +1,98 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+#include "base.perf.h"
+#include <lightmetrica/random.h>
+#include <lightmetrica/configurablesampler.h>
+#include <lightmetrica.test/stub.config.h>
+#include <lightmetrica.test/stub.assets.h>
+
+LM_NAMESPACE_BEGIN
+LM_TEST_NAMESPACE_BEGIN
+
+/*
+	Microbenchmark of random number generation.
+	Compares generating numbers one by one via virtual function calls,
+	bulk generation with Random::Fill, and the buffered random sampler.
+*/
+class RandomPerfTest : public TestBase
+{
+protected:
+
+	static const long long Count = 1LL<<26;
+
+};
+
+TEST_F(RandomPerfTest, Generate)
+{
+	const std::string RngTypes[] = { "standardmt", "sfmt", "philox" };
+	for (const auto& rngType : RngTypes)
+	{
+		std::unique_ptr<Random> rng(ComponentFactory::Create<Random>(rngType));
+
+		// Numbers one by one
+		rng->SetSeed(1);
+		MeasurePerformance(rngType + " (Next)", Count, [&]()
+		{
+			double sum = 0;
+			for (long long i = 0; i < Count; i++)
+			{
+				sum += rng->Next();
+			}
+			return sum;
+		});
+
+		// Bulk generation
+		rng->SetSeed(1);
+		MeasurePerformance(rngType + " (Fill)", Count, [&]()
+		{
+			const size_t BufferSize = 1024;
+			std::vector<Math::Float> buffer(BufferSize);
+			double sum = 0;
+			for (long long i = 0; i < Count; i += BufferSize)
+			{
+				rng->Fill(&buffer[0], BufferSize);
+				for (const auto& v : buffer)
+				{
+					sum += v;
+				}
+			}
+			return sum;
+		});
+
+		// Buffered sampler
+		StubConfig config;
+		StubAssets assets;
+		std::unique_ptr<ConfigurableSampler> sampler(ComponentFactory::Create<ConfigurableSampler>("random"));
+		ASSERT_TRUE(sampler->Configure(config.LoadFromStringAndGetFirstChild("<sampler type=\"random\"><rng>" + rngType + "</rng><rng_seed>1</rng_seed></sampler>"), assets));
+		MeasurePerformance(rngType + " (sampler)", Count, [&]()
+		{
+			double sum = 0;
+			for (long long i = 0; i < Count; i++)
+			{
+				sum += sampler->Next();
+			}
+			return sum;
+		});
+	}
+}
+
+LM_TEST_NAMESPACE_END
+LM_NAMESPACE_END
@@ -0,0 +1,148 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.test.h"
+#include <lightmetrica.test/base.h>
+#include <lightmetrica.test/base.math.h>
+#include <lightmetrica/bitmapwriter.h>
+#include <lightmetrica/bitmap.h>
+
+LM_NAMESPACE_BEGIN
+LM_TEST_NAMESPACE_BEGIN
+
+class BitmapImageWriterTest : public TestBase
+{
+public:
+
+	BitmapImageWriterTest()
+		: width(13)
+		, height(7)
+	{
+		auto& data = image.InternalData();
+		for (int i = 0; i < width * height * 3; i++)
+		{
+			data.push_back(Math::Float(i) / Math::Float(width * height * 3));
+		}
+	}
+
+protected:
+
+	int width;
+	int height;
+	BitmapImage image;
+
+};
+
+TEST_F(BitmapImageWriterTest, ConvertToFloat)
+{
+	const Math::Float weight(2);
+	std::vector<float> result(width * height * 3);
+	BitmapImageWriter::ConvertToFloat(image, width, height, weight, reinterpret_cast<unsigned char*>(&result[0]), width * 3 * sizeof(float));
+
+	const auto& data = image.InternalData();
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		EXPECT_TRUE(ExpectNear(data[i] * weight, Math::Float(result[i])));
+	}
+}
+
+TEST_F(BitmapImageWriterTest, ConvertTo8Bit)
+{
+	// Scanlines are padded
+	const size_t pitch = width * 3 + 1;
+	const Math::Float weight(2);
+	std::vector<unsigned char> result(pitch * height);
+
+	const auto& data = image.InternalData();
+	for (int i = 0; i < 2; i++)
+	{
+		const bool bgr = i == 1;
+		BitmapImageWriter::ConvertTo8Bit(image, width, height, weight, BitmapTransferFunction::Gamma, bgr, &result[0], pitch);
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					// Quantization error of the look-up table is at most 1
+					const int expected = static_cast<int>(Math::Clamp(std::pow(static_cast<double>(data[3 * (y * width + x) + c] * weight), 1.0 / 2.2), 0.0, 1.0) * 255.0);
+					const int actual = result[y * pitch + 3 * x + (bgr ? 2 - c : c)];
+					EXPECT_LE(std::abs(expected - actual), 1);
+				}
+			}
+		}
+	}
+}
+
+TEST_F(BitmapImageWriterTest, ConvertTo8Bit_SRGB)
+{
+	BitmapImage image2;
+	auto& data = image2.InternalData();
+	const Math::Float values[] = { Math::Float(-1), Math::Float(0), Math::Float(0.001), Math::Float(0.5), Math::Float(1), Math::Float(10) };
+	for (const auto& v : values)
+	{
+		data.push_back(v);
+	}
+
+	std::vector<unsigned char> result(data.size());
+	BitmapImageWriter::ConvertTo8Bit(image2, 2, 1, Math::Float(1), BitmapTransferFunction::SRGB, false, &result[0], result.size());
+	EXPECT_EQ(0, result[0]);
+	EXPECT_EQ(0, result[1]);
+	EXPECT_LE(std::abs(3 - result[2]), 1);
+	EXPECT_LE(std::abs(187 - result[3]), 1);
+	EXPECT_EQ(255, result[4]);
+	EXPECT_EQ(255, result[5]);
+}
+
+TEST_F(BitmapImageWriterTest, SavePFM)
+{
+	namespace fs = boost::filesystem;
+	const std::string path = (fs::temp_directory_path() / "lightmetrica.test.pfm").string();
+	const Math::Float weight(2);
+	EXPECT_TRUE(BitmapImageWriter::SavePFM(path, image, width, height, weight));
+
+	// Check header
+	std::ifstream ifs(path, std::ios::in | std::ios::binary);
+	ASSERT_TRUE(ifs.is_open());
+	std::string magic;
+	int w, h;
+	float scale;
+	ifs >> magic >> w >> h >> scale;
+	ifs.get();
+	EXPECT_EQ("PF", magic);
+	EXPECT_EQ(width, w);
+	EXPECT_EQ(height, h);
+	EXPECT_GT(0.0f, scale);
+
+	// Check data
+	const auto& data = image.InternalData();
+	std::vector<float> result(data.size());
+	ifs.read(reinterpret_cast<char*>(&result[0]), result.size() * sizeof(float));
+	EXPECT_TRUE(ifs.good());
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		EXPECT_TRUE(ExpectNear(data[i] * weight, Math::Float(result[i])));
+	}
+
+	ifs.close();
+	EXPECT_TRUE(fs::remove(path));
+}
+
+LM_TEST_NAMESPACE_END
+LM_NAMESPACE_END
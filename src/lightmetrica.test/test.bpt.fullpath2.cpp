@@ -20,24 +20,15 @@
 #include "pch.test.h"
 #include <lightmetrica.test/base.h>
 #include <lightmetrica.test/base.math.h>
-#include <lightmetrica.test/stub.config.h>
 #include <lightmetrica.test/testscenes.h>
-#include <lightmetrica/assets.h>
-#include <lightmetrica/texture.h>
-#include <lightmetrica/bsdf.h>
-#include <lightmetrica/trianglemesh.h>
-#include <lightmetrica/film.h>
-#include <lightmetrica/camera.h>
-#include <lightmetrica/light.h>
+#include <lightmetrica.test/testsceneloader.h>
 #include <lightmetrica/confignode.h>
-#include <lightmetrica/scene.h>
 #include <lightmetrica/bpt.subpath.h>
 #include <lightmetrica/bpt.fullpath.h>
 #include <lightmetrica/bpt.pool.h>
 #include <lightmetrica/bpt.mis.h>
 #include <lightmetrica/configurablesampler.h>
 #include <lightmetrica/renderutils.h>
-#include <lightmetrica/primitives.h>
 
 LM_NAMESPACE_BEGIN
 LM_TEST_NAMESPACE_BEGIN
@@ -46,32 +37,17 @@ class BPTFullpathTest2 : public TestBase {};
 
 TEST_F(BPTFullpathTest2, Consistency)
 {
-	StubConfig config;
-	ASSERT_TRUE(config.LoadFromString(TestScenes::Simple03(), ""));
-
-	std::unique_ptr<Assets> assets(ComponentFactory::Create<Assets>());
-	ASSERT_TRUE(assets->RegisterInterface<Texture>());
-	ASSERT_TRUE(assets->RegisterInterface<BSDF>());
-	ASSERT_TRUE(assets->RegisterInterface<TriangleMesh>());
-	ASSERT_TRUE(assets->RegisterInterface<Film>());
-	ASSERT_TRUE(assets->RegisterInterface<Camera>());
-	ASSERT_TRUE(assets->RegisterInterface<Light>());
-	ASSERT_TRUE(assets->Load(config.Root().Child("assets")));
-	
-	std::unique_ptr<Primitives> primitives(ComponentFactory::Create<Primitives>());
-	ASSERT_TRUE(primitives->Load(config.Root().Child("scene"), *assets));
-	std::unique_ptr<Scene> scene(ComponentFactory::Create<Scene>(config.Root().Child("scene").AttributeValue("type")));
-	ASSERT_NE(scene, nullptr);
-	scene->Load(primitives.release());
-	ASSERT_TRUE(scene->Configure(config.Root().Child("scene")));
-	ASSERT_TRUE(scene->Build());
+	TestSceneLoader loader;
+	ASSERT_TRUE(loader.Load(TestScenes::Simple03()));
+	const auto& scene = loader.GetScene();
+	const auto& assets = loader.GetAssets();
 
 	BPTPathVertexPool pool;
 	BPTSubpath subpathL(TransportDirection::LE);
 	BPTSubpath subpathE(TransportDirection::EL);
 
 	std::unique_ptr<ConfigurableSampler> sampler(ComponentFactory::Create<ConfigurableSampler>("random"));
-	ASSERT_TRUE(sampler->Configure(ConfigNode(), *assets));
+	ASSERT_TRUE(sampler->Configure(ConfigNode(), assets));
 	sampler->SetSeed(1);
 
 	const int Samples = 1<<10;
@@ -80,8 +56,8 @@ TEST_F(BPTFullpathTest2, Consistency)
 		pool.Release();
 		subpathL.Clear();
 		subpathE.Clear();
-		subpathL.Sample(*scene, *sampler, pool, 3, -1);
-		subpathE.Sample(*scene, *sampler, pool, 3, -1);
+		subpathL.Sample(scene, *sampler, pool, 3, -1);
+		subpathE.Sample(scene, *sampler, pool, 3, -1);
 
 		const int nL = subpathL.NumVertices();
 		const int nE = subpathE.NumVertices();
@@ -101,7 +77,7 @@ TEST_F(BPTFullpathTest2, Consistency)
 				Math::Float connGeom(-1);
 				if (s > 0 && t > 0)
 				{
-					connGeom = RenderUtils::GeneralizedGeometryTermWithVisibility(*scene, subpathL.Vertex(s-1)->geom, subpathE.Vertex(t-1)->geom);
+					connGeom = RenderUtils::GeneralizedGeometryTermWithVisibility(scene, subpathL.Vertex(s-1)->geom, subpathE.Vertex(t-1)->geom);
 					if (Math::Abs(connGeom) < Math::Constants::Eps())
 					{
 						continue;
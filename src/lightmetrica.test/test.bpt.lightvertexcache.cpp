@@ -0,0 +1,170 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.test.h"
+#include <lightmetrica.test/base.h>
+#include <lightmetrica.test/base.math.h>
+#include <lightmetrica.test/testscenes.h>
+#include <lightmetrica.test/testsceneloader.h>
+#include <lightmetrica/confignode.h>
+#include <lightmetrica/ray.h>
+#include <lightmetrica/bpt.subpath.h>
+#include <lightmetrica/bpt.fullpath.h>
+#include <lightmetrica/bpt.pool.h>
+#include <lightmetrica/bpt.lightvertexcache.h>
+#include <lightmetrica/configurablesampler.h>
+
+LM_NAMESPACE_BEGIN
+LM_TEST_NAMESPACE_BEGIN
+
+class BPTLightVertexCacheTest : public TestBase {};
+
+// Checks if the MIS weights in light vertex cache mode are consistent with
+// the power heuristics with the numbers of samples of the strategies, i.e.,
+// w_s = n_s^2 p_s^2 / \sum_i n_i^2 p_i^2, which sum to one over the strategies of a full-path.
+TEST_F(BPTLightVertexCacheTest, MISWeightConsistency)
+{
+	TestSceneLoader loader;
+	ASSERT_TRUE(loader.Load(TestScenes::Simple03()));
+	const auto& scene = loader.GetScene();
+	const auto& assets = loader.GetAssets();
+
+	BPTPathVertexPool pool;
+	BPTSubpath lightSubpath(TransportDirection::LE);
+	BPTSubpath eyeSubpath(TransportDirection::EL);
+
+	std::unique_ptr<ConfigurableSampler> sampler(ComponentFactory::Create<ConfigurableSampler>("random"));
+	ASSERT_TRUE(sampler->Configure(ConfigNode(), assets));
+	sampler->SetSeed(1);
+
+	// Effective number of connection samples
+	const Math::Float c(2.5);
+
+	std::vector<Math::Float> endpointPartialSumsL, partialSumsL;
+	std::vector<Math::Float> endpointPartialSumsE, partialSumsE;
+	BPTLightVertices lightVertices;
+
+	const int Samples = 1<<12;
+	for (int sample = 0; sample < Samples; sample++)
+	{
+		pool.Release();
+		lightSubpath.Clear();
+		eyeSubpath.Clear();
+		lightSubpath.Sample(scene, *sampler, pool, 3, -1);
+		eyeSubpath.Sample(scene, *sampler, pool, 3, -1);
+
+		BPTLightVertexCache::EvaluatePartialSums(lightSubpath, endpointPartialSumsL, partialSumsL);
+		BPTLightVertexCache::EvaluatePartialSums(eyeSubpath, endpointPartialSumsE, partialSumsE);
+		lightVertices.clear();
+		BPTLightVertexCache::AppendLightVertices(lightSubpath, endpointPartialSumsL, partialSumsL, lightVertices);
+
+		const int nL = lightSubpath.NumVertices();
+		const int nE = eyeSubpath.NumVertices();
+		for (int s = 0; s <= nL; s++)
+		{
+			// The strategies with t = 0 are not sampled
+			for (int t = 1; t <= nE; t++)
+			{
+				const int n = s + t;
+				if (n < 2)
+				{
+					continue;
+				}
+
+				BPTFullPath fullpath(s, t, lightSubpath, eyeSubpath);
+
+				// Calculate contribution same as BPT implementation
+				// in order to exclude zero-contribution cases.
+				Math::Vec2 rasterPosition;
+				auto Cstar = fullpath.EvaluateUnweightContribution(scene, rasterPosition);
+				if (Math::IsZero(Cstar))
+				{
+					continue;
+				}
+
+				// Reference weight
+				// The strategy s = 0 is sampled once, t = 0 is not sampled, and the others are sampled c times
+				Math::Float sum(0);
+				Math::Float ps2(0);
+				for (int i = 0; i <= n; i++)
+				{
+					const auto ni = i == 0 ? Math::Float(1) : i == n ? Math::Float(0) : c;
+					const auto pi = fullpath.EvaluateFullpathPDF(i);
+					sum += ni * ni * pi * pi;
+					if (i == s)
+					{
+						ps2 = ni * ni * pi * pi;
+					}
+				}
+				ASSERT_GT(sum, Math::Float(0));
+				const auto reference = ps2 / sum;
+
+				// Weight evaluated with the light vertex cache
+				Math::Float weight;
+				if (s == 0)
+				{
+					weight = BPTLightVertexCache::EvaluateEndpointMISWeight(fullpath, partialSumsE, c);
+				}
+				else
+				{
+					// Light vertex y_{s-1}
+					const BPTLightVertex* y = nullptr;
+					for (const auto& v : lightVertices)
+					{
+						if (v.numVertices == s)
+						{
+							y = &v;
+						}
+					}
+					if (y == nullptr)
+					{
+						// y_{s-1} cannot be connected
+						EXPECT_TRUE(ExpectNear(Math::Float(0), reference));
+						continue;
+					}
+
+					Math::Vec2 rasterPositionE;
+					const auto alphaE = eyeSubpath.EvaluateSubpathAlpha(t, rasterPositionE);
+					Ray shadowRay;
+					Math::Float weightPerConnection;
+					const auto CstarCached = BPTLightVertexCache::EvaluateConnection(scene, *y, eyeSubpath, t, partialSumsE, alphaE, c, rasterPositionE, shadowRay, weightPerConnection);
+					if (Math::IsZero(CstarCached))
+					{
+						continue;
+					}
+
+					// The weight is divided by the number of connection samples
+					weight = c * weightPerConnection;
+				}
+
+				auto result = ExpectNear(reference, weight);
+				EXPECT_TRUE(result);
+				if (!result)
+				{
+					LM_LOG_DEBUG("s = " + std::to_string(s));
+					LM_LOG_DEBUG("t = " + std::to_string(t));
+					fullpath.DebugPrint();
+				}
+			}
+		}
+	}
+}
+
+LM_TEST_NAMESPACE_END
+LM_NAMESPACE_END
\ No newline at end of file
@@ -0,0 +1,128 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.test.h"
+#include <lightmetrica.test/base.h>
+#include <lightmetrica/halfutils.h>
+#include <cmath>
+#include <limits>
+
+LM_NAMESPACE_BEGIN
+LM_TEST_NAMESPACE_BEGIN
+
+class HalfUtilsTest : public TestBase {};
+
+TEST_F(HalfUtilsTest, FloatToHalf)
+{
+	EXPECT_EQ(0x0000, HalfUtils::FloatToHalf(0.0f));
+	EXPECT_EQ(0x8000, HalfUtils::FloatToHalf(-0.0f));
+	EXPECT_EQ(0x3c00, HalfUtils::FloatToHalf(1.0f));
+	EXPECT_EQ(0x3800, HalfUtils::FloatToHalf(0.5f));
+	EXPECT_EQ(0xc000, HalfUtils::FloatToHalf(-2.0f));
+	EXPECT_EQ(0x7bff, HalfUtils::FloatToHalf(65504.0f));
+	EXPECT_EQ(0x0400, HalfUtils::FloatToHalf(std::ldexp(1.0f, -14)));
+	EXPECT_EQ(0x3555, HalfUtils::FloatToHalf(1.0f / 3.0f));
+}
+
+TEST_F(HalfUtilsTest, FloatToHalf_Rounding)
+{
+	// Rounded to nearest
+	EXPECT_EQ(0x3c01, HalfUtils::FloatToHalf(1.0f + std::ldexp(1.0f, -10) + std::ldexp(1.0f, -12)));
+	EXPECT_EQ(0x3c00, HalfUtils::FloatToHalf(1.0f + std::ldexp(1.0f, -12)));
+
+	// Ties are rounded to even
+	EXPECT_EQ(0x3c00, HalfUtils::FloatToHalf(1.0f + std::ldexp(1.0f, -11)));
+	EXPECT_EQ(0x3c02, HalfUtils::FloatToHalf(1.0f + std::ldexp(3.0f, -11)));
+
+	// Carry to the exponent
+	EXPECT_EQ(0x4000, HalfUtils::FloatToHalf(2.0f - std::ldexp(1.0f, -12)));
+}
+
+TEST_F(HalfUtilsTest, FloatToHalf_Subnormal)
+{
+	EXPECT_EQ(0x0001, HalfUtils::FloatToHalf(std::ldexp(1.0f, -24)));
+	EXPECT_EQ(0x03ff, HalfUtils::FloatToHalf(std::ldexp(1023.0f, -24)));
+	EXPECT_EQ(0x8001, HalfUtils::FloatToHalf(-std::ldexp(1.0f, -24)));
+
+	// Ties are rounded to even
+	EXPECT_EQ(0x0000, HalfUtils::FloatToHalf(std::ldexp(1.0f, -25)));
+	EXPECT_EQ(0x0002, HalfUtils::FloatToHalf(std::ldexp(3.0f, -25)));
+
+	// Rounded up to the smallest normal number
+	EXPECT_EQ(0x0400, HalfUtils::FloatToHalf(std::ldexp(2047.0f, -25)));
+
+	// Too small values become zero
+	EXPECT_EQ(0x0000, HalfUtils::FloatToHalf(std::ldexp(1.0f, -26)));
+	EXPECT_EQ(0x8000, HalfUtils::FloatToHalf(-std::ldexp(1.0f, -30)));
+}
+
+TEST_F(HalfUtilsTest, FloatToHalf_Overflow)
+{
+	// Finite values rounded out of the range become infinity
+	EXPECT_EQ(0x7bff, HalfUtils::FloatToHalf(65519.0f));
+	EXPECT_EQ(0x7c00, HalfUtils::FloatToHalf(65520.0f));
+	EXPECT_EQ(0x7c00, HalfUtils::FloatToHalf(1e6f));
+	EXPECT_EQ(0xfc00, HalfUtils::FloatToHalf(-1e6f));
+	EXPECT_EQ(0x7c00, HalfUtils::FloatToHalf(std::numeric_limits<float>::max()));
+
+	// Infinity and NaN are preserved
+	EXPECT_EQ(0x7c00, HalfUtils::FloatToHalf(std::numeric_limits<float>::infinity()));
+	EXPECT_EQ(0xfc00, HalfUtils::FloatToHalf(-std::numeric_limits<float>::infinity()));
+	const auto nan = HalfUtils::FloatToHalf(std::numeric_limits<float>::quiet_NaN());
+	EXPECT_EQ(0x7c00, nan & 0x7c00);
+	EXPECT_NE(0, nan & 0x3ff);
+}
+
+TEST_F(HalfUtilsTest, HalfToFloat)
+{
+	EXPECT_EQ(0.0f, HalfUtils::HalfToFloat(0x0000));
+	EXPECT_EQ(1.0f, HalfUtils::HalfToFloat(0x3c00));
+	EXPECT_EQ(-2.0f, HalfUtils::HalfToFloat(0xc000));
+	EXPECT_EQ(65504.0f, HalfUtils::HalfToFloat(0x7bff));
+	EXPECT_EQ(std::ldexp(1.0f, -24), HalfUtils::HalfToFloat(0x0001));
+	EXPECT_EQ(std::ldexp(1023.0f, -24), HalfUtils::HalfToFloat(0x03ff));
+	EXPECT_EQ(std::numeric_limits<float>::infinity(), HalfUtils::HalfToFloat(0x7c00));
+	EXPECT_TRUE(std::isnan(HalfUtils::HalfToFloat(0x7e00)));
+}
+
+TEST_F(HalfUtilsTest, RoundTrip)
+{
+	// All finite half precision numbers are preserved
+	for (unsigned int h = 0; h < 0x10000U; h++)
+	{
+		if ((h & 0x7c00U) == 0x7c00U)
+		{
+			continue;
+		}
+
+		const auto v = static_cast<unsigned short>(h);
+		EXPECT_EQ(v, HalfUtils::FloatToHalf(HalfUtils::HalfToFloat(v)));
+	}
+
+	// Representative values are preserved within the precision of half precision numbers
+	const float values[] = { 0.1f, 0.25f, 0.333f, 1.0f, 3.14159f, 100.5f, 1234.5f, 1e-3f, 1e-5f };
+	for (const float v : values)
+	{
+		const float r = HalfUtils::HalfToFloat(HalfUtils::FloatToHalf(v));
+		EXPECT_LE(std::abs(r - v), std::ldexp(std::abs(v), -11) + std::ldexp(1.0f, -25));
+	}
+}
+
+LM_TEST_NAMESPACE_END
+LM_NAMESPACE_END
\ No newline at end of file
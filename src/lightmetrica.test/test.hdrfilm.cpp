@@ -24,6 +24,7 @@
 #include <lightmetrica.test/stub.config.h>
 #include <lightmetrica/bitmapfilm.h>
 #include <lightmetrica/bitmap.h>
+#include <lightmetrica/align.h>
 #include <FreeImage.h>
 
 namespace
@@ -45,6 +46,14 @@ namespace
 		</film>
 	);
 
+	const std::string FilmNode_OpenEXR = LM_TEST_MULTILINE_LITERAL(
+		<film id="test" type="hdr">
+			<width>40</width>
+			<height>30</height>
+			<imagetype>openexr</imagetype>
+		</film>
+	);
+
 	const std::string FilmNode_Fail_MissingElement = LM_TEST_MULTILINE_LITERAL(
 		<film id="test" type="hdr">
 			<height>30</height>
@@ -181,6 +190,46 @@ TEST_F(HDRBitmapFilmTest, AccumulateContribution_2)
 	}
 }
 
+TEST_F(HDRBitmapFilmTest, AccumulateContributions)
+{
+	EXPECT_TRUE(film->Load(config.LoadFromStringAndGetFirstChild(FilmNode_1), assets));
+
+	// A splat for each pixel and some invalid splats
+	std::vector<Splat, aligned_allocator<Splat, std::alignment_of<Splat>::value>> splats;
+	for (int y = 0; y < film->Height(); y++)
+	{
+		for (int x = 0; x < film->Width(); x++)
+		{
+			Math::Vec2 rasterPos(
+				(Math::Float(x) + Math::Float(0.5)) / Math::Float(film->Width()),
+				(Math::Float(y) + Math::Float(0.5)) / Math::Float(film->Height()));
+			splats.emplace_back(rasterPos, Math::Vec3(Math::Float(x), Math::Float(y), Math::Float(1)));
+		}
+		splats.emplace_back(Math::Vec2(Math::Float(-1), Math::Float(0.5)), Math::Vec3(Math::Float(100)));
+		splats.emplace_back(Math::Vec2(Math::Float(0.5), Math::Float(2)), Math::Vec3(Math::Float(100)));
+	}
+
+	// Accumulate #Count times
+	const int Count = 10;
+	for (int i = 0; i < Count; i++)
+	{
+		film->AccumulateContributions(&splats[0], splats.size(), Math::Float(2));
+	}
+
+	// Check data
+	const auto& data = film->Bitmap().InternalData();
+	for (int y = 0; y < film->Height(); y++)
+	{
+		for (int x = 0; x < film->Width(); x++)
+		{
+			int i = y * film->Width() + x;
+			EXPECT_TRUE(ExpectNear(Math::Float(x * Count * 2), data[3*i  ]));
+			EXPECT_TRUE(ExpectNear(Math::Float(y * Count * 2), data[3*i+1]));
+			EXPECT_TRUE(ExpectNear(Math::Float(Count * 2), data[3*i+2]));
+		}
+	}
+}
+
 TEST_F(HDRBitmapFilmTest, Save)
 {
 	// Create a film
@@ -252,6 +301,50 @@ TEST_F(HDRBitmapFilmTest, Save)
 	}
 }
 
+TEST_F(HDRBitmapFilmTest, Save_OpenEXR)
+{
+	// Create a film
+	EXPECT_TRUE(film->Load(config.LoadFromStringAndGetFirstChild(FilmNode_OpenEXR), assets));
+	for (int y = 0; y < film->Height(); y++)
+	{
+		for (int x = 0; x < film->Width(); x++)
+		{
+			Math::Vec2 rasterPos(
+				(Math::Float(x) + Math::Float(0.5)) / Math::Float(film->Width()),
+				(Math::Float(y) + Math::Float(0.5)) / Math::Float(film->Height()));
+			film->RecordContribution(rasterPos, Math::Vec3(Math::Float(x), Math::Float(y), Math::Float(1)));
+		}
+	}
+
+	// Output image to temporary directory
+	namespace fs = boost::filesystem;
+	const std::string path = (fs::temp_directory_path() / "lightmetrica.test.exr").string();
+	EXPECT_TRUE(film->Save(path));
+
+	// Load image with FreeImage and check data
+	// Pixel values are small integers so that they are exactly represented in half
+	const auto& data = film->Bitmap().InternalData();
+	auto* bitmap = FreeImage_Load(FIF_EXR, path.c_str(), 0);
+	ASSERT_NE(nullptr, bitmap);
+	EXPECT_EQ(film->Width(), static_cast<int>(FreeImage_GetWidth(bitmap)));
+	EXPECT_EQ(film->Height(), static_cast<int>(FreeImage_GetHeight(bitmap)));
+	for (int y = 0; y < film->Height(); y++)
+	{
+		FIRGBF* bits = reinterpret_cast<FIRGBF*>(FreeImage_GetScanLine(bitmap, y));
+		for (int x = 0; x < film->Width(); x++)
+		{
+			int i = y * film->Width() + x;
+			EXPECT_TRUE(ExpectNear(data[3*i  ], Math::Float(bits[x].red)));
+			EXPECT_TRUE(ExpectNear(data[3*i+1], Math::Float(bits[x].green)));
+			EXPECT_TRUE(ExpectNear(data[3*i+2], Math::Float(bits[x].blue)));
+		}
+	}
+	FreeImage_Unload(bitmap);
+
+	// Clean up
+	EXPECT_TRUE(fs::remove(path));
+}
+
 TEST_F(HDRBitmapFilmTest, Clone)
 {
 	// Create a film
@@ -282,6 +375,51 @@ TEST_F(HDRBitmapFilmTest, Clone)
 	LM_SAFE_DELETE(film2);
 }
 
+TEST_F(HDRBitmapFilmTest, SharedMode)
+{
+	EXPECT_TRUE(film->Load(config.LoadFromStringAndGetFirstChild(FilmNode_1), assets));
+	film->SetSharedMode(true);
+
+	// Accumulate #Count times to each pixel from per-thread films
+	const int NumThreads = 4;
+	const int Count = 10;
+	std::vector<std::unique_ptr<Film>> threadFilms;
+	for (int i = 0; i < NumThreads; i++)
+	{
+		threadFilms.emplace_back(film->Clone());
+		ASSERT_NE(nullptr, threadFilms.back().get());
+	}
+
+	#pragma omp parallel for
+	for (int i = 0; i < NumThreads; i++)
+	{
+		for (int j = 0; j < Count; j++)
+		{
+			for (int y = 0; y < film->Height(); y++)
+			{
+				for (int x = 0; x < film->Width(); x++)
+				{
+					Math::Vec2 rasterPos(
+						(Math::Float(x) + Math::Float(0.5)) / Math::Float(film->Width()),
+						(Math::Float(y) + Math::Float(0.5)) / Math::Float(film->Height()));
+					threadFilms[i]->AccumulateContribution(rasterPos, Math::Vec3(Math::Float(1)));
+				}
+			}
+		}
+	}
+
+	film->Flush();
+	threadFilms.clear();
+	film->SetSharedMode(false);
+
+	// Check data
+	const auto& data = film->Bitmap().InternalData();
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		EXPECT_TRUE(ExpectNear(Math::Float(NumThreads * Count), data[i]));
+	}
+}
+
 TEST_F(HDRBitmapFilmTest, Allocate)
 {
 	film->SetImageType(BitmapImageType::RadianceHDR);
@@ -0,0 +1,214 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "pch.test.h"
+#include <lightmetrica.test/base.math.h>
+#include <lightmetrica.test/stub.assets.h>
+#include <lightmetrica.test/stub.config.h>
+#include <lightmetrica.test/testscenes.h>
+#include <lightmetrica.test/testsceneloader.h>
+#include <lightmetrica/lightselector.h>
+#include <lightmetrica/light.h>
+#include <lightmetrica/aabb.h>
+
+LM_NAMESPACE_BEGIN
+LM_TEST_NAMESPACE_BEGIN
+
+/*
+	Stub light.
+	A light with given power and bound.
+*/
+class StubLight : public Light
+{
+public:
+
+	LM_COMPONENT_IMPL_DEF("stub");
+
+public:
+
+	StubLight(const Math::Vec3& p, const Math::Float& power, bool environment)
+		: p(p)
+		, power(power)
+		, environment(environment)
+	{
+
+	}
+
+public:
+
+	virtual bool Load(const ConfigNode& node, const Assets& assets) { return true; }
+	virtual bool SampleDirection(const GeneralizedBSDFSampleQuery& query, const SurfaceGeometry& geom, GeneralizedBSDFSampleResult& result) const { return false; }
+	virtual Math::Vec3 SampleAndEstimateDirection(const GeneralizedBSDFSampleQuery& query, const SurfaceGeometry& geom, GeneralizedBSDFSampleResult& result) const { return Math::Vec3(); }
+	virtual bool SampleAndEstimateDirectionBidir(const GeneralizedBSDFSampleQuery& query, const SurfaceGeometry& geom, GeneralizedBSDFSampleBidirResult& result) const { return false; }
+	virtual Math::Vec3 EvaluateDirection(const GeneralizedBSDFEvaluateQuery& query, const SurfaceGeometry& geom) const { return Math::Vec3(); }
+	virtual Math::PDFEval EvaluateDirectionPDF(const GeneralizedBSDFEvaluateQuery& query, const SurfaceGeometry& geom) const { return Math::PDFEval(); }
+	virtual int BSDFTypes() const { return GeneralizedBSDFType::None; }
+	virtual void SamplePosition(const Math::Vec2& sample, SurfaceGeometry& geom, Math::PDFEval& pdf) const {}
+	virtual Math::Vec3 EvaluatePosition(const SurfaceGeometry& geom) const { return Math::Vec3(); }
+	virtual Math::PDFEval EvaluatePositionPDF(const SurfaceGeometry& geom) const { return Math::PDFEval(); }
+	virtual void RegisterPrimitives(const std::vector<Primitive*>& primitives) {}
+	virtual void PostConfigure(const Scene& scene) {}
+	virtual EmitterShape* CreateEmitterShape() const { return nullptr; }
+	virtual AABB GetAABB() const { return AABB(p - Math::Vec3(Math::Float(0.1)), p + Math::Vec3(Math::Float(0.1))); }
+	virtual bool EnvironmentLight() const { return environment; }
+	virtual Math::Vec3 Power() const { return Math::Vec3(power); }
+
+private:
+
+	Math::Vec3 p;
+	Math::Float power;
+	bool environment;
+
+};
+
+class LightSelectorTest : public TestBase
+{
+public:
+
+	LightSelectorTest()
+	{
+		// Lights on a grid with various power and an environment light
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				stubLights.emplace_back(new StubLight(Math::Vec3(Math::Float(i), Math::Float(j), Math::Float(0)), Math::Float(i + 2 * j + 1), false));
+			}
+		}
+		stubLights.emplace_back(new StubLight(Math::Vec3(), Math::Float(10), true));
+
+		for (const auto& light : stubLights)
+		{
+			lights.push_back(light.get());
+		}
+	}
+
+protected:
+
+	LightSelector* CreateLightSelector(const std::string& type)
+	{
+		auto* lightSelector = ComponentFactory::Create<LightSelector>(type);
+		EXPECT_TRUE(lightSelector->Configure(config.LoadFromStringAndGetFirstChild("<light_selector type=\"" + type + "\" />"), assets));
+		EXPECT_TRUE(lightSelector->Build(lights));
+		return lightSelector;
+	}
+
+	// Checks if the PDFs sum to one and are consistent with the sampling
+	void CheckConsistency(const LightSelector& lightSelector, const Math::Vec3* p)
+	{
+		const int N = static_cast<int>(lights.size());
+		Math::Float sum(0);
+		std::vector<Math::Float> pdfs(N);
+		for (int i = 0; i < N; i++)
+		{
+			pdfs[i] = lightSelector.EvaluatePdf(p, i).v;
+			sum += pdfs[i];
+		}
+		EXPECT_TRUE(ExpectNear(Math::Float(1), sum));
+
+		const int Samples = 1 << 16;
+		std::vector<int> counts(N);
+		for (int k = 0; k < Samples; k++)
+		{
+			Math::PDFEval selectionPdf;
+			auto u = (Math::Float(k) + Math::Float(0.5)) / Math::Float(Samples);
+			int i = lightSelector.Sample(p, u, selectionPdf);
+			ASSERT_TRUE(i >= 0 && i < N);
+			ASSERT_TRUE(u >= Math::Float(0) && u < Math::Float(1));
+			EXPECT_TRUE(ExpectNear(pdfs[i], selectionPdf.v));
+			counts[i]++;
+		}
+
+		for (int i = 0; i < N; i++)
+		{
+			EXPECT_NEAR(pdfs[i], Math::Float(counts[i]) / Math::Float(Samples), 1e-3);
+		}
+	}
+
+protected:
+
+	StubAssets assets;
+	StubConfig config;
+	std::vector<std::unique_ptr<StubLight>> stubLights;
+	std::vector<const Light*> lights;
+
+};
+
+TEST_F(LightSelectorTest, Uniform)
+{
+	std::unique_ptr<LightSelector> lightSelector(CreateLightSelector("uniform"));
+	CheckConsistency(*lightSelector, nullptr);
+	for (int i = 0; i < static_cast<int>(lights.size()); i++)
+	{
+		EXPECT_TRUE(ExpectNear(Math::Float(1) / Math::Float(lights.size()), lightSelector->EvaluatePdf(nullptr, i).v));
+	}
+}
+
+TEST_F(LightSelectorTest, Power)
+{
+	std::unique_ptr<LightSelector> lightSelector(CreateLightSelector("power"));
+	CheckConsistency(*lightSelector, nullptr);
+
+	// Selection probabilities are proportional to the power
+	Math::Float sum(0);
+	for (const auto* light : lights)
+	{
+		sum += Math::Luminance(light->Power());
+	}
+	for (int i = 0; i < static_cast<int>(lights.size()); i++)
+	{
+		EXPECT_TRUE(ExpectNear(Math::Luminance(lights[i]->Power()) / sum, lightSelector->EvaluatePdf(nullptr, i).v));
+	}
+}
+
+TEST_F(LightSelectorTest, BVH)
+{
+	std::unique_ptr<LightSelector> lightSelector(CreateLightSelector("bvh"));
+	CheckConsistency(*lightSelector, nullptr);
+
+	const Math::Vec3 p(Math::Float(0), Math::Float(0), Math::Float(0.5));
+	CheckConsistency(*lightSelector, &p);
+
+	// Environment light is chosen with the probability 1/2
+	const int envLightIndex = static_cast<int>(lights.size()) - 1;
+	EXPECT_TRUE(ExpectNear(Math::Float(0.5), lightSelector->EvaluatePdf(&p, envLightIndex).v));
+
+	// Nearer light is more likely to be chosen than the farther light with the same power
+	// (power of the lights at (2, 0, 0) and (0, 1, 0) is 3)
+	EXPECT_LT(lightSelector->EvaluatePdf(&p, 8).v, lightSelector->EvaluatePdf(&p, 1).v);
+}
+
+TEST_F(LightSelectorTest, SceneWithoutPostConfigure)
+{
+	// The light selector is available once the scene is loaded and built
+	TestSceneLoader loader;
+	ASSERT_TRUE(loader.Load(TestScenes::Simple03()));
+	const auto& scene = loader.GetScene();
+
+	Math::PDFEval selectionPdf;
+	Math::Vec2 lightSampleP(Math::Float(0.5));
+	const auto* light = scene.SampleLightSelection(lightSampleP, selectionPdf);
+	ASSERT_NE(nullptr, light);
+	EXPECT_TRUE(ExpectNear(Math::Float(1), selectionPdf.v));
+	EXPECT_TRUE(ExpectNear(Math::Float(1), scene.LightSelectionPdf(light).v));
+}
+
+LM_TEST_NAMESPACE_END
+LM_NAMESPACE_END
\ No newline at end of file
@@ -0,0 +1,174 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.test.h"
+#include <lightmetrica.test/base.h>
+#include <lightmetrica.test/stub.assets.h>
+#include <lightmetrica.test/stub.config.h>
+#include <lightmetrica/configurablesampler.h>
+
+namespace
+{
+
+	const std::string SamplerNode_Sobol = LM_TEST_MULTILINE_LITERAL(
+		<sampler type="sobol">
+			<rng_seed>1</rng_seed>
+		</sampler>
+	);
+
+	const std::string SamplerNode_Halton = LM_TEST_MULTILINE_LITERAL(
+		<sampler type="halton">
+			<rng_seed>1</rng_seed>
+		</sampler>
+	);
+
+}
+
+LM_NAMESPACE_BEGIN
+LM_TEST_NAMESPACE_BEGIN
+
+class LowDiscrepancySamplerTest : public TestBase
+{
+protected:
+
+	ConfigurableSampler* CreateSampler(const std::string& node)
+	{
+		auto* sampler = ComponentFactory::Create<ConfigurableSampler>(config.LoadFromStringAndGetFirstChild(node).AttributeValue("type"));
+		EXPECT_TRUE(sampler->Configure(config.LoadFromStringAndGetFirstChild(node), assets));
+		return sampler;
+	}
+
+protected:
+
+	StubAssets assets;
+	StubConfig config;
+
+};
+
+TEST_F(LowDiscrepancySamplerTest, Sobol_Stratification)
+{
+	std::unique_ptr<ConfigurableSampler> sampler(CreateSampler(SamplerNode_Sobol));
+	EXPECT_TRUE(sampler->RequiresSampleIndex());
+
+	// Each pair of dimensions is a (0, 2)-sequence in base 2, so that
+	// the first 256 points are stratified in 16x16, 256x1, and 1x256 grids
+	const int N = 256;
+	for (long long pixel = 0; pixel < 4; pixel++)
+	{
+		for (int dimension = 0; dimension < 8; dimension += 2)
+		{
+			std::vector<int> grid(N), rows(N), cols(N);
+			for (int i = 0; i < N; i++)
+			{
+				sampler->BeginSample(pixel, i);
+				sampler->SetDimension(dimension);
+				auto u = sampler->NextVec2();
+				ASSERT_TRUE(u.x >= Math::Float(0) && u.x < Math::Float(1));
+				ASSERT_TRUE(u.y >= Math::Float(0) && u.y < Math::Float(1));
+				grid[static_cast<int>(u.x * 16) * 16 + static_cast<int>(u.y * 16)]++;
+				rows[static_cast<int>(u.x * N)]++;
+				cols[static_cast<int>(u.y * N)]++;
+			}
+
+			for (int i = 0; i < N; i++)
+			{
+				EXPECT_EQ(1, grid[i]);
+				EXPECT_EQ(1, rows[i]);
+				EXPECT_EQ(1, cols[i]);
+			}
+		}
+	}
+}
+
+TEST_F(LowDiscrepancySamplerTest, Halton_Stratification)
+{
+	std::unique_ptr<ConfigurableSampler> sampler(CreateSampler(SamplerNode_Halton));
+	EXPECT_TRUE(sampler->RequiresSampleIndex());
+
+	// The first b^k points of the dimension with base b are stratified in b^k intervals
+	// Bases of the first four dimensions are 2, 3, 5, and 7
+	const int Ns[] = { 256, 243, 125, 49 };
+	for (long long pixel = 0; pixel < 4; pixel++)
+	{
+		for (int dimension = 0; dimension < 4; dimension++)
+		{
+			const int N = Ns[dimension];
+			std::vector<int> intervals(N);
+			for (int i = 0; i < N; i++)
+			{
+				sampler->BeginSample(pixel, i);
+				sampler->SetDimension(dimension);
+				auto u = sampler->Next();
+				ASSERT_TRUE(u >= Math::Float(0) && u < Math::Float(1));
+				intervals[static_cast<int>(u * N)]++;
+			}
+
+			for (int i = 0; i < N; i++)
+			{
+				EXPECT_EQ(1, intervals[i]);
+			}
+		}
+	}
+}
+
+TEST_F(LowDiscrepancySamplerTest, Consistency)
+{
+	const std::string Nodes[] = { SamplerNode_Sobol, SamplerNode_Halton };
+	for (const auto& node : Nodes)
+	{
+		std::unique_ptr<ConfigurableSampler> sampler(CreateSampler(node));
+		std::unique_ptr<Sampler> cloned(sampler->Clone());
+		cloned->SetSeed(sampler->NextUInt());
+
+		for (long long pixel = 0; pixel < 4; pixel++)
+		{
+			for (long long index = 0; index < 16; index++)
+			{
+				// Points depend only on the pixel and the index
+				const int Dimensions = 10;
+				std::vector<Math::Float> values;
+				sampler->BeginSample(pixel, index);
+				cloned->BeginSample(pixel, index);
+				for (int d = 0; d < Dimensions; d++)
+				{
+					auto u = sampler->Next();
+					EXPECT_EQ(u, cloned->Next());
+					values.push_back(u);
+				}
+
+				// Dimensions specified by SetDimension
+				for (int d = Dimensions - 1; d >= 0; d--)
+				{
+					sampler->SetDimension(d);
+					EXPECT_EQ(values[d], sampler->Next());
+				}
+			}
+		}
+
+		// Sequences are decorrelated among pixels
+		sampler->BeginSample(0, 1);
+		auto u1 = sampler->NextVec2();
+		sampler->BeginSample(1, 1);
+		auto u2 = sampler->NextVec2();
+		EXPECT_TRUE(u1.x != u2.x || u1.y != u2.y);
+	}
+}
+
+LM_TEST_NAMESPACE_END
+LM_NAMESPACE_END
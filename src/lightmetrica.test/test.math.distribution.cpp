@@ -59,5 +59,79 @@ TEST_F(DiscreteDistribution1DTest, Sample)
 	EXPECT_EQ(3U, dist.Sample(Math::Float(0.76)));
 }
 
+class DiscreteAliasDistribution1DTest : public TestBase {};
+
+TEST_F(DiscreteAliasDistribution1DTest, Normalize)
+{
+	Math::DiscreteAliasDistribution1D dist;
+	dist.Add(Math::Float(1));
+	dist.Add(Math::Float(3));
+	dist.Normalize();
+	EXPECT_TRUE(ExpectNear(Math::Float(4), dist.Sum()));
+	EXPECT_TRUE(ExpectNear(Math::Float(0.25), dist.EvaluatePDF(0)));
+	EXPECT_TRUE(ExpectNear(Math::Float(0.75), dist.EvaluatePDF(1)));
+}
+
+TEST_F(DiscreteAliasDistribution1DTest, Sample)
+{
+	// Stratified samples are distributed according to the PDF
+	const Math::Float Values[] = { Math::Float(1), Math::Float(0), Math::Float(5), Math::Float(2), Math::Float(0.5) };
+	Math::DiscreteAliasDistribution1D dist;
+	for (const auto& v : Values)
+	{
+		dist.Add(v);
+	}
+	dist.Normalize();
+
+	const int N = 1 << 16;
+	std::vector<int> counts(5);
+	for (int i = 0; i < N; i++)
+	{
+		auto u = (Math::Float(i) + Math::Float(0.5)) / Math::Float(N);
+		auto j = dist.SampleReuse(u);
+		ASSERT_TRUE(j < 5);
+		ASSERT_TRUE(u >= Math::Float(0) && u < Math::Float(1));
+		counts[j]++;
+	}
+
+	EXPECT_EQ(0, counts[1]);
+	for (int j = 0; j < 5; j++)
+	{
+		EXPECT_TRUE(ExpectNear(dist.EvaluatePDF(j), Math::Float(counts[j]) / Math::Float(N), Math::Float(1e-3)));
+	}
+}
+
+class PiecewiseConstantDistribution2DTest : public TestBase {};
+
+TEST_F(PiecewiseConstantDistribution2DTest, Sample)
+{
+	// 2x2 grid with values 1, 2, 3, 4 (row major)
+	std::vector<Math::Float> values;
+	values.push_back(Math::Float(1));
+	values.push_back(Math::Float(2));
+	values.push_back(Math::Float(3));
+	values.push_back(Math::Float(4));
+	Math::PiecewiseConstantDistribution2D dist;
+	dist.Build(values, 2, 2);
+	EXPECT_TRUE(ExpectNear(Math::Float(10), dist.Sum()));
+
+	const int N = 64;
+	for (int i = 0; i < N; i++)
+	{
+		for (int j = 0; j < N; j++)
+		{
+			// The PDF of the sampled point is the value of the cell divided by the average
+			Math::Float pdf;
+			const auto uv = dist.Sample(Math::Vec2((Math::Float(i) + Math::Float(0.5)) / Math::Float(N), (Math::Float(j) + Math::Float(0.5)) / Math::Float(N)), pdf);
+			ASSERT_TRUE(uv.x >= Math::Float(0) && uv.x <= Math::Float(1));
+			ASSERT_TRUE(uv.y >= Math::Float(0) && uv.y <= Math::Float(1));
+			const int x = uv.x < Math::Float(0.5) ? 0 : 1;
+			const int y = uv.y < Math::Float(0.5) ? 0 : 1;
+			EXPECT_TRUE(ExpectNear(values[2 * y + x] / Math::Float(2.5), pdf));
+			EXPECT_TRUE(ExpectNear(pdf, dist.EvaluatePDF(uv)));
+		}
+	}
+}
+
 LM_TEST_NAMESPACE_END
 LM_NAMESPACE_END
\ No newline at end of file
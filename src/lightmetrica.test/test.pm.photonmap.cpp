@@ -33,6 +33,7 @@ TEST_F(PhotonMapTest, Consistency)
 	std::vector<std::string> photonMapTypes;
 	photonMapTypes.emplace_back("naive");
 	photonMapTypes.emplace_back("kdtree");
+	photonMapTypes.emplace_back("hashgrid");
 
 	// Create photon map with random photons
 	std::vector<std::unique_ptr<PhotonMap>> photonMaps;
@@ -174,5 +175,71 @@ TEST_F(PhotonMapTest, Consistency)
 	}
 }
 
+TEST_F(PhotonMapTest, CollectNearestPhotons)
+{
+	std::vector<std::string> photonMapTypes;
+	photonMapTypes.emplace_back("naive");
+	photonMapTypes.emplace_back("kdtree");
+	photonMapTypes.emplace_back("hashgrid");
+
+	// Numbers of photons which are not the multiple of the size of the leaf buckets
+	std::mt19937 gen(42);
+	std::uniform_real_distribution<double> dist;
+	const int Samples[] = { 0, 1, 7, 1000, 4099 };
+	for (int samples : Samples)
+	{
+		Photons photons;
+		for (int i = 0; i < samples; i++)
+		{
+			Photon photon;
+			photon.p = Math::Vec3(Math::Float(dist(gen)), Math::Float(dist(gen)), Math::Float(dist(gen)));
+			photons.push_back(photon);
+		}
+
+		std::vector<std::unique_ptr<PhotonMap>> photonMaps;
+		for (auto& type : photonMapTypes)
+		{
+			photonMaps.emplace_back(ComponentFactory::Create<PhotonMap>(type));
+			photonMaps.back()->SetQueryRadius(std::sqrt(Math::Float(0.1)));
+			photonMaps.back()->Build(photons);
+		}
+
+		const int Queries = 1<<6;
+		for (int query = 0; query < Queries; query++)
+		{
+			Math::Vec3 p(Math::Float(dist(gen)), Math::Float(dist(gen)), Math::Float(dist(gen)));
+			const int Ks[] = { 1, 10, 50 };
+			for (int k : Ks)
+			{
+				const auto comp = [](const PhotonMap::CollectedPhotonInfo& p1, const PhotonMap::CollectedPhotonInfo& p2){ return p1.second < p2.second; };
+
+				// Results of the naive photon map as reference
+				std::vector<PhotonMap::CollectedPhotonInfo> reference;
+				Math::Float referenceMaxDist2 = Math::Float(0.1);
+				photonMaps[0]->CollectNearestPhotons(p, k, referenceMaxDist2, reference);
+				std::sort(reference.begin(), reference.end(), comp);
+
+				for (size_t i = 1; i < photonMapTypes.size(); i++)
+				{
+					std::vector<PhotonMap::CollectedPhotonInfo> collected;
+					Math::Float maxDist2 = Math::Float(0.1);
+					photonMaps[i]->CollectNearestPhotons(p, k, maxDist2, collected);
+					std::sort(collected.begin(), collected.end(), comp);
+
+					EXPECT_LE(collected.size(), static_cast<size_t>(k));
+					EXPECT_TRUE(ExpectNear(referenceMaxDist2, maxDist2));
+					ASSERT_EQ(reference.size(), collected.size());
+					for (size_t j = 0; j < collected.size(); j++)
+					{
+						EXPECT_LE(collected[j].second, maxDist2);
+						EXPECT_TRUE(ExpectNear(reference[j].second, collected[j].second));
+						EXPECT_TRUE(ExpectNear(Math::Length2(collected[j].first->p - p), collected[j].second));
+					}
+				}
+			}
+		}
+	}
+}
+
 LM_TEST_NAMESPACE_END
 LM_NAMESPACE_END
\ No newline at end of file
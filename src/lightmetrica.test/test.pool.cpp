@@ -0,0 +1,92 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.test.h"
+#include <lightmetrica.test/base.h>
+#include <lightmetrica/pool.h>
+
+namespace
+{
+
+	// Object which counts constructions and destructions
+	struct LM_ALIGN_16 ArenaTestObject
+	{
+		ArenaTestObject() : value(42) { constructed++; }
+		~ArenaTestObject() { destructed++; }
+		int value;
+		static int constructed;
+		static int destructed;
+	};
+
+	int ArenaTestObject::constructed = 0;
+	int ArenaTestObject::destructed = 0;
+
+}
+
+LM_NAMESPACE_BEGIN
+LM_TEST_NAMESPACE_BEGIN
+
+class ObjectArenaTest : public TestBase {};
+
+TEST_F(ObjectArenaTest, ConstructAndRelease)
+{
+	ArenaTestObject::constructed = 0;
+	ArenaTestObject::destructed = 0;
+
+	{
+		ObjectArena<ArenaTestObject, 16> arena(4);
+		std::vector<ArenaTestObject*> objects;
+		for (int i = 0; i < 10; i++)
+		{
+			auto* object = arena.Construct();
+			EXPECT_TRUE(is_aligned(object, 16));
+			EXPECT_EQ(42, object->value);
+			object->value = i;
+			objects.push_back(object);
+		}
+
+		// Objects are not overwritten
+		for (int i = 0; i < 10; i++)
+		{
+			EXPECT_EQ(i, objects[i]->value);
+		}
+
+		EXPECT_EQ(10, ArenaTestObject::constructed);
+		EXPECT_EQ(10U, arena.NumConstructed());
+		EXPECT_EQ(12U, arena.Capacity());
+
+		arena.Release();
+		EXPECT_EQ(10, ArenaTestObject::destructed);
+		EXPECT_EQ(0U, arena.NumConstructed());
+
+		// Slots are reused after the release
+		for (int i = 0; i < 10; i++)
+		{
+			EXPECT_EQ(objects[i], arena.Construct());
+		}
+		EXPECT_EQ(12U, arena.Capacity());
+	}
+
+	// Remaining objects are destructed with the arena
+	EXPECT_EQ(20, ArenaTestObject::constructed);
+	EXPECT_EQ(20, ArenaTestObject::destructed);
+}
+
+LM_TEST_NAMESPACE_END
+LM_NAMESPACE_END
\ No newline at end of file
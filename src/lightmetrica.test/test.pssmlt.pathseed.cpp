@@ -0,0 +1,91 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.test.h"
+#include <lightmetrica.test/base.h>
+#include <lightmetrica/pssmlt.pathseed.h>
+#include <lightmetrica/random.h>
+
+LM_NAMESPACE_BEGIN
+LM_TEST_NAMESPACE_BEGIN
+
+class PSSMLTPathSeedReservoirTest : public TestBase
+{
+public:
+
+	PSSMLTPathSeedReservoirTest()
+		: rng(ComponentFactory::Create<Random>("philox"))
+	{
+		rng->SetSeed(1);
+	}
+
+protected:
+
+	std::unique_ptr<Random> rng;
+
+};
+
+TEST_F(PSSMLTPathSeedReservoirTest, SingleCandidate)
+{
+	PSSMLTPathSeedReservoir reservoir;
+	reservoir.Initialize(8);
+	reservoir.Add(PSSMLTPathSeed(1, 10, Math::Float(2)), *rng);
+
+	EXPECT_EQ(1LL, reservoir.numCandidates);
+	for (int i = 0; i < 16; i++)
+	{
+		const auto& seed = reservoir.Next();
+		EXPECT_EQ(1, seed.stream);
+		EXPECT_EQ(10LL, seed.index);
+	}
+}
+
+TEST_F(PSSMLTPathSeedReservoirTest, Distribution)
+{
+	// Seeds are sampled proportional to the luminance
+	const int NumSlots = 100000;
+	const int NumCandidates = 4;
+	const Math::Float Weights[] = { Math::Float(1), Math::Float(2), Math::Float(3), Math::Float(4) };
+
+	PSSMLTPathSeedReservoir reservoir;
+	reservoir.Initialize(NumSlots);
+	for (int i = 0; i < NumCandidates; i++)
+	{
+		reservoir.Add(PSSMLTPathSeed(0, i, Weights[i]), *rng);
+	}
+
+	EXPECT_EQ(NumCandidates, reservoir.numCandidates);
+	EXPECT_NEAR(10.0, static_cast<double>(reservoir.sumI), 1e-5);
+
+	std::vector<int> counts(NumCandidates);
+	for (int i = 0; i < NumSlots; i++)
+	{
+		const auto& seed = reservoir.Next();
+		ASSERT_TRUE(seed.index >= 0 && seed.index < NumCandidates);
+		counts[seed.index]++;
+	}
+
+	for (int i = 0; i < NumCandidates; i++)
+	{
+		EXPECT_NEAR(static_cast<double>(Weights[i]) / 10.0, static_cast<double>(counts[i]) / NumSlots, 0.01);
+	}
+}
+
+LM_TEST_NAMESPACE_END
+LM_NAMESPACE_END
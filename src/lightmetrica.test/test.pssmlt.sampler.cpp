@@ -31,31 +31,56 @@ class RewindableSamplerTest : public TestBase {};
 
 TEST_F(RewindableSamplerTest, GenerateAndRestore)
 {
-	// Initialize using seed 1
-	std::unique_ptr<RewindableSampler> sampler(ComponentFactory::Create<RewindableSampler>());
-	sampler->Configure(ComponentFactory::Create<Random>("standardmt"));
-	sampler->SetSeed(1);
-
-	// Generate some samples
-	const int Count = 1<<9;
-	std::vector<Math::Float> samples;
-	for (int i = 0; i < Count; i++)
+	// Generic and counter-based random number generators
+	const std::string RngTypes[] = { "standardmt", "philox" };
+	for (const auto& rngType : RngTypes)
 	{
-		samples.push_back(sampler->Next());
-	}
+		// Initialize using seed 1
+		std::unique_ptr<RewindableSampler> sampler(ComponentFactory::Create<RewindableSampler>());
+		sampler->Configure(ComponentFactory::Create<Random>(rngType));
+		sampler->SetSeed(1);
 
-	// Restore state and re-generate samples
-	for (int index = 0; index < Count-1; index++)
-	{
-		sampler->Rewind(index);
-		for (int i = index; i < Count; i++)
+		// Generate some samples
+		const int Count = 1<<9;
+		std::vector<Math::Float> samples;
+		for (int i = 0; i < Count; i++)
 		{
-			// Check generated values
-			EXPECT_TRUE(ExpectNear(sampler->Next(), samples[i]));
+			samples.push_back(sampler->Next());
+		}
+
+		// Restore state and re-generate samples
+		for (int index = 0; index < Count-1; index++)
+		{
+			sampler->Rewind(index);
+			EXPECT_EQ(index, sampler->SampleIndex());
+			for (int i = index; i < Count; i++)
+			{
+				// Check generated values
+				EXPECT_TRUE(ExpectNear(sampler->Next(), samples[i]));
+			}
 		}
 	}
 }
 
+TEST_F(RewindableSamplerTest, Rewind_LargeIndex)
+{
+	std::unique_ptr<RewindableSampler> sampler(ComponentFactory::Create<RewindableSampler>());
+	sampler->Configure(ComponentFactory::Create<Random>("philox"));
+	sampler->SetSeed(1);
+
+	// Index beyond the range of 32-bit integer
+	const long long Index = (1LL<<40) + 3;
+	sampler->Rewind(Index);
+	EXPECT_EQ(Index, sampler->SampleIndex());
+	auto v1 = sampler->Next();
+	auto v2 = sampler->Next();
+	EXPECT_EQ(Index + 2, sampler->SampleIndex());
+
+	sampler->Rewind(Index);
+	EXPECT_TRUE(ExpectNear(v1, sampler->Next()));
+	EXPECT_TRUE(ExpectNear(v2, sampler->Next()));
+}
+
 // --------------------------------------------------------------------------------
 
 class PSSMLTPrimarySampleTest : public TestBase
@@ -142,6 +167,41 @@ TEST_F(PSSMLTPrimarySampleTest, Accept)
 	}
 }
 
+TEST_F(PSSMLTPrimarySampleTest, Reserve)
+{
+	// Reserve less samples than required
+	primarySample->Reserve(Count / 4);
+
+	// Generate initial samples
+	std::vector<Math::Float> samples;
+	for (int i = 0; i < Count / 2; i++)
+	{
+		samples.push_back(primarySample->Next());
+	}
+	primarySample->Accept();
+
+	for (int mode = 0; mode < 2; mode++)
+	{
+		// Mutation requiring more samples than the current ones
+		primarySample->EnableLargeStepMutation(mode == 0);
+		for (int i = 0; i < Count; i++)
+		{
+			primarySample->Next();
+		}
+
+		// Reject -> the sample should be the previous state
+		primarySample->Reject();
+
+		std::vector<Math::Float> currentSamples;
+		primarySample->GetCurrentSampleState(currentSamples);
+		EXPECT_EQ(Count, static_cast<int>(currentSamples.size()));
+		for (int i = 0; i < Count / 2; i++)
+		{
+			EXPECT_TRUE(ExpectNear(currentSamples[i], samples[i]));
+		}
+	}
+}
+
 TEST_F(PSSMLTPrimarySampleTest, Sequence)
 {
 	// Another random number generator
@@ -0,0 +1,142 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.test.h"
+#include <lightmetrica.test/base.h>
+#include <lightmetrica/random.h>
+
+LM_NAMESPACE_BEGIN
+LM_TEST_NAMESPACE_BEGIN
+
+class RandomTest : public TestBase {};
+
+TEST_F(RandomTest, Skip)
+{
+	const std::string RngTypes[] = { "standardmt", "sfmt", "philox" };
+	for (const auto& rngType : RngTypes)
+	{
+		std::unique_ptr<Random> rng1(ComponentFactory::Create<Random>(rngType));
+		std::unique_ptr<Random> rng2(ComponentFactory::Create<Random>(rngType));
+
+		// Generate some numbers
+		const int Count = 100;
+		std::vector<unsigned int> values;
+		rng1->SetSeed(1);
+		for (int i = 0; i < Count; i++)
+		{
+			values.push_back(rng1->NextUInt());
+		}
+
+		// Skip and compare
+		for (int n = 0; n < Count; n++)
+		{
+			rng2->SetSeed(1);
+			rng2->Skip(n);
+			EXPECT_EQ(values[n], rng2->NextUInt());
+		}
+	}
+}
+
+TEST_F(RandomTest, Fill)
+{
+	const std::string RngTypes[] = { "standardmt", "sfmt", "philox" };
+	for (const auto& rngType : RngTypes)
+	{
+		std::unique_ptr<Random> rng1(ComponentFactory::Create<Random>(rngType));
+		std::unique_ptr<Random> rng2(ComponentFactory::Create<Random>(rngType));
+		rng1->SetSeed(1);
+		rng2->SetSeed(1);
+
+		// Mix single and bulk generation
+		// Sizes are chosen to cross the internal block boundaries
+		const size_t Sizes[] = { 1, 3, 100, 5000, 7 };
+		for (size_t n : Sizes)
+		{
+			std::vector<unsigned int> values(n);
+			rng1->FillUInt(&values[0], n);
+			for (size_t i = 0; i < n; i++)
+			{
+				EXPECT_EQ(rng2->NextUInt(), values[i]);
+			}
+
+			std::vector<Math::Float> floats(n);
+			rng1->Fill(&floats[0], n);
+			for (size_t i = 0; i < n; i++)
+			{
+				EXPECT_EQ(rng2->Next(), floats[i]);
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------------------------------
+
+class PhiloxRandomTest : public TestBase
+{
+public:
+
+	PhiloxRandomTest()
+		: rng(ComponentFactory::Create<Random>("philox"))
+	{
+
+	}
+
+protected:
+
+	std::unique_ptr<Random> rng;
+
+};
+
+TEST_F(PhiloxRandomTest, KnownAnswer)
+{
+	// Philox4x32-10 with counter = 0 and key = 0 (Random123 known-answer test)
+	rng->SetSeed(0);
+	EXPECT_EQ(0x6627e8d5U, rng->NextUInt());
+	EXPECT_EQ(0xe169c58dU, rng->NextUInt());
+	EXPECT_EQ(0xbc57ac4cU, rng->NextUInt());
+	EXPECT_EQ(0x9b00dbd8U, rng->NextUInt());
+}
+
+TEST_F(PhiloxRandomTest, Skip_Large)
+{
+	// Skip in several steps or at once
+	const unsigned long long N = (1ULL<<40) + 5;
+	rng->SetSeed(1);
+	rng->Skip(N - 7);
+	rng->NextUInt();
+	rng->Skip(6);
+	auto v1 = rng->NextUInt();
+
+	rng->SetSeed(1);
+	rng->Skip(N);
+	EXPECT_EQ(v1, rng->NextUInt());
+}
+
+TEST_F(PhiloxRandomTest, Seed)
+{
+	// Different seeds give different sequences
+	rng->SetSeed(1);
+	auto v1 = rng->NextUInt();
+	rng->SetSeed(2);
+	auto v2 = rng->NextUInt();
+	EXPECT_NE(v1, v2);
+}
+
+LM_TEST_NAMESPACE_END
+LM_NAMESPACE_END
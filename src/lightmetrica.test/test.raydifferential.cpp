@@ -0,0 +1,139 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "pch.test.h"
+#include <lightmetrica.test/base.h>
+#include <lightmetrica.test/base.math.h>
+#include <lightmetrica/raydifferential.h>
+
+LM_NAMESPACE_BEGIN
+LM_TEST_NAMESPACE_BEGIN
+
+class RayDifferentialTest : public TestBase
+{
+protected:
+
+	// Reflected direction
+	Math::Vec3 Reflect(const Math::Vec3& d, const Math::Vec3& n)
+	{
+		return d - n * (Math::Float(2) * Math::Dot(d, n));
+	}
+
+	// Refracted direction by Snell's law (#n is in the same side as -d)
+	Math::Vec3 Refract(const Math::Vec3& d, const Math::Vec3& n, const Math::Float& eta)
+	{
+		auto cosThetaI = -Math::Dot(d, n);
+		auto cosThetaT = Math::Sqrt(Math::Float(1) - eta * eta * (Math::Float(1) - cosThetaI * cosThetaI));
+		return d * eta + n * (eta * cosThetaI - cosThetaT);
+	}
+
+};
+
+TEST_F(RayDifferentialTest, Transfer)
+{
+	// Plane z = 0 where (u, v) = (x / 2, y)
+	SurfaceGeometry geom;
+	geom.gn = Math::Vec3(0, 0, 1);
+	geom.dpdu = Math::Vec3(2, 0, 0);
+	geom.dpdv = Math::Vec3(0, 1, 0);
+
+	Ray ray;
+	ray.o = Math::Vec3(0, 0, 2);
+	ray.d = Math::Vec3(0, 0, -1);
+	ray.maxT = Math::Float(2);
+
+	RayDifferential rd;
+	rd.dddx = Math::Vec3(Math::Float(0.01), 0, 0);
+	rd.dddy = Math::Vec3(0, Math::Float(0.01), 0);
+	rd.Transfer(ray, geom);
+
+	EXPECT_TRUE(ExpectVec3Near(Math::Vec3(Math::Float(0.02), 0, 0), rd.dodx));
+	EXPECT_TRUE(ExpectVec3Near(Math::Vec3(0, Math::Float(0.02), 0), rd.dody));
+	EXPECT_TRUE(ExpectNear(Math::Float(0.02), geom.uvFootprint));
+
+	// Oblique ray stretches the footprint
+	ray.o = Math::Vec3(0, -2, 2);
+	ray.d = Math::Normalize(Math::Vec3(0, 1, -1));
+	ray.maxT = Math::Sqrt(Math::Float(8));
+	rd = RayDifferential();
+	rd.dddy = Math::Vec3(0, Math::Float(0.01), Math::Float(0.01)) / Math::Sqrt(Math::Float(2));
+	rd.Transfer(ray, geom);
+	EXPECT_TRUE(ExpectNear(Math::Float(0.04), geom.uvFootprint));
+
+	// Footprint is unknown without partial derivatives
+	geom.dpdu = geom.dpdv = Math::Vec3();
+	rd.Transfer(ray, geom);
+	EXPECT_EQ(Math::Float(0), geom.uvFootprint);
+}
+
+TEST_F(RayDifferentialTest, ReflectAndRefract)
+{
+	// Compare with the finite differences
+	const auto n = Math::Normalize(Math::Vec3(Math::Float(0.1), Math::Float(0.2), 1));
+	const auto d = Math::Normalize(Math::Vec3(Math::Float(0.3), Math::Float(-0.2), -1));
+	const auto h = Math::Float(1e-3);
+
+	RayDifferential rd;
+	rd.dddx = Math::Normalize(Math::Vec3(Math::Float(1), Math::Float(0.5), Math::Float(0.2)) * h + d) - d;
+	rd.dddy = Math::Normalize(Math::Vec3(Math::Float(-0.3), Math::Float(1), Math::Float(0.1)) * h + d) - d;
+
+	{
+		auto reflected = rd;
+		reflected.Reflect(n);
+		auto r = Reflect(d, n);
+		EXPECT_TRUE(ExpectVec3Near(Reflect(d + rd.dddx, n) - r, reflected.dddx, Math::Float(1e-5)));
+		EXPECT_TRUE(ExpectVec3Near(Reflect(d + rd.dddy, n) - r, reflected.dddy, Math::Float(1e-5)));
+	}
+
+	const Math::Float Etas[] = { Math::Float(1) / Math::Float(1.5), Math::Float(1.2) };
+	for (auto eta : Etas)
+	{
+		auto refracted = rd;
+		auto t = Refract(d, n, eta);
+		refracted.Refract(d, t, n, eta);
+		EXPECT_TRUE(ExpectVec3Near(Refract(d + rd.dddx, n, eta) - t, refracted.dddx, Math::Float(1e-5)));
+		EXPECT_TRUE(ExpectVec3Near(Refract(d + rd.dddy, n, eta) - t, refracted.dddy, Math::Float(1e-5)));
+
+		// Normal in the opposite side
+		refracted = rd;
+		refracted.Refract(d, t, -n, eta);
+		EXPECT_TRUE(ExpectVec3Near(Refract(d + rd.dddx, n, eta) - t, refracted.dddx, Math::Float(1e-5)));
+	}
+}
+
+TEST_F(RayDifferentialTest, Spread)
+{
+	const auto wo = Math::Normalize(Math::Vec3(1, 1, 1));
+
+	// Narrow lobe
+	RayDifferential rd;
+	rd.Spread(wo, Math::Float(10000));
+	EXPECT_TRUE(ExpectNear(Math::Float(0.01), Math::Length(rd.dddx)));
+	EXPECT_TRUE(ExpectNear(Math::Float(0.01), Math::Length(rd.dddy)));
+	EXPECT_TRUE(ExpectNear(Math::Float(0), Math::Dot(wo, rd.dddx)));
+	EXPECT_TRUE(ExpectNear(Math::Float(0), Math::Dot(wo, rd.dddy)));
+
+	// Wide lobe is clamped
+	rd.Spread(wo, Math::Constants::InvPi());
+	EXPECT_TRUE(ExpectNear(Math::Float(0.25), Math::Length(rd.dddx)));
+}
+
+LM_TEST_NAMESPACE_END
+LM_NAMESPACE_END
\ No newline at end of file
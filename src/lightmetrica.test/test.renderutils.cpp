@@ -0,0 +1,56 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.test.h"
+#include <lightmetrica.test/base.h>
+#include <lightmetrica.test/base.math.h>
+#include <lightmetrica/renderutils.h>
+
+LM_NAMESPACE_BEGIN
+LM_TEST_NAMESPACE_BEGIN
+
+class RenderUtilsTest : public TestBase {};
+
+TEST_F(RenderUtilsTest, ProgressiveRadius2_FirstIteration)
+{
+	// The radius of the first iteration is the initial radius regardless of the previous radius
+	EXPECT_TRUE(ExpectNear(Math::Float(0.01), RenderUtils::ProgressiveRadius2(Math::Float(0), Math::Float(0.1), Math::Float(0.7), 0)));
+	EXPECT_TRUE(ExpectNear(Math::Float(0.01), RenderUtils::ProgressiveRadius2(Math::Float(5), Math::Float(0.1), Math::Float(0.7), 0)));
+}
+
+TEST_F(RenderUtilsTest, ProgressiveRadius2_Reduction)
+{
+	// r_{i+1}^2 / r_i^2 = (i + alpha) / (i + 1)
+	const Math::Float initialRadius(0.1);
+	const Math::Float alpha(0.7);
+	auto radius2 = RenderUtils::ProgressiveRadius2(Math::Float(0), initialRadius, alpha, 0);
+	auto expected = initialRadius * initialRadius;
+	for (long long i = 1; i < 100; i++)
+	{
+		const auto prevRadius2 = radius2;
+		radius2 = RenderUtils::ProgressiveRadius2(radius2, initialRadius, alpha, i);
+		expected *= (Math::Float(i) + alpha) / Math::Float(i + 1);
+		EXPECT_TRUE(ExpectNear(expected, radius2));
+		EXPECT_TRUE(ExpectNear((Math::Float(i) + alpha) / Math::Float(i + 1), radius2 / prevRadius2));
+		EXPECT_LT(radius2, prevRadius2);
+	}
+}
+
+LM_TEST_NAMESPACE_END
+LM_NAMESPACE_END
\ No newline at end of file
@@ -265,5 +265,108 @@ TEST_F(SceneIntersectionTest, Consistency)
 	}
 }
 
+// Check if the batched query returns the same result as the single query
+TEST_F(SceneIntersectionTest, IntersectBatch)
+{
+	for (const auto& type : sceneTypes)
+	{
+		// Triangle mesh and scene
+		std::unique_ptr<TriangleMesh> mesh(new StubTriangleMesh_Random());
+		auto scene = CreateAndSetupScene(type, mesh.get());
+
+		// Rays in the region of [-0.5, 1.5]^2, some of which miss the triangles
+		// The number of rays is not a multiple of the batch size of the implementations
+		const int Steps = 13;
+		const Math::Float Delta = Math::Float(2) / Math::Float(Steps);
+		std::vector<Ray, aligned_allocator<Ray, std::alignment_of<Ray>::value>> rays;
+		for (int i = 0; i < Steps; i++)
+		{
+			for (int j = 0; j < Steps; j++)
+			{
+				Ray ray;
+				ray.o = Math::Vec3(Delta * Math::Float(j) - Math::Float(0.5), Delta * Math::Float(i) - Math::Float(0.5), 1);
+				ray.d = Math::Vec3(0, 0, -1);
+				ray.minT = Math::Constants::Zero();
+				ray.maxT = Math::Constants::Inf();
+				rays.push_back(ray);
+			}
+		}
+
+		// Batched query
+		const int n = static_cast<int>(rays.size());
+		auto batchRays = rays;
+		std::vector<Intersection, aligned_allocator<Intersection, std::alignment_of<Intersection>::value>> isects(n);
+		std::unique_ptr<bool[]> hits(new bool[n]);
+		scene->IntersectBatch(&batchRays[0], &isects[0], hits.get(), n);
+
+		int numHits = 0;
+		for (int i = 0; i < n; i++)
+		{
+			Intersection isect;
+			bool hit = scene->Intersect(rays[i], isect);
+			ASSERT_EQ(hit, hits[i]);
+			if (hit)
+			{
+				numHits++;
+				EXPECT_TRUE(ExpectNear(rays[i].maxT, batchRays[i].maxT));
+				EXPECT_TRUE(ExpectVec3Near(isect.geom.p, isects[i].geom.p));
+				EXPECT_TRUE(ExpectVec3Near(isect.geom.gn, isects[i].geom.gn));
+				EXPECT_TRUE(ExpectVec2Near(isect.geom.uv, isects[i].geom.uv));
+			}
+		}
+
+		EXPECT_TRUE(numHits > 0 && numHits < n);
+	}
+}
+
+// Check if the batched occlusion query returns the same result as the single query
+TEST_F(SceneIntersectionTest, OccludedBatch)
+{
+	for (const auto& type : sceneTypes)
+	{
+		// Triangle mesh and scene
+		std::unique_ptr<TriangleMesh> mesh(new StubTriangleMesh_Random());
+		auto scene = CreateAndSetupScene(type, mesh.get());
+
+		// Rays in the region of [-0.5, 1.5]^2 with various ranges,
+		// some of which miss the triangles or end before the triangles
+		const int Steps = 13;
+		const Math::Float Delta = Math::Float(2) / Math::Float(Steps);
+		std::vector<Ray, aligned_allocator<Ray, std::alignment_of<Ray>::value>> rays;
+		for (int i = 0; i < Steps; i++)
+		{
+			for (int j = 0; j < Steps; j++)
+			{
+				Ray ray;
+				ray.o = Math::Vec3(Delta * Math::Float(j) - Math::Float(0.5), Delta * Math::Float(i) - Math::Float(0.5), 1);
+				ray.d = Math::Vec3(0, 0, -1);
+				ray.minT = Math::Constants::Zero();
+				ray.maxT = Math::Float((i + j) % 4) * Math::Float(0.5);
+				rays.push_back(ray);
+			}
+		}
+
+		// Batched query
+		const int n = static_cast<int>(rays.size());
+		auto batchRays = rays;
+		std::unique_ptr<bool[]> occluded(new bool[n]);
+		scene->OccludedBatch(&batchRays[0], occluded.get(), n);
+
+		int numOccluded = 0;
+		for (int i = 0; i < n; i++)
+		{
+			Intersection isect;
+			bool hit = scene->Intersect(rays[i], isect);
+			ASSERT_EQ(hit, occluded[i]);
+			if (hit)
+			{
+				numOccluded++;
+			}
+		}
+
+		EXPECT_TRUE(numOccluded > 0 && numOccluded < n);
+	}
+}
+
 LM_TEST_NAMESPACE_END
 LM_NAMESPACE_END
@@ -0,0 +1,178 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "pch.test.h"
+#include <lightmetrica.test/base.h>
+#include <lightmetrica/texturetilecache.h>
+
+LM_NAMESPACE_BEGIN
+LM_TEST_NAMESPACE_BEGIN
+
+class TextureTileCacheTest : public TestBase
+{
+public:
+
+	TextureTileCacheTest()
+		: cache(TextureTileCache::Instance())
+	{
+
+	}
+
+protected:
+
+	virtual void SetUp()
+	{
+		TestBase::SetUp();
+		cache.Clear();
+		budget = cache.MemoryBudget();
+	}
+
+	virtual void TearDown()
+	{
+		cache.Clear();
+		cache.SetMemoryBudget(budget);
+		TestBase::TearDown();
+	}
+
+protected:
+
+	// Loader creating a tile of #size bytes filled with #value
+	TextureTileCache::TileLoaderFunc Loader(size_t size, unsigned char value, int& count)
+	{
+		return [size, value, &count](TextureTileCache::TileData& data)
+		{
+			count++;
+			data.assign(size, value);
+			return true;
+		};
+	}
+
+protected:
+
+	TextureTileCache& cache;
+	size_t budget;
+
+};
+
+TEST_F(TextureTileCacheTest, Lookup)
+{
+	int count = 0;
+	const int id = cache.RegisterTexture();
+
+	// The tile is loaded only in the first lookup
+	for (int i = 0; i < 3; i++)
+	{
+		auto tile = cache.Lookup(id, 0, Loader(16, 1, count));
+		ASSERT_TRUE(tile != nullptr);
+		EXPECT_EQ(16U, tile->size());
+		EXPECT_EQ(1, (*tile)[0]);
+	}
+
+	EXPECT_EQ(1, count);
+	EXPECT_EQ(16U, cache.MemoryUsage());
+
+	// Tiles are distinguished by the texture ID and the tile index
+	const int id2 = cache.RegisterTexture();
+	EXPECT_NE(id, id2);
+	EXPECT_EQ(2, (*cache.Lookup(id, 1, Loader(16, 2, count)))[0]);
+	EXPECT_EQ(3, (*cache.Lookup(id2, 0, Loader(16, 3, count)))[0]);
+	EXPECT_EQ(3, count);
+	EXPECT_EQ(48U, cache.MemoryUsage());
+
+	cache.UnregisterTexture(id);
+	EXPECT_EQ(16U, cache.MemoryUsage());
+	cache.UnregisterTexture(id2);
+	EXPECT_EQ(0U, cache.MemoryUsage());
+}
+
+TEST_F(TextureTileCacheTest, FailedLoad)
+{
+	const int id = cache.RegisterTexture();
+	auto tile = cache.Lookup(id, 0, [](TextureTileCache::TileData&){ return false; });
+	EXPECT_TRUE(tile == nullptr);
+	EXPECT_EQ(0U, cache.MemoryUsage());
+	cache.UnregisterTexture(id);
+}
+
+TEST_F(TextureTileCacheTest, Eviction)
+{
+	// Tiles of the indices multiple of #NumShards are in the same shard,
+	// whose budget is 48 bytes
+	int count = 0;
+	const int id = cache.RegisterTexture();
+	const int n = TextureTileCache::NumShards;
+	cache.SetMemoryBudget(48 * n);
+
+	for (int i = 0; i < 3; i++)
+	{
+		cache.Lookup(id, i * n, Loader(16, 0, count));
+	}
+	EXPECT_EQ(3, count);
+	EXPECT_EQ(48U, cache.MemoryUsage());
+
+	// Tile 0 becomes the most recently used one, so tile 1 is evicted
+	cache.Lookup(id, 0, Loader(16, 0, count));
+	cache.Lookup(id, 3 * n, Loader(16, 0, count));
+	EXPECT_EQ(4, count);
+	EXPECT_EQ(48U, cache.MemoryUsage());
+
+	cache.Lookup(id, 0, Loader(16, 0, count));
+	cache.Lookup(id, 2 * n, Loader(16, 0, count));
+	cache.Lookup(id, 3 * n, Loader(16, 0, count));
+	EXPECT_EQ(4, count);
+	cache.Lookup(id, 1 * n, Loader(16, 0, count));
+	EXPECT_EQ(5, count);
+
+	// Evicted tiles are still valid while they are referenced
+	auto tile = cache.Lookup(id, 4 * n, Loader(16, 4, count));
+	cache.SetMemoryBudget(0);
+	EXPECT_EQ(16U, cache.MemoryUsage());
+	cache.Lookup(id, 5 * n, Loader(16, 5, count));
+	EXPECT_EQ(16U, cache.MemoryUsage());
+	EXPECT_EQ(4, (*tile)[0]);
+
+	cache.UnregisterTexture(id);
+}
+
+TEST_F(TextureTileCacheTest, Shards)
+{
+	// Tiles in different shards do not evict each other
+	int count = 0;
+	const int id = cache.RegisterTexture();
+	const int n = TextureTileCache::NumShards;
+	cache.SetMemoryBudget(16 * n);
+
+	for (int i = 0; i < n; i++)
+	{
+		cache.Lookup(id, i, Loader(16, 0, count));
+	}
+	for (int i = 0; i < n; i++)
+	{
+		cache.Lookup(id, i, Loader(16, 0, count));
+	}
+	EXPECT_EQ(n, count);
+	EXPECT_EQ(static_cast<size_t>(16 * n), cache.MemoryUsage());
+
+	cache.UnregisterTexture(id);
+	EXPECT_EQ(0U, cache.MemoryUsage());
+}
+
+LM_TEST_NAMESPACE_END
+LM_NAMESPACE_END
\ No newline at end of file
@@ -0,0 +1,227 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.test.h"
+#include <lightmetrica.test/base.h>
+#include <lightmetrica.test/base.math.h>
+#include <lightmetrica.test/stub.assets.h>
+#include <lightmetrica.test/stub.config.h>
+#include <lightmetrica.test/testimages.h>
+#include <lightmetrica/texture.h>
+#include <lightmetrica/halfutils.h>
+#include <fstream>
+#include <cstring>
+
+namespace
+{
+
+	const std::string TextureNode_TileSize = LM_TEST_MULTILINE_LITERAL(
+		<texture id="test" type="bitmap.tiled">
+			<path>%s</path>
+			<tile_size>%d</tile_size>
+		</texture>
+	);
+
+}
+
+LM_NAMESPACE_BEGIN
+LM_TEST_NAMESPACE_BEGIN
+
+namespace
+{
+
+	const std::string Extension[]	= { "exr", "png" };
+	const TestImage Images[]		= { TestImages::OpenEXR(), TestImages::PNG() };
+	const int Format[]				= { 1, 0 };		// Half, UInt8
+
+}
+
+//! Tiled file created next to the image.
+class TemporaryTiledFile : public TemporaryFile
+{
+public:
+
+	TemporaryTiledFile(const std::string& imagePath) { path = imagePath + ".tiled"; }
+
+};
+
+class TiledBitmapTextureTest : public TestBase
+{
+public:
+
+	std::unique_ptr<Texture> LoadTexture(const std::string& path, int tileSize)
+	{
+		std::unique_ptr<Texture> texture(ComponentFactory::Create<Texture>("bitmap.tiled"));
+		const auto node = config.LoadFromStringAndGetFirstChild(boost::str(boost::format(TextureNode_TileSize) % path % tileSize));
+		EXPECT_TRUE(texture->Load(node, assets));
+		return texture;
+	}
+
+	// Read the texel of the tile in the tiled file
+	Math::Vec3 TiledFileTexel(const std::vector<char>& data, size_t offset, int format, int tileSize, int x, int y)
+	{
+		Math::Float v[3];
+		const size_t i = 3 * (tileSize * y + x);
+		for (int c = 0; c < 3; c++)
+		{
+			if (format == 1)
+			{
+				unsigned short h;
+				std::memcpy(&h, &data[offset + 2 * (i + c)], sizeof(h));
+				v[c] = Math::Float(HalfUtils::HalfToFloat(h));
+			}
+			else
+			{
+				v[c] = Math::Float(static_cast<unsigned char>(data[offset + i + c])) / Math::Float(255);
+			}
+		}
+		return Math::Vec3(v[0], v[1], v[2]);
+	}
+
+protected:
+
+	StubAssets assets;
+	StubConfig config;
+
+};
+
+TEST_F(TiledBitmapTextureTest, TiledFile)
+{
+	const int tileSize = 4;
+	for (int format = 0; format < 2; format++)
+	{
+		TemporaryBinaryFile tmp("test." + Extension[format], Images[format].data, Images[format].length);
+		TemporaryTiledFile tiled(tmp.Path());
+		{
+			auto texture = LoadTexture(tmp.Path(), tileSize);
+		}
+
+		std::ifstream ifs(tiled.Path(), std::ios::in | std::ios::binary);
+		ASSERT_TRUE(ifs.is_open());
+		const std::vector<char> data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+		// Header
+		int header[5];
+		ASSERT_LE(8 + sizeof(header), data.size());
+		EXPECT_EQ(0, std::memcmp(&data[0], "LMTILED", 8));
+		std::memcpy(header, &data[8], sizeof(header));
+		EXPECT_EQ(1, header[0]);				// Version
+		EXPECT_EQ(Format[format], header[1]);	// Format
+		EXPECT_EQ(tileSize, header[2]);			// Tile size
+		EXPECT_EQ(0, header[3]);				// Vertical flip
+		EXPECT_EQ(2, header[4]);				// Number of levels
+
+		// Sizes of the levels
+		int sizes[4];
+		std::memcpy(sizes, &data[8 + sizeof(header)], sizeof(sizes));
+		EXPECT_EQ(2, sizes[0]);
+		EXPECT_EQ(2, sizes[1]);
+		EXPECT_EQ(1, sizes[2]);
+		EXPECT_EQ(1, sizes[3]);
+
+		// One tile for each level
+		const size_t dataOffset = 8 + sizeof(header) + sizeof(sizes);
+		const size_t tileBytes = tileSize * tileSize * 3 * (Format[format] == 1 ? 2 : 1);
+		ASSERT_EQ(dataOffset + 2 * tileBytes, data.size());
+
+		// Level 0
+		EXPECT_TRUE(ExpectVec3Near(Math::Vec3(1, 1, 1), TiledFileTexel(data, dataOffset, Format[format], tileSize, 0, 0)));
+		EXPECT_TRUE(ExpectVec3Near(Math::Vec3(1, 0, 0), TiledFileTexel(data, dataOffset, Format[format], tileSize, 1, 0)));
+		EXPECT_TRUE(ExpectVec3Near(Math::Vec3(0, 0, 1), TiledFileTexel(data, dataOffset, Format[format], tileSize, 0, 1)));
+		EXPECT_TRUE(ExpectVec3Near(Math::Vec3(0, 0, 0), TiledFileTexel(data, dataOffset, Format[format], tileSize, 1, 1)));
+
+		// Texels out of the level are filled by the nearest texels on the edge
+		EXPECT_TRUE(ExpectVec3Near(Math::Vec3(1, 0, 0), TiledFileTexel(data, dataOffset, Format[format], tileSize, 3, 0)));
+		EXPECT_TRUE(ExpectVec3Near(Math::Vec3(0, 0, 1), TiledFileTexel(data, dataOffset, Format[format], tileSize, 0, 3)));
+		EXPECT_TRUE(ExpectVec3Near(Math::Vec3(0, 0, 0), TiledFileTexel(data, dataOffset, Format[format], tileSize, 3, 3)));
+
+		// Level 1 is the average of level 0
+		// 8-bit integer texels are quantized
+		const auto eps = Math::Float(1) / Math::Float(255);
+		for (int y = 0; y < tileSize; y++)
+		{
+			for (int x = 0; x < tileSize; x++)
+			{
+				EXPECT_TRUE(ExpectVec3Near(Math::Vec3(Math::Float(0.5), Math::Float(0.25), Math::Float(0.5)), TiledFileTexel(data, dataOffset + tileBytes, Format[format], tileSize, x, y), eps));
+			}
+		}
+	}
+}
+
+TEST_F(TiledBitmapTextureTest, Evaluate)
+{
+	const auto eps = Math::Float(1) / Math::Float(255);
+	const Math::Vec3 average(Math::Float(0.5), Math::Float(0.25), Math::Float(0.5));
+	for (int format = 0; format < 2; format++)
+	{
+		// Tile size of 1 puts the texels of a bilinear footprint into different tiles
+		for (int tileSize : { 1, 4 })
+		{
+			TemporaryBinaryFile tmp("test." + Extension[format], Images[format].data, Images[format].length);
+			TemporaryTiledFile tiled(tmp.Path());
+			auto texture = LoadTexture(tmp.Path(), tileSize);
+
+			// Centers of the texels
+			EXPECT_TRUE(ExpectVec3Near(Math::Vec3(1, 1, 1), texture->Evaluate(Math::Vec2(Math::Float(0.25), Math::Float(0.25))), eps));
+			EXPECT_TRUE(ExpectVec3Near(Math::Vec3(1, 0, 0), texture->Evaluate(Math::Vec2(Math::Float(0.75), Math::Float(0.25))), eps));
+			EXPECT_TRUE(ExpectVec3Near(Math::Vec3(0, 0, 1), texture->Evaluate(Math::Vec2(Math::Float(0.25), Math::Float(0.75))), eps));
+			EXPECT_TRUE(ExpectVec3Near(Math::Vec3(0, 0, 0), texture->Evaluate(Math::Vec2(Math::Float(0.75), Math::Float(0.75))), eps));
+
+			// Bilinear filtering, with 'repeat' texture coordinates
+			EXPECT_TRUE(ExpectVec3Near(average, texture->Evaluate(Math::Vec2(Math::Float(0.5), Math::Float(0.5))), eps));
+			EXPECT_TRUE(ExpectVec3Near(average, texture->Evaluate(Math::Vec2(Math::Float(0), Math::Float(0))), eps));
+			EXPECT_TRUE(ExpectVec3Near(Math::Vec3(1, Math::Float(0.5), Math::Float(0.5)), texture->Evaluate(Math::Vec2(Math::Float(0.5), Math::Float(0.25))), eps));
+
+			texture.reset();
+		}
+	}
+}
+
+TEST_F(TiledBitmapTextureTest, Evaluate_Footprint)
+{
+	const auto eps = Math::Float(1) / Math::Float(255);
+	const Math::Vec3 average(Math::Float(0.5), Math::Float(0.25), Math::Float(0.5));
+	const Math::Vec2 uv(Math::Float(0.25), Math::Float(0.25));
+	for (int format = 0; format < 2; format++)
+	{
+		TemporaryBinaryFile tmp("test." + Extension[format], Images[format].data, Images[format].length);
+		TemporaryTiledFile tiled(tmp.Path());
+		auto texture = LoadTexture(tmp.Path(), 1);
+
+		// Footprint smaller than a texel selects level 0
+		EXPECT_TRUE(ExpectVec3Near(Math::Vec3(1, 1, 1), texture->Evaluate(uv, Math::Float(0))));
+		EXPECT_TRUE(ExpectVec3Near(Math::Vec3(1, 1, 1), texture->Evaluate(uv, Math::Float(0.25)), eps));
+
+		// Footprint of 2 texels selects level 1
+		EXPECT_TRUE(ExpectVec3Near(average, texture->Evaluate(uv, Math::Float(1)), eps));
+
+		// Footprint larger than the image selects the coarsest level
+		EXPECT_TRUE(ExpectVec3Near(average, texture->Evaluate(uv, Math::Float(10)), eps));
+
+		// Intermediate footprint is interpolated between the levels
+		// log2(sqrt(2)) = 0.5
+		const Math::Vec3 mixed(Math::Float(0.75), Math::Float(0.625), Math::Float(0.75));
+		EXPECT_TRUE(ExpectVec3Near(mixed, texture->Evaluate(uv, Math::Sqrt(Math::Float(2)) / Math::Float(2)), eps));
+
+		texture.reset();
+	}
+}
+
+LM_TEST_NAMESPACE_END
+LM_NAMESPACE_END
\ No newline at end of file
@@ -0,0 +1,235 @@
+/*
+	Lightmetrica : A research-oriented renderer
+
+	Copyright (c) 2014 Hisanari Otsu
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.test.h"
+#include <lightmetrica.test/base.h>
+#include <lightmetrica.test/base.math.h>
+#include <lightmetrica.test/testscenes.h>
+#include <lightmetrica.test/testsceneloader.h>
+#include <lightmetrica/confignode.h>
+#include <lightmetrica/ray.h>
+#include <lightmetrica/bpt.subpath.h>
+#include <lightmetrica/bpt.fullpath.h>
+#include <lightmetrica/bpt.pool.h>
+#include <lightmetrica/vcm.utils.h>
+#include <lightmetrica/generalizedbsdf.h>
+#include <lightmetrica/surfacegeometry.h>
+#include <lightmetrica/renderutils.h>
+#include <lightmetrica/configurablesampler.h>
+
+LM_NAMESPACE_BEGIN
+LM_TEST_NAMESPACE_BEGIN
+
+namespace
+{
+
+	/*
+		Reference MIS weights (power heuristics) of the full-path.
+		The connection strategy i samples x_0 ... x_{i-1} from the light and x_i ... x_{n-1} from the eye,
+		and the merging strategy merging x_k samples x_k from both sides with the additional factor \eta.
+		The PDFs are evaluated with the area PDFs of the vertices sampled from the both sides,
+		and the weights of all strategies sum to one.
+		#connectionWeights[i] is the weight of the connection strategy i (i = 0 to n), and
+		#mergingWeights[k] is the weight of the merging strategy merging x_k (zero if x_k cannot be merged).
+	*/
+	void EvaluateReferenceWeights(const BPTFullPath& fullPath, const Math::Float& eta, std::vector<Math::Float>& connectionWeights, std::vector<Math::Float>& mergingWeights)
+	{
+		const int n = fullPath.s + fullPath.t;
+
+		// Area PDFs of x_j sampled from the light (pdfL) and from the eye (pdfE)
+		std::vector<Math::Float> pdfL(n);
+		std::vector<Math::Float> pdfE(n);
+		pdfL[0] = fullPath.FullPathVertex(0)->pdfP.v;
+		for (int j = 1; j < n; j++)
+		{
+			const auto G = RenderUtils::GeneralizedGeometryTerm(fullPath.FullPathVertex(j-1)->geom, fullPath.FullPathVertex(j)->geom);
+			pdfL[j] = fullPath.FullPathVertexDirectionPDF(j-1, TransportDirection::LE).v * G;
+		}
+		pdfE[n-1] = fullPath.FullPathVertex(n-1)->pdfP.v;
+		for (int j = n-2; j >= 0; j--)
+		{
+			const auto G = RenderUtils::GeneralizedGeometryTerm(fullPath.FullPathVertex(j+1)->geom, fullPath.FullPathVertex(j)->geom);
+			pdfE[j] = fullPath.FullPathVertexDirectionPDF(j+1, TransportDirection::EL).v * G;
+		}
+
+		// PDF sampling x_0 ... x_{l-1} from the light and x_e ... x_{n-1} from the eye
+		const auto EvaluatePDF = [&](int l, int e)
+		{
+			Math::Float pdf(1);
+			for (int j = 0; j < l; j++)
+			{
+				pdf *= pdfL[j];
+			}
+			for (int j = e; j < n; j++)
+			{
+				pdf *= pdfE[j];
+			}
+			return pdf;
+		};
+
+		connectionWeights.assign(n + 1, Math::Float(0));
+		mergingWeights.assign(n, Math::Float(0));
+		Math::Float sum(0);
+
+		for (int i = 0; i <= n; i++)
+		{
+			if (!fullPath.FullpathPDFIsZero(i))
+			{
+				const auto pi = EvaluatePDF(i, i);
+				connectionWeights[i] = pi * pi;
+				sum += connectionWeights[i];
+			}
+		}
+
+		// The endpoints cannot be merged
+		for (int k = 1; k < n-1; k++)
+		{
+			if ((fullPath.FullPathVertex(k)->bsdf->BSDFTypes() & GeneralizedBSDFType::NonDelta) != 0)
+			{
+				const auto qk = eta * EvaluatePDF(k + 1, k);
+				mergingWeights[k] = qk * qk;
+				sum += mergingWeights[k];
+			}
+		}
+
+		for (auto& w : connectionWeights)
+		{
+			w /= sum;
+		}
+		for (auto& w : mergingWeights)
+		{
+			w /= sum;
+		}
+	}
+
+}
+
+class VCMUtilsTest : public TestBase {};
+
+// Checks if the MIS weights of the connection and merging strategies
+// are consistent with the power heuristics over all strategies of the full-path.
+// The merging of z_{t-1} is checked with the light vertex which would be obtained
+// by extending the light sub-path y_0 ... y_{s-1} to z_{t-1}, so that the merged full-path
+// is identical to the full-path with the strategy (s,t).
+TEST_F(VCMUtilsTest, MISWeightConsistency)
+{
+	TestSceneLoader loader;
+	ASSERT_TRUE(loader.Load(TestScenes::Simple03()));
+	const auto& scene = loader.GetScene();
+	const auto& assets = loader.GetAssets();
+
+	BPTPathVertexPool pool;
+	BPTSubpath lightSubpath(TransportDirection::LE);
+	BPTSubpath eyeSubpath(TransportDirection::EL);
+
+	std::unique_ptr<ConfigurableSampler> sampler(ComponentFactory::Create<ConfigurableSampler>("random"));
+	ASSERT_TRUE(sampler->Configure(ConfigNode(), assets));
+	sampler->SetSeed(1);
+
+	// Merging radius r = 0.01 with 1000 light sub-paths
+	const Math::Float eta = Math::Constants::Pi() * Math::Float(0.01 * 0.01) * Math::Float(1000);
+
+	std::vector<Math::Float> mergePartialSumsL;
+	std::vector<Math::Float> mergePartialSumsE;
+	std::vector<Math::Float> connectionWeights;
+	std::vector<Math::Float> mergingWeights;
+
+	const int Samples = 1<<12;
+	for (int sample = 0; sample < Samples; sample++)
+	{
+		pool.Release();
+		lightSubpath.Clear();
+		eyeSubpath.Clear();
+		lightSubpath.Sample(scene, *sampler, pool, 3, -1);
+		eyeSubpath.Sample(scene, *sampler, pool, 3, -1);
+		VCMUtils::EvaluateMergePartialSums(lightSubpath, mergePartialSumsL);
+		VCMUtils::EvaluateMergePartialSums(eyeSubpath, mergePartialSumsE);
+
+		const int nL = lightSubpath.NumVertices();
+		const int nE = eyeSubpath.NumVertices();
+		for (int s = 0; s <= nL; s++)
+		{
+			for (int t = 0; t <= nE; t++)
+			{
+				// # of vertices must be no less than 2
+				const int n = s + t;
+				if (n < 2)
+				{
+					continue;
+				}
+
+				BPTFullPath fullpath(s, t, lightSubpath, eyeSubpath);
+
+				// Calculate contribution same as BPT implementation
+				// in order to exclude zero-contribution cases.
+				Math::Vec2 rasterPosition;
+				auto Cstar = fullpath.EvaluateUnweightContribution(scene, rasterPosition);
+				if (Math::IsZero(Cstar))
+				{
+					continue;
+				}
+
+				EvaluateReferenceWeights(fullpath, eta, connectionWeights, mergingWeights);
+
+				// Connection strategy (s,t)
+				const auto connectionWeight = VCMUtils::EvaluateConnectionMISWeight(fullpath, mergePartialSumsL, mergePartialSumsE, eta);
+				auto result = ExpectNear(connectionWeights[s], connectionWeight);
+				EXPECT_TRUE(result);
+				bool failed = !result;
+
+				// Merging strategy merging x_s = z_{t-1}
+				if (s >= 1 && t >= 2 && !Math::IsZero(mergingWeights[s]))
+				{
+					const auto* y = lightSubpath.vertices[s-1];
+					const auto* z = eyeSubpath.vertices[t-1];
+					const auto G = RenderUtils::GeneralizedGeometryTerm(y->geom, z->geom);
+					const auto yPdfD = fullpath.pdfDL[TransportDirection::LE].v;
+					const auto yPdfDRev = fullpath.pdfDL[TransportDirection::EL].v;
+					const auto pdfA = yPdfD * G;
+					ASSERT_FALSE(Math::IsZero(pdfA));
+
+					// Light vertex at z_{t-1} extending the light sub-path (see #BPTSubpath::Sample)
+					VCMLightVertex lightVertex;
+					lightVertex.p = z->geom.p;
+					lightVertex.wi = Math::Normalize(y->geom.p - z->geom.p);
+					lightVertex.misInvPdfSq = Math::Float(1) / (pdfA * pdfA);
+					lightVertex.misPartialSum = (y->misInvPdfSq + yPdfDRev * yPdfDRev * y->misPartialSum) / (yPdfD * yPdfD);
+					const Math::Float m = s >= 2 ? Math::Float(1) : Math::Float(0);
+					lightVertex.misMergePartialSum = (m + yPdfDRev * yPdfDRev * mergePartialSumsL[s-1]) / (yPdfD * yPdfD);
+					lightVertex.numVertices = s + 1;
+
+					const auto mergingWeight = VCMUtils::EvaluateMergingMISWeight(z, mergePartialSumsE[t-1], lightVertex, eta);
+					auto resultMerging = ExpectNear(mergingWeights[s], mergingWeight);
+					EXPECT_TRUE(resultMerging);
+					failed = failed || !resultMerging;
+				}
+
+				if (failed)
+				{
+					LM_LOG_DEBUG("s = " + std::to_string(s));
+					LM_LOG_DEBUG("t = " + std::to_string(t));
+					fullpath.DebugPrint();
+				}
+			}
+		}
+	}
+}
+
+LM_TEST_NAMESPACE_END
+LM_NAMESPACE_END
\ No newline at end of file
@@ -30,8 +30,10 @@
 #include <lightmetrica/camera.h>
 #include <lightmetrica/bitmapfilm.h>
 #include <lightmetrica/light.h>
+#include <lightmetrica/lightselector.h>
 #include <lightmetrica/bsdf.h>
 #include <lightmetrica/texture.h>
+#include <lightmetrica/texturetilecache.h>
 #include <lightmetrica/trianglemesh.h>
 #include <lightmetrica/math.h>
 #include <lightmetrica/fp.h>
@@ -386,6 +388,26 @@ bool LightmetricaApplication::LoadAssets( const Config& config, Assets& assets )
 		assets.RegisterInterface<Light>();
 	}
 	#pragma endregion
+
+	#pragma region Configure texture tile cache
+	{
+		// Memory budget of the tiles of the tiled textures in MB (optional)
+		auto textureCacheNode = config.Root().Child("texture_cache");
+		if (!textureCacheNode.Empty())
+		{
+			int memoryBudget;
+			textureCacheNode.ChildValueOrDefault("memory_budget", 512, memoryBudget);
+			if (memoryBudget <= 0)
+			{
+				LM_LOG_ERROR("Invalid memory budget of texture cache");
+				return false;
+			}
+
+			LM_LOG_INFO("Memory budget of texture cache : " + std::to_string(memoryBudget) + " MB");
+			TextureTileCache::Instance().SetMemoryBudget(static_cast<size_t>(memoryBudget) << 20);
+		}
+	}
+	#pragma endregion
 	
 	#pragma region Load assets
 	{
@@ -437,6 +459,31 @@ bool LightmetricaApplication::LoadAndBuildScene( const Config& config, const Ass
 	}
 	#pragma endregion
 
+	#pragma region Load light selector
+	{
+		// Light selector is optional; the uniform light selector is used by default
+		auto lightSelectorNode = config.Root().Child("scene").Child("light_selector");
+		if (!lightSelectorNode.Empty())
+		{
+			auto lightSelectorType = lightSelectorNode.AttributeValue("type");
+			if (!ComponentFactory::CheckRegistered<LightSelector>(lightSelectorType))
+			{
+				LM_LOG_ERROR("Unsupported light selector type '" + lightSelectorType + "'");
+				return false;
+			}
+
+			LM_LOG_INFO("Light selector type : '" + lightSelectorType + "'");
+			std::unique_ptr<LightSelector> lightSelector(ComponentFactory::Create<LightSelector>(lightSelectorType));
+			if (!lightSelector->Configure(lightSelectorNode, assets))
+			{
+				return false;
+			}
+
+			scene.LoadLightSelector(lightSelector.release());
+		}
+	}
+	#pragma endregion
+
 	#pragma region Configure scene
 	{
 		LM_LOG_INFO("Entering : Scene configuration");